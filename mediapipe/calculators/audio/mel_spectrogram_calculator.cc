@@ -0,0 +1,418 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Defines MelSpectrogramCalculator.
+#include <math.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "audio/dsp/mfcc/mel_filterbank.h"
+#include "audio/dsp/number_util.h"
+#include "audio/dsp/window_functions.h"
+#include "mediapipe/calculators/audio/mel_spectrogram_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/time_series_util.h"
+#include "unsupported/Eigen/FFT"
+
+namespace mediapipe {
+
+namespace {
+
+// Same floor as audio_dsp::Mfcc applies before taking the log.
+constexpr float kFilterbankFloor = 1e-12;
+
+}  // namespace
+
+// MediaPipe Calculator that fuses TimeSeriesFramerCalculator-style framing,
+// windowing, the squared-magnitude DFT of SpectrogramCalculator and the
+// MelSpectrumCalculator / MfccCalculator transforms into one node.
+//
+// Input samples are kept in a ring buffer of one frame per channel. All frames
+// completed by an input packet, across all channels, are gathered into one
+// matrix. Each frame goes through one windowed real FFT, and the mel
+// filterbank and DCT are then applied to all magnitude spectra at once as
+// dense matrix products, so Eigen evaluates them as batched, vectorized GEMMs
+// instead of one filterbank call per channel and frame. Intermediate buffers
+// are sized once and reused; the only per-packet allocation is the output.
+//
+// Framing and output timestamps follow SpectrogramCalculator (with
+// use_local_timestamp false), and the output values match
+// SpectrogramCalculator followed by MelSpectrumCalculator or MfccCalculator.
+//
+// Result is a Matrix with one column per frame (for single channel input and
+// when the allow_multichannel_input flag is false), or a vector of such
+// matrices, one for each channel.
+//
+// Example config:
+// node {
+//   calculator: "MelSpectrogramCalculator"
+//   input_stream: "audio_samples"
+//   output_stream: "mfcc_frames"
+//   options {
+//     [mediapipe.MelSpectrogramCalculatorOptions.ext] {
+//       frame_duration_seconds: 0.025
+//       frame_overlap_seconds: 0.015
+//       output_type: MFCC
+//       mel_spectrum_params {
+//         channel_count: 40
+//         min_frequency_hertz: 125.0
+//         max_frequency_hertz: 7500.0
+//       }
+//       mfcc_count: 13
+//     }
+//   }
+// }
+class MelSpectrogramCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<Matrix>(
+        // Input stream with TimeSeriesHeader.
+    );
+    if (!cc->Options<MelSpectrogramCalculatorOptions>()
+             .allow_multichannel_input()) {
+      cc->Outputs().Index(0).Set<Matrix>(
+          // Mel or MFCC frames with TimeSeriesHeader.
+      );
+    } else {
+      cc->Outputs().Index(0).Set<std::vector<Matrix>>(
+          // Mel or MFCC frames with MultiStreamTimeSeriesHeader.
+      );
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns an error if the options or the input stream header are invalid.
+  absl::Status Open(CalculatorContext* cc) override;
+
+  // Outputs at most one packet holding the features of all frames completed
+  // by the input samples.
+  absl::Status Process(CalculatorContext* cc) override;
+
+  // Pads and processes any remaining samples if pad_final_packet is set.
+  absl::Status Close(CalculatorContext* cc) override;
+
+ private:
+  // Sets up the window, the FFT, the mel weights and the DCT.
+  absl::Status InitializeTransforms(int num_output_channels);
+
+  // Appends the samples of |input| to the ring buffer, copies each completed
+  // frame into frames_, and outputs the features of those frames.
+  absl::Status ProcessSamples(const Matrix& input, CalculatorContext* cc);
+
+  // Copies the frame currently held in the ring buffer to frame slot
+  // |frame_index| of frames_, growing frames_ if needed.
+  void CopyFrameFromRing(int frame_index);
+
+  Timestamp CumulativeOutputTimestamp() const {
+    return initial_input_timestamp_ +
+           round(cumulative_completed_frames_ * frame_step_samples_ *
+                 Timestamp::kTimestampUnitsPerSecond / input_sample_rate_);
+  }
+
+  MelSpectrogramCalculatorOptions options_;
+  double input_sample_rate_;
+  int num_input_channels_;
+  int frame_duration_samples_;
+  int frame_step_samples_;
+  int fft_length_;
+  int num_frequency_bins_;
+  int num_output_channels_;
+
+  Eigen::VectorXf window_;
+  Eigen::FFT<float> fft_;
+  // Windowed frame zero-padded to fft_length_, and its half spectrum.
+  Eigen::VectorXf fft_input_;
+  Eigen::VectorXcf fft_output_;
+  // Mel filterbank applied to the linear magnitude spectrum.
+  Matrix mel_weights_;
+  // DCT-II applied to the log mel spectrum (MFCC only).
+  Matrix dct_;
+
+  // Last frame_duration_samples_ samples of each channel.
+  Matrix ring_;
+  int ring_write_position_;
+  int samples_to_next_frame_;
+
+  // Reused work buffers. Column f * num_input_channels_ + c of frames_ holds
+  // frame f of channel c.
+  Matrix frames_;
+  Matrix magnitudes_;
+  Matrix features_;
+  Matrix log_features_;
+
+  int64 cumulative_input_samples_;
+  int64 cumulative_completed_frames_;
+  Timestamp initial_input_timestamp_;
+};
+REGISTER_CALCULATOR(MelSpectrogramCalculator);
+
+absl::Status MelSpectrogramCalculator::Open(CalculatorContext* cc) {
+  options_ = cc->Options<MelSpectrogramCalculatorOptions>();
+  RET_CHECK_GT(options_.frame_duration_seconds(), 0.0)
+      << "Invalid or missing frame_duration_seconds.";
+  RET_CHECK(options_.frame_overlap_seconds() >= 0.0 &&
+            options_.frame_overlap_seconds() <
+                options_.frame_duration_seconds())
+      << "Invalid frame_overlap_seconds.";
+
+  TimeSeriesHeader input_header;
+  MP_RETURN_IF_ERROR(time_series_util::FillTimeSeriesHeaderIfValid(
+      cc->Inputs().Index(0).Header(), &input_header));
+  input_sample_rate_ = input_header.sample_rate();
+  num_input_channels_ = input_header.num_channels();
+  RET_CHECK(options_.allow_multichannel_input() || num_input_channels_ == 1)
+      << "Multichannel input requires allow_multichannel_input.";
+
+  frame_duration_samples_ =
+      round(options_.frame_duration_seconds() * input_sample_rate_);
+  frame_step_samples_ =
+      frame_duration_samples_ -
+      round(options_.frame_overlap_seconds() * input_sample_rate_);
+  RET_CHECK_GT(frame_step_samples_, 0) << "Frame step must be positive.";
+
+  const int num_output_channels =
+      options_.output_type() == MelSpectrogramCalculatorOptions::MFCC
+          ? options_.mfcc_count()
+          : options_.mel_spectrum_params().channel_count();
+  MP_RETURN_IF_ERROR(InitializeTransforms(num_output_channels));
+
+  auto output_header = absl::make_unique<TimeSeriesHeader>(input_header);
+  output_header->set_audio_sample_rate(input_sample_rate_);
+  output_header->set_num_channels(num_output_channels_);
+  output_header->set_sample_rate(input_sample_rate_ / frame_step_samples_);
+  output_header->clear_packet_rate();
+  output_header->clear_num_samples();
+  if (!options_.allow_multichannel_input()) {
+    cc->Outputs().Index(0).SetHeader(Adopt(output_header.release()));
+  } else {
+    auto multichannel_output_header =
+        absl::make_unique<MultiStreamTimeSeriesHeader>();
+    *multichannel_output_header->mutable_time_series_header() = *output_header;
+    multichannel_output_header->set_num_streams(num_input_channels_);
+    cc->Outputs().Index(0).SetHeader(
+        Adopt(multichannel_output_header.release()));
+  }
+
+  ring_ = Matrix::Zero(num_input_channels_, frame_duration_samples_);
+  ring_write_position_ = 0;
+  samples_to_next_frame_ = frame_duration_samples_;
+  cumulative_input_samples_ = 0;
+  cumulative_completed_frames_ = 0;
+  initial_input_timestamp_ = Timestamp::Unstarted();
+  return absl::OkStatus();
+}
+
+absl::Status MelSpectrogramCalculator::InitializeTransforms(
+    int num_output_channels) {
+  std::vector<double> window;
+  switch (options_.window_type()) {
+    case SpectrogramCalculatorOptions::COSINE:
+      audio_dsp::CosineWindow().GetPeriodicSamples(frame_duration_samples_,
+                                                   &window);
+      break;
+    case SpectrogramCalculatorOptions::HANN:
+      audio_dsp::HannWindow().GetPeriodicSamples(frame_duration_samples_,
+                                                 &window);
+      break;
+    case SpectrogramCalculatorOptions::HAMMING:
+      audio_dsp::HammingWindow().GetPeriodicSamples(frame_duration_samples_,
+                                                    &window);
+      break;
+  }
+
+  window_ = Eigen::Map<const Eigen::VectorXd>(window.data(), window.size())
+                .cast<float>();
+
+  // Zero-padded like audio_dsp::Spectrogram. Only the non-redundant half of
+  // the spectrum of the real frame is computed.
+  fft_length_ = audio_dsp::NextPowerOfTwo(frame_duration_samples_);
+  num_frequency_bins_ = fft_length_ / 2 + 1;
+  fft_.SetFlag(Eigen::FFT<float>::HalfSpectrum);
+  fft_input_ = Eigen::VectorXf::Zero(fft_length_);
+  fft_output_.resize(fft_length_);
+
+  // audio_dsp::MelFilterbank sums square roots of its squared-magnitude input
+  // with fixed triangular weights, so probing it with unit vectors yields the
+  // weight matrix to apply to linear magnitudes.
+  const auto& mel_params = options_.mel_spectrum_params();
+  audio_dsp::MelFilterbank mel_filterbank;
+  if (!mel_filterbank.Initialize(
+          num_frequency_bins_, input_sample_rate_, mel_params.channel_count(),
+          mel_params.min_frequency_hertz(), mel_params.max_frequency_hertz())) {
+    return absl::InternalError("MelFilterbank::Initialize failed.");
+  }
+  mel_weights_.resize(mel_params.channel_count(), num_frequency_bins_);
+  std::vector<double> probe(num_frequency_bins_, 0.0);
+  std::vector<double> response;
+  for (int i = 0; i < num_frequency_bins_; ++i) {
+    probe[i] = 1.0;
+    mel_filterbank.Compute(probe, &response);
+    probe[i] = 0.0;
+    for (int j = 0; j < mel_params.channel_count(); ++j) {
+      mel_weights_(j, i) = response[j];
+    }
+  }
+
+  if (options_.output_type() == MelSpectrogramCalculatorOptions::MFCC) {
+    const int num_mel_channels = mel_params.channel_count();
+    if (num_output_channels > num_mel_channels) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("mfcc_count (", num_output_channels,
+                       ") exceeds the mel channel_count (", num_mel_channels,
+                       ")."));
+    }
+    // Same DCT-II as audio_dsp::MfccDct.
+    dct_.resize(num_output_channels, num_mel_channels);
+    const double fnorm = sqrt(2.0 / num_mel_channels);
+    const double arg = M_PI / num_mel_channels;
+    for (int i = 0; i < num_output_channels; ++i) {
+      for (int j = 0; j < num_mel_channels; ++j) {
+        dct_(i, j) = fnorm * cos(i * arg * (j + 0.5));
+      }
+    }
+  }
+  num_output_channels_ = num_output_channels;
+  return absl::OkStatus();
+}
+
+void MelSpectrogramCalculator::CopyFrameFromRing(int frame_index) {
+  const int first_column = frame_index * num_input_channels_;
+  if (frames_.cols() < first_column + num_input_channels_) {
+    // Amortized growth; the buffer settles at the largest packet size.
+    frames_.conservativeResize(
+        frame_duration_samples_,
+        std::max<int>(2 * frames_.cols(), first_column + num_input_channels_));
+  }
+  // The oldest sample sits at the write position.
+  const int tail_length = frame_duration_samples_ - ring_write_position_;
+  for (int c = 0; c < num_input_channels_; ++c) {
+    auto frame = frames_.col(first_column + c);
+    frame.head(tail_length) =
+        ring_.row(c).segment(ring_write_position_, tail_length).transpose();
+    frame.tail(ring_write_position_) =
+        ring_.row(c).head(ring_write_position_).transpose();
+  }
+}
+
+absl::Status MelSpectrogramCalculator::ProcessSamples(const Matrix& input,
+                                                      CalculatorContext* cc) {
+  RET_CHECK_EQ(input.rows(), num_input_channels_)
+      << "Unexpected number of input channels.";
+  const int num_samples = input.cols();
+  int num_frames = 0;
+  int consumed = 0;
+  while (consumed < num_samples) {
+    const int chunk = std::min({num_samples - consumed,
+                                frame_duration_samples_ - ring_write_position_,
+                                samples_to_next_frame_});
+    ring_.middleCols(ring_write_position_, chunk) =
+        input.middleCols(consumed, chunk);
+    consumed += chunk;
+    ring_write_position_ = (ring_write_position_ + chunk) %
+                           frame_duration_samples_;
+    samples_to_next_frame_ -= chunk;
+    if (samples_to_next_frame_ == 0) {
+      CopyFrameFromRing(num_frames++);
+      samples_to_next_frame_ = frame_step_samples_;
+    }
+  }
+  if (num_frames == 0) {
+    return absl::OkStatus();
+  }
+
+  const int num_columns = num_frames * num_input_channels_;
+  if (magnitudes_.cols() < num_columns) {
+    magnitudes_.resize(num_frequency_bins_, frames_.cols());
+    features_.resize(mel_weights_.rows(), frames_.cols());
+    if (dct_.size() > 0) {
+      log_features_.resize(mel_weights_.rows(), frames_.cols());
+    }
+  }
+  for (int i = 0; i < num_columns; ++i) {
+    fft_input_.head(frame_duration_samples_) =
+        frames_.col(i).cwiseProduct(window_);
+    fft_.fwd(fft_output_.data(), fft_input_.data(), fft_length_);
+    magnitudes_.col(i) = fft_output_.head(num_frequency_bins_).cwiseAbs();
+  }
+  features_.leftCols(num_columns).noalias() =
+      mel_weights_ * magnitudes_.leftCols(num_columns);
+
+  std::unique_ptr<Matrix> output;
+  if (dct_.size() > 0) {
+    log_features_.leftCols(num_columns) =
+        features_.leftCols(num_columns).array().max(kFilterbankFloor).log();
+    output = absl::make_unique<Matrix>(num_output_channels_, num_columns);
+    output->noalias() = dct_ * log_features_.leftCols(num_columns);
+  } else {
+    output = absl::make_unique<Matrix>(features_.leftCols(num_columns));
+  }
+
+  const Timestamp output_timestamp = CumulativeOutputTimestamp();
+  if (!options_.allow_multichannel_input()) {
+    cc->Outputs().Index(0).Add(output.release(), output_timestamp);
+  } else {
+    // Columns of |output| interleave channels; split them per channel.
+    auto output_vector = absl::make_unique<std::vector<Matrix>>();
+    output_vector->reserve(num_input_channels_);
+    for (int c = 0; c < num_input_channels_; ++c) {
+      output_vector->emplace_back(
+          Eigen::Map<const Matrix, 0, Eigen::OuterStride<>>(
+              output->data() + c * num_output_channels_, num_output_channels_,
+              num_frames,
+              Eigen::OuterStride<>(num_output_channels_ *
+                                   num_input_channels_)));
+    }
+    cc->Outputs().Index(0).Add(output_vector.release(), output_timestamp);
+  }
+  cumulative_completed_frames_ += num_frames;
+  cc->Outputs().Index(0).SetNextTimestampBound(CumulativeOutputTimestamp());
+  return absl::OkStatus();
+}
+
+absl::Status MelSpectrogramCalculator::Process(CalculatorContext* cc) {
+  if (initial_input_timestamp_ == Timestamp::Unstarted()) {
+    initial_input_timestamp_ = cc->InputTimestamp();
+  }
+  const Matrix& input = cc->Inputs().Index(0).Get<Matrix>();
+  cumulative_input_samples_ += input.cols();
+  return ProcessSamples(input, cc);
+}
+
+absl::Status MelSpectrogramCalculator::Close(CalculatorContext* cc) {
+  if (cumulative_input_samples_ > 0 && options_.pad_final_packet()) {
+    // Same padding as SpectrogramCalculator: flush with frame_step - 1 zeros,
+    // or complete the first frame if no frame was emitted yet.
+    int required_padding_samples = frame_step_samples_ - 1;
+    if (cumulative_input_samples_ < frame_duration_samples_) {
+      required_padding_samples =
+          frame_duration_samples_ - cumulative_input_samples_;
+    }
+    return ProcessSamples(
+        Matrix::Zero(num_input_channels_, required_padding_samples), cc);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
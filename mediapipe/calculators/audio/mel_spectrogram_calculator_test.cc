@@ -0,0 +1,209 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/memory/memory.h"
+#include "absl/strings/substitute.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+const double kSampleRate = 16000.0;
+const int kNumPackets = 7;
+// Not a multiple of the frame step, so frames straddle input packets.
+const int kSamplesPerPacket = 1234;
+
+constexpr char kFramingOptions[] =
+    "frame_duration_seconds: 0.025 frame_overlap_seconds: 0.015";
+// Frames of 4800 samples, transformed with 8192-point FFTs.
+constexpr char kLongFramingOptions[] =
+    "frame_duration_seconds: 0.3 frame_overlap_seconds: 0.2";
+
+void FillInputs(int num_channels, CalculatorRunner* runner) {
+  auto header = absl::make_unique<TimeSeriesHeader>();
+  header->set_sample_rate(kSampleRate);
+  header->set_num_channels(num_channels);
+  runner->MutableInputs()->Index(0).header = Adopt(header.release());
+  for (int i = 0; i < kNumPackets; ++i) {
+    const int64 timestamp = i * kSamplesPerPacket *
+                            Timestamp::kTimestampUnitsPerSecond / kSampleRate;
+    runner->MutableInputs()->Index(0).packets.push_back(
+        MakePacket<Matrix>(Matrix::Random(num_channels, kSamplesPerPacket))
+            .At(Timestamp(timestamp)));
+  }
+}
+
+// Runs SpectrogramCalculator followed by |transform_calculator| and returns the
+// output packets of the latter.
+std::vector<Packet> RunReferencePipeline(
+    const std::string& framing_options,
+    const std::string& transform_calculator,
+    const std::string& transform_options) {
+  CalculatorRunner spectrogram(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          R"pb(
+            calculator: "SpectrogramCalculator"
+            input_stream: "input"
+            output_stream: "output"
+            options { [mediapipe.SpectrogramCalculatorOptions.ext] { $0 } }
+          )pb",
+          framing_options)));
+  FillInputs(/*num_channels=*/1, &spectrogram);
+  MP_EXPECT_OK(spectrogram.Run());
+
+  CalculatorRunner transform(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          R"pb(
+            calculator: "$0"
+            input_stream: "input"
+            output_stream: "output"
+            options { $1 }
+          )pb",
+          transform_calculator, transform_options)));
+  transform.MutableInputs()->Index(0) = spectrogram.Outputs().Index(0);
+  MP_EXPECT_OK(transform.Run());
+  return transform.Outputs().Index(0).packets;
+}
+
+std::unique_ptr<CalculatorRunner> MakeMelSpectrogramRunner(
+    const std::string& framing_options, const std::string& extra_options) {
+  return absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          R"pb(
+            calculator: "MelSpectrogramCalculator"
+            input_stream: "input"
+            output_stream: "output"
+            options {
+              [mediapipe.MelSpectrogramCalculatorOptions.ext] {
+                $0
+                mel_spectrum_params { channel_count: 20 }
+                $1
+              }
+            }
+          )pb",
+          framing_options, extra_options)));
+}
+
+void ExpectSamePackets(const std::vector<Packet>& expected,
+                       const std::vector<Packet>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].Timestamp(), actual[i].Timestamp());
+    const Matrix& expected_matrix = expected[i].Get<Matrix>();
+    const Matrix& actual_matrix = actual[i].Get<Matrix>();
+    ASSERT_EQ(expected_matrix.rows(), actual_matrix.rows());
+    ASSERT_EQ(expected_matrix.cols(), actual_matrix.cols());
+    EXPECT_TRUE(actual_matrix.isApprox(expected_matrix, 1e-3))
+        << "Packet " << i << " differs.";
+  }
+}
+
+TEST(MelSpectrogramCalculatorTest, MatchesSpectrogramAndMelSpectrum) {
+  const std::vector<Packet> expected = RunReferencePipeline(
+      kFramingOptions, "MelSpectrumCalculator",
+      "[mediapipe.MelSpectrumCalculatorOptions.ext] { channel_count: 20 }");
+
+  auto runner = MakeMelSpectrogramRunner(kFramingOptions, "");
+  FillInputs(/*num_channels=*/1, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  EXPECT_EQ(runner->Outputs()
+                .Index(0)
+                .header.Get<TimeSeriesHeader>()
+                .num_channels(),
+            20);
+  ExpectSamePackets(expected, runner->Outputs().Index(0).packets);
+}
+
+TEST(MelSpectrogramCalculatorTest, MatchesSpectrogramAndMfcc) {
+  const std::vector<Packet> expected =
+      RunReferencePipeline(kFramingOptions, "MfccCalculator",
+                           "[mediapipe.MfccCalculatorOptions.ext] { "
+                           "mel_spectrum_params { channel_count: 20 } "
+                           "mfcc_count: 13 }");
+
+  auto runner = MakeMelSpectrogramRunner(kFramingOptions,
+                                         "output_type: MFCC mfcc_count: 13");
+  FillInputs(/*num_channels=*/1, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  ExpectSamePackets(expected, runner->Outputs().Index(0).packets);
+}
+
+TEST(MelSpectrogramCalculatorTest, MatchesSpectrogramAndMfccWithLongFrames) {
+  const std::vector<Packet> expected =
+      RunReferencePipeline(kLongFramingOptions, "MfccCalculator",
+                           "[mediapipe.MfccCalculatorOptions.ext] { "
+                           "mel_spectrum_params { channel_count: 20 } "
+                           "mfcc_count: 13 }");
+  ASSERT_FALSE(expected.empty());
+
+  auto runner = MakeMelSpectrogramRunner(kLongFramingOptions,
+                                         "output_type: MFCC mfcc_count: 13");
+  FillInputs(/*num_channels=*/1, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  ExpectSamePackets(expected, runner->Outputs().Index(0).packets);
+}
+
+TEST(MelSpectrogramCalculatorTest, ProcessesChannelsIndependently) {
+  auto runner = MakeMelSpectrogramRunner(kFramingOptions,
+                                         "allow_multichannel_input: true");
+  FillInputs(/*num_channels=*/3, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  // Feed each channel separately and compare.
+  const auto& multichannel_packets = runner->Outputs().Index(0).packets;
+  for (int channel = 0; channel < 3; ++channel) {
+    auto mono_runner = MakeMelSpectrogramRunner(kFramingOptions, "");
+    auto header = absl::make_unique<TimeSeriesHeader>();
+    header->set_sample_rate(kSampleRate);
+    header->set_num_channels(1);
+    mono_runner->MutableInputs()->Index(0).header = Adopt(header.release());
+    for (const Packet& packet :
+         runner->MutableInputs()->Index(0).packets) {
+      mono_runner->MutableInputs()->Index(0).packets.push_back(
+          MakePacket<Matrix>(packet.Get<Matrix>().row(channel))
+              .At(packet.Timestamp()));
+    }
+    MP_ASSERT_OK(mono_runner->Run());
+    const auto& mono_packets = mono_runner->Outputs().Index(0).packets;
+    ASSERT_EQ(mono_packets.size(), multichannel_packets.size());
+    for (int i = 0; i < mono_packets.size(); ++i) {
+      EXPECT_TRUE(multichannel_packets[i]
+                      .Get<std::vector<Matrix>>()[channel]
+                      .isApprox(mono_packets[i].Get<Matrix>(), 1e-5));
+    }
+  }
+}
+
+TEST(MelSpectrogramCalculatorTest, RejectsTooManyMfccCoefficients) {
+  auto runner = MakeMelSpectrogramRunner(kFramingOptions,
+                                         "output_type: MFCC mfcc_count: 21");
+  FillInputs(/*num_channels=*/1, runner.get());
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -21,13 +21,13 @@
 
 #include "Eigen/Core"
 #include "absl/strings/str_cat.h"
-#include "audio/dsp/resampler.h"
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
+#include "mediapipe/util/polyphase_resampler.h"
 #include "mediapipe/util/time_series_util.h"
 
 namespace mediapipe {
@@ -37,8 +37,19 @@ namespace mediapipe {
 // RationalFactorResampleCalculatorOptions.  The output time series may have
 // a varying number of samples per frame.
 //
-// NOTE: This calculator uses QResampler, despite the name, which supersedes
-// RationalFactorResampler.
+// All channels are resampled together by a single PolyphaseResampler, which
+// filters the channel matrix directly and keeps its history between packets.
+// The filter parameters follow QResampler, which superseded
+// RationalFactorResampler despite the name of this calculator.
+//
+// The resampling factor is target_sample_rate / source_sample_rate as a
+// fraction L / M with M at most 2000. For N input frames, the output has
+// exactly ceil(N * L / M) frames in total, where output frame n is the input
+// signal at time n * M / L and Close() flushes the frames the filter delay
+// held back. Packets in the middle of the stream may be shorter than
+// N * L / M by up to the filter delay. The former per-channel QResampler
+// path also emitted up to a filter radius of trailing frames of the flushed
+// silence, which are no longer output.
 class RationalFactorResampleCalculator : public CalculatorBase {
  public:
   struct TestAccess;
@@ -63,14 +74,13 @@ class RationalFactorResampleCalculator : public CalculatorBase {
   absl::Status Close(CalculatorContext* cc) override;
 
  protected:
-  typedef audio_dsp::Resampler<float> ResamplerType;
-
-  // Returns a Resampler<float> implementation specified by the
-  // RationalFactorResampleCalculatorOptions proto. Returns null if the options
-  // specify an invalid resampler.
-  static std::unique_ptr<ResamplerType> ResamplerFromOptions(
-      const double source_sample_rate, const double target_sample_rate,
-      const RationalFactorResampleCalculatorOptions& options);
+  // Returns a resampler for num_channels channels as specified by the
+  // RationalFactorResampleCalculatorOptions proto. Returns an error if the
+  // options specify an invalid resampler.
+  static absl::StatusOr<std::unique_ptr<PolyphaseResampler>>
+  ResamplerFromOptions(const double source_sample_rate,
+                       const double target_sample_rate, int num_channels,
+                       const RationalFactorResampleCalculatorOptions& options);
 
   // Does Timestamp bookkeeping and resampling common to Process() and
   // Close().  Returns FAIL if the resampler state becomes
@@ -78,12 +88,6 @@ class RationalFactorResampleCalculator : public CalculatorBase {
   absl::Status ProcessInternal(const Matrix& input_frame, bool should_flush,
                                CalculatorContext* cc);
 
-  // Uses the internal resampler_ objects to actually resample each
-  // row of the input TimeSeries.  Returns false if the resampler
-  // state becomes inconsistent.
-  bool Resample(const Matrix& input_frame, Matrix* output_frame,
-                bool should_flush);
-
   double source_sample_rate_;
   double target_sample_rate_;
   int64 cumulative_input_samples_;
@@ -91,16 +95,18 @@ class RationalFactorResampleCalculator : public CalculatorBase {
   Timestamp initial_timestamp_;
   bool check_inconsistent_timestamps_;
   int num_channels_;
-  std::vector<std::unique_ptr<ResamplerType>> resampler_;
+  // Null for pass-through, when the sample rates are equal.
+  std::unique_ptr<PolyphaseResampler> resampler_;
 };
 
 // Test-only access to RationalFactorResampleCalculator methods.
 struct RationalFactorResampleCalculator::TestAccess {
-  static std::unique_ptr<ResamplerType> ResamplerFromOptions(
-      const double source_sample_rate, const double target_sample_rate,
-      const RationalFactorResampleCalculatorOptions& options) {
+  static absl::StatusOr<std::unique_ptr<PolyphaseResampler>>
+  ResamplerFromOptions(const double source_sample_rate,
+                       const double target_sample_rate, int num_channels,
+                       const RationalFactorResampleCalculatorOptions& options) {
     return RationalFactorResampleCalculator::ResamplerFromOptions(
-        source_sample_rate, target_sample_rate, options);
+        source_sample_rate, target_sample_rate, num_channels, options);
   }
 };
 
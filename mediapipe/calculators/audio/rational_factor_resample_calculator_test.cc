@@ -17,11 +17,12 @@
 #include <math.h>
 
 #include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 
 #include "Eigen/Core"
-#include "audio/dsp/signal_vector_util.h"
+#include "audio/dsp/resampler_q.h"
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.pb.h"
 #include "mediapipe/framework//tool/validate_type.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -30,7 +31,9 @@
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/util/time_series_test_util.h"
 
 namespace mediapipe {
@@ -61,6 +64,21 @@ class RationalFactorResampleCalculatorTest
     }
   }
 
+  // Expects the elements of actual to match the first elements of expected,
+  // up to float rounding relative to the largest expected magnitude.
+  void ExpectVectorPrefixNear(const std::vector<float>& expected,
+                              const std::vector<float>& actual) {
+    ASSERT_LE(actual.size(), expected.size());
+    float max_magnitude = 0.0f;
+    for (float value : expected) {
+      max_magnitude = std::max(max_magnitude, std::abs(value));
+    }
+    for (int i = 0; i < actual.size(); ++i) {
+      EXPECT_NEAR(expected[i], actual[i], 1e-5 * max_magnitude)
+          << " where i=" << i << ".";
+    }
+  }
+
   // Returns a float value with the sample, channel, and timestamp
   // separated by a few orders of magnitude, for easy parsing by
   // humans.
@@ -110,19 +128,26 @@ class RationalFactorResampleCalculatorTest
     return RunGraph();
   }
 
+  // Checks the frame count contract of the calculator: ceil(N * L / M)
+  // output frames in total for N input frames and the factor L / M.
   void CheckOutputLength(double output_sample_rate) {
-    double factor = output_sample_rate / input_sample_rate_;
+    auto status_or_resampler =
+        RationalFactorResampleCalculator::TestAccess::ResamplerFromOptions(
+            input_sample_rate_, output_sample_rate, num_input_channels_,
+            options_);
+    MP_ASSERT_OK(status_or_resampler);
+    const PolyphaseResampler& resampler = *status_or_resampler.value();
+    const int64 factor_numerator = resampler.factor_numerator();
+    const int64 factor_denominator = resampler.factor_denominator();
 
     int num_output_samples = 0;
     for (const Packet& packet : output().packets) {
       num_output_samples += packet.Get<Matrix>().cols();
     }
 
-    // The exact number of expected samples may vary based on the implementation
-    // of the resampler since the exact value is not an integer.
-    const double expected_num_output_samples = num_input_samples_ * factor;
-    EXPECT_LE(ceil(expected_num_output_samples), num_output_samples);
-    EXPECT_GE(ceil(expected_num_output_samples) + 11, num_output_samples);
+    EXPECT_EQ((num_input_samples_ * factor_numerator + factor_denominator - 1) /
+                  factor_denominator,
+              num_output_samples);
   }
 
   // Checks that output timestamps are consistent with the
@@ -138,25 +163,46 @@ class RationalFactorResampleCalculatorTest
     }
   }
 
-  // Checks that output values from the calculator (which resamples
-  // packet-by-packet) are consistent with resampling the entire
-  // signal at once.
+  // Checks that output values from the calculator (which resamples all
+  // channels together, packet-by-packet) are the same as resampling each
+  // entire channel at once with QResampler, as the calculator used to. The
+  // QResampler output may have a few more trailing frames; see
+  // CheckOutputLength for the calculator's frame count.
   void CheckOutputValues(double output_sample_rate) {
+    // The same conversion of the options as in ResamplerFromOptions.
+    audio_dsp::QResamplerParams params;
+    const auto& rational_factor_options =
+        options_.resampler_rational_factor_options();
+    if (rational_factor_options.has_radius() &&
+        rational_factor_options.has_cutoff() &&
+        rational_factor_options.has_kaiser_beta()) {
+      params.filter_radius_factor =
+          rational_factor_options.radius() *
+          std::min(1.0, output_sample_rate / input_sample_rate_);
+      params.cutoff_proportion =
+          2 * rational_factor_options.cutoff() /
+          std::min(input_sample_rate_, output_sample_rate);
+      params.kaiser_beta = rational_factor_options.kaiser_beta();
+    }
+    params.max_denominator = 2000;
+
     for (int i = 0; i < num_input_channels_; ++i) {
-      auto verification_resampler =
-          RationalFactorResampleCalculator::TestAccess::ResamplerFromOptions(
-              input_sample_rate_, output_sample_rate, options_);
+      audio_dsp::QResampler<float> verification_resampler(
+          input_sample_rate_, output_sample_rate, /*num_channels=*/1, params);
+      ASSERT_TRUE(verification_resampler.Valid());
 
       std::vector<float> input_data;
       for (int j = 0; j < num_input_samples_; ++j) {
         input_data.push_back(concatenated_input_samples_(i, j));
       }
-      std::vector<float> expected_resampled_data;
+      std::vector<float> expected_channel_data;
       std::vector<float> temp;
-      verification_resampler->ProcessSamples(input_data, &temp);
-      audio_dsp::VectorAppend(&expected_resampled_data, temp);
-      verification_resampler->Flush(&temp);
-      audio_dsp::VectorAppend(&expected_resampled_data, temp);
+      verification_resampler.ProcessSamples(input_data, &temp);
+      expected_channel_data.insert(expected_channel_data.end(), temp.begin(),
+                                   temp.end());
+      verification_resampler.Flush(&temp);
+      expected_channel_data.insert(expected_channel_data.end(), temp.begin(),
+                                   temp.end());
       std::vector<float> actual_resampled_data;
       for (const Packet& packet : output().packets) {
         Matrix output_frame_row = packet.Get<Matrix>().row(i);
@@ -165,7 +211,7 @@ class RationalFactorResampleCalculatorTest
             &output_frame_row(0) + output_frame_row.cols());
       }
 
-      ExpectVectorMostlyFloatEq(expected_resampled_data, actual_resampled_data);
+      ExpectVectorPrefixNear(expected_channel_data, actual_resampled_data);
     }
   }
 
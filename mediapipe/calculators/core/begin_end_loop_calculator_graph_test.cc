@@ -444,5 +444,55 @@ TEST_F(BeginEndLoopCalculatorGraphWithClonedInputsTest, MultipleVectors) {
                   PacketOfIntsEq(input_timestamp2, std::vector<int>{6, 9})));
 }
 
+TEST(BeginEndLoopCalculatorAliasingTest, ItemsPointIntoIterable) {
+  auto graph_config = ParseTextProtoOrDie<CalculatorGraphConfig>(
+      R"pb(
+        input_stream: "ints"
+        node {
+          calculator: "BeginLoopIntegerCalculator"
+          input_stream: "ITERABLE:ints"
+          output_stream: "ITEM:int"
+          output_stream: "BATCH_END:timestamp"
+          options {
+            [mediapipe.BeginLoopCalculatorOptions.ext] { alias_items: true }
+          }
+        }
+        node {
+          calculator: "IncrementCalculator"
+          input_stream: "int"
+          output_stream: "int_plus_one"
+        }
+        node {
+          calculator: "EndLoopIntegersCalculator"
+          input_stream: "ITEM:int_plus_one"
+          input_stream: "BATCH_END:timestamp"
+          output_stream: "ITERABLE:ints_plus_one"
+        }
+      )pb");
+  std::vector<Packet> item_packets;
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("int", &graph_config, &item_packets);
+  tool::AddVectorSink("ints_plus_one", &graph_config, &output_packets);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(graph_config));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  Packet ints =
+      MakePacket<std::vector<int>>(std::vector<int>{0, 1, 2}).At(Timestamp(0));
+  MP_ASSERT_OK(graph.AddPacketToInputStream("ints", ints));
+  MP_ASSERT_OK(graph.CloseAllPacketSources());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  EXPECT_THAT(output_packets,
+              testing::ElementsAre(
+                  PacketOfIntsEq(Timestamp(0), std::vector<int>{1, 2, 3})));
+  const std::vector<int>& values = ints.Get<std::vector<int>>();
+  ASSERT_EQ(3, item_packets.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(&values[i], &item_packets[i].Get<int>());
+    EXPECT_EQ(Timestamp(i), item_packets[i].Timestamp());
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -15,7 +15,11 @@
 #ifndef MEDIAPIPE_CALCULATORS_CORE_BEGIN_LOOP_CALCULATOR_H_
 #define MEDIAPIPE_CALCULATORS_CORE_BEGIN_LOOP_CALCULATOR_H_
 
+#include <type_traits>
+#include <utility>
+
 #include "absl/memory/memory.h"
+#include "mediapipe/calculators/core/begin_loop_calculator.pb.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_contract.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -56,6 +60,18 @@ namespace mediapipe {
 // streams at loop timestamps. This ensures that a MediaPipe graph or sub-graph
 // can run multiple times, once per element in the "ITERABLE" for each pakcet
 // clone of the packets in the "CLONE" input streams.
+//
+// With the alias_items option, ITEM packets point to the elements inside the
+// ITERABLE packet instead of holding copies, which avoids copying large
+// elements such as landmark lists:
+//
+// node {
+//   calculator:    "BeginLoopNormalizedLandmarkListVectorCalculator"
+//   ...
+//   options {
+//     [mediapipe.BeginLoopCalculatorOptions.ext] { alias_items: true }
+//   }
+// }
 template <typename IterableT>
 class BeginLoopCalculator : public CalculatorBase {
   using ItemT = typename IterableT::value_type;
@@ -109,14 +125,32 @@ class BeginLoopCalculator : public CalculatorBase {
     return absl::OkStatus();
   }
 
+  absl::Status Open(CalculatorContext* cc) final {
+    alias_items_ =
+        cc->Options<::mediapipe::BeginLoopCalculatorOptions>().alias_items();
+    RET_CHECK(!alias_items_ || kItemsAreAddressable)
+        << "alias_items requires a collection that stores its elements, "
+           "unlike std::vector<bool>.";
+    // Stream ids are looked up once, rather than by tag for every element.
+    iterable_id_ = cc->Inputs().GetId("ITERABLE", 0);
+    item_id_ = cc->Outputs().GetId("ITEM", 0);
+    batch_end_id_ = cc->Outputs().GetId("BATCH_END", 0);
+    num_clones_ = cc->Inputs().NumEntries("CLONE");
+    if (num_clones_ > 0) {
+      input_clone_id_ = cc->Inputs().BeginId("CLONE");
+      output_clone_id_ = cc->Outputs().BeginId("CLONE");
+    }
+    return absl::OkStatus();
+  }
+
   absl::Status Process(CalculatorContext* cc) final {
     Timestamp last_timestamp = loop_internal_timestamp_;
-    if (!cc->Inputs().Tag("ITERABLE").IsEmpty()) {
-      const IterableT& collection =
-          cc->Inputs().Tag("ITERABLE").template Get<IterableT>();
-      for (const auto& item : collection) {
-        cc->Outputs().Tag("ITEM").AddPacket(
-            MakePacket<ItemT>(item).At(loop_internal_timestamp_));
+    const Packet& iterable_packet = cc->Inputs().Get(iterable_id_).Value();
+    if (!iterable_packet.IsEmpty()) {
+      OutputStreamShard& item_output = cc->Outputs().Get(item_id_);
+      for (const auto& item : iterable_packet.Get<IterableT>()) {
+        item_output.AddPacket(MakeItemPacket(item, iterable_packet)
+                                  .At(loop_internal_timestamp_));
         ForwardClonePackets(cc, loop_internal_timestamp_);
         ++loop_internal_timestamp_;
       }
@@ -135,7 +169,7 @@ class BeginLoopCalculator : public CalculatorBase {
     // loop_internal_timestamp_. To emit BATCH_END packet along the last
     // non-BATCH_END packet, decrement by one.
     cc->Outputs()
-        .Tag("BATCH_END")
+        .Get(batch_end_id_)
         .AddPacket(MakePacket<Timestamp>(cc->InputTimestamp())
                        .At(Timestamp(loop_internal_timestamp_ - 1)));
 
@@ -143,19 +177,39 @@ class BeginLoopCalculator : public CalculatorBase {
   }
 
  private:
+  // Whether iterating the collection yields references to its elements, which
+  // ITEM packets can point to.
+  static constexpr bool kItemsAreAddressable =
+      std::is_same<decltype(*std::declval<const IterableT&>().begin()),
+                   const ItemT&>::value;
+
+  Packet MakeItemPacket(const ItemT& item, const Packet& iterable_packet) {
+    if (alias_items_) {
+      return PointIntoPacket(&item, iterable_packet);
+    }
+    return MakePacket<ItemT>(item);
+  }
+
   void ForwardClonePackets(CalculatorContext* cc, Timestamp output_timestamp) {
-    if (cc->Inputs().NumEntries("CLONE") > 0) {
-      for (int i = 0; i < cc->Inputs().NumEntries("CLONE"); ++i) {
-        if (!cc->Inputs().Get("CLONE", i).IsEmpty()) {
-          auto input_packet = cc->Inputs().Get("CLONE", i).Value();
-          cc->Outputs()
-              .Get("CLONE", i)
-              .AddPacket(std::move(input_packet).At(output_timestamp));
-        }
+    for (int i = 0; i < num_clones_; ++i) {
+      const Packet& input_packet =
+          cc->Inputs().Get(input_clone_id_ + i).Value();
+      if (!input_packet.IsEmpty()) {
+        cc->Outputs()
+            .Get(output_clone_id_ + i)
+            .AddPacket(input_packet.At(output_timestamp));
       }
     }
   }
 
+  bool alias_items_ = false;
+  CollectionItemId iterable_id_;
+  CollectionItemId item_id_;
+  CollectionItemId batch_end_id_;
+  int num_clones_ = 0;
+  CollectionItemId input_clone_id_;
+  CollectionItemId output_clone_id_;
+
   // Fake timestamps generated per element in collection.
   Timestamp loop_internal_timestamp_ = Timestamp(0);
 };
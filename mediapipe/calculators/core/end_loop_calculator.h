@@ -70,27 +70,38 @@ class EndLoopCalculator : public CalculatorBase {
     return absl::OkStatus();
   }
 
+  absl::Status Open(CalculatorContext* cc) override {
+    item_id_ = cc->Inputs().GetId("ITEM", 0);
+    batch_end_id_ = cc->Inputs().GetId("BATCH_END", 0);
+    iterable_id_ = cc->Outputs().GetId("ITERABLE", 0);
+    return absl::OkStatus();
+  }
+
   absl::Status Process(CalculatorContext* cc) override {
-    if (!cc->Inputs().Tag("ITEM").IsEmpty()) {
+    Packet& item_packet = cc->Inputs().Get(item_id_).Value();
+    if (!item_packet.IsEmpty()) {
       if (!input_stream_collection_) {
         input_stream_collection_.reset(new IterableT);
       }
-      input_stream_collection_->push_back(
-          cc->Inputs().Tag("ITEM").template Get<ItemT>());
+      // Moves the element if this calculator holds the only reference to it,
+      // e.g. when it was produced by the loop body, and copies it otherwise.
+      ASSIGN_OR_RETURN(std::unique_ptr<ItemT> item,
+                       item_packet.ConsumeOrCopy<ItemT>());
+      input_stream_collection_->push_back(std::move(*item));
     }
 
-    if (!cc->Inputs().Tag("BATCH_END").Value().IsEmpty()) {  // flush signal
-      Timestamp loop_control_ts =
-          cc->Inputs().Tag("BATCH_END").template Get<Timestamp>();
+    const Packet& batch_end_packet = cc->Inputs().Get(batch_end_id_).Value();
+    if (!batch_end_packet.IsEmpty()) {  // flush signal
+      Timestamp loop_control_ts = batch_end_packet.Get<Timestamp>();
       if (input_stream_collection_) {
         cc->Outputs()
-            .Tag("ITERABLE")
+            .Get(iterable_id_)
             .Add(input_stream_collection_.release(), loop_control_ts);
       } else {
         // Since there is no collection, inform downstream calculators to not
         // expect any packet by updating the timestamp bounds.
         cc->Outputs()
-            .Tag("ITERABLE")
+            .Get(iterable_id_)
             .SetNextTimestampBound(Timestamp(loop_control_ts.Value() + 1));
       }
     }
@@ -98,6 +109,9 @@ class EndLoopCalculator : public CalculatorBase {
   }
 
  private:
+  CollectionItemId item_id_;
+  CollectionItemId batch_end_id_;
+  CollectionItemId iterable_id_;
   std::unique_ptr<IterableT> input_stream_collection_;
 };
 
@@ -12,51 +12,58 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/source_location.h"
 #include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/util/image_frame_util.h"
 
 namespace mediapipe {
 namespace {
-void SetColorChannel(int channel, uint8 value, cv::Mat* mat) {
-  CHECK(mat->depth() == CV_8U);
-  CHECK(channel < mat->channels());
-  const int step = mat->channels();
-  for (int r = 0; r < mat->rows; ++r) {
-    uint8* row_ptr = mat->ptr<uint8>(r);
-    for (int offset = channel; offset < mat->cols * step; offset += step) {
-      row_ptr[offset] = value;
-    }
-  }
-}
-
 constexpr char kRgbaInTag[] = "RGBA_IN";
 constexpr char kRgbInTag[] = "RGB_IN";
 constexpr char kBgraInTag[] = "BGRA_IN";
 constexpr char kGrayInTag[] = "GRAY_IN";
+constexpr char kYuvInTag[] = "YUV_IN";
 constexpr char kRgbaOutTag[] = "RGBA_OUT";
 constexpr char kRgbOutTag[] = "RGB_OUT";
 constexpr char kBgraOutTag[] = "BGRA_OUT";
 constexpr char kGrayOutTag[] = "GRAY_OUT";
+
+// The ImageFrame tags and the formats of their frames.
+constexpr struct {
+  const char* in_tag;
+  const char* out_tag;
+  ImageFormat::Format format;
+} kImageFrameTags[] = {
+    {kRgbaInTag, kRgbaOutTag, ImageFormat::SRGBA},
+    {kRgbInTag, kRgbOutTag, ImageFormat::SRGB},
+    {kBgraInTag, kBgraOutTag, ImageFormat::SBGRA},
+    {kGrayInTag, kGrayOutTag, ImageFormat::GRAY8},
+};
 }  // namespace
 
 // A portable color conversion calculator calculator.
 //
-// The following conversions are currently supported, but it's fairly easy to
-// add new ones if this doesn't meet your needs--Don't forget to add a test to
-// color_convert_calculator_test.cc if you do!
-//   RGBA -> RGB
-//   GRAY -> RGB
-//   RGB  -> GRAY
-//   RGB  -> RGBA
-//   RGBA -> BGRA
-//   BGRA -> RGBA
+// Converts between any two of the RGBA, RGB, BGRA and GRAY formats, and from
+// a YUVImage to any of them. The conversions are done by
+// image_frame_util::ConvertImageFrame() and ConvertYUVImageToImageFrame(),
+// which write directly into the output frame. Alpha is set to 255 when it is
+// added, and GRAY is BT.601 luma.
+//
+// YUV_IN accepts 8-bit I420, YV12, NV12 and NV21 images, so camera frames can
+// enter a graph without first being converted to RGB. YUV images tagged with
+// BT.709 matrix coefficients are converted with BT.709, others with BT.601.
 //
 // This calculator only supports a single input stream and output stream at a
 // time. If more than one input stream or output stream is present, the
@@ -69,6 +76,7 @@ constexpr char kGrayOutTag[] = "GRAY_OUT";
 //   RGB_IN:        The input video stream (ImageFrame, SRGB).
 //   BGRA_IN:       The input video stream (ImageFrame, SBGRA).
 //   GRAY_IN:       The input video stream (ImageFrame, GRAY8).
+//   YUV_IN:        The input video stream (YUVImage).
 //
 // Output streams:
 //   RGBA_OUT:      The output video stream (ImageFrame, SRGBA).
@@ -79,23 +87,13 @@ class ColorConvertCalculator : public CalculatorBase {
  public:
   ~ColorConvertCalculator() override = default;
   static absl::Status GetContract(CalculatorContract* cc);
+  absl::Status Open(CalculatorContext* cc) override;
   absl::Status Process(CalculatorContext* cc) override;
 
-  absl::Status Open(CalculatorContext* cc) override {
-    cc->SetOffset(TimestampDiff(0));
-    return absl::OkStatus();
-  }
-
  private:
-  // Wrangles the appropriate inputs and outputs to perform the color
-  // conversion. The ImageFrame on input_tag is converted using the
-  // open_cv_convert_code provided and then output on the output_tag stream.
-  // Note that the output_format must match the destination conversion code.
-  absl::Status ConvertAndOutput(const std::string& input_tag,
-                                const std::string& output_tag,
-                                ImageFormat::Format output_format,
-                                int open_cv_convert_code,
-                                CalculatorContext* cc);
+  std::string input_tag_;
+  std::string output_tag_;
+  ImageFormat::Format output_format_ = ImageFormat::UNKNOWN;
 };
 
 REGISTER_CALCULATOR(ColorConvertCalculator);
@@ -106,97 +104,66 @@ absl::Status ColorConvertCalculator::GetContract(CalculatorContract* cc) {
   RET_CHECK_EQ(cc->Outputs().NumEntries(), 1)
       << "Only one output stream is allowed.";
 
-  if (cc->Inputs().HasTag(kRgbaInTag)) {
-    cc->Inputs().Tag(kRgbaInTag).Set<ImageFrame>();
-  }
-
-  if (cc->Inputs().HasTag(kGrayInTag)) {
-    cc->Inputs().Tag(kGrayInTag).Set<ImageFrame>();
+  for (const auto& tags : kImageFrameTags) {
+    if (cc->Inputs().HasTag(tags.in_tag)) {
+      cc->Inputs().Tag(tags.in_tag).Set<ImageFrame>();
+    }
+    if (cc->Outputs().HasTag(tags.out_tag)) {
+      cc->Outputs().Tag(tags.out_tag).Set<ImageFrame>();
+    }
   }
 
-  if (cc->Inputs().HasTag(kRgbInTag)) {
-    cc->Inputs().Tag(kRgbInTag).Set<ImageFrame>();
+  if (cc->Inputs().HasTag(kYuvInTag)) {
+    cc->Inputs().Tag(kYuvInTag).Set<YUVImage>();
   }
 
-  if (cc->Inputs().HasTag(kBgraInTag)) {
-    cc->Inputs().Tag(kBgraInTag).Set<ImageFrame>();
-  }
+  return absl::OkStatus();
+}
 
-  if (cc->Outputs().HasTag(kRgbOutTag)) {
-    cc->Outputs().Tag(kRgbOutTag).Set<ImageFrame>();
-  }
+absl::Status ColorConvertCalculator::Open(CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
 
-  if (cc->Outputs().HasTag(kGrayOutTag)) {
-    cc->Outputs().Tag(kGrayOutTag).Set<ImageFrame>();
+  if (cc->Inputs().HasTag(kYuvInTag)) {
+    input_tag_ = kYuvInTag;
   }
-
-  if (cc->Outputs().HasTag(kRgbaOutTag)) {
-    cc->Outputs().Tag(kRgbaOutTag).Set<ImageFrame>();
+  for (const auto& tags : kImageFrameTags) {
+    if (cc->Inputs().HasTag(tags.in_tag)) {
+      input_tag_ = tags.in_tag;
+    }
+    if (cc->Outputs().HasTag(tags.out_tag)) {
+      output_tag_ = tags.out_tag;
+      output_format_ = tags.format;
+    }
   }
-
-  if (cc->Outputs().HasTag(kBgraOutTag)) {
-    cc->Outputs().Tag(kBgraOutTag).Set<ImageFrame>();
+  if (input_tag_.empty() || output_tag_.empty()) {
+    return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Unsupported image format conversion.";
   }
-
   return absl::OkStatus();
 }
 
-absl::Status ColorConvertCalculator::ConvertAndOutput(
-    const std::string& input_tag, const std::string& output_tag,
-    ImageFormat::Format output_format, int open_cv_convert_code,
-    CalculatorContext* cc) {
-  const cv::Mat& input_mat =
-      formats::MatView(&cc->Inputs().Tag(input_tag).Get<ImageFrame>());
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(output_format, input_mat.cols, input_mat.rows));
-  cv::Mat output_mat = formats::MatView(output_frame.get());
-  cv::cvtColor(input_mat, output_mat, open_cv_convert_code);
-
-  // cv::cvtColor will leave the alpha channel set to 0, which is a bizarre
-  // design choice. Instead, let's set alpha to 255.
-  if (open_cv_convert_code == cv::COLOR_RGB2RGBA) {
-    SetColorChannel(3, 255, &output_mat);
+absl::Status ColorConvertCalculator::Process(CalculatorContext* cc) {
+  const auto& input = cc->Inputs().Tag(input_tag_);
+  std::unique_ptr<ImageFrame> output_frame;
+  if (input_tag_ == kYuvInTag) {
+    const auto& yuv_image = input.Get<YUVImage>();
+    output_frame = absl::make_unique<ImageFrame>(
+        output_format_, yuv_image.width(), yuv_image.height());
+    const bool use_bt709 = yuv_image.matrix_coefficients() ==
+                           YUVImage::COLOR_MATRIX_COEFFICIENTS_BT709;
+    MP_RETURN_IF_ERROR(image_frame_util::ConvertYUVImageToImageFrame(
+        yuv_image, output_frame.get(), use_bt709));
+  } else {
+    const auto& input_frame = input.Get<ImageFrame>();
+    output_frame = absl::make_unique<ImageFrame>(
+        output_format_, input_frame.Width(), input_frame.Height());
+    MP_RETURN_IF_ERROR(
+        image_frame_util::ConvertImageFrame(input_frame, output_frame.get()));
   }
   cc->Outputs()
-      .Tag(output_tag)
+      .Tag(output_tag_)
       .Add(output_frame.release(), cc->InputTimestamp());
   return absl::OkStatus();
 }
 
-absl::Status ColorConvertCalculator::Process(CalculatorContext* cc) {
-  // RGBA -> RGB
-  if (cc->Inputs().HasTag(kRgbaInTag) && cc->Outputs().HasTag(kRgbOutTag)) {
-    return ConvertAndOutput(kRgbaInTag, kRgbOutTag, ImageFormat::SRGB,
-                            cv::COLOR_RGBA2RGB, cc);
-  }
-  // GRAY -> RGB
-  if (cc->Inputs().HasTag(kGrayInTag) && cc->Outputs().HasTag(kRgbOutTag)) {
-    return ConvertAndOutput(kGrayInTag, kRgbOutTag, ImageFormat::SRGB,
-                            cv::COLOR_GRAY2RGB, cc);
-  }
-  // RGB -> GRAY
-  if (cc->Inputs().HasTag(kRgbInTag) && cc->Outputs().HasTag(kGrayOutTag)) {
-    return ConvertAndOutput(kRgbInTag, kGrayOutTag, ImageFormat::GRAY8,
-                            cv::COLOR_RGB2GRAY, cc);
-  }
-  // RGB -> RGBA
-  if (cc->Inputs().HasTag(kRgbInTag) && cc->Outputs().HasTag(kRgbaOutTag)) {
-    return ConvertAndOutput(kRgbInTag, kRgbaOutTag, ImageFormat::SRGBA,
-                            cv::COLOR_RGB2RGBA, cc);
-  }
-  // BGRA -> RGBA
-  if (cc->Inputs().HasTag(kBgraInTag) && cc->Outputs().HasTag(kRgbaOutTag)) {
-    return ConvertAndOutput(kBgraInTag, kRgbaOutTag, ImageFormat::SRGBA,
-                            cv::COLOR_BGRA2RGBA, cc);
-  }
-  // RGBA -> BGRA
-  if (cc->Inputs().HasTag(kRgbaInTag) && cc->Outputs().HasTag(kBgraOutTag)) {
-    return ConvertAndOutput(kRgbaInTag, kBgraOutTag, ImageFormat::SBGRA,
-                            cv::COLOR_RGBA2BGRA, cc);
-  }
-
-  return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
-         << "Unsupported image format conversion.";
-}
-
 }  // namespace mediapipe
@@ -0,0 +1,96 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/util/image_frame_util.h"
+
+namespace mediapipe {
+namespace {
+
+using Node = ::mediapipe::CalculatorGraphConfig::Node;
+
+Packet MakeRgbPacket(int width, int height, uint8 r, uint8 g, uint8 b,
+                     int64 timestamp) {
+  auto image = absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int x = 0; x < width; ++x) {
+      row[x * 3] = r;
+      row[x * 3 + 1] = g;
+      row[x * 3 + 2] = b;
+    }
+  }
+  return Adopt(image.release()).At(Timestamp(timestamp));
+}
+
+TEST(ColorConvertCalculatorTest, ConvertsRgbToBgra) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "ColorConvertCalculator"
+    input_stream: "RGB_IN:input"
+    output_stream: "BGRA_OUT:output"
+  )pb"));
+  runner.MutableInputs()->Tag("RGB_IN").packets.push_back(
+      MakeRgbPacket(3, 2, 10, 20, 30, 0));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& outputs = runner.Outputs().Tag("BGRA_OUT").packets;
+  ASSERT_EQ(1, outputs.size());
+  const auto& output = outputs[0].Get<ImageFrame>();
+  EXPECT_EQ(ImageFormat::SBGRA, output.Format());
+  const uint8* pixel = output.PixelData() + output.WidthStep() + 2 * 4;
+  EXPECT_EQ(30, pixel[0]);
+  EXPECT_EQ(20, pixel[1]);
+  EXPECT_EQ(10, pixel[2]);
+  EXPECT_EQ(255, pixel[3]);
+}
+
+TEST(ColorConvertCalculatorTest, ConvertsYuvToRgba) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "ColorConvertCalculator"
+    input_stream: "YUV_IN:input"
+    output_stream: "RGBA_OUT:output"
+  )pb"));
+  const Packet rgb = MakeRgbPacket(4, 4, 200, 100, 50, 0);
+  auto yuv_image = absl::make_unique<YUVImage>();
+  image_frame_util::ImageFrameToYUVNV12Image(rgb.Get<ImageFrame>(),
+                                             yuv_image.get());
+  runner.MutableInputs()->Tag("YUV_IN").packets.push_back(
+      Adopt(yuv_image.release()).At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& outputs = runner.Outputs().Tag("RGBA_OUT").packets;
+  ASSERT_EQ(1, outputs.size());
+  const auto& output = outputs[0].Get<ImageFrame>();
+  EXPECT_EQ(ImageFormat::SRGBA, output.Format());
+  EXPECT_EQ(4, output.Width());
+  EXPECT_EQ(4, output.Height());
+  const uint8* pixel = output.PixelData() + 3 * output.WidthStep();
+  EXPECT_NEAR(200, pixel[0], 3);
+  EXPECT_NEAR(100, pixel[1], 3);
+  EXPECT_NEAR(50, pixel[2], 3);
+  EXPECT_EQ(255, pixel[3]);
+}
+
+}  // namespace
+}  // namespace mediapipe
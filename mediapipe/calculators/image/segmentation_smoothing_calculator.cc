@@ -27,6 +27,7 @@
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/vector.h"
+#include "mediapipe/util/image_frame_pool_util.h"
 
 #if !MEDIAPIPE_DISABLE_GPU
 #include "mediapipe/gpu/gl_calculator_helper.h"
@@ -112,6 +113,7 @@ absl::Status SegmentationSmoothingCalculator::GetContract(
   cc->Inputs().Tag(kCurrentMaskTag).Set<Image>();
   cc->Inputs().Tag(kPreviousMaskTag).Set<Image>();
   cc->Outputs().Tag(kOutputMaskTag).Set<Image>();
+  cc->UseService(kImageFramePoolService).Optional();
 
 #if !MEDIAPIPE_DISABLE_GPU
   MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
@@ -197,8 +199,8 @@ absl::Status SegmentationSmoothingCalculator::RenderCpu(CalculatorContext* cc) {
   RET_CHECK_EQ(current_mat.cols, previous_mat.cols);
 
   // Setup destination image.
-  auto output_frame = std::make_shared<ImageFrame>(
-      current_frame.image_format(), current_mat.cols, current_mat.rows);
+  std::shared_ptr<ImageFrame> output_frame = GetPooledImageFrame(
+      cc, current_frame.image_format(), current_mat.cols, current_mat.rows);
   cv::Mat output_mat = mediapipe::formats::MatView(output_frame.get());
   output_mat.setTo(cv::Scalar(0));
 
@@ -12,12 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "absl/strings/str_format.h"
 #include "absl/types/span.h"
 #include "mediapipe/calculators/tensor/tensors_to_detections_calculator.pb.h"
+#include "mediapipe/calculators/tensor/tensors_to_detections_utils.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/deps/file_path.h"
@@ -65,19 +67,6 @@ namespace api2 {
 
 namespace {
 
-void ConvertRawValuesToAnchors(const float* raw_anchors, int num_boxes,
-                               std::vector<Anchor>* anchors) {
-  anchors->clear();
-  for (int i = 0; i < num_boxes; ++i) {
-    Anchor new_anchor;
-    new_anchor.set_y_center(raw_anchors[i * kNumCoordsPerBox + 0]);
-    new_anchor.set_x_center(raw_anchors[i * kNumCoordsPerBox + 1]);
-    new_anchor.set_h(raw_anchors[i * kNumCoordsPerBox + 2]);
-    new_anchor.set_w(raw_anchors[i * kNumCoordsPerBox + 3]);
-    anchors->push_back(new_anchor);
-  }
-}
-
 void ConvertAnchorsToRawValues(const std::vector<Anchor>& anchors,
                                int num_boxes, float* raw_anchors) {
   CHECK_EQ(anchors.size(), num_boxes);
@@ -117,6 +106,12 @@ void ConvertAnchorsToRawValues(const std::vector<Anchor>& anchors,
 // Output:
 //  DETECTIONS - Result MediaPipe detections.
 //
+// On CPU, scores are thresholded before boxes are decoded, so only the boxes
+// that can pass min_score_thresh are decoded. Setting non_max_suppression in
+// the options applies non-maximum suppression to the decoded boxes, which
+// avoids creating Detection protos for the boxes it suppresses and replaces a
+// downstream NonMaxSuppressionCalculator.
+//
 // Usage example:
 // node {
 //   calculator: "TensorsToDetectionsCalculator"
@@ -160,13 +155,8 @@ class TensorsToDetectionsCalculator : public Node {
 
   absl::Status LoadOptions(CalculatorContext* cc);
   absl::Status GpuInit(CalculatorContext* cc);
-  absl::Status DecodeBoxes(const float* raw_boxes,
-                           const std::vector<Anchor>& anchors,
-                           std::vector<float>* boxes);
-  absl::Status ConvertToDetections(const float* detection_boxes,
-                                   const float* detection_scores,
-                                   const int* detection_classes,
-                                   std::vector<Detection>* output_detections);
+  // Converts the results of decoder_ to detections.
+  absl::Status ConvertToDetections(std::vector<Detection>* output_detections);
   Detection ConvertToDetection(float box_ymin, float box_xmin, float box_ymax,
                                float box_xmax, float score, int class_id,
                                bool flip_vertically);
@@ -177,7 +167,8 @@ class TensorsToDetectionsCalculator : public Node {
   std::set<int> ignore_classes_;
 
   ::mediapipe::TensorsToDetectionsCalculatorOptions options_;
-  std::vector<Anchor> anchors_;
+  std::unique_ptr<DetectionDecoder> decoder_;
+  std::vector<int> detection_classes_;
 
 #ifndef MEDIAPIPE_DISABLE_GL_COMPUTE
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -279,60 +270,24 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
     auto raw_scores = raw_scores_view.buffer<float>();
 
     // TODO: Support other options to load anchors.
-    if (!anchors_init_) {
+    if (!decoder_->has_anchors()) {
       if (input_tensors.size() == kNumInputTensorsWithAnchors) {
         auto anchor_tensor = &input_tensors[2];
         RET_CHECK_EQ(anchor_tensor->shape().dims.size(), 2);
         RET_CHECK_EQ(anchor_tensor->shape().dims[0], num_boxes_);
         RET_CHECK_EQ(anchor_tensor->shape().dims[1], kNumCoordsPerBox);
         auto anchor_view = anchor_tensor->GetCpuReadView();
-        auto raw_anchors = anchor_view.buffer<float>();
-        ConvertRawValuesToAnchors(raw_anchors, num_boxes_, &anchors_);
+        decoder_->SetAnchors(anchor_view.buffer<float>(), num_boxes_);
       } else if (!kInAnchors(cc).IsEmpty()) {
-        anchors_ = *kInAnchors(cc);
+        const auto& anchors = *kInAnchors(cc);
+        RET_CHECK_EQ(anchors.size(), num_boxes_);
+        decoder_->SetAnchors(anchors);
       } else {
         return absl::UnavailableError("No anchor data available.");
       }
-      anchors_init_ = true;
-    }
-    std::vector<float> boxes(num_boxes_ * num_coords_);
-    MP_RETURN_IF_ERROR(DecodeBoxes(raw_boxes, anchors_, &boxes));
-
-    std::vector<float> detection_scores(num_boxes_);
-    std::vector<int> detection_classes(num_boxes_);
-
-    // Filter classes by scores.
-    for (int i = 0; i < num_boxes_; ++i) {
-      int class_id = -1;
-      float max_score = -std::numeric_limits<float>::max();
-      // Find the top score for box i.
-      for (int score_idx = 0; score_idx < num_classes_; ++score_idx) {
-        if (ignore_classes_.find(score_idx) == ignore_classes_.end()) {
-          auto score = raw_scores[i * num_classes_ + score_idx];
-          if (options_.sigmoid_score()) {
-            if (options_.has_score_clipping_thresh()) {
-              score = score < -options_.score_clipping_thresh()
-                          ? -options_.score_clipping_thresh()
-                          : score;
-              score = score > options_.score_clipping_thresh()
-                          ? options_.score_clipping_thresh()
-                          : score;
-            }
-            score = 1.0f / (1.0f + std::exp(-score));
-          }
-          if (max_score < score) {
-            max_score = score;
-            class_id = score_idx;
-          }
-        }
-      }
-      detection_scores[i] = max_score;
-      detection_classes[i] = class_id;
     }
-
-    MP_RETURN_IF_ERROR(
-        ConvertToDetections(boxes.data(), detection_scores.data(),
-                            detection_classes.data(), output_detections));
+    decoder_->DecodeRawTensors(raw_boxes, raw_scores);
+    MP_RETURN_IF_ERROR(ConvertToDetections(output_detections));
   } else {
     // Postprocessing on CPU with postprocessing op (e.g. anchor decoding and
     // non-maximum suppression) within the model.
@@ -370,13 +325,13 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
 
     auto detection_classes_view = detection_classes_tensor->GetCpuReadView();
     auto detection_classes_ptr = detection_classes_view.buffer<float>();
-    std::vector<int> detection_classes(num_boxes_);
+    detection_classes_.resize(num_boxes_);
     for (int i = 0; i < num_boxes_; ++i) {
-      detection_classes[i] = static_cast<int>(detection_classes_ptr[i]);
+      detection_classes_[i] = static_cast<int>(detection_classes_ptr[i]);
     }
-    MP_RETURN_IF_ERROR(ConvertToDetections(detection_boxes, detection_scores,
-                                           detection_classes.data(),
-                                           output_detections));
+    decoder_->DecodeScoredBoxes(detection_boxes, detection_scores,
+                                detection_classes_.data(), num_boxes_);
+    MP_RETURN_IF_ERROR(ConvertToDetections(output_detections));
   }
   return absl::OkStatus();
 }
@@ -448,9 +403,9 @@ absl::Status TensorsToDetectionsCalculator::ProcessGPU(
   }
   auto decoded_boxes_view = decoded_boxes_buffer_->GetCpuReadView();
   auto boxes = decoded_boxes_view.buffer<float>();
-  MP_RETURN_IF_ERROR(ConvertToDetections(boxes, detection_scores.data(),
-                                         detection_classes.data(),
-                                         output_detections));
+  decoder_->DecodeScoredBoxes(boxes, detection_scores.data(),
+                              detection_classes.data(), num_boxes_);
+  MP_RETURN_IF_ERROR(ConvertToDetections(output_detections));
 #elif MEDIAPIPE_METAL_ENABLED
   id<MTLDevice> device = gpu_helper_.mtlDevice;
   if (!anchors_init_) {
@@ -529,9 +484,9 @@ absl::Status TensorsToDetectionsCalculator::ProcessGPU(
   }
   auto decoded_boxes_view = decoded_boxes_buffer_->GetCpuReadView();
   auto boxes = decoded_boxes_view.buffer<float>();
-  MP_RETURN_IF_ERROR(ConvertToDetections(boxes, detection_scores.data(),
-                                         detection_classes.data(),
-                                         output_detections));
+  decoder_->DecodeScoredBoxes(boxes, detection_scores.data(),
+                              detection_classes.data(), num_boxes_);
+  MP_RETURN_IF_ERROR(ConvertToDetections(output_detections));
 
 #else
   LOG(ERROR) << "GPU input on non-Android not supported yet.";
@@ -589,110 +544,44 @@ absl::Status TensorsToDetectionsCalculator::LoadOptions(CalculatorContext* cc) {
     }
   }
 
-  return absl::OkStatus();
-}
-
-absl::Status TensorsToDetectionsCalculator::DecodeBoxes(
-    const float* raw_boxes, const std::vector<Anchor>& anchors,
-    std::vector<float>* boxes) {
-  for (int i = 0; i < num_boxes_; ++i) {
-    const int box_offset = i * num_coords_ + options_.box_coord_offset();
-
-    float y_center = raw_boxes[box_offset];
-    float x_center = raw_boxes[box_offset + 1];
-    float h = raw_boxes[box_offset + 2];
-    float w = raw_boxes[box_offset + 3];
-    if (options_.reverse_output_order()) {
-      x_center = raw_boxes[box_offset];
-      y_center = raw_boxes[box_offset + 1];
-      w = raw_boxes[box_offset + 2];
-      h = raw_boxes[box_offset + 3];
-    }
-
-    x_center =
-        x_center / options_.x_scale() * anchors[i].w() + anchors[i].x_center();
-    y_center =
-        y_center / options_.y_scale() * anchors[i].h() + anchors[i].y_center();
-
-    if (options_.apply_exponential_on_box_size()) {
-      h = std::exp(h / options_.h_scale()) * anchors[i].h();
-      w = std::exp(w / options_.w_scale()) * anchors[i].w();
-    } else {
-      h = h / options_.h_scale() * anchors[i].h();
-      w = w / options_.w_scale() * anchors[i].w();
-    }
-
-    const float ymin = y_center - h / 2.f;
-    const float xmin = x_center - w / 2.f;
-    const float ymax = y_center + h / 2.f;
-    const float xmax = x_center + w / 2.f;
-
-    (*boxes)[i * num_coords_ + 0] = ymin;
-    (*boxes)[i * num_coords_ + 1] = xmin;
-    (*boxes)[i * num_coords_ + 2] = ymax;
-    (*boxes)[i * num_coords_ + 3] = xmax;
-
-    if (options_.num_keypoints()) {
-      for (int k = 0; k < options_.num_keypoints(); ++k) {
-        const int offset = i * num_coords_ + options_.keypoint_coord_offset() +
-                           k * options_.num_values_per_keypoint();
-
-        float keypoint_y = raw_boxes[offset];
-        float keypoint_x = raw_boxes[offset + 1];
-        if (options_.reverse_output_order()) {
-          keypoint_x = raw_boxes[offset];
-          keypoint_y = raw_boxes[offset + 1];
-        }
-
-        (*boxes)[offset] = keypoint_x / options_.x_scale() * anchors[i].w() +
-                           anchors[i].x_center();
-        (*boxes)[offset + 1] =
-            keypoint_y / options_.y_scale() * anchors[i].h() +
-            anchors[i].y_center();
-      }
+  if (options_.has_non_max_suppression()) {
+    RET_CHECK_NE(options_.non_max_suppression().max_num_detections(), 0)
+        << "max_num_detections=0 is not a valid value.";
+    RET_CHECK_NE(options_.non_max_suppression().overlap_type(),
+                 NonMaxSuppressionCalculatorOptions::UNSPECIFIED_OVERLAP_TYPE);
+  }
+  std::vector<int> class_ids;
+  for (int i = 0; i < num_classes_; ++i) {
+    if (ignore_classes_.find(i) == ignore_classes_.end()) {
+      class_ids.push_back(i);
     }
   }
+  decoder_ = absl::make_unique<DetectionDecoder>(options_, std::move(class_ids));
 
   return absl::OkStatus();
 }
 
 absl::Status TensorsToDetectionsCalculator::ConvertToDetections(
-    const float* detection_boxes, const float* detection_scores,
-    const int* detection_classes, std::vector<Detection>* output_detections) {
-  for (int i = 0; i < num_boxes_; ++i) {
-    if (options_.has_min_score_thresh() &&
-        detection_scores[i] < options_.min_score_thresh()) {
-      continue;
-    }
-    const int box_offset = i * num_coords_;
+    std::vector<Detection>* output_detections) {
+  output_detections->reserve(decoder_->num_detections());
+  for (int i = 0; i < decoder_->num_detections(); ++i) {
+    const ScoredBox& scored_box = decoder_->detection(i);
+    const absl::Span<const float> box = decoder_->box(i);
     Detection detection = ConvertToDetection(
-        detection_boxes[box_offset + 0], detection_boxes[box_offset + 1],
-        detection_boxes[box_offset + 2], detection_boxes[box_offset + 3],
-        detection_scores[i], detection_classes[i], options_.flip_vertically());
-    const auto& bbox = detection.location_data().relative_bounding_box();
-    if (bbox.width() < 0 || bbox.height() < 0 || std::isnan(bbox.width()) ||
-        std::isnan(bbox.height())) {
-      // Decoded detection boxes could have negative values for width/height due
-      // to model prediction. Filter out those boxes since some downstream
-      // calculators may assume non-negative values. (b/171391719)
-      continue;
-    }
+        box[0], box[1], box[2], box[3], scored_box.score, scored_box.class_id,
+        options_.flip_vertically());
     // Add keypoints.
     if (options_.num_keypoints() > 0) {
       auto* location_data = detection.mutable_location_data();
-      for (int kp_id = 0; kp_id < options_.num_keypoints() *
-                                      options_.num_values_per_keypoint();
-           kp_id += options_.num_values_per_keypoint()) {
+      for (int k = 0; k < options_.num_keypoints(); ++k) {
         auto keypoint = location_data->add_relative_keypoints();
-        const int keypoint_index =
-            box_offset + options_.keypoint_coord_offset() + kp_id;
-        keypoint->set_x(detection_boxes[keypoint_index + 0]);
-        keypoint->set_y(options_.flip_vertically()
-                            ? 1.f - detection_boxes[keypoint_index + 1]
-                            : detection_boxes[keypoint_index + 1]);
+        const float x = box[DetectionDecoder::kNumCoordsPerBox + 2 * k];
+        const float y = box[DetectionDecoder::kNumCoordsPerBox + 2 * k + 1];
+        keypoint->set_x(x);
+        keypoint->set_y(options_.flip_vertically() ? 1.f - y : y);
       }
     }
-    output_detections->emplace_back(detection);
+    output_detections->push_back(std::move(detection));
   }
   return absl::OkStatus();
 }
@@ -0,0 +1,420 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_detections_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Scores are thresholded a block of boxes at a time. Most boxes score below
+// the threshold, and a block can be skipped with a branch-free pass that the
+// compiler vectorizes.
+constexpr int kScoreBlockSize = 16;
+
+bool AnyAtLeast(const float* values, int count, float threshold) {
+  bool any = false;
+  for (int i = 0; i < count; ++i) {
+    any |= values[i] >= threshold;
+  }
+  return any;
+}
+
+float ClipScore(float score, float clipping_thresh) {
+  return std::min(std::max(score, -clipping_thresh), clipping_thresh);
+}
+
+}  // namespace
+
+constexpr int DetectionDecoder::kNumCoordsPerBox;
+
+float OverlapSimilarity(
+    NonMaxSuppressionCalculatorOptions::OverlapType overlap_type,
+    const float* box1, const float* box2) {
+  const float ymin1 = box1[0], xmin1 = box1[1], ymax1 = box1[2],
+              xmax1 = box1[3];
+  const float ymin2 = box2[0], xmin2 = box2[1], ymax2 = box2[2],
+              xmax2 = box2[3];
+  if (xmax2 < xmin1 || xmax1 < xmin2 || ymax2 < ymin1 || ymax1 < ymin2) {
+    return 0.0f;
+  }
+  const float intersection_area =
+      (std::min(xmax1, xmax2) - std::max(xmin1, xmin2)) *
+      (std::min(ymax1, ymax2) - std::max(ymin1, ymin2));
+  const float area1 = (xmax1 - xmin1) * (ymax1 - ymin1);
+  const float area2 = (xmax2 - xmin2) * (ymax2 - ymin2);
+  float normalization;
+  switch (overlap_type) {
+    case NonMaxSuppressionCalculatorOptions::JACCARD:
+      // The area of the bounding box of both boxes, as Rectangle::Union().
+      normalization = (std::max(xmax1, xmax2) - std::min(xmin1, xmin2)) *
+                      (std::max(ymax1, ymax2) - std::min(ymin1, ymin2));
+      break;
+    case NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD:
+      normalization = area2;
+      break;
+    case NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION:
+      normalization = area1 + area2 - intersection_area;
+      break;
+    default:
+      LOG(FATAL) << "Unrecognized overlap type: " << overlap_type;
+  }
+  return normalization > 0.0f ? intersection_area / normalization : 0.0f;
+}
+
+DetectionDecoder::DetectionDecoder(
+    const TensorsToDetectionsCalculatorOptions& options,
+    std::vector<int> class_ids)
+    : options_(options),
+      class_ids_(std::move(class_ids)),
+      all_classes_(class_ids_.size() == options_.num_classes()),
+      box_size_(kNumCoordsPerBox + 2 * options_.num_keypoints()),
+      raw_score_threshold_(-std::numeric_limits<float>::infinity()) {
+  if (!options_.has_min_score_thresh()) {
+    return;
+  }
+  const float min_score = options_.min_score_thresh();
+  if (!options_.sigmoid_score()) {
+    raw_score_threshold_ = min_score;
+    return;
+  }
+  // The sigmoid is increasing, so raw scores can be compared against its
+  // inverse. The margin absorbs rounding; the exact threshold is applied to
+  // the final scores.
+  if (min_score > 0.0f && min_score < 1.0f) {
+    const float logit = std::log(min_score / (1.0f - min_score));
+    raw_score_threshold_ = logit - 1e-4f * (1.0f + std::abs(logit));
+  }
+  // Clipped scores are at least -score_clipping_thresh, so a threshold below
+  // that rejects nothing. Above it, raw and clipped scores pass alike.
+  if (options_.has_score_clipping_thresh() &&
+      raw_score_threshold_ <= -options_.score_clipping_thresh()) {
+    raw_score_threshold_ = -std::numeric_limits<float>::infinity();
+  }
+}
+
+void DetectionDecoder::SetAnchors(const std::vector<Anchor>& anchors) {
+  anchors_.resize(anchors.size() * kNumCoordsPerBox);
+  float* anchor = anchors_.data();
+  for (const Anchor& a : anchors) {
+    anchor[0] = a.y_center();
+    anchor[1] = a.x_center();
+    anchor[2] = a.h();
+    anchor[3] = a.w();
+    anchor += kNumCoordsPerBox;
+  }
+}
+
+void DetectionDecoder::SetAnchors(const float* raw_anchors, int num_boxes) {
+  anchors_.assign(raw_anchors, raw_anchors + num_boxes * kNumCoordsPerBox);
+}
+
+void DetectionDecoder::DecodeRawTensors(const float* raw_boxes,
+                                        const float* raw_scores) {
+  CHECK_EQ(anchors_.size(), options_.num_boxes() * kNumCoordsPerBox);
+  SelectBoxes(raw_scores);
+  boxes_.resize(scored_boxes_.size() * box_size_);
+  for (int i = 0; i < scored_boxes_.size(); ++i) {
+    const int box_index = scored_boxes_[i].box_index;
+    DecodeBox(raw_boxes + box_index * options_.num_coords(),
+              anchors_.data() + box_index * kNumCoordsPerBox,
+              boxes_.data() + i * box_size_);
+  }
+  Finish();
+}
+
+void DetectionDecoder::DecodeScoredBoxes(const float* boxes,
+                                         const float* scores,
+                                         const int* classes, int num_boxes) {
+  scored_boxes_.clear();
+  boxes_.clear();
+  for (int i = 0; i < num_boxes; ++i) {
+    if (options_.has_min_score_thresh() &&
+        scores[i] < options_.min_score_thresh()) {
+      continue;
+    }
+    scored_boxes_.push_back({i, classes[i], scores[i]});
+    const float* box = boxes + i * options_.num_coords();
+    boxes_.insert(boxes_.end(), box, box + kNumCoordsPerBox);
+    for (int k = 0; k < options_.num_keypoints(); ++k) {
+      const float* keypoint = box + options_.keypoint_coord_offset() +
+                              k * options_.num_values_per_keypoint();
+      boxes_.push_back(keypoint[0]);
+      boxes_.push_back(keypoint[1]);
+    }
+  }
+  Finish();
+}
+
+void DetectionDecoder::SelectBoxes(const float* raw_scores) {
+  scored_boxes_.clear();
+  const int num_boxes = options_.num_boxes();
+  const int num_classes = options_.num_classes();
+  const bool clip_scores =
+      options_.sigmoid_score() && options_.has_score_clipping_thresh();
+  const float clipping_thresh = options_.score_clipping_thresh();
+
+  if (num_classes == 1 && all_classes_) {
+    for (int start = 0; start < num_boxes; start += kScoreBlockSize) {
+      const int end = std::min(start + kScoreBlockSize, num_boxes);
+      if (!AnyAtLeast(raw_scores + start, end - start, raw_score_threshold_)) {
+        continue;
+      }
+      for (int i = start; i < end; ++i) {
+        const float score = clip_scores
+                                ? ClipScore(raw_scores[i], clipping_thresh)
+                                : raw_scores[i];
+        if (score >= raw_score_threshold_) {
+          AddBox(i, 0, score);
+        }
+      }
+    }
+    return;
+  }
+
+  for (int i = 0; i < num_boxes; ++i) {
+    const float* scores = raw_scores + i * num_classes;
+    // Find the top score first, which vectorizes when no class is ignored,
+    // and the first class with that score only for boxes that pass.
+    float max_score = -std::numeric_limits<float>::max();
+    if (all_classes_) {
+      for (int c = 0; c < num_classes; ++c) {
+        max_score = std::max(max_score, scores[c]);
+      }
+    } else {
+      for (int c : class_ids_) {
+        max_score = std::max(max_score, scores[c]);
+      }
+    }
+    if (clip_scores) {
+      max_score = ClipScore(max_score, clipping_thresh);
+    }
+    if (max_score < raw_score_threshold_) {
+      continue;
+    }
+    int class_id = -1;
+    for (int c : class_ids_) {
+      const float score =
+          clip_scores ? ClipScore(scores[c], clipping_thresh) : scores[c];
+      if (score == max_score) {
+        class_id = c;
+        break;
+      }
+    }
+    AddBox(i, class_id, max_score);
+  }
+}
+
+void DetectionDecoder::AddBox(int box_index, int class_id, float raw_score) {
+  float score = raw_score;
+  if (class_id < 0) {
+    // No class scored, e.g. because all of them are ignored.
+    score = -std::numeric_limits<float>::max();
+  } else if (options_.sigmoid_score()) {
+    score = 1.0f / (1.0f + std::exp(-raw_score));
+  }
+  if (options_.has_min_score_thresh() && score < options_.min_score_thresh()) {
+    return;
+  }
+  scored_boxes_.push_back({box_index, class_id, score});
+}
+
+void DetectionDecoder::DecodeBox(const float* raw_box, const float* anchor,
+                                 float* box) const {
+  const float anchor_y_center = anchor[0];
+  const float anchor_x_center = anchor[1];
+  const float anchor_h = anchor[2];
+  const float anchor_w = anchor[3];
+  const float* raw = raw_box + options_.box_coord_offset();
+  float y_center = raw[0];
+  float x_center = raw[1];
+  float h = raw[2];
+  float w = raw[3];
+  if (options_.reverse_output_order()) {
+    x_center = raw[0];
+    y_center = raw[1];
+    w = raw[2];
+    h = raw[3];
+  }
+
+  x_center = x_center / options_.x_scale() * anchor_w + anchor_x_center;
+  y_center = y_center / options_.y_scale() * anchor_h + anchor_y_center;
+  if (options_.apply_exponential_on_box_size()) {
+    h = std::exp(h / options_.h_scale()) * anchor_h;
+    w = std::exp(w / options_.w_scale()) * anchor_w;
+  } else {
+    h = h / options_.h_scale() * anchor_h;
+    w = w / options_.w_scale() * anchor_w;
+  }
+  box[0] = y_center - h / 2.f;
+  box[1] = x_center - w / 2.f;
+  box[2] = y_center + h / 2.f;
+  box[3] = x_center + w / 2.f;
+
+  for (int k = 0; k < options_.num_keypoints(); ++k) {
+    const float* keypoint = raw_box + options_.keypoint_coord_offset() +
+                            k * options_.num_values_per_keypoint();
+    float keypoint_y = keypoint[0];
+    float keypoint_x = keypoint[1];
+    if (options_.reverse_output_order()) {
+      keypoint_x = keypoint[0];
+      keypoint_y = keypoint[1];
+    }
+    box[kNumCoordsPerBox + 2 * k] =
+        keypoint_x / options_.x_scale() * anchor_w + anchor_x_center;
+    box[kNumCoordsPerBox + 2 * k + 1] =
+        keypoint_y / options_.y_scale() * anchor_h + anchor_y_center;
+  }
+}
+
+void DetectionDecoder::Finish() {
+  // Decoded boxes could have negative or NaN sizes due to model prediction.
+  // Drop them since some downstream calculators assume non-negative sizes.
+  int num_valid = 0;
+  for (int i = 0; i < scored_boxes_.size(); ++i) {
+    const float* box = boxes_.data() + i * box_size_;
+    const float width = box[3] - box[1];
+    const float height = box[2] - box[0];
+    if (width < 0 || height < 0 || std::isnan(width) || std::isnan(height)) {
+      continue;
+    }
+    if (num_valid != i) {
+      scored_boxes_[num_valid] = scored_boxes_[i];
+      std::copy(box, box + box_size_, boxes_.data() + num_valid * box_size_);
+    }
+    ++num_valid;
+  }
+  scored_boxes_.resize(num_valid);
+  boxes_.resize(num_valid * box_size_);
+
+  if (!options_.has_non_max_suppression()) {
+    // Swapping keeps the capacity of both buffers.
+    std::swap(detections_, scored_boxes_);
+    std::swap(detection_boxes_, boxes_);
+    return;
+  }
+
+  order_.resize(scored_boxes_.size());
+  for (int i = 0; i < order_.size(); ++i) {
+    order_[i] = i;
+  }
+  std::stable_sort(order_.begin(), order_.end(), [this](int a, int b) {
+    return scored_boxes_[a].score > scored_boxes_[b].score;
+  });
+  detections_.clear();
+  detection_boxes_.clear();
+  if (options_.non_max_suppression().algorithm() ==
+      NonMaxSuppressionCalculatorOptions::WEIGHTED) {
+    WeightedNonMaxSuppression();
+  } else {
+    NonMaxSuppression();
+  }
+}
+
+void DetectionDecoder::NonMaxSuppression() {
+  const auto& nms_options = options_.non_max_suppression();
+  const int max_num_detections = nms_options.max_num_detections();
+  for (int index : order_) {
+    const ScoredBox& scored_box = scored_boxes_[index];
+    if (nms_options.min_score_threshold() > 0 &&
+        scored_box.score < nms_options.min_score_threshold()) {
+      break;
+    }
+    const float* box = boxes_.data() + index * box_size_;
+    bool suppressed = false;
+    for (int i = 0; i < detections_.size(); ++i) {
+      if (OverlapSimilarity(nms_options.overlap_type(),
+                            detection_boxes_.data() + i * box_size_, box) >
+          nms_options.min_suppression_threshold()) {
+        suppressed = true;
+        break;
+      }
+    }
+    if (!suppressed) {
+      AddDetection(scored_box, box);
+    }
+    if (max_num_detections > -1 && detections_.size() >= max_num_detections) {
+      break;
+    }
+  }
+}
+
+void DetectionDecoder::WeightedNonMaxSuppression() {
+  const auto& nms_options = options_.non_max_suppression();
+  const int max_num_detections = nms_options.max_num_detections();
+  remaining_ = order_;
+  while (!remaining_.empty()) {
+    const ScoredBox& top = scored_boxes_[remaining_[0]];
+    if (nms_options.min_score_threshold() > 0 &&
+        top.score < nms_options.min_score_threshold()) {
+      break;
+    }
+    const float* top_box = boxes_.data() + remaining_[0] * box_size_;
+    candidates_.clear();
+    next_remaining_.clear();
+    // This includes the top box.
+    for (int index : remaining_) {
+      if (OverlapSimilarity(nms_options.overlap_type(),
+                            boxes_.data() + index * box_size_, top_box) >
+          nms_options.min_suppression_threshold()) {
+        candidates_.push_back(index);
+      } else {
+        next_remaining_.push_back(index);
+      }
+    }
+
+    AddDetection(top, top_box);
+    if (!candidates_.empty()) {
+      float* weighted_box =
+          detection_boxes_.data() + (detections_.size() - 1) * box_size_;
+      std::fill(weighted_box, weighted_box + box_size_, 0.0f);
+      float total_score = 0.0f;
+      for (int index : candidates_) {
+        const float score = scored_boxes_[index].score;
+        const float* box = boxes_.data() + index * box_size_;
+        total_score += score;
+        for (int c = 0; c < box_size_; ++c) {
+          weighted_box[c] += box[c] * score;
+        }
+      }
+      for (int c = 0; c < box_size_; ++c) {
+        weighted_box[c] /= total_score;
+      }
+    }
+
+    if (max_num_detections > -1 && detections_.size() >= max_num_detections) {
+      break;
+    }
+    // Stops if no box was merged into this detection.
+    if (next_remaining_.size() == remaining_.size()) {
+      break;
+    }
+    std::swap(remaining_, next_remaining_);
+  }
+}
+
+void DetectionDecoder::AddDetection(const ScoredBox& scored_box,
+                                    const float* box) {
+  detections_.push_back(scored_box);
+  detection_boxes_.insert(detection_boxes_.end(), box, box + box_size_);
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,119 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_DETECTIONS_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_DETECTIONS_UTILS_H_
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "mediapipe/calculators/tensor/tensors_to_detections_calculator.pb.h"
+#include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/framework/formats/object_detection/anchor.pb.h"
+
+namespace mediapipe {
+
+// A box whose best scoring class passed the score threshold.
+struct ScoredBox {
+  // The index of the box in the model output.
+  int box_index;
+  int class_id;
+  float score;
+};
+
+// Computes the overlap similarity of two boxes stored as
+// [ymin, xmin, ymax, xmax], with the same semantics as
+// NonMaxSuppressionCalculator.
+float OverlapSimilarity(
+    NonMaxSuppressionCalculatorOptions::OverlapType overlap_type,
+    const float* box1, const float* box2);
+
+// Decodes the output tensors of detection models into scored boxes, and
+// optionally applies non-maximum suppression to them, working on flat arrays
+// that are reused across calls.
+//
+// Scores are thresholded before any box is decoded, so only the boxes that
+// can become detections are decoded. Decoded boxes are stored as
+// [ymin, xmin, ymax, xmax] followed by [x, y] of each keypoint, in the
+// coordinate system of the model (i.e. before flip_vertically is applied).
+class DetectionDecoder {
+ public:
+  static constexpr int kNumCoordsPerBox = 4;
+
+  // class_ids are the classes that are not ignored, in increasing order.
+  DetectionDecoder(const TensorsToDetectionsCalculatorOptions& options,
+                   std::vector<int> class_ids);
+
+  void SetAnchors(const std::vector<Anchor>& anchors);
+  // raw_anchors holds [y_center, x_center, h, w] for each box.
+  void SetAnchors(const float* raw_anchors, int num_boxes);
+  bool has_anchors() const { return !anchors_.empty(); }
+
+  // Decodes the raw box and score tensors of a model without built-in
+  // postprocessing. raw_boxes holds num_boxes * num_coords values and
+  // raw_scores holds num_boxes * num_classes values. Requires anchors.
+  void DecodeRawTensors(const float* raw_boxes, const float* raw_scores);
+
+  // Selects from boxes that are already decoded, e.g. on GPU or by the model,
+  // given the best score and class of each box. boxes holds num_boxes *
+  // num_coords values laid out as [ymin, xmin, ymax, xmax] at the start of
+  // each box, and keypoints at keypoint_coord_offset.
+  void DecodeScoredBoxes(const float* boxes, const float* scores,
+                         const int* classes, int num_boxes);
+
+  // The results of the last decoding, ordered by box index or, with
+  // non-maximum suppression, by decreasing score.
+  int num_detections() const { return detections_.size(); }
+  const ScoredBox& detection(int i) const { return detections_[i]; }
+  absl::Span<const float> box(int i) const {
+    return absl::MakeConstSpan(detection_boxes_.data() + i * box_size_,
+                               box_size_);
+  }
+
+ private:
+  void SelectBoxes(const float* raw_scores);
+  void AddBox(int box_index, int class_id, float raw_score);
+  void DecodeBox(const float* raw_box, const float* anchor, float* box) const;
+  // Drops boxes with negative or NaN sizes, and runs non-maximum suppression
+  // if enabled.
+  void Finish();
+  void NonMaxSuppression();
+  void WeightedNonMaxSuppression();
+  void AddDetection(const ScoredBox& scored_box, const float* box);
+
+  const TensorsToDetectionsCalculatorOptions options_;
+  const std::vector<int> class_ids_;
+  const bool all_classes_;
+  // The number of floats per decoded box.
+  const int box_size_;
+  // Raw scores below this threshold cannot pass min_score_thresh.
+  float raw_score_threshold_;
+
+  // [y_center, x_center, h, w] for each box.
+  std::vector<float> anchors_;
+
+  // Scratch buffers, reused across calls.
+  std::vector<ScoredBox> scored_boxes_;
+  std::vector<float> boxes_;
+  std::vector<int> order_;
+  std::vector<int> remaining_;
+  std::vector<int> candidates_;
+  std::vector<int> next_remaining_;
+  std::vector<ScoredBox> detections_;
+  std::vector<float> detection_boxes_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_DETECTIONS_UTILS_H_
@@ -0,0 +1,232 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_detections_utils.h"
+
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/calculators/tensor/tensors_to_detections_calculator.pb.h"
+#include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kNumBoxes = 40;
+
+float Logit(float p) { return std::log(p / (1.0f - p)); }
+
+// Anchors at the center of the unit square, so that a raw box of
+// [0, 0, 0, 0] decodes to a 1x1 box around (0.5, 0.5) with unit scales.
+std::vector<float> CenteredAnchors(int num_boxes) {
+  std::vector<float> anchors;
+  for (int i = 0; i < num_boxes; ++i) {
+    anchors.insert(anchors.end(), {0.5f, 0.5f, 1.0f, 1.0f});
+  }
+  return anchors;
+}
+
+TensorsToDetectionsCalculatorOptions SingleClassOptions() {
+  return ParseTextProtoOrDie<TensorsToDetectionsCalculatorOptions>(R"pb(
+    num_classes: 1
+    num_boxes: 40
+    num_coords: 6
+    num_keypoints: 1
+    keypoint_coord_offset: 4
+    x_scale: 1
+    y_scale: 1
+    w_scale: 1
+    h_scale: 1
+    sigmoid_score: true
+    min_score_thresh: 0.5
+  )pb");
+}
+
+TEST(DetectionDecoderTest, DecodesOnlyBoxesAboveThreshold) {
+  DetectionDecoder decoder(SingleClassOptions(), {0});
+  const std::vector<float> anchors = CenteredAnchors(kNumBoxes);
+  decoder.SetAnchors(anchors.data(), kNumBoxes);
+
+  std::vector<float> raw_boxes(kNumBoxes * 6, 0.0f);
+  std::vector<float> raw_scores(kNumBoxes, -5.0f);
+  // Box 3 scores exactly at the threshold and box 33 above it.
+  raw_scores[3] = 0.0f;
+  raw_scores[33] = Logit(0.75f);
+  // [y_center, x_center, h, w, keypoint_y, keypoint_x] relative to anchors.
+  const float box[6] = {0.1f, -0.2f, 0.5f, 0.5f, 0.25f, -0.25f};
+  std::copy(box, box + 6, raw_boxes.begin() + 33 * 6);
+
+  decoder.DecodeRawTensors(raw_boxes.data(), raw_scores.data());
+  ASSERT_EQ(2, decoder.num_detections());
+  EXPECT_EQ(3, decoder.detection(0).box_index);
+  EXPECT_FLOAT_EQ(0.5f, decoder.detection(0).score);
+  EXPECT_EQ(33, decoder.detection(1).box_index);
+  EXPECT_EQ(0, decoder.detection(1).class_id);
+  EXPECT_NEAR(0.75f, decoder.detection(1).score, 1e-6);
+  // [ymin, xmin, ymax, xmax, keypoint_x, keypoint_y].
+  const std::vector<float> expected = {0.35f, 0.05f, 0.85f, 0.55f, 0.25f, 0.75f};
+  ASSERT_EQ(6, decoder.box(1).size());
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_FLOAT_EQ(expected[i], decoder.box(1)[i]) << i;
+  }
+}
+
+TEST(DetectionDecoderTest, SelectsBestClassWithClippingAndIgnoredClasses) {
+  auto options = ParseTextProtoOrDie<TensorsToDetectionsCalculatorOptions>(R"pb(
+    num_classes: 3
+    num_boxes: 2
+    num_coords: 4
+    x_scale: 1
+    y_scale: 1
+    w_scale: 1
+    h_scale: 1
+    sigmoid_score: true
+    score_clipping_thresh: 2
+    min_score_thresh: 0.6
+  )pb");
+  // Class 0 is ignored.
+  DetectionDecoder decoder(options, {1, 2});
+  const std::vector<float> anchors = CenteredAnchors(2);
+  decoder.SetAnchors(anchors.data(), 2);
+  const std::vector<float> raw_boxes(2 * 4, 0.0f);
+  // Box 0: classes 1 and 2 clip to the same score, so class 1 wins. Box 1
+  // scores only through the ignored class.
+  const std::vector<float> raw_scores = {9.0f, 3.0f, 5.0f,  //
+                                         9.0f, -1.0f, 0.0f};
+  decoder.DecodeRawTensors(raw_boxes.data(), raw_scores.data());
+  ASSERT_EQ(1, decoder.num_detections());
+  EXPECT_EQ(0, decoder.detection(0).box_index);
+  EXPECT_EQ(1, decoder.detection(0).class_id);
+  EXPECT_NEAR(1.0f / (1.0f + std::exp(-2.0f)), decoder.detection(0).score,
+              1e-6);
+}
+
+TEST(DetectionDecoderTest, SelectsClassOnRawScoresWhenSigmoidSaturates) {
+  auto options = ParseTextProtoOrDie<TensorsToDetectionsCalculatorOptions>(R"pb(
+    num_classes: 2
+    num_boxes: 1
+    num_coords: 4
+    x_scale: 1
+    y_scale: 1
+    w_scale: 1
+    h_scale: 1
+    sigmoid_score: true
+    min_score_thresh: 0.5
+  )pb");
+  DetectionDecoder decoder(options, {0, 1});
+  const std::vector<float> anchors = CenteredAnchors(1);
+  decoder.SetAnchors(anchors.data(), 1);
+  const std::vector<float> raw_boxes(4, 0.0f);
+  // Both scores have a sigmoid of 1.0f. The class is chosen on the raw
+  // scores, so class 1 wins rather than the first class.
+  const std::vector<float> raw_scores = {17.0f, 20.0f};
+  ASSERT_EQ(1.0f / (1.0f + std::exp(-raw_scores[0])),
+            1.0f / (1.0f + std::exp(-raw_scores[1])));
+  decoder.DecodeRawTensors(raw_boxes.data(), raw_scores.data());
+  ASSERT_EQ(1, decoder.num_detections());
+  EXPECT_EQ(1, decoder.detection(0).class_id);
+  EXPECT_FLOAT_EQ(1.0f, decoder.detection(0).score);
+}
+
+// Boxes stored as [ymin, xmin, ymax, xmax] with one score per box.
+struct TestBoxes {
+  std::vector<float> boxes;
+  std::vector<float> scores;
+  std::vector<int> classes;
+
+  void Add(float ymin, float xmin, float ymax, float xmax, float score) {
+    boxes.insert(boxes.end(), {ymin, xmin, ymax, xmax});
+    scores.push_back(score);
+    classes.push_back(0);
+  }
+};
+
+TensorsToDetectionsCalculatorOptions NmsOptions(
+    const std::string& nms_options) {
+  auto options = ParseTextProtoOrDie<TensorsToDetectionsCalculatorOptions>(R"pb(
+    num_classes: 1 num_boxes: 1 num_coords: 4
+  )pb");
+  *options.mutable_non_max_suppression() =
+      ParseTextProtoOrDie<NonMaxSuppressionCalculatorOptions>(nms_options);
+  return options;
+}
+
+TEST(DetectionDecoderTest, SuppressesOverlappingBoxes) {
+  DetectionDecoder decoder(NmsOptions(R"pb(
+                             min_suppression_threshold: 0.3
+                             overlap_type: INTERSECTION_OVER_UNION
+                             max_num_detections: 2
+                           )pb"),
+                           {0});
+  TestBoxes boxes;
+  boxes.Add(0.0f, 0.0f, 0.5f, 0.5f, 0.6f);
+  boxes.Add(0.0f, 0.05f, 0.5f, 0.55f, 0.9f);  // Suppresses the first box.
+  boxes.Add(0.6f, 0.6f, 0.9f, 0.9f, 0.7f);
+  boxes.Add(0.0f, 0.6f, 0.2f, 0.9f, 0.5f);  // Beyond max_num_detections.
+  boxes.Add(0.5f, 0.5f, 0.4f, 0.6f, 0.95f);  // Negative height, dropped.
+  decoder.DecodeScoredBoxes(boxes.boxes.data(), boxes.scores.data(),
+                            boxes.classes.data(), boxes.scores.size());
+  ASSERT_EQ(2, decoder.num_detections());
+  EXPECT_EQ(1, decoder.detection(0).box_index);
+  EXPECT_EQ(2, decoder.detection(1).box_index);
+  EXPECT_FLOAT_EQ(0.6f, decoder.box(1)[0]);
+}
+
+TEST(DetectionDecoderTest, AveragesBoxesWithWeightedSuppression) {
+  DetectionDecoder decoder(NmsOptions(R"pb(
+                             min_suppression_threshold: 0.3
+                             overlap_type: INTERSECTION_OVER_UNION
+                             algorithm: WEIGHTED
+                           )pb"),
+                           {0});
+  TestBoxes boxes;
+  boxes.Add(0.0f, 0.0f, 0.4f, 0.4f, 0.25f);
+  boxes.Add(0.0f, 0.1f, 0.4f, 0.5f, 0.75f);
+  boxes.Add(0.6f, 0.6f, 0.9f, 0.9f, 0.5f);
+  decoder.DecodeScoredBoxes(boxes.boxes.data(), boxes.scores.data(),
+                            boxes.classes.data(), boxes.scores.size());
+  ASSERT_EQ(2, decoder.num_detections());
+  EXPECT_EQ(1, decoder.detection(0).box_index);
+  EXPECT_FLOAT_EQ(0.75f, decoder.detection(0).score);
+  // Weighted by score: xmin = 0.25 * 0.0 + 0.75 * 0.1.
+  EXPECT_FLOAT_EQ(0.075f, decoder.box(0)[1]);
+  EXPECT_FLOAT_EQ(0.475f, decoder.box(0)[3]);
+  EXPECT_EQ(2, decoder.detection(1).box_index);
+}
+
+TEST(DetectionDecoderTest, ComputesOverlapLikeNonMaxSuppressionCalculator) {
+  const float box1[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+  const float box2[4] = {0.5f, 0.0f, 1.0f, 2.0f};
+  // Intersection 0.5, areas 1 and 1, bounding box of both 2.
+  EXPECT_FLOAT_EQ(0.25f, OverlapSimilarity(
+                             NonMaxSuppressionCalculatorOptions::JACCARD,
+                             box1, box2));
+  EXPECT_FLOAT_EQ(
+      0.5f, OverlapSimilarity(
+                NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD, box1,
+                box2));
+  EXPECT_FLOAT_EQ(
+      1.0f / 3, OverlapSimilarity(
+                    NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION,
+                    box1, box2));
+  const float far_box[4] = {2.0f, 2.0f, 3.0f, 3.0f};
+  EXPECT_EQ(0.0f, OverlapSimilarity(
+                      NonMaxSuppressionCalculatorOptions::JACCARD, box1,
+                      far_box));
+}
+
+}  // namespace
+}  // namespace mediapipe
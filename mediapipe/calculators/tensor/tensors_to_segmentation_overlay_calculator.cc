@@ -0,0 +1,429 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_overlay_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/util/color.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kTensorsTag[] = "TENSORS";
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kBackgroundTag[] = "BACKGROUND";
+constexpr char kMaskTag[] = "MASK";
+
+using Options = ::mediapipe::TensorsToSegmentationCalculatorOptions;
+
+absl::StatusOr<std::tuple<int, int, int>> GetHwcFromDims(
+    const std::vector<int>& dims) {
+  if (dims.size() == 3) {
+    return std::make_tuple(dims[0], dims[1], dims[2]);
+  } else if (dims.size() == 4) {
+    // BHWC format check B == 1
+    RET_CHECK_EQ(1, dims[0]) << "Expected batch to be 1 for BHWC heatmap";
+    return std::make_tuple(dims[1], dims[2], dims[3]);
+  } else {
+    RET_CHECK(false) << "Invalid shape for segmentation tensor " << dims.size();
+  }
+}
+
+// Uncertainty estimate of a mask value, see SegmentationSmoothingCalculator.
+inline float Uncertainty(float mask_value) {
+  constexpr float c1 = 5.68842;
+  constexpr float c2 = -0.748699;
+  constexpr float c3 = -57.8051;
+  constexpr float c4 = 291.309;
+  constexpr float c5 = -624.717;
+  const float t = mask_value - 0.5f;
+  const float x = t * t;
+  return 1.0f -
+         std::min(1.0f, x * (c1 + x * (c2 + x * (c3 + x * (c4 + x * c5)))));
+}
+
+inline uint8 ToUint8(float value) {
+  return static_cast<uint8>(std::min(255.0f, std::max(0.0f, value + 0.5f)));
+}
+
+// Source taps of linear interpolation from `src_size` to `dst_size` samples,
+// with the pixel center convention of cv::resize(INTER_LINEAR).
+void ComputeLinearTaps(int src_size, int dst_size, std::vector<int>* index0,
+                       std::vector<int>* index1, std::vector<float>* weight) {
+  index0->resize(dst_size);
+  index1->resize(dst_size);
+  weight->resize(dst_size);
+  const float scale = static_cast<float>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; ++i) {
+    const float src = std::max(0.0f, (i + 0.5f) * scale - 0.5f);
+    const int i0 = std::min(static_cast<int>(src), src_size - 1);
+    (*index0)[i] = i0;
+    (*index1)[i] = std::min(i0 + 1, src_size - 1);
+    (*weight)[i] = i0 + 1 < src_size ? src - i0 : 0.0f;
+  }
+}
+
+}  // namespace
+
+// Converts Tensors from a tflite segmentation model into a mask and composites
+// it onto an image in a single pass on CPU.
+//
+// This fuses the CPU paths of TensorsToSegmentationCalculator,
+// SegmentationSmoothingCalculator and RecolorCalculator (or a CPU mask overlay
+// with a background image): the activation and the temporal smoothing run at
+// the tensor resolution, and the mask is upsampled one output row at a time
+// right before blending, so no full resolution mask is ever allocated. The
+// separate calculators remain available, e.g. to inspect intermediate masks.
+//
+// Unlike SegmentationSmoothingCalculator, smoothing blends with the previous
+// mask at the tensor resolution, which is kept internally instead of being
+// fed back through a MASK_PREVIOUS input.
+//
+// Inputs:
+//   TENSORS: Vector of Tensor, as for TensorsToSegmentationCalculator.
+//   IMAGE: An ImageFrame input image in ImageFormat::SRGB or SRGBA.
+//   BACKGROUND (optional): An ImageFrame of the same size and format as IMAGE.
+//     If connected, it is blended in where the mask is > 0 instead of the
+//     color from the options.
+//
+// Outputs:
+//   IMAGE: An ImageFrame output image, in the format of the input image.
+//   MASK (optional): The smoothed mask at the tensor resolution, as an
+//     ImageFormat::VEC32F1 ImageFrame with values scaled 0-1.
+//
+// Options:
+//   See tensors_to_segmentation_overlay_calculator.proto
+//
+// Usage example:
+// node {
+//   calculator: "TensorsToSegmentationOverlayCalculator"
+//   input_stream: "TENSORS:output_tensors"
+//   input_stream: "IMAGE:input_video"
+//   output_stream: "IMAGE:output_video"
+//   options: {
+//     [mediapipe.TensorsToSegmentationOverlayCalculatorOptions.ext] {
+//       activation: NONE
+//       combine_with_previous_ratio: 0.7
+//       color { r: 0 g: 0 b: 255 }
+//       invert_mask: true
+//       adjust_with_luminance: false
+//     }
+//   }
+// }
+//
+class TensorsToSegmentationOverlayCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  // Applies the activation to `tensor` and smooths the result with the
+  // previous mask into mask_.
+  absl::Status UpdateMask(const Tensor& tensor);
+
+  // Stores the activated tensor values into mask_, blending them with the
+  // previous values if `smooth`.
+  template <typename ActivationFn>
+  void StoreMask(const float* tensor_data, int tensor_channels, bool smooth,
+                 const ActivationFn& activation_fn);
+
+  // Linearly interpolates mask_ row `src_row` to the output width.
+  void UpsampleMaskRow(int src_row, float* dst) const;
+
+  // Blends `num_pixels` pixels of `image` with `background`, or with color_ if
+  // `background` is null, according to `mask`.
+  void BlendRow(const uint8* image, const uint8* background, const float* mask,
+                int num_pixels, int num_channels, uint8* output) const;
+
+  ::mediapipe::TensorsToSegmentationOverlayCalculatorOptions options_;
+  float color_[3];
+
+  // The smoothed mask at the tensor resolution.
+  std::vector<float> mask_;
+  int mask_width_ = 0;
+  int mask_height_ = 0;
+
+  // Interpolation taps for the current mask and output sizes.
+  int output_width_ = 0;
+  int output_height_ = 0;
+  int taps_mask_width_ = 0;
+  int taps_mask_height_ = 0;
+  std::vector<int> x0_, x1_, y0_, y1_;
+  std::vector<float> wx_, wy_;
+
+  // Mask rows interpolated to the output width, and the mask row they were
+  // interpolated from.
+  std::vector<float> upper_row_, lower_row_, mask_row_;
+  int upper_row_index_ = -1;
+  int lower_row_index_ = -1;
+};
+REGISTER_CALCULATOR(TensorsToSegmentationOverlayCalculator);
+
+// static
+absl::Status TensorsToSegmentationOverlayCalculator::GetContract(
+    CalculatorContract* cc) {
+  cc->Inputs().Tag(kTensorsTag).Set<std::vector<Tensor>>();
+  cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+  if (cc->Inputs().HasTag(kBackgroundTag)) {
+    cc->Inputs().Tag(kBackgroundTag).Set<ImageFrame>();
+  }
+  cc->Outputs().Tag(kImageTag).Set<ImageFrame>();
+  if (cc->Outputs().HasTag(kMaskTag)) {
+    cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TensorsToSegmentationOverlayCalculator::Open(
+    CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  options_ =
+      cc->Options<::mediapipe::TensorsToSegmentationOverlayCalculatorOptions>();
+  if (!cc->Inputs().HasTag(kBackgroundTag)) {
+    RET_CHECK(options_.has_color()) << "Missing color option.";
+  }
+  color_[0] = options_.color().r();
+  color_[1] = options_.color().g();
+  color_[2] = options_.color().b();
+  if (options_.activation() == Options::SOFTMAX) {
+    RET_CHECK(options_.output_layer_index() == 0 ||
+              options_.output_layer_index() == 1);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TensorsToSegmentationOverlayCalculator::Process(
+    CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kImageTag).IsEmpty()) {
+    return absl::OkStatus();
+  }
+  if (cc->Inputs().Tag(kTensorsTag).IsEmpty()) {
+    cc->Outputs().Tag(kImageTag).AddPacket(cc->Inputs().Tag(kImageTag).Value());
+    return absl::OkStatus();
+  }
+
+  const auto& input_tensors =
+      cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
+  RET_CHECK(!input_tensors.empty());
+  MP_RETURN_IF_ERROR(UpdateMask(input_tensors[0]));
+
+  const auto& input_image = cc->Inputs().Tag(kImageTag).Get<ImageFrame>();
+  RET_CHECK(input_image.Format() == ImageFormat::SRGB ||
+            input_image.Format() == ImageFormat::SRGBA)
+      << "Unsupported image format " << input_image.Format();
+  const ImageFrame* background = nullptr;
+  if (cc->Inputs().HasTag(kBackgroundTag)) {
+    RET_CHECK(!cc->Inputs().Tag(kBackgroundTag).IsEmpty());
+    background = &cc->Inputs().Tag(kBackgroundTag).Get<ImageFrame>();
+    RET_CHECK_EQ(background->Format(), input_image.Format());
+    RET_CHECK_EQ(background->Width(), input_image.Width());
+    RET_CHECK_EQ(background->Height(), input_image.Height());
+  }
+
+  const int width = input_image.Width();
+  const int height = input_image.Height();
+  if (width != output_width_ || height != output_height_ ||
+      mask_width_ != taps_mask_width_ || mask_height_ != taps_mask_height_) {
+    output_width_ = width;
+    output_height_ = height;
+    taps_mask_width_ = mask_width_;
+    taps_mask_height_ = mask_height_;
+    ComputeLinearTaps(mask_width_, width, &x0_, &x1_, &wx_);
+    ComputeLinearTaps(mask_height_, height, &y0_, &y1_, &wy_);
+    upper_row_.resize(width);
+    lower_row_.resize(width);
+    mask_row_.resize(width);
+  }
+  upper_row_index_ = -1;
+  lower_row_index_ = -1;
+
+  auto output_image = absl::make_unique<ImageFrame>(input_image.Format(), width,
+                                                    height);
+  const int num_channels = input_image.NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    // Consecutive output rows mostly share their source rows, which are
+    // interpolated horizontally only once.
+    if (upper_row_index_ != y0_[y]) {
+      if (lower_row_index_ == y0_[y]) {
+        std::swap(upper_row_, lower_row_);
+        std::swap(upper_row_index_, lower_row_index_);
+      } else {
+        UpsampleMaskRow(y0_[y], upper_row_.data());
+        upper_row_index_ = y0_[y];
+      }
+    }
+    if (lower_row_index_ != y1_[y]) {
+      UpsampleMaskRow(y1_[y], lower_row_.data());
+      lower_row_index_ = y1_[y];
+    }
+    const float wy = wy_[y];
+    const float* upper = upper_row_.data();
+    const float* lower = lower_row_.data();
+    float* mask_row = mask_row_.data();
+    for (int x = 0; x < width; ++x) {
+      mask_row[x] = upper[x] + (lower[x] - upper[x]) * wy;
+    }
+    BlendRow(input_image.PixelData() + y * input_image.WidthStep(),
+             background
+                 ? background->PixelData() + y * background->WidthStep()
+                 : nullptr,
+             mask_row, width, num_channels,
+             output_image->MutablePixelData() + y * output_image->WidthStep());
+  }
+  cc->Outputs().Tag(kImageTag).Add(output_image.release(),
+                                   cc->InputTimestamp());
+
+  if (cc->Outputs().HasTag(kMaskTag)) {
+    auto mask_frame = absl::make_unique<ImageFrame>(
+        ImageFormat::VEC32F1, mask_width_, mask_height_);
+    for (int y = 0; y < mask_height_; ++y) {
+      std::copy_n(mask_.data() + y * mask_width_, mask_width_,
+                  reinterpret_cast<float*>(mask_frame->MutablePixelData() +
+                                           y * mask_frame->WidthStep()));
+    }
+    cc->Outputs().Tag(kMaskTag).Add(mask_frame.release(), cc->InputTimestamp());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TensorsToSegmentationOverlayCalculator::UpdateMask(
+    const Tensor& tensor) {
+  ASSIGN_OR_RETURN(auto hwc, GetHwcFromDims(tensor.shape().dims));
+  auto [tensor_height, tensor_width, tensor_channels] = hwc;
+  switch (options_.activation()) {
+    case Options::NONE:
+    case Options::SIGMOID:
+      RET_CHECK_EQ(tensor_channels, 1);
+      break;
+    case Options::SOFTMAX:
+      RET_CHECK_EQ(tensor_channels, 2);
+      break;
+  }
+
+  // Smoothing needs a previous mask of the same size.
+  const bool smooth = options_.combine_with_previous_ratio() > 0.0f &&
+                      tensor_width == mask_width_ &&
+                      tensor_height == mask_height_;
+  mask_width_ = tensor_width;
+  mask_height_ = tensor_height;
+  mask_.resize(tensor_width * tensor_height);
+
+  auto view = tensor.GetCpuReadView();
+  const float* data = view.buffer<float>();
+  RET_CHECK(data) << "Expected a float32 segmentation tensor.";
+  // The activation is selected outside of the loops so that they can be
+  // vectorized.
+  switch (options_.activation()) {
+    case Options::NONE:
+      StoreMask(data, tensor_channels, smooth,
+                [](const float* value) { return value[0]; });
+      break;
+    case Options::SIGMOID:
+      StoreMask(data, tensor_channels, smooth, [](const float* value) {
+        return 1.0f / (std::exp(-value[0]) + 1.0f);
+      });
+      break;
+    case Options::SOFTMAX: {
+      // softmax(v)[i] == sigmoid(v[i] - v[1 - i]) for two channels.
+      const int index = options_.output_layer_index();
+      StoreMask(data, tensor_channels, smooth, [index](const float* value) {
+        return 1.0f / (std::exp(value[1 - index] - value[index]) + 1.0f);
+      });
+      break;
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <typename ActivationFn>
+void TensorsToSegmentationOverlayCalculator::StoreMask(
+    const float* tensor_data, int tensor_channels, bool smooth,
+    const ActivationFn& activation_fn) {
+  const int size = mask_.size();
+  float* mask = mask_.data();
+  if (!smooth) {
+    for (int i = 0; i < size; ++i) {
+      mask[i] = activation_fn(tensor_data + i * tensor_channels);
+    }
+    return;
+  }
+  const float ratio = options_.combine_with_previous_ratio();
+  for (int i = 0; i < size; ++i) {
+    const float new_mask_value = activation_fn(tensor_data + i * tensor_channels);
+    mask[i] = new_mask_value + (mask[i] - new_mask_value) *
+                                   (Uncertainty(new_mask_value) * ratio);
+  }
+}
+
+void TensorsToSegmentationOverlayCalculator::UpsampleMaskRow(
+    int src_row, float* dst) const {
+  const float* src = mask_.data() + src_row * mask_width_;
+  const int* x0 = x0_.data();
+  const int* x1 = x1_.data();
+  const float* wx = wx_.data();
+  for (int x = 0; x < output_width_; ++x) {
+    dst[x] = src[x0[x]] + (src[x1[x]] - src[x0[x]]) * wx[x];
+  }
+}
+
+void TensorsToSegmentationOverlayCalculator::BlendRow(
+    const uint8* image, const uint8* background, const float* mask,
+    int num_pixels, int num_channels, uint8* output) const {
+  const bool invert_mask = options_.invert_mask();
+  // From RecolorCalculator:
+  //   mix_value = weight * luminance(color1)
+  //   output = mix(color1, color2, mix_value)
+  // where luminance is 1 unless adjust_with_luminance is set. The luminance
+  // is not applied when blending with a background image.
+  const bool adjust_with_luminance =
+      background == nullptr && options_.adjust_with_luminance();
+  for (int x = 0; x < num_pixels; ++x) {
+    const uint8* color1 = image + x * num_channels;
+    const float weight = invert_mask ? 1.0f - mask[x] : mask[x];
+    const float luminance =
+        adjust_with_luminance
+            ? (color1[0] * 0.299f + color1[1] * 0.587f + color1[2] * 0.114f) /
+                  255.0f
+            : 1.0f;
+    const float mix_value = weight * luminance;
+    uint8* out = output + x * num_channels;
+    for (int c = 0; c < 3; ++c) {
+      const float color2 =
+          background ? background[x * num_channels + c] : color_[c];
+      out[c] = ToUint8(color1[c] + (color2 - color1[c]) * mix_value);
+    }
+    if (num_channels == 4) {
+      out[3] = color1[3];
+    }
+  }
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,210 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using Node = ::mediapipe::CalculatorGraphConfig::Node;
+
+constexpr float kMaskErrorMargin = 1e-5f;
+
+Packet MakeTensorsPacket(int height, int width, int channels,
+                         const std::vector<float>& values, int64 timestamp) {
+  auto tensors = absl::make_unique<std::vector<Tensor>>();
+  tensors->emplace_back(Tensor::ElementType::kFloat32,
+                        Tensor::Shape{1, height, width, channels});
+  auto view = tensors->back().GetCpuWriteView();
+  std::copy(values.begin(), values.end(), view.buffer<float>());
+  return Adopt(tensors.release()).At(Timestamp(timestamp));
+}
+
+Packet MakeImagePacket(int width, int height, uint8 r, uint8 g, uint8 b,
+                       int64 timestamp) {
+  auto image = absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8* row = image->MutablePixelData() + y * image->WidthStep();
+    for (int x = 0; x < width; ++x) {
+      row[x * 3] = r;
+      row[x * 3 + 1] = g;
+      row[x * 3 + 2] = b;
+    }
+  }
+  return Adopt(image.release()).At(Timestamp(timestamp));
+}
+
+const uint8* Pixel(const ImageFrame& image, int x, int y) {
+  return image.PixelData() + y * image.WidthStep() + x * 3;
+}
+
+float MaskAt(const ImageFrame& mask, int x, int y) {
+  return reinterpret_cast<const float*>(mask.PixelData() +
+                                        y * mask.WidthStep())[x];
+}
+
+TEST(TensorsToSegmentationOverlayCalculatorTest, UpsamplesAndRecolors) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "TensorsToSegmentationOverlayCalculator"
+    input_stream: "TENSORS:tensors"
+    input_stream: "IMAGE:image"
+    output_stream: "IMAGE:output"
+    output_stream: "MASK:mask"
+    options: {
+      [mediapipe.TensorsToSegmentationOverlayCalculatorOptions.ext] {
+        color { r: 0 g: 0 b: 200 }
+        adjust_with_luminance: false
+      }
+    }
+  )pb"));
+  // A 2x1 mask upsampled to 4x2 is {0, 0.25, 0.75, 1} on every row.
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(1, 2, 1, {0.0f, 1.0f}, 0));
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      MakeImagePacket(4, 2, 100, 40, 0, 0));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& outputs = runner.Outputs().Tag("IMAGE").packets;
+  ASSERT_EQ(1, outputs.size());
+  const auto& output = outputs[0].Get<ImageFrame>();
+  ASSERT_EQ(4, output.Width());
+  ASSERT_EQ(2, output.Height());
+  const float weights[] = {0.0f, 0.25f, 0.75f, 1.0f};
+  for (int y = 0; y < 2; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      const uint8* pixel = Pixel(output, x, y);
+      EXPECT_EQ(std::lround(100 * (1 - weights[x])), pixel[0]);
+      EXPECT_EQ(std::lround(40 * (1 - weights[x])), pixel[1]);
+      EXPECT_EQ(std::lround(200 * weights[x]), pixel[2]);
+    }
+  }
+
+  const auto& masks = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(1, masks.size());
+  const auto& mask = masks[0].Get<ImageFrame>();
+  EXPECT_EQ(ImageFormat::VEC32F1, mask.Format());
+  EXPECT_EQ(2, mask.Width());
+  EXPECT_EQ(1, mask.Height());
+}
+
+TEST(TensorsToSegmentationOverlayCalculatorTest, SmoothsWithPreviousMask) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "TensorsToSegmentationOverlayCalculator"
+    input_stream: "TENSORS:tensors"
+    input_stream: "IMAGE:image"
+    output_stream: "IMAGE:output"
+    output_stream: "MASK:mask"
+    options: {
+      [mediapipe.TensorsToSegmentationOverlayCalculatorOptions.ext] {
+        activation: SIGMOID
+        combine_with_previous_ratio: 0.9
+        color { r: 255 g: 255 b: 255 }
+      }
+    }
+  )pb"));
+  // sigmoid(0) = 0.5 is fully uncertain, so the previous value is mostly
+  // kept. sigmoid(10) is certain, so the new value is used.
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(1, 2, 1, {-10.0f, -10.0f}, 0));
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(1, 2, 1, {0.0f, 10.0f}, 1));
+  for (int t = 0; t < 2; ++t) {
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+        MakeImagePacket(2, 1, 0, 0, 0, t));
+  }
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& masks = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(2, masks.size());
+  const float previous = 1.0f / (1.0f + std::exp(10.0f));
+  EXPECT_NEAR(previous, MaskAt(masks[0].Get<ImageFrame>(), 0, 0),
+              kMaskErrorMargin);
+  const auto& smoothed = masks[1].Get<ImageFrame>();
+  EXPECT_NEAR(0.5f + (previous - 0.5f) * 0.9f, MaskAt(smoothed, 0, 0),
+              kMaskErrorMargin);
+  // The uncertainty polynomial is only approximately 0 at the extremes.
+  EXPECT_NEAR(1.0f / (1.0f + std::exp(-10.0f)), MaskAt(smoothed, 1, 0),
+              1e-3f);
+}
+
+TEST(TensorsToSegmentationOverlayCalculatorTest, BlendsBackgroundWithSoftmax) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "TensorsToSegmentationOverlayCalculator"
+    input_stream: "TENSORS:tensors"
+    input_stream: "IMAGE:image"
+    input_stream: "BACKGROUND:background"
+    output_stream: "IMAGE:output"
+    options: {
+      [mediapipe.TensorsToSegmentationOverlayCalculatorOptions.ext] {
+        activation: SOFTMAX
+        output_layer_index: 1
+        invert_mask: true
+      }
+    }
+  )pb"));
+  // Channel 1 wins in the first pixel, channel 0 in the second.
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      MakeTensorsPacket(1, 2, 2, {-20.0f, 20.0f, 20.0f, -20.0f}, 0));
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      MakeImagePacket(2, 1, 10, 20, 30, 0));
+  runner.MutableInputs()->Tag("BACKGROUND").packets.push_back(
+      MakeImagePacket(2, 1, 200, 150, 100, 0));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& outputs = runner.Outputs().Tag("IMAGE").packets;
+  ASSERT_EQ(1, outputs.size());
+  const auto& output = outputs[0].Get<ImageFrame>();
+  // With invert_mask, the foreground keeps the image and the rest is replaced
+  // by the background.
+  EXPECT_EQ(10, Pixel(output, 0, 0)[0]);
+  EXPECT_EQ(30, Pixel(output, 0, 0)[2]);
+  EXPECT_EQ(200, Pixel(output, 1, 0)[0]);
+  EXPECT_EQ(100, Pixel(output, 1, 0)[2]);
+}
+
+TEST(TensorsToSegmentationOverlayCalculatorTest, PassesImageWithoutTensors) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "TensorsToSegmentationOverlayCalculator"
+    input_stream: "TENSORS:tensors"
+    input_stream: "IMAGE:image"
+    output_stream: "IMAGE:output"
+    options: {
+      [mediapipe.TensorsToSegmentationOverlayCalculatorOptions.ext] {
+        color { r: 255 g: 0 b: 0 }
+      }
+    }
+  )pb"));
+  const Packet image = MakeImagePacket(2, 2, 1, 2, 3, 0);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(image);
+  MP_ASSERT_OK(runner.Run());
+  const auto& outputs = runner.Outputs().Tag("IMAGE").packets;
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_EQ(&image.Get<ImageFrame>(), &outputs[0].Get<ImageFrame>());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,148 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensorflow/inference_batcher.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/profiler/time_histogram_util.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The precision of the queue wait histograms, within about 6%.
+constexpr int kQueueWaitPrecisionBits = 5;
+
+}  // namespace
+
+const GraphService<InferenceBatcher> kInferenceBatcherService(
+    "inference_batcher");
+
+absl::Status InferenceBatcher::Run(const std::string& queue_name,
+                                   const Options& options,
+                                   RunBatchFunction run_batch, Task* task) {
+  mutex_.Lock();
+  std::unique_ptr<Queue>& queue_ptr = queues_[queue_name];
+  if (!queue_ptr) {
+    queue_ptr = absl::make_unique<Queue>();
+    queue_ptr->options = options;
+    InitializeLogBuckets(kQueueWaitPrecisionBits,
+                         &queue_ptr->stats.queue_wait);
+  }
+  Queue& queue = *queue_ptr;
+  task->enqueue_time_ = absl::Now();
+  task->done_ = false;
+  task->status_ = absl::OkStatus();
+  queue.tasks.push_back(task);
+  ++num_callers_;
+  // The new task may complete a batch for a waiting caller, and the new caller
+  // may leave no thread to add tasks to any queue.
+  for (auto& name_and_queue : queues_) {
+    Queue& other_queue = *name_and_queue.second;
+    if (other_queue.options.max_callers > 0 &&
+        num_callers_ >= other_queue.options.max_callers) {
+      other_queue.num_tasks_to_flush = other_queue.tasks.size();
+      other_queue.cond.SignalAll();
+    } else if (&other_queue == &queue) {
+      other_queue.cond.SignalAll();
+    }
+  }
+
+  while (!task->done_) {
+    const absl::Time now = absl::Now();
+    if (HasReadyBatch(queue, now)) {
+      const int batch_size = std::min<int>(queue.tasks.size(),
+                                           queue.options.max_batch_size);
+      std::vector<Task*> batch(queue.tasks.begin(),
+                               queue.tasks.begin() + batch_size);
+      queue.tasks.erase(queue.tasks.begin(),
+                        queue.tasks.begin() + batch_size);
+      queue.num_tasks_to_flush =
+          std::max(queue.num_tasks_to_flush - batch_size, 0);
+      const int padded_batch_size = PaddedBatchSize(queue.options, batch_size);
+
+      QueueStats& stats = queue.stats;
+      ++stats.num_batches;
+      stats.num_tasks += batch_size;
+      stats.num_padding += padded_batch_size - batch_size;
+      if (stats.batch_size_counts.size() <= batch_size) {
+        stats.batch_size_counts.resize(batch_size + 1);
+      }
+      ++stats.batch_size_counts[batch_size];
+      for (Task* batch_task : batch) {
+        batch_task->queue_wait_ = now - batch_task->enqueue_time_;
+        batch_task->batch_size_ = batch_size;
+        batch_task->padded_batch_size_ = padded_batch_size;
+        AddTimeHistogramSample(
+            absl::ToInt64Microseconds(batch_task->queue_wait_),
+            &stats.queue_wait);
+      }
+
+      // Run the batch unlocked, so that the next batch can form meanwhile.
+      mutex_.Unlock();
+      const absl::Status status = run_batch(batch, padded_batch_size);
+      mutex_.Lock();
+      for (Task* batch_task : batch) {
+        if (!status.ok()) {
+          batch_task->status_ = status;
+        }
+        batch_task->done_ = true;
+      }
+      queue.cond.SignalAll();
+    } else if (queue.tasks.empty()) {
+      // The task is in a batch run by another caller.
+      queue.cond.Wait(&mutex_);
+    } else {
+      queue.cond.WaitWithDeadline(
+          &mutex_,
+          queue.tasks.front()->enqueue_time_ + queue.options.batch_timeout);
+    }
+  }
+  --num_callers_;
+  const absl::Status status = task->status_;
+  mutex_.Unlock();
+  return status;
+}
+
+InferenceBatcher::QueueStats InferenceBatcher::GetQueueStats(
+    const std::string& queue_name) const {
+  absl::MutexLock lock(&mutex_);
+  auto iter = queues_.find(queue_name);
+  if (iter == queues_.end()) {
+    return QueueStats();
+  }
+  return iter->second->stats;
+}
+
+bool InferenceBatcher::HasReadyBatch(const Queue& queue, absl::Time now) {
+  return !queue.tasks.empty() &&
+         (queue.tasks.size() >= queue.options.max_batch_size ||
+          queue.num_tasks_to_flush > 0 ||
+          now >= queue.tasks.front()->enqueue_time_ +
+                     queue.options.batch_timeout);
+}
+
+int InferenceBatcher::PaddedBatchSize(const Options& options,
+                                      int batch_size) {
+  for (int allowed_batch_size : options.allowed_batch_sizes) {
+    if (allowed_batch_size >= batch_size) {
+      return allowed_batch_size;
+    }
+  }
+  return batch_size;
+}
+
+}  // namespace mediapipe
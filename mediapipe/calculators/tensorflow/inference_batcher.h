@@ -0,0 +1,179 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSORFLOW_INFERENCE_BATCHER_H_
+#define MEDIAPIPE_CALCULATORS_TENSORFLOW_INFERENCE_BATCHER_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+// Forms batches from tasks submitted concurrently, e.g. by the Process calls
+// of calculators with max_in_flight > 1, or of calculators in several graphs.
+// A batch runs once it holds max_batch_size tasks, or once its oldest task has
+// waited for batch_timeout, whichever comes first. So a batch is full when
+// tasks arrive quickly, and a task waits at most batch_timeout (plus the run
+// time of the batches ahead of it) when they arrive slowly.
+//
+// Tasks are kept in named queues, and only tasks of the same queue are
+// batched together. Each caller of Run waits for its own task, and one of the
+// waiting callers runs each batch, so the batcher has no threads of its own.
+//
+// Example:
+//   struct MyTask : public InferenceBatcher::Task {
+//     Input input;
+//     Output output;
+//   };
+//   MyTask task;
+//   task.input = ...;
+//   MP_RETURN_IF_ERROR(batcher.Run(
+//       "my_model", options,
+//       [](absl::Span<InferenceBatcher::Task* const> tasks, int batch_size) {
+//         // Run the model on the inputs of the tasks, padded to batch_size,
+//         // and set the outputs of the tasks.
+//       },
+//       &task));
+//   Use(task.output);
+class InferenceBatcher {
+ public:
+  struct Options {
+    // The maximum number of tasks in a batch.
+    int max_batch_size = 1;
+    // How long the oldest task of a queue waits for more tasks before a
+    // smaller batch is run. Zero runs whatever tasks are queued right away.
+    absl::Duration batch_timeout = absl::ZeroDuration();
+    // If not empty, the increasing batch sizes a model accepts. A batch is
+    // padded to the smallest of them that fits it, so that the model sees only
+    // a few shapes. The last one must be at least max_batch_size.
+    std::vector<int> allowed_batch_sizes;
+    // If positive, the number of threads that can call Run, e.g. the size of
+    // the executor of the calling calculators. Callers block in Run, so once
+    // that many of them wait, no more tasks can arrive, and the tasks queued
+    // then run without waiting for batch_timeout. The callers of all queues
+    // are counted, since they usually share the threads.
+    int max_callers = 0;
+  };
+
+  // A unit of work in a batch. Callers derive from it to hold their inputs
+  // and outputs.
+  class Task {
+   public:
+    virtual ~Task() = default;
+
+    // How long the task waited in its queue before its batch started running.
+    absl::Duration queue_wait() const { return queue_wait_; }
+
+    // The number of tasks in the batch of this task, and the size the batch
+    // was padded to.
+    int batch_size() const { return batch_size_; }
+    int padded_batch_size() const { return padded_batch_size_; }
+
+    // Fails this task only, e.g. if its inputs don't fit the other tasks of
+    // its batch. Called by RunBatchFunction; Run returns the status, unless
+    // the whole batch fails.
+    void set_status(absl::Status status) { status_ = std::move(status); }
+
+   private:
+    friend class InferenceBatcher;
+
+    absl::Time enqueue_time_;
+    absl::Duration queue_wait_;
+    int batch_size_ = 0;
+    int padded_batch_size_ = 0;
+    bool done_ = false;
+    absl::Status status_;
+  };
+
+  // Runs a batch of tasks, which is padded to padded_batch_size, at least
+  // tasks.size(). It is called by one of the callers of Run without any lock
+  // held, and may run concurrently with other batches. An error fails all the
+  // tasks of the batch; see Task::set_status to fail only some of them.
+  using RunBatchFunction = std::function<absl::Status(
+      absl::Span<Task* const> tasks, int padded_batch_size)>;
+
+  // Statistics of a queue.
+  struct QueueStats {
+    int64 num_batches = 0;
+    int64 num_tasks = 0;
+    // Padding added to reach an allowed batch size.
+    int64 num_padding = 0;
+    // The number of batches of each size, before padding.
+    std::vector<int64> batch_size_counts;
+    // How long tasks waited in the queue, in log-linear buckets.
+    TimeHistogram queue_wait;
+  };
+
+  InferenceBatcher() = default;
+  InferenceBatcher(const InferenceBatcher&) = delete;
+  InferenceBatcher& operator=(const InferenceBatcher&) = delete;
+
+  // Adds a task to the named queue, and returns once it has run as part of a
+  // batch, with the status of that run. The options of the first call for a
+  // queue are used for all of its batches, and a batch runs with the run_batch
+  // of the caller that runs it, so all callers sharing a queue must run the
+  // same model.
+  absl::Status Run(const std::string& queue_name, const Options& options,
+                   RunBatchFunction run_batch, Task* task);
+
+  // Returns the statistics of the named queue, which are empty if no task has
+  // been added to it.
+  QueueStats GetQueueStats(const std::string& queue_name) const;
+
+  // Returns the size a batch of batch_size tasks is padded to, e.g. for a
+  // RunBatchFunction that splits its batch.
+  static int PaddedBatchSize(const Options& options, int batch_size);
+
+ private:
+  struct Queue {
+    Options options;
+    std::deque<Task*> tasks;
+    // The number of queued tasks that run without waiting for batch_timeout,
+    // as they were queued when all of max_callers were in Run.
+    int num_tasks_to_flush = 0;
+    // Signaled when tasks are added or finished.
+    absl::CondVar cond;
+    QueueStats stats;
+  };
+
+  // Returns true if the queue has a batch ready to run at the given time.
+  static bool HasReadyBatch(const Queue& queue, absl::Time now);
+
+  mutable absl::Mutex mutex_;
+  std::map<std::string, std::unique_ptr<Queue>> queues_ ABSL_GUARDED_BY(mutex_);
+  // The number of callers in Run, over all queues.
+  int num_callers_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// A batcher shared by all the calculators of the graphs it is set on, e.g.
+// with CalculatorGraph::SetServiceObject.
+extern const GraphService<InferenceBatcher> kInferenceBatcherService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSORFLOW_INFERENCE_BATCHER_H_
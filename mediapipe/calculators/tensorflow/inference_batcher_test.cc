@@ -0,0 +1,288 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensorflow/inference_batcher.h"
+
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+struct SquareTask : public InferenceBatcher::Task {
+  int input = 0;
+  int output = 0;
+};
+
+// Squares the inputs, and records the size of each batch.
+class SquareModel {
+ public:
+  InferenceBatcher::RunBatchFunction RunBatch() {
+    return [this](absl::Span<InferenceBatcher::Task* const> tasks,
+                  int padded_batch_size) {
+      absl::MutexLock lock(&mutex_);
+      batch_sizes_.push_back(tasks.size());
+      padded_batch_sizes_.push_back(padded_batch_size);
+      for (InferenceBatcher::Task* task : tasks) {
+        auto* square_task = static_cast<SquareTask*>(task);
+        square_task->output = square_task->input * square_task->input;
+      }
+      return absl::OkStatus();
+    };
+  }
+
+  std::vector<int> batch_sizes() {
+    absl::MutexLock lock(&mutex_);
+    return batch_sizes_;
+  }
+  std::vector<int> padded_batch_sizes() {
+    absl::MutexLock lock(&mutex_);
+    return padded_batch_sizes_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<int> batch_sizes_;
+  std::vector<int> padded_batch_sizes_;
+};
+
+// Runs a task for each input on its own thread, and returns the outputs.
+std::vector<int> RunConcurrently(InferenceBatcher* batcher,
+                                 const std::string& queue_name,
+                                 const InferenceBatcher::Options& options,
+                                 SquareModel* model,
+                                 const std::vector<int>& inputs) {
+  std::vector<SquareTask> tasks(inputs.size());
+  std::vector<std::thread> threads;
+  for (int i = 0; i < inputs.size(); ++i) {
+    tasks[i].input = inputs[i];
+    threads.emplace_back([&, i] {
+      MP_EXPECT_OK(
+          batcher->Run(queue_name, options, model->RunBatch(), &tasks[i]));
+    });
+  }
+  std::vector<int> outputs;
+  for (int i = 0; i < inputs.size(); ++i) {
+    threads[i].join();
+    outputs.push_back(tasks[i].output);
+  }
+  return outputs;
+}
+
+TEST(InferenceBatcherTest, RunsFullBatchBeforeTimeout) {
+  InferenceBatcher batcher;
+  SquareModel model;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 4;
+  options.batch_timeout = absl::Hours(1);
+
+  EXPECT_EQ(std::vector<int>({1, 4, 9, 16}),
+            RunConcurrently(&batcher, "square", options, &model, {1, 2, 3, 4}));
+  EXPECT_EQ(std::vector<int>({4}), model.batch_sizes());
+
+  const InferenceBatcher::QueueStats stats = batcher.GetQueueStats("square");
+  EXPECT_EQ(1, stats.num_batches);
+  EXPECT_EQ(4, stats.num_tasks);
+  EXPECT_EQ(0, stats.num_padding);
+  ASSERT_EQ(5, stats.batch_size_counts.size());
+  EXPECT_EQ(1, stats.batch_size_counts[4]);
+}
+
+TEST(InferenceBatcherTest, RunsPartialBatchAtTimeout) {
+  InferenceBatcher batcher;
+  SquareModel model;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 8;
+  options.batch_timeout = absl::Milliseconds(20);
+
+  SquareTask task;
+  task.input = 3;
+  const absl::Time start = absl::Now();
+  MP_ASSERT_OK(batcher.Run("square", options, model.RunBatch(), &task));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(20));
+  EXPECT_EQ(9, task.output);
+  EXPECT_EQ(1, task.batch_size());
+  EXPECT_GE(task.queue_wait(), absl::Milliseconds(20));
+
+  const InferenceBatcher::QueueStats stats = batcher.GetQueueStats("square");
+  EXPECT_EQ(1, stats.num_batches);
+  EXPECT_GE(stats.queue_wait.total(), 20000);
+}
+
+TEST(InferenceBatcherTest, PadsToAllowedBatchSizes) {
+  InferenceBatcher batcher;
+  SquareModel model;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 8;
+  options.allowed_batch_sizes = {2, 4, 8};
+
+  // Without a timeout, each task runs right away in a batch of its own.
+  SquareTask task;
+  task.input = 5;
+  MP_ASSERT_OK(batcher.Run("square", options, model.RunBatch(), &task));
+  EXPECT_EQ(25, task.output);
+  EXPECT_EQ(1, task.batch_size());
+  EXPECT_EQ(2, task.padded_batch_size());
+  EXPECT_EQ(std::vector<int>({2}), model.padded_batch_sizes());
+
+  // A full batch of 3 is padded to 4.
+  options.max_batch_size = 3;
+  options.batch_timeout = absl::Hours(1);
+  EXPECT_EQ(std::vector<int>({1, 4, 9}),
+            RunConcurrently(&batcher, "full", options, &model, {1, 2, 3}));
+  EXPECT_EQ(std::vector<int>({2, 4}), model.padded_batch_sizes());
+
+  const InferenceBatcher::QueueStats stats = batcher.GetQueueStats("full");
+  EXPECT_EQ(1, stats.num_batches);
+  EXPECT_EQ(3, stats.num_tasks);
+  EXPECT_EQ(1, stats.num_padding);
+}
+
+TEST(InferenceBatcherTest, ReturnsBatchErrors) {
+  InferenceBatcher batcher;
+  InferenceBatcher::Options options;
+  SquareTask task;
+  EXPECT_EQ(absl::StatusCode::kInternal,
+            batcher
+                .Run("failing", options,
+                     [](absl::Span<InferenceBatcher::Task* const> tasks,
+                        int padded_batch_size) {
+                       return absl::InternalError("Run failed");
+                     },
+                     &task)
+                .code());
+}
+
+TEST(InferenceBatcherTest, ReturnsTaskErrors) {
+  InferenceBatcher batcher;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 4;
+  options.batch_timeout = absl::Hours(1);
+
+  // Fails the tasks with odd inputs, and squares the others.
+  SquareTask tasks[4];
+  std::vector<std::thread> threads;
+  std::vector<absl::Status> statuses(4);
+  for (int i = 0; i < 4; ++i) {
+    tasks[i].input = i;
+    threads.emplace_back([&, i] {
+      statuses[i] = batcher.Run(
+          "odd", options,
+          [](absl::Span<InferenceBatcher::Task* const> tasks,
+             int padded_batch_size) {
+            for (InferenceBatcher::Task* task : tasks) {
+              auto* square_task = static_cast<SquareTask*>(task);
+              if (square_task->input % 2 == 1) {
+                task->set_status(absl::InvalidArgumentError("Odd input"));
+              } else {
+                square_task->output = square_task->input * square_task->input;
+              }
+            }
+            return absl::OkStatus();
+          },
+          &tasks[i]);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  MP_EXPECT_OK(statuses[0]);
+  EXPECT_EQ(absl::StatusCode::kInvalidArgument, statuses[1].code());
+  MP_EXPECT_OK(statuses[2]);
+  EXPECT_EQ(absl::StatusCode::kInvalidArgument, statuses[3].code());
+  EXPECT_EQ(4, tasks[2].output);
+  EXPECT_EQ(1, batcher.GetQueueStats("odd").num_batches);
+
+  // A task of a later batch doesn't keep the error of an earlier one.
+  SquareModel model;
+  options.max_batch_size = 1;
+  MP_EXPECT_OK(batcher.Run("square", options, model.RunBatch(), &tasks[1]));
+  EXPECT_EQ(1, tasks[1].output);
+}
+
+TEST(InferenceBatcherTest, RunsBatchOnceAllCallersWait) {
+  InferenceBatcher batcher;
+  SquareModel model;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 8;
+  options.batch_timeout = absl::Hours(1);
+  options.max_callers = 3;
+
+  // Without max_callers, the batch would wait for 5 more tasks or an hour.
+  EXPECT_EQ(std::vector<int>({1, 4, 9}),
+            RunConcurrently(&batcher, "square", options, &model, {1, 2, 3}));
+  EXPECT_EQ(std::vector<int>({3}), model.batch_sizes());
+}
+
+TEST(InferenceBatcherTest, CountsCallersOfAllQueues) {
+  InferenceBatcher batcher;
+  SquareModel model;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 8;
+  options.batch_timeout = absl::Hours(1);
+  options.max_callers = 2;
+
+  // The caller of each queue waits until the other one has called Run.
+  SquareTask tasks[2];
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; ++i) {
+    tasks[i].input = i + 2;
+    threads.emplace_back([&, i] {
+      MP_EXPECT_OK(batcher.Run(i == 0 ? "first" : "second", options,
+                               model.RunBatch(), &tasks[i]));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(std::vector<int>({1, 1}), model.batch_sizes());
+  EXPECT_EQ(4, tasks[0].output);
+  EXPECT_EQ(9, tasks[1].output);
+}
+
+TEST(InferenceBatcherTest, KeepsQueuesSeparate) {
+  InferenceBatcher batcher;
+  SquareModel model;
+  InferenceBatcher::Options options;
+  options.max_batch_size = 2;
+  options.batch_timeout = absl::Hours(1);
+
+  SquareTask tasks[4];
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    tasks[i].input = i;
+    threads.emplace_back([&, i] {
+      MP_EXPECT_OK(batcher.Run(i % 2 == 0 ? "even" : "odd", options,
+                               model.RunBatch(), &tasks[i]));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(std::vector<int>({2, 2}), model.batch_sizes());
+  EXPECT_EQ(1, batcher.GetQueueStats("even").num_batches);
+  EXPECT_EQ(1, batcher.GetQueueStats("odd").num_batches);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(i * i, tasks[i].output);
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
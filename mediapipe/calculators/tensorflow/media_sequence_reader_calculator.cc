@@ -0,0 +1,136 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/tensorflow/media_sequence_reader_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/sequence/media_sequence.h"
+#include "mediapipe/util/sequence/media_sequence_reader.h"
+#include "tensorflow/core/example/example.pb.h"
+
+namespace mediapipe {
+
+const char kTFRecordPathTag[] = "TFRECORD_PATH";
+const char kRecordIndexTag[] = "RECORD_INDEX";
+const char kSequenceExampleTag[] = "SEQUENCE_EXAMPLE";
+
+namespace mpms = mediapipe::mediasequence;
+
+// Reads a MediaSequence tf.SequenceExample from a TFRecord file, decoding only
+// the feature lists and the time range the graph needs.
+//
+// The file is memory-mapped and the record is located through a sidecar
+// offset index (see media_sequence_reader.h), so reading record N does not
+// read the records before it. The record itself is indexed without being
+// parsed, and only the selected feature list entries are decoded. The output
+// SequenceExample holds the full context and the selected entries, and can be
+// consumed by UnpackMediaSequenceCalculator like a fully parsed one.
+//
+// Input side packets:
+//   TFRECORD_PATH: path to the TFRecord file.
+//   RECORD_INDEX: optional index of the record to read; defaults to 0.
+// Output side packets:
+//   SEQUENCE_EXAMPLE: the tf.SequenceExample with the selected feature lists.
+//
+// Example config:
+// node {
+//   calculator: "MediaSequenceReaderCalculator"
+//   input_side_packet: "TFRECORD_PATH:tfrecord_path"
+//   input_side_packet: "RECORD_INDEX:record_index"
+//   output_side_packet: "SEQUENCE_EXAMPLE:sequence_example"
+//   options {
+//     [mediapipe.MediaSequenceReaderCalculatorOptions.ext]: {
+//       feature_list_prefix: "image/"
+//       restrict_to_clip: true
+//     }
+//   }
+// }
+class MediaSequenceReaderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->InputSidePackets().Tag(kTFRecordPathTag).Set<std::string>();
+    if (cc->InputSidePackets().HasTag(kRecordIndexTag)) {
+      cc->InputSidePackets().Tag(kRecordIndexTag).Set<int>();
+    }
+    cc->OutputSidePackets()
+        .Tag(kSequenceExampleTag)
+        .Set<tensorflow::SequenceExample>();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<MediaSequenceReaderCalculatorOptions>();
+    const std::string& path =
+        cc->InputSidePackets().Tag(kTFRecordPathTag).Get<std::string>();
+    const int record_index =
+        cc->InputSidePackets().HasTag(kRecordIndexTag)
+            ? cc->InputSidePackets().Tag(kRecordIndexTag).Get<int>()
+            : 0;
+
+    ASSIGN_OR_RETURN(auto shard,
+                     mpms::TFRecordShard::Open(path, options.write_index()));
+    ASSIGN_OR_RETURN(absl::string_view record, shard->GetRecord(record_index));
+    mpms::SequenceExampleView view;
+    MP_RETURN_IF_ERROR(view.Parse(record));
+
+    mpms::SequenceExampleSelection selection;
+    selection.feature_list_prefixes.assign(
+        options.feature_list_prefix().begin(),
+        options.feature_list_prefix().end());
+    if (options.restrict_to_clip()) {
+      tensorflow::SequenceExample context_only;
+      MP_RETURN_IF_ERROR(view.ParseContext(context_only.mutable_context()));
+      if (mpms::HasClipStartTimestamp(context_only)) {
+        selection.start_timestamp =
+            mpms::GetClipStartTimestamp(context_only) -
+            Timestamp::FromSeconds(options.padding_before_clip()).Value();
+      }
+      if (mpms::HasClipEndTimestamp(context_only)) {
+        selection.end_timestamp =
+            mpms::GetClipEndTimestamp(context_only) +
+            Timestamp::FromSeconds(options.padding_after_clip()).Value();
+      }
+    }
+    if (options.has_start_time_us()) {
+      selection.start_timestamp = options.start_time_us();
+    }
+    if (options.has_end_time_us()) {
+      selection.end_timestamp = options.end_time_us();
+    }
+    RET_CHECK_LE(selection.start_timestamp, selection.end_timestamp)
+        << "Empty time range for " << path << " record " << record_index;
+
+    auto sequence = absl::make_unique<tensorflow::SequenceExample>();
+    MP_RETURN_IF_ERROR(
+        mpms::ExtractSequenceExample(view, selection, sequence.get()));
+    cc->OutputSidePackets()
+        .Tag(kSequenceExampleTag)
+        .Set(Adopt(sequence.release()));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    return absl::OkStatus();
+  }
+};
+
+REGISTER_CALCULATOR(MediaSequenceReaderCalculator);
+
+}  // namespace mediapipe
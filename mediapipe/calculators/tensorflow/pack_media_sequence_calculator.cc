@@ -12,11 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "mediapipe/calculators/image/opencv_image_encoder_calculator.pb.h"
 #include "mediapipe/calculators/tensorflow/pack_media_sequence_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -26,8 +30,10 @@
 #include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/util/sequence/media_sequence.h"
 #include "mediapipe/util/sequence/media_sequence_util.h"
+#include "mediapipe/util/sequence/media_sequence_writer.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
 
@@ -42,6 +48,7 @@ const char kForwardFlowEncodedTag[] = "FORWARD_FLOW_ENCODED";
 const char kBBoxTag[] = "BBOX";
 const char kKeypointsTag[] = "KEYPOINTS";
 const char kSegmentationMaskTag[] = "CLASS_SEGMENTATION";
+const char kOutputPathTag[] = "OUTPUT_PATH";
 
 namespace tf = ::tensorflow;
 namespace mpms = mediapipe::mediasequence;
@@ -64,6 +71,15 @@ namespace mpms = mediapipe::mediasequence;
 // each stream, which allows for multiple image streams to be included. However,
 // the default names are suppored by more tools.
 //
+// By default the whole SequenceExample is kept in memory until Close(). When
+// the "OUTPUT_PATH" input side packet is set, the sequence is instead written
+// to that path as a single-record TFRecord file: feature list entries are
+// spilled to disk after every Process() call and the record is assembled from
+// the spill file, so memory use does not grow with the length of the stream.
+// Metadata reconciliation then only sees the first entries of each feature
+// list (and all image timestamps), which covers everything except bounding box
+// and region alignment.
+//
 // Example config:
 // node {
 //   calculator: "PackMediaSequenceCalculator"
@@ -159,10 +175,18 @@ class PackMediaSequenceCalculator : public CalculatorBase {
       }
     }
 
-    CHECK(cc->Outputs().HasTag(kSequenceExampleTag) ||
-          cc->OutputSidePackets().HasTag(kSequenceExampleTag))
-        << "Neither the output stream nor the output side packet is set to "
-           "output the sequence example.";
+    if (cc->InputSidePackets().HasTag(kOutputPathTag)) {
+      cc->InputSidePackets().Tag(kOutputPathTag).Set<std::string>();
+      RET_CHECK(!cc->Outputs().HasTag(kSequenceExampleTag) &&
+                !cc->OutputSidePackets().HasTag(kSequenceExampleTag))
+          << "The sequence example is written to OUTPUT_PATH and cannot also "
+             "be output as a packet.";
+    } else {
+      CHECK(cc->Outputs().HasTag(kSequenceExampleTag) ||
+            cc->OutputSidePackets().HasTag(kSequenceExampleTag))
+          << "Neither the output stream nor the output side packet is set to "
+             "output the sequence example.";
+    }
     if (cc->Outputs().HasTag(kSequenceExampleTag)) {
       cc->Outputs().Tag(kSequenceExampleTag).Set<tf::SequenceExample>();
     }
@@ -175,13 +199,33 @@ class PackMediaSequenceCalculator : public CalculatorBase {
   }
 
   absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<PackMediaSequenceCalculatorOptions>();
     sequence_ = ::absl::make_unique<tf::SequenceExample>(
         cc->InputSidePackets()
             .Tag(kSequenceExampleTag)
             .Get<tf::SequenceExample>());
 
-    const auto& context_features =
-        cc->Options<PackMediaSequenceCalculatorOptions>().context_feature_map();
+    if (cc->InputSidePackets().HasTag(kOutputPathTag)) {
+      RET_CHECK(!options.reconcile_metadata() ||
+                !options.reconcile_bbox_annotations())
+          << "Bounding box reconciliation needs the whole sequence in memory "
+             "and is not supported with OUTPUT_PATH.";
+      output_path_ =
+          cc->InputSidePackets().Tag(kOutputPathTag).Get<std::string>();
+      ASSIGN_OR_RETURN(writer_,
+                       mpms::StreamingSequenceExampleWriter::Create(
+                           options.has_spill_path()
+                               ? options.spill_path()
+                               : absl::StrCat(output_path_, ".spill")));
+      writer_->RetainFeatureList(mpms::kImageTimestampKey);
+    }
+    if (options.num_encoding_threads() > 0) {
+      encoding_pool_ = absl::make_unique<ThreadPool>(
+          "pack_media_sequence", options.num_encoding_threads());
+      encoding_pool_->StartWorkers();
+    }
+
+    const auto& context_features = options.context_feature_map();
     for (const auto& feature : context_features.feature()) {
       *mpms::MutableContext(feature.first, sequence_.get()) = feature.second;
     }
@@ -190,8 +234,7 @@ class PackMediaSequenceCalculator : public CalculatorBase {
     }
 
     replace_keypoints_ = false;
-    if (cc->Options<PackMediaSequenceCalculatorOptions>()
-            .replace_data_instead_of_append()) {
+    if (options.replace_data_instead_of_append()) {
       for (const auto& tag : cc->Inputs().GetTags()) {
         if (absl::StartsWith(tag, kImageTag)) {
           std::string key = "";
@@ -254,6 +297,9 @@ class PackMediaSequenceCalculator : public CalculatorBase {
       }
     }
 
+    if (writer_) {
+      MP_RETURN_IF_ERROR(writer_->MoveFeatureLists(sequence_.get()));
+    }
     return absl::OkStatus();
   }
 
@@ -273,12 +319,12 @@ class PackMediaSequenceCalculator : public CalculatorBase {
     }
   }
 
-  absl::Status VerifySize() {
+  absl::Status VerifySize(int64 byte_size) {
     const int64 MAX_PROTO_BYTES = 1073741823;
     std::string id = mpms::HasExampleId(*sequence_)
                          ? mpms::GetExampleId(*sequence_)
                          : "example";
-    RET_CHECK_LT(sequence_->ByteSizeLong(), MAX_PROTO_BYTES)
+    RET_CHECK_LT(byte_size, MAX_PROTO_BYTES)
         << "sequence '" << id
         << "' would be too many bytes to serialize after adding features.";
     return absl::OkStatus();
@@ -286,6 +332,11 @@ class PackMediaSequenceCalculator : public CalculatorBase {
 
   absl::Status Close(CalculatorContext* cc) override {
     auto& options = cc->Options<PackMediaSequenceCalculatorOptions>();
+    MP_RETURN_IF_ERROR(AddEncodedMasks(/*wait=*/true));
+    if (writer_) {
+      MP_RETURN_IF_ERROR(writer_->MoveFeatureLists(sequence_.get()));
+      return CloseStreaming(cc);
+    }
     if (options.reconcile_metadata()) {
       RET_CHECK_OK(mpms::ReconcileMetadata(
           options.reconcile_bbox_annotations(),
@@ -293,7 +344,7 @@ class PackMediaSequenceCalculator : public CalculatorBase {
     }
 
     if (options.skip_large_sequences()) {
-      RET_CHECK_OK(VerifySize());
+      RET_CHECK_OK(VerifySize(sequence_->ByteSizeLong()));
     }
     if (options.output_only_if_all_present()) {
       absl::Status status = VerifySequence();
@@ -320,6 +371,79 @@ class PackMediaSequenceCalculator : public CalculatorBase {
     return absl::OkStatus();
   }
 
+  // Reconciles the metadata against the head of the spilled feature lists and
+  // writes the TFRecord to output_path_.
+  absl::Status CloseStreaming(CalculatorContext* cc) {
+    auto& options = cc->Options<PackMediaSequenceCalculatorOptions>();
+    if (options.reconcile_metadata()) {
+      tf::SequenceExample head;
+      *head.mutable_context() = std::move(*sequence_->mutable_context());
+      *head.mutable_feature_lists() = writer_->FeatureListsHead();
+      if (options.reconcile_region_annotations()) {
+        for (const auto& key_value : head.feature_lists().feature_list()) {
+          RET_CHECK(!absl::StrContains(key_value.first,
+                                       mpms::kRegionTimestampKey))
+              << "Region reconciliation needs the whole sequence in memory "
+                 "and is not supported with OUTPUT_PATH: "
+              << key_value.first;
+        }
+      }
+      RET_CHECK_OK(mpms::ReconcileMetadata(
+          /*reconcile_bbox_annotations=*/false,
+          /*reconcile_region_annotations=*/false, &head));
+      *sequence_->mutable_context() = std::move(*head.mutable_context());
+    }
+
+    if (options.skip_large_sequences()) {
+      RET_CHECK_OK(VerifySize(writer_->ByteSizeLong(sequence_->context())));
+    }
+    if (options.output_only_if_all_present()) {
+      absl::Status status = VerifySequence();
+      if (!status.ok()) {
+        cc->GetCounter(status.ToString())->Increment();
+        return status;
+      }
+    }
+
+    MP_RETURN_IF_ERROR(
+        writer_->WriteTFRecord(sequence_->context(), output_path_));
+    writer_.reset();
+    sequence_.reset();
+    return absl::OkStatus();
+  }
+
+  // Adds the masks encoded so far to the sequence, in input order. If `wait`
+  // is true, first waits until all scheduled masks are encoded.
+  absl::Status AddEncodedMasks(bool wait) {
+    absl::MutexLock lock(&mask_mutex_);
+    if (wait) {
+      mask_mutex_.Await(
+          absl::Condition(this, &PackMediaSequenceCalculator::AllMasksEncoded));
+    }
+    while (!pending_masks_.empty() && pending_masks_.front()->done) {
+      const EncodedMask& mask = *pending_masks_.front();
+      MP_RETURN_IF_ERROR(mask.status);
+      mpms::AddClassSegmentationEncoded(mask.encoded, sequence_.get());
+      mpms::AddClassSegmentationTimestamp(mask.timestamp, sequence_.get());
+      pending_masks_.pop_front();
+    }
+    return absl::OkStatus();
+  }
+
+  bool AllMasksEncoded() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mask_mutex_) {
+    for (const auto& mask : pending_masks_) {
+      if (!mask->done) return false;
+    }
+    return true;
+  }
+
+  static absl::Status EncodeMask(const cv::Mat& mask, std::string* encoded) {
+    std::vector<uchar> bytes;
+    RET_CHECK(cv::imencode(".png", mask, bytes, {}));
+    encoded->assign(bytes.begin(), bytes.end());
+    return absl::OkStatus();
+  }
+
   absl::Status Process(CalculatorContext* cc) override {
     int image_height = -1;
     int image_width = -1;
@@ -387,6 +511,9 @@ class PackMediaSequenceCalculator : public CalculatorBase {
             mpms::ClearBBoxTrackString(prefix, sequence_.get());
             mpms::ClearBBoxTrackIndex(prefix, sequence_.get());
             mpms::ClearUnmodifiedBBoxTimestamp(prefix, sequence_.get());
+            if (writer_) {
+              writer_->ClearFeatureLists(mpms::merge_prefix(prefix, "region/"));
+            }
           }
           mpms::AddBBoxTimestamp(prefix, cc->InputTimestamp().Value(),
                                  sequence_.get());
@@ -508,14 +635,29 @@ class PackMediaSequenceCalculator : public CalculatorBase {
           RET_CHECK(!already_has_mask)
               << "We currently only support adding one mask per timestamp. "
               << sequence_->DebugString();
-          auto mask_mat_ptr = Location(detection.location_data()).GetCvMask();
-          std::vector<uchar> bytes;
-          RET_CHECK(cv::imencode(".png", *mask_mat_ptr, bytes, {}));
-
-          std::string encoded_mask(bytes.begin(), bytes.end());
-          mpms::AddClassSegmentationEncoded(encoded_mask, sequence_.get());
-          mpms::AddClassSegmentationTimestamp(cc->InputTimestamp().Value(),
-                                              sequence_.get());
+          std::shared_ptr<cv::Mat> mask_mat_ptr =
+              Location(detection.location_data()).GetCvMask();
+          auto mask = std::make_shared<EncodedMask>();
+          mask->timestamp = cc->InputTimestamp().Value();
+          if (encoding_pool_) {
+            {
+              absl::MutexLock lock(&mask_mutex_);
+              pending_masks_.push_back(mask);
+            }
+            encoding_pool_->Schedule([this, mask, mask_mat_ptr]() {
+              std::string encoded;
+              absl::Status status = EncodeMask(*mask_mat_ptr, &encoded);
+              absl::MutexLock lock(&mask_mutex_);
+              mask->encoded = std::move(encoded);
+              mask->status = std::move(status);
+              mask->done = true;
+            });
+          } else {
+            MP_RETURN_IF_ERROR(EncodeMask(*mask_mat_ptr, &mask->encoded));
+            mpms::AddClassSegmentationEncoded(mask->encoded, sequence_.get());
+            mpms::AddClassSegmentationTimestamp(mask->timestamp,
+                                                sequence_.get());
+          }
           // SegmentationClassLabelString is a context feature for the entire
           // sequence. The values in the last detection will be saved.
           mpms::SetClassSegmentationClassLabelString({detection.label(0)},
@@ -527,12 +669,33 @@ class PackMediaSequenceCalculator : public CalculatorBase {
         }
       }
     }
+    MP_RETURN_IF_ERROR(AddEncodedMasks(/*wait=*/false));
+    if (writer_) {
+      MP_RETURN_IF_ERROR(writer_->MoveFeatureLists(sequence_.get()));
+    }
     return absl::OkStatus();
   }
 
+  // A segmentation mask scheduled for encoding on encoding_pool_.
+  struct EncodedMask {
+    int64 timestamp;
+    std::string encoded;
+    absl::Status status;
+    bool done = false;
+  };
+
   std::unique_ptr<tf::SequenceExample> sequence_;
   std::map<std::string, bool> features_present_;
   bool replace_keypoints_;
+  // Set when streaming to OUTPUT_PATH.
+  std::string output_path_;
+  std::unique_ptr<mpms::StreamingSequenceExampleWriter> writer_;
+  absl::Mutex mask_mutex_;
+  std::deque<std::shared_ptr<EncodedMask>> pending_masks_
+      ABSL_GUARDED_BY(mask_mutex_);
+  // Declared last so that pending encodings finish before the members they
+  // reference are destroyed.
+  std::unique_ptr<ThreadPool> encoding_pool_;
 };
 REGISTER_CALCULATOR(PackMediaSequenceCalculator);
 
@@ -17,6 +17,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "mediapipe/calculators/image/opencv_image_encoder_calculator.pb.h"
 #include "mediapipe/calculators/tensorflow/pack_media_sequence_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -25,6 +26,7 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/location.h"
+#include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
@@ -59,6 +61,7 @@ constexpr char kFloatFeatureTestTag[] = "FLOAT_FEATURE_TEST";
 constexpr char kImagePrefixTag[] = "IMAGE_PREFIX";
 constexpr char kSequenceExampleTag[] = "SEQUENCE_EXAMPLE";
 constexpr char kImageTag[] = "IMAGE";
+constexpr char kOutputPathTag[] = "OUTPUT_PATH";
 
 class PackMediaSequenceCalculatorTest : public ::testing::Test {
  protected:
@@ -710,6 +713,126 @@ TEST_F(PackMediaSequenceCalculatorTest, PacksTwoMaskDetections) {
               testing::ElementsAreArray(::std::vector<std::string>({"mask"})));
 }
 
+TEST_F(PackMediaSequenceCalculatorTest, PacksMaskDetectionsOnEncodingPool) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("PackMediaSequenceCalculator");
+  config.add_input_side_packet("SEQUENCE_EXAMPLE:input_sequence");
+  config.add_output_stream("SEQUENCE_EXAMPLE:output_sequence");
+  config.add_input_stream("CLASS_SEGMENTATION:detections");
+  config.mutable_options()
+      ->MutableExtension(PackMediaSequenceCalculatorOptions::ext)
+      ->set_num_encoding_threads(4);
+  runner_ = ::absl::make_unique<CalculatorRunner>(config);
+  auto input_sequence = ::absl::make_unique<tf::SequenceExample>();
+  mpms::SetImageHeight(480, input_sequence.get());
+  mpms::SetImageWidth(640, input_sequence.get());
+
+  int num_vectors = 20;
+  for (int i = 0; i < num_vectors; ++i) {
+    auto detections = ::absl::make_unique<::std::vector<Detection>>();
+    Detection detection;
+    detection.add_label("mask");
+    detection.add_score(1.0);
+    // Masks of increasing width, to check the order of the encoded masks.
+    cv::Mat image(2, i + 1, CV_8UC1, cv::Scalar(0));
+    Location::CreateCvMaskLocation<uint8>(image).ConvertToProto(
+        detection.mutable_location_data());
+    detections->push_back(detection);
+    runner_->MutableInputs()
+        ->Tag(kClassSegmentationTag)
+        .packets.push_back(Adopt(detections.release()).At(Timestamp(i)));
+  }
+  runner_->MutableSidePackets()->Tag(kSequenceExampleTag) =
+      Adopt(input_sequence.release());
+
+  MP_ASSERT_OK(runner_->Run());
+
+  const std::vector<Packet>& output_packets =
+      runner_->Outputs().Tag(kSequenceExampleTag).packets;
+  ASSERT_EQ(1, output_packets.size());
+  const tf::SequenceExample& output_sequence =
+      output_packets[0].Get<tf::SequenceExample>();
+  ASSERT_EQ(num_vectors,
+            mpms::GetClassSegmentationEncodedSize(output_sequence));
+  ASSERT_EQ(num_vectors,
+            mpms::GetClassSegmentationTimestampSize(output_sequence));
+  for (int i = 0; i < num_vectors; ++i) {
+    ASSERT_EQ(i, mpms::GetClassSegmentationTimestampAt(output_sequence, i));
+    const std::string& encoded =
+        mpms::GetClassSegmentationEncodedAt(output_sequence, i);
+    cv::Mat decoded = cv::imdecode(
+        std::vector<char>(encoded.begin(), encoded.end()), cv::IMREAD_ANYDEPTH);
+    ASSERT_EQ(i + 1, decoded.cols);
+  }
+}
+
+TEST_F(PackMediaSequenceCalculatorTest, StreamsToTFRecord) {
+  const std::string output_path =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/streamed.tfrecord");
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("PackMediaSequenceCalculator");
+  config.add_input_side_packet("SEQUENCE_EXAMPLE:input_sequence");
+  config.add_input_side_packet("OUTPUT_PATH:output_path");
+  config.add_input_stream("IMAGE:images");
+  config.add_input_stream("FLOAT_FEATURE_TEST:test");
+  runner_ = ::absl::make_unique<CalculatorRunner>(config);
+
+  auto input_sequence = ::absl::make_unique<tf::SequenceExample>();
+  std::string test_video_id = "test_video_id";
+  mpms::SetClipMediaId(test_video_id, input_sequence.get());
+  cv::Mat image(2, 3, CV_8UC3, cv::Scalar(0, 0, 255));
+  std::vector<uchar> bytes;
+  ASSERT_TRUE(cv::imencode(".jpg", image, bytes, {80}));
+  OpenCvImageEncoderCalculatorResults encoded_image;
+  encoded_image.set_encoded_image(bytes.data(), bytes.size());
+  encoded_image.set_width(3);
+  encoded_image.set_height(2);
+
+  int num_timesteps = 10;
+  for (int i = 0; i < num_timesteps; ++i) {
+    runner_->MutableInputs()->Tag(kImageTag).packets.push_back(
+        MakePacket<OpenCvImageEncoderCalculatorResults>(encoded_image)
+            .At(Timestamp(i * 1000)));
+    runner_->MutableInputs()
+        ->Tag(kFloatFeatureTestTag)
+        .packets.push_back(
+            MakePacket<std::vector<float>>(2, static_cast<float>(i))
+                .At(Timestamp(i * 1000)));
+  }
+  runner_->MutableSidePackets()->Tag(kSequenceExampleTag) =
+      Adopt(input_sequence.release());
+  runner_->MutableSidePackets()->Tag(kOutputPathTag) =
+      MakePacket<std::string>(output_path);
+
+  MP_ASSERT_OK(runner_->Run());
+
+  // A single record: 12 bytes of length and checksum, the serialized
+  // example, and a 4 byte checksum.
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(output_path, &contents));
+  ASSERT_GT(contents.size(), 16);
+  tf::SequenceExample output_sequence;
+  ASSERT_TRUE(output_sequence.ParseFromString(
+      contents.substr(12, contents.size() - 16)));
+  ASSERT_EQ(test_video_id, mpms::GetClipMediaId(output_sequence));
+  ASSERT_EQ(num_timesteps, mpms::GetImageTimestampSize(output_sequence));
+  ASSERT_EQ(num_timesteps, mpms::GetImageEncodedSize(output_sequence));
+  ASSERT_EQ(num_timesteps,
+            mpms::GetFeatureFloatsSize("TEST", output_sequence));
+  for (int i = 0; i < num_timesteps; ++i) {
+    ASSERT_EQ(i * 1000, mpms::GetImageTimestampAt(output_sequence, i));
+    ASSERT_THAT(mpms::GetFeatureFloatsAt("TEST", output_sequence, i),
+                testing::ElementsAre(i, i));
+  }
+  // Metadata is reconciled from the first entries of each feature list.
+  ASSERT_EQ(2, mpms::GetImageHeight(output_sequence));
+  ASSERT_EQ(3, mpms::GetImageWidth(output_sequence));
+  ASSERT_EQ(1000, mpms::GetImageFrameRate(output_sequence));
+  ASSERT_THAT(mpms::GetFeatureDimensions("TEST", output_sequence),
+              testing::ElementsAre(2));
+  EXPECT_FALSE(file::Exists(output_path + ".spill").ok());
+}
+
 TEST_F(PackMediaSequenceCalculatorTest, MissingStreamOK) {
   SetUpCalculator(
       {"FORWARD_FLOW_ENCODED:flow", "FLOAT_FEATURE_I3D_FLOW:feature"}, {},
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -21,8 +22,13 @@
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "mediapipe/calculators/tensorflow/inference_batcher.h"
 #include "mediapipe/calculators/tensorflow/tensorflow_inference_calculator.pb.h"
 #include "mediapipe/calculators/tensorflow/tensorflow_session.h"
 #include "mediapipe/framework/calculator_context.h"
@@ -30,12 +36,14 @@
 #include "mediapipe/framework/deps/clock.h"
 #include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/map_util.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_macros.h"
 #include "mediapipe/framework/timestamp.h"
 #include "mediapipe/framework/tool/status_util.h"
+#include "mediapipe/util/cpu_util.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_util.h"
@@ -99,6 +107,43 @@ class InferenceState {
   std::vector<Timestamp> batch_timestamps_;
 };
 
+// The tensors of one timestamp in an adaptive batch, ordered by tensor name so
+// that all the calculators sharing a batch queue agree on them.
+class BatchTask : public InferenceBatcher::Task {
+ public:
+  std::vector<tf::Tensor> input_tensors;
+  std::vector<tf::Tensor> output_tensors;
+  // The context of the Process call that queued the task, which stays valid
+  // while the call waits for the batch.
+  CalculatorContext* cc = nullptr;
+};
+
+// Returns true if the input tensors of the tasks can be concatenated.
+bool HaveSameInputShapes(const BatchTask& a, const BatchTask& b) {
+  for (int i = 0; i < a.input_tensors.size(); ++i) {
+    if (a.input_tensors[i].dtype() != b.input_tensors[i].dtype() ||
+        !a.input_tensors[i].shape().IsSameSize(b.input_tensors[i].shape())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the named counter of each context, without duplicates, so that the
+// contexts of a node with max_in_flight > 1 count an event once.
+std::vector<Counter*> GetCounters(absl::Span<CalculatorContext* const> ccs,
+                                  const std::string& name) {
+  std::vector<Counter*> counters;
+  for (CalculatorContext* cc : ccs) {
+    Counter* counter = cc->GetCounter(name);
+    if (std::find(counters.begin(), counters.end(), counter) ==
+        counters.end()) {
+      counters.push_back(counter);
+    }
+  }
+  return counters;
+}
+
 }  // namespace
 
 // This calculator performs inference on a trained TensorFlow model.
@@ -134,6 +179,14 @@ class InferenceState {
 // recurrent tensors. Initializing the recurrent state can be handled by the
 // GraphTensorsPacketGenerator.
 //
+// Alternatively, adaptive_batching forms batches from the timestamps that are
+// processed concurrently, either by this node with max_in_flight > 1 or by
+// other nodes running the same session that share an InferenceBatcher through
+// the kInferenceBatcherService graph service. A batch runs once it is full or
+// once its oldest timestamp has waited for batch_timeout_usec, so that a batch
+// grows with the load while the latency stays bounded. Batches can be padded
+// to a few allowed_batch_sizes, so that the session sees only a few shapes.
+//
 // The calculator updates two Counters to report timing information:
 //   --<name>-TotalTimeUsecs = Total time spent running inference (in usecs),
 //   --<name>-TotalProcessedTimestamps = # of instances processed
@@ -143,6 +196,28 @@ class InferenceState {
 // name must be set for timing information to be instance-specific in graphs
 // with multiple TensorFlowInferenceCalculators.
 //
+// With adaptive_batching, the calculator also updates:
+//   --<name>-TotalQueueWaitUsecs = Total time timestamps waited for a batch,
+//   --<name>-TotalPaddedTimestamps = # of padding instances in the session
+//         runs of this node.
+// A session run, and its TotalSessionRunsTimeUsecs, TotalNumSessionRuns and
+// TotalPaddedTimestamps, count for every node with timestamps in it, whichever
+// node runs it. A batch whose timestamps have different input shapes is split
+// into a session run per shape, and a failed session run fails only its
+// timestamps. The distribution of batch sizes and queue waits is available from
+// InferenceBatcher::GetQueueStats, for the adaptive_batching.queue_name of the
+// node, if the InferenceBatcher is set as the kInferenceBatcherService object.
+//
+// Without a shared InferenceBatcher, batches form only from the concurrent
+// Process calls of this node, so with max_in_flight 1 every timestamp runs on
+// its own after waiting for batch_timeout_usec.
+//
+// A Process call blocks its executor thread while it waits for a batch. Once
+// adaptive_batching.executor_threads calls wait, the batch runs without
+// waiting for batch_timeout_usec, as no thread is left to add to it. Running
+// the node on an executor of its own keeps the other nodes from waiting for
+// threads meanwhile.
+//
 // Example config:
 //   packet_generator {
 //     packet_generator: "TensorFlowSessionFromSavedModelGenerator"
@@ -230,6 +305,10 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
       "TotalSessionRunsTimeUsecs";
   static constexpr char kTotalNumSessionRunsCounterSuffix[] =
       "TotalNumSessionRuns";
+  static constexpr char kTotalQueueWaitUsecsCounterSuffix[] =
+      "TotalQueueWaitUsecs";
+  static constexpr char kTotalPaddedTimestampsCounterSuffix[] =
+      "TotalPaddedTimestamps";
 
   TensorFlowInferenceCalculator() : session_(nullptr) {
     clock_ = std::unique_ptr<mediapipe::Clock>(
@@ -263,6 +342,9 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
           .Tag(kRecurrentInitTensorsTag)
           .Set<std::unique_ptr<std::map<std::string, tf::Tensor>>>();
     }
+    if (options.has_adaptive_batching()) {
+      cc->UseService(kInferenceBatcherService).Optional();
+    }
     return absl::OkStatus();
   }
 
@@ -296,7 +378,7 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
                              .tag_to_tensor_map;
 
     // Validate and store the recurrent tags
-    RET_CHECK(options_.has_batch_size());
+    RET_CHECK(options_.has_batch_size() || options_.has_adaptive_batching());
     RET_CHECK(options_.batch_size() == 1 ||
               options_.recurrent_tag_pair().empty())
         << "To use recurrent_tag_pairs, batch_size must be 1.";
@@ -333,13 +415,91 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
       inference_state_ = std::unique_ptr<InferenceState>();
     }
 
-    if (options_.batch_size() == 1 || options_.batched_input()) {
+    if (options_.has_adaptive_batching()) {
+      MP_RETURN_IF_ERROR(InitializeAdaptiveBatching(cc));
+    }
+
+    if (options_.batch_size() == 1 || options_.batched_input() ||
+        options_.has_adaptive_batching()) {
       cc->SetOffset(0);
     }
 
     return absl::OkStatus();
   }
 
+  // Validates the adaptive_batching options, and sets up the batch queue of
+  // this node, which is shared with the nodes that feed and fetch the same
+  // tensors of the same session.
+  absl::Status InitializeAdaptiveBatching(CalculatorContext* cc) {
+    const auto& batching = options_.adaptive_batching();
+    RET_CHECK_LE(options_.batch_size(), 1)
+        << "adaptive_batching can't be used with batch_size > 1.";
+    RET_CHECK(options_.recurrent_tag_pair().empty() &&
+              !options_.batched_input())
+        << "adaptive_batching can't be used with recurrent_tag_pair or "
+           "batched_input.";
+    RET_CHECK_GT(batching.max_batch_size(), 0);
+    RET_CHECK_GE(batching.batch_timeout_usec(), 0);
+    RET_CHECK_GE(batching.executor_threads(), 0);
+    int previous_batch_size = 0;
+    for (int allowed_batch_size : batching.allowed_batch_sizes()) {
+      RET_CHECK_GT(allowed_batch_size, previous_batch_size)
+          << "allowed_batch_sizes must be increasing.";
+      previous_batch_size = allowed_batch_size;
+    }
+    if (!batching.allowed_batch_sizes().empty()) {
+      RET_CHECK_GE(previous_batch_size, batching.max_batch_size())
+          << "The last of allowed_batch_sizes must be at least max_batch_size.";
+    }
+    batcher_options_.max_batch_size = batching.max_batch_size();
+    batcher_options_.batch_timeout =
+        absl::Microseconds(batching.batch_timeout_usec());
+    batcher_options_.allowed_batch_sizes.assign(
+        batching.allowed_batch_sizes().begin(),
+        batching.allowed_batch_sizes().end());
+    batcher_options_.max_callers = batching.executor_threads() > 0
+                                       ? batching.executor_threads()
+                                       : NumCPUCores();
+
+    for (const std::string& tag : cc->Inputs().GetTags()) {
+      batch_inputs_.emplace_back(tag_to_tensor_map_[tag], tag);
+    }
+    for (const std::string& tag : cc->Outputs().GetTags()) {
+      batch_outputs_.emplace_back(tag_to_tensor_map_[tag], tag);
+    }
+    std::sort(batch_inputs_.begin(), batch_inputs_.end());
+    std::sort(batch_outputs_.begin(), batch_outputs_.end());
+    const auto tensor_name_formatter = [](std::string* out,
+                                          const auto& name_and_tag) {
+      out->append(name_and_tag.first);
+    };
+    batch_queue_name_ =
+        !batching.queue_name().empty()
+            ? batching.queue_name()
+            : absl::StrCat(
+                  absl::Hex(reinterpret_cast<uintptr_t>(session_)), ":",
+                  absl::StrJoin(batch_inputs_, ",", tensor_name_formatter),
+                  "->",
+                  absl::StrJoin(batch_outputs_, ",", tensor_name_formatter));
+
+    auto batcher_service = cc->Service(kInferenceBatcherService);
+    if (batcher_service.IsAvailable()) {
+      batcher_ = &batcher_service.GetObject();
+    } else {
+      // The calculator can't see its max_in_flight, which is the only source
+      // of concurrent timestamps here.
+      LOG_IF(WARNING, batching.batch_timeout_usec() > 0)
+          << "adaptive_batching without a kInferenceBatcherService object "
+             "batches only the concurrent Process calls of "
+          << cc->NodeName()
+          << ". Unless its max_in_flight is above 1, every timestamp waits "
+             "for batch_timeout_usec and then runs on its own.";
+      own_batcher_ = absl::make_unique<InferenceBatcher>();
+      batcher_ = own_batcher_.get();
+    }
+    return absl::OkStatus();
+  }
+
   // Adds a batch dimension to the input tensor if specified in the calculator
   // options.
   absl::Status AddBatchDimension(tf::Tensor* input_tensor) {
@@ -386,6 +546,9 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
   }
 
   absl::Status Process(CalculatorContext* cc) override {
+    if (options_.has_adaptive_batching()) {
+      return ProcessInAdaptiveBatch(cc);
+    }
     std::unique_ptr<InferenceState> inference_state_to_process;
     {
       absl::WriterMutexLock l(&mutex_);
@@ -525,35 +688,8 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
       }
     }
     std::vector<tf::Tensor> outputs;
-
-    SimpleSemaphore* session_run_throttle = nullptr;
-    if (options_.max_concurrent_session_runs() > 0) {
-      session_run_throttle =
-          get_session_run_throttle(options_.max_concurrent_session_runs());
-      session_run_throttle->Acquire(1);
-    }
-    const int64 run_start_time = absl::ToUnixMicros(clock_->TimeNow());
-    tf::Status tf_status;
-    {
-#if !defined(MEDIAPIPE_MOBILE) && !defined(__APPLE__)
-      tensorflow::profiler::TraceMe trace(absl::string_view(cc->NodeName()));
-#endif
-      tf_status = session_->Run(input_tensors, output_tensor_names,
-                                {} /* target_node_names */, &outputs);
-    }
-
-    if (session_run_throttle != nullptr) {
-      session_run_throttle->Release(1);
-    }
-
-    // RET_CHECK on the tf::Status object itself in order to print an
-    // informative error message.
-    RET_CHECK(tf_status.ok()) << "Run failed: " << tf_status.ToString();
-
-    const int64 run_end_time = absl::ToUnixMicros(clock_->TimeNow());
-    cc->GetCounter(kTotalSessionRunsTimeUsecsCounterSuffix)
-        ->IncrementBy(run_end_time - run_start_time);
-    cc->GetCounter(kTotalNumSessionRunsCounterSuffix)->Increment();
+    MP_RETURN_IF_ERROR(
+        RunSession(cc, {cc}, input_tensors, output_tensor_names, &outputs));
 
     // Feed back the recurrent state.
     for (const auto& tag_pair : recurrent_fetch_tags_to_feed_tags_) {
@@ -610,6 +746,189 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
     return absl::OkStatus();
   }
 
+  // Queues the input tensors of this timestamp for an adaptive batch, waits
+  // until the batch has run, and outputs the output tensors.
+  absl::Status ProcessInAdaptiveBatch(CalculatorContext* cc) {
+    const int64 start_time = absl::ToUnixMicros(clock_->TimeNow());
+    BatchTask task;
+    task.cc = cc;
+    for (const auto& name_and_tag : batch_inputs_) {
+      const std::string& tag = name_and_tag.second;
+      if (cc->Inputs().Tag(tag).IsEmpty()) {
+        if (options_.skip_on_missing_features()) {
+          return absl::OkStatus();
+        }
+        return absl::InvalidArgumentError(
+            absl::StrCat("Tag ", tag, " not present at timestamp: ",
+                         cc->InputTimestamp().Value()));
+      }
+      tf::Tensor input_tensor(cc->Inputs().Tag(tag).Get<tf::Tensor>());
+      RET_CHECK_OK(AddBatchDimension(&input_tensor));
+      task.input_tensors.push_back(input_tensor);
+    }
+
+    MP_RETURN_IF_ERROR(batcher_->Run(
+        batch_queue_name_, batcher_options_,
+        [this, cc](absl::Span<InferenceBatcher::Task* const> tasks,
+                   int padded_batch_size) {
+          return RunAdaptiveBatch(cc, tasks);
+        },
+        &task));
+
+    RET_CHECK_EQ(task.output_tensors.size(), batch_outputs_.size());
+    for (int i = 0; i < batch_outputs_.size(); ++i) {
+      tf::Tensor output_tensor(task.output_tensors[i]);
+      RET_CHECK_OK(RemoveBatchDimension(&output_tensor));
+      cc->Outputs()
+          .Tag(batch_outputs_[i].second)
+          .Add(new tf::Tensor(output_tensor), cc->InputTimestamp());
+    }
+
+    const int64 end_time = absl::ToUnixMicros(clock_->TimeNow());
+    cc->GetCounter(kTotalUsecsCounterSuffix)
+        ->IncrementBy(end_time - start_time);
+    cc->GetCounter(kTotalProcessedTimestampsCounterSuffix)->Increment();
+    cc->GetCounter(kTotalQueueWaitUsecsCounterSuffix)
+        ->IncrementBy(absl::ToInt64Microseconds(task.queue_wait()));
+    return absl::OkStatus();
+  }
+
+  // Runs an adaptive batch of BatchTasks, and sets their output tensors.
+  // Tasks whose input tensors can't be concatenated run in separate groups,
+  // and a group that fails to run fails only its own tasks.
+  absl::Status RunAdaptiveBatch(
+      CalculatorContext* cc, absl::Span<InferenceBatcher::Task* const> tasks) {
+    std::vector<std::vector<BatchTask*>> groups;
+    for (InferenceBatcher::Task* task : tasks) {
+      auto* batch_task = static_cast<BatchTask*>(task);
+      auto group = std::find_if(groups.begin(), groups.end(),
+                                [batch_task](const std::vector<BatchTask*>& g) {
+                                  return HaveSameInputShapes(*g[0],
+                                                             *batch_task);
+                                });
+      if (group == groups.end()) {
+        group = groups.emplace(groups.end());
+      }
+      group->push_back(batch_task);
+    }
+    for (const std::vector<BatchTask*>& group : groups) {
+      const absl::Status status = RunAdaptiveBatchGroup(
+          cc, group,
+          InferenceBatcher::PaddedBatchSize(batcher_options_, group.size()));
+      if (!status.ok()) {
+        for (BatchTask* task : group) {
+          task->set_status(status);
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Runs a group of BatchTasks with the same input shapes, padded to
+  // padded_batch_size, and sets their output tensors. As in OutputBatch, the
+  // padding replicates the first tensor and its outputs are ignored.
+  absl::Status RunAdaptiveBatchGroup(CalculatorContext* cc,
+                                     absl::Span<BatchTask* const> tasks,
+                                     int padded_batch_size) {
+    std::vector<CalculatorContext*> task_ccs;
+    for (BatchTask* task : tasks) {
+      task_ccs.push_back(task->cc);
+    }
+    std::vector<std::pair<mediapipe::ProtoString, tf::Tensor>> input_tensors;
+    for (int i = 0; i < batch_inputs_.size(); ++i) {
+      if (padded_batch_size == 1) {
+        // Short circuit to avoid the cost of deep copying tensors in concat.
+        input_tensors.emplace_back(batch_inputs_[i].first,
+                                   tasks[0]->input_tensors[i]);
+        continue;
+      }
+      std::vector<tf::Tensor> batch;
+      batch.reserve(padded_batch_size);
+      for (BatchTask* task : tasks) {
+        batch.push_back(task->input_tensors[i]);
+      }
+      batch.resize(padded_batch_size, batch[0]);
+      tf::Tensor concated;
+      const tf::Status concat_status = tf::tensor::Concat(batch, &concated);
+      RET_CHECK(concat_status.ok()) << concat_status.ToString();
+      input_tensors.emplace_back(batch_inputs_[i].first, concated);
+    }
+    std::vector<mediapipe::ProtoString> output_tensor_names;
+    for (const auto& name_and_tag : batch_outputs_) {
+      output_tensor_names.emplace_back(name_and_tag.first);
+    }
+    std::vector<tf::Tensor> outputs;
+    MP_RETURN_IF_ERROR(RunSession(cc, task_ccs, input_tensors,
+                                  output_tensor_names, &outputs));
+
+    // Set that we want to split on each index of the 0th dimension.
+    std::vector<tf::int64> split_vector(padded_batch_size, 1);
+    for (const tf::Tensor& output : outputs) {
+      if (padded_batch_size == 1) {
+        tasks[0]->output_tensors.push_back(output);
+        continue;
+      }
+      std::vector<tf::Tensor> split_tensors;
+      const tf::Status split_status =
+          tf::tensor::Split(output, split_vector, &split_tensors);
+      RET_CHECK(split_status.ok()) << split_status.ToString();
+      // Loop over the tasks so that we don't copy the padding.
+      for (int j = 0; j < tasks.size(); ++j) {
+        tasks[j]->output_tensors.push_back(split_tensors[j]);
+      }
+    }
+    for (Counter* counter :
+         GetCounters(task_ccs, kTotalPaddedTimestampsCounterSuffix)) {
+      counter->IncrementBy(padded_batch_size - tasks.size());
+    }
+    return absl::OkStatus();
+  }
+
+  // Runs the session for the node of cc, throttled by
+  // max_concurrent_session_runs, and reports the run to the nodes of
+  // counter_ccs, whose inputs it runs.
+  absl::Status RunSession(
+      CalculatorContext* cc, absl::Span<CalculatorContext* const> counter_ccs,
+      const std::vector<std::pair<mediapipe::ProtoString, tf::Tensor>>&
+          input_tensors,
+      const std::vector<mediapipe::ProtoString>& output_tensor_names,
+      std::vector<tf::Tensor>* outputs) {
+    SimpleSemaphore* session_run_throttle = nullptr;
+    if (options_.max_concurrent_session_runs() > 0) {
+      session_run_throttle =
+          get_session_run_throttle(options_.max_concurrent_session_runs());
+      session_run_throttle->Acquire(1);
+    }
+    const int64 run_start_time = absl::ToUnixMicros(clock_->TimeNow());
+    tf::Status tf_status;
+    {
+#if !defined(MEDIAPIPE_MOBILE) && !defined(__APPLE__)
+      tensorflow::profiler::TraceMe trace(absl::string_view(cc->NodeName()));
+#endif
+      tf_status = session_->Run(input_tensors, output_tensor_names,
+                                {} /* target_node_names */, outputs);
+    }
+
+    if (session_run_throttle != nullptr) {
+      session_run_throttle->Release(1);
+    }
+
+    // RET_CHECK on the tf::Status object itself in order to print an
+    // informative error message.
+    RET_CHECK(tf_status.ok()) << "Run failed: " << tf_status.ToString();
+
+    const int64 run_end_time = absl::ToUnixMicros(clock_->TimeNow());
+    for (Counter* counter :
+         GetCounters(counter_ccs, kTotalSessionRunsTimeUsecsCounterSuffix)) {
+      counter->IncrementBy(run_end_time - run_start_time);
+    }
+    for (Counter* counter :
+         GetCounters(counter_ccs, kTotalNumSessionRunsCounterSuffix)) {
+      counter->Increment();
+    }
+    return absl::OkStatus();
+  }
+
  private:
   // The Session object is provided by a packet factory and is owned by the
   // MediaPipe framework. Individual calls are thread-safe, but session state
@@ -629,6 +948,16 @@ class TensorFlowInferenceCalculator : public CalculatorBase {
   std::set<std::string> recurrent_feed_tags_;
   std::map<std::string, std::string> recurrent_fetch_tags_to_feed_tags_;
 
+  // The batch queue used with adaptive_batching, and the (tensor name, tag)
+  // pairs of the inputs and outputs, ordered by tensor name.
+  InferenceBatcher::Options batcher_options_;
+  std::string batch_queue_name_;
+  std::vector<std::pair<std::string, std::string>> batch_inputs_;
+  std::vector<std::pair<std::string, std::string>> batch_outputs_;
+  // The batcher of the kInferenceBatcherService, or else own_batcher_.
+  InferenceBatcher* batcher_ = nullptr;
+  std::unique_ptr<InferenceBatcher> own_batcher_;
+
   // Clock used to measure the computation time in OutputBatch().
   std::unique_ptr<mediapipe::Clock> clock_;
 
@@ -649,4 +978,8 @@ constexpr char
     TensorFlowInferenceCalculator::kTotalSessionRunsTimeUsecsCounterSuffix[];
 constexpr char
     TensorFlowInferenceCalculator::kTotalNumSessionRunsCounterSuffix[];
+constexpr char
+    TensorFlowInferenceCalculator::kTotalQueueWaitUsecsCounterSuffix[];
+constexpr char
+    TensorFlowInferenceCalculator::kTotalPaddedTimestampsCounterSuffix[];
 }  // namespace mediapipe
@@ -17,6 +17,7 @@
 #include <vector>
 
 #include "absl/flags/flag.h"
+#include "mediapipe/calculators/tensorflow/inference_batcher.h"
 #include "mediapipe/calculators/tensorflow/tensorflow_inference_calculator.pb.h"
 #include "mediapipe/calculators/tensorflow/tensorflow_session_from_frozen_graph_generator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -25,7 +26,9 @@
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"  // NOLINT
+#include "mediapipe/framework/tool/sink.h"
 #include "mediapipe/framework/tool/validate_type.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -74,6 +77,10 @@ class TensorflowInferenceCalculatorTest : public ::testing::Test {
  protected:
   // Add the input side packet.
   void AddSessionInputSidePacket() {
+    runner_->MutableSidePackets()->Tag(kSessionTag) = CreateSessionPacket();
+  }
+
+  Packet CreateSessionPacket() {
     PacketGeneratorOptions extendable_options;
     TensorFlowSessionFromFrozenGraphGeneratorOptions* generator_options;
     generator_options = extendable_options.MutableExtension(
@@ -91,8 +98,7 @@ class TensorflowInferenceCalculatorTest : public ::testing::Test {
     MEDIAPIPE_CHECK_OK(tool::RunGenerateAndValidateTypes(
         "TensorFlowSessionFromFrozenGraphGenerator", extendable_options,
         input_side_packets, &output_side_packets));
-    runner_->MutableSidePackets()->Tag(kSessionTag) =
-        output_side_packets.Tag(kSessionTag);
+    return output_side_packets.Tag(kSessionTag);
   }
 
   Packet CreateTensorPacket(const std::vector<int32>& input, int64 time) {
@@ -510,6 +516,158 @@ TEST_F(TensorflowInferenceCalculatorTest, GetBatchComputed_MaxInFlight) {
                    ->Get());
 }
 
+TEST_F(TensorflowInferenceCalculatorTest, GetAdaptiveBatchComputed) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("TensorFlowInferenceCalculator");
+  config.add_input_stream("A:tensor_a");
+  config.add_input_stream("B:tensor_b");
+  config.add_output_stream("MULTIPLIED:tensor_o1");
+  config.add_input_side_packet("SESSION:session");
+  CalculatorOptions options;
+  auto* batching =
+      options.MutableExtension(TensorFlowInferenceCalculatorOptions::ext)
+          ->mutable_adaptive_batching();
+  batching->set_max_batch_size(4);
+  batching->add_allowed_batch_sizes(2);
+  batching->add_allowed_batch_sizes(4);
+  *config.mutable_options() = options;
+
+  runner_ = absl::make_unique<CalculatorRunner>(config);
+  AddSessionInputSidePacket();
+  AddVectorToInputsAsTensor({2, 2, 2}, "A", 0);
+  AddVectorToInputsAsTensor({3, 4, 5}, "B", 0);
+  AddVectorToInputsAsTensor({3, 3, 3}, "A", 1);
+  AddVectorToInputsAsTensor({3, 4, 5}, "B", 1);
+  MP_ASSERT_OK(runner_->Run());
+
+  // Without concurrent Process calls or a timeout, each timestamp runs in a
+  // batch of its own, which is padded to 2.
+  const std::vector<Packet>& output_packets_mult =
+      runner_->Outputs().Tag(kMultipliedTag).packets;
+  ASSERT_EQ(2, output_packets_mult.size());
+  EXPECT_EQ(Timestamp(0), output_packets_mult[0].Timestamp());
+  tf::test::ExpectTensorEqual<int32>(
+      tf::test::AsTensor<int32>({6, 8, 10}),
+      output_packets_mult[0].Get<tf::Tensor>());
+  EXPECT_EQ(Timestamp(1), output_packets_mult[1].Timestamp());
+  tf::test::ExpectTensorEqual<int32>(
+      tf::test::AsTensor<int32>({9, 12, 15}),
+      output_packets_mult[1].Get<tf::Tensor>());
+
+  EXPECT_EQ(2, runner_
+                   ->GetCounter(
+                       "TensorFlowInferenceCalculator-TotalProcessedTimestamps")
+                   ->Get());
+  EXPECT_EQ(
+      2, runner_
+             ->GetCounter("TensorFlowInferenceCalculator-TotalNumSessionRuns")
+             ->Get());
+  EXPECT_EQ(
+      2, runner_
+             ->GetCounter("TensorFlowInferenceCalculator-TotalPaddedTimestamps")
+             ->Get());
+}
+
+TEST_F(TensorflowInferenceCalculatorTest,
+       GetAdaptiveBatchComputed_DifferentShapes) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("TensorFlowInferenceCalculator");
+  config.add_input_stream("A:tensor_a");
+  config.add_input_stream("B:tensor_b");
+  config.add_output_stream("MULTIPLIED:tensor_o1");
+  config.add_input_side_packet("SESSION:session");
+  config.set_max_in_flight(2);
+  CalculatorOptions options;
+  auto* batching =
+      options.MutableExtension(TensorFlowInferenceCalculatorOptions::ext)
+          ->mutable_adaptive_batching();
+  batching->set_max_batch_size(2);
+  batching->set_batch_timeout_usec(100000);
+  batching->set_executor_threads(2);
+  batching->add_allowed_batch_sizes(2);
+  *config.mutable_options() = options;
+
+  runner_ = absl::make_unique<CalculatorRunner>(config);
+  AddSessionInputSidePacket();
+  AddVectorToInputsAsTensor({2, 2, 2}, "A", 0);
+  AddVectorToInputsAsTensor({3, 4, 5}, "B", 0);
+  AddVectorToInputsAsTensor({3, 3}, "A", 1);
+  AddVectorToInputsAsTensor({3, 4}, "B", 1);
+  MP_ASSERT_OK(runner_->Run());
+
+  // Whether or not both timestamps are queued together, they can't be
+  // concatenated, so each one runs on its own, padded to 2.
+  const std::vector<Packet>& output_packets_mult =
+      runner_->Outputs().Tag(kMultipliedTag).packets;
+  ASSERT_EQ(2, output_packets_mult.size());
+  tf::test::ExpectTensorEqual<int32>(
+      tf::test::AsTensor<int32>({6, 8, 10}),
+      output_packets_mult[0].Get<tf::Tensor>());
+  tf::test::ExpectTensorEqual<int32>(
+      tf::test::AsTensor<int32>({9, 12}),
+      output_packets_mult[1].Get<tf::Tensor>());
+
+  EXPECT_EQ(
+      2, runner_
+             ->GetCounter("TensorFlowInferenceCalculator-TotalNumSessionRuns")
+             ->Get());
+  EXPECT_EQ(
+      2, runner_
+             ->GetCounter("TensorFlowInferenceCalculator-TotalPaddedTimestamps")
+             ->Get());
+}
+
+TEST_F(TensorflowInferenceCalculatorTest, GetAdaptiveBatchQueueStats) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+        input_stream: "tensor_a"
+        input_stream: "tensor_b"
+        input_side_packet: "session"
+        node {
+          calculator: "TensorFlowInferenceCalculator"
+          input_stream: "A:tensor_a"
+          input_stream: "B:tensor_b"
+          output_stream: "MULTIPLIED:tensor_o1"
+          input_side_packet: "SESSION:session"
+          options {
+            [mediapipe.TensorFlowInferenceCalculatorOptions.ext] {
+              adaptive_batching {
+                max_batch_size: 4
+                allowed_batch_sizes: 2
+                allowed_batch_sizes: 4
+                queue_name: "multiply"
+              }
+            }
+          }
+        }
+      )pb");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_o1", &graph_config, &output_packets);
+  auto batcher = std::make_shared<InferenceBatcher>();
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(graph_config));
+  MP_ASSERT_OK(graph.SetServiceObject(kInferenceBatcherService, batcher));
+  MP_ASSERT_OK(graph.StartRun({{"session", CreateSessionPacket()}}));
+  for (int t = 0; t < 3; ++t) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_a", CreateTensorPacket({2, 2, 2}, t)));
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_b", CreateTensorPacket({3, 4, 5}, t)));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  ASSERT_EQ(3, output_packets.size());
+
+  // Each timestamp runs in a batch of its own, padded to 2.
+  const InferenceBatcher::QueueStats stats =
+      batcher->GetQueueStats("multiply");
+  EXPECT_EQ(3, stats.num_batches);
+  EXPECT_EQ(3, stats.num_tasks);
+  EXPECT_EQ(3, stats.num_padding);
+  ASSERT_EQ(2, stats.batch_size_counts.size());
+  EXPECT_EQ(3, stats.batch_size_counts[1]);
+}
+
 TEST_F(TensorflowInferenceCalculatorTest, TestRecurrentStates) {
   CalculatorGraphConfig::Node config;
   config.set_calculator("TensorFlowInferenceCalculator");
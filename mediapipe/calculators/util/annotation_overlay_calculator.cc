@@ -12,7 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "mediapipe/calculators/util/annotation_overlay_calculator.pb.h"
@@ -58,6 +61,29 @@ constexpr uchar kAnnotationBackgroundColor = 2;  // Grayscale value.
 
 // Future Image type.
 inline bool HasImageTag(mediapipe::CalculatorContext* cc) { return false; }
+
+// Returns whether any RenderData input has annotations to draw.
+bool HasAnnotations(CalculatorContext* cc) {
+  for (CollectionItemId id = cc->Inputs().BeginId(); id < cc->Inputs().EndId();
+       ++id) {
+    const std::string& tag = cc->Inputs().TagAndIndexFromId(id).first;
+    if ((!tag.empty() && tag != kVectorTag) || cc->Inputs().Get(id).IsEmpty()) {
+      continue;
+    }
+    if (tag.empty()) {
+      if (cc->Inputs().Get(id).Get<RenderData>().render_annotations_size() >
+          0) {
+        return true;
+      }
+    } else {
+      for (const RenderData& render_data :
+           cc->Inputs().Get(id).Get<std::vector<RenderData>>()) {
+        if (render_data.render_annotations_size() > 0) return true;
+      }
+    }
+  }
+  return false;
+}
 }  // namespace
 
 // A calculator for rendering data on images.
@@ -84,6 +110,16 @@ inline bool HasImageTag(mediapipe::CalculatorContext* cc) { return false; }
 //
 // For GPU input frames, only 4-channel images are supported.
 //
+// On CPU, annotations are drawn directly into the output ImageFrame, and the
+// input packet is forwarded as is when there is nothing to draw. If this
+// calculator holds the only reference to an SRGB or SRGBA input frame, the
+// annotations are drawn on it in place. Otherwise the output is a full copy of
+// the input, since packets are immutable and every pixel must be in the new
+// frame, so the dirty tiles of the renderer don't reduce the CPU work beyond
+// rasterizing. On GPU, the annotation canvas is reused across frames: only the
+// regions drawn in the previous frame are cleared, and only the rows that
+// changed are uploaded.
+//
 // Note: When using GPU, drawing with color kAnnotationBackgroundColor (defined
 // above) is not supported.
 //
@@ -133,16 +169,18 @@ class AnnotationOverlayCalculator : public CalculatorBase {
 
  private:
   absl::Status CreateRenderTargetCpu(CalculatorContext* cc,
-                                     std::unique_ptr<cv::Mat>& image_mat,
-                                     ImageFormat::Format* target_format);
+                                     std::unique_ptr<ImageFrame>& output_frame);
   template <typename Type, const char* Tag>
   absl::Status CreateRenderTargetGpu(CalculatorContext* cc,
                                      std::unique_ptr<cv::Mat>& image_mat);
   template <typename Type, const char* Tag>
-  absl::Status RenderToGpu(CalculatorContext* cc, uchar* overlay_image);
+  absl::Status RenderToGpu(CalculatorContext* cc, uchar* overlay_image,
+                           int upload_row_begin, int upload_row_end);
   absl::Status RenderToCpu(CalculatorContext* cc,
-                           const ImageFormat::Format& target_format,
-                           uchar* data_image);
+                           std::unique_ptr<ImageFrame> output_frame);
+  // Forwards the input image, or the blank canvas, when there is nothing to
+  // draw. Returns false if the output needs to be rendered.
+  bool PassThroughCpu(CalculatorContext* cc);
 
   absl::Status GlRender(CalculatorContext* cc);
   template <typename Type, const char* Tag>
@@ -157,6 +195,9 @@ class AnnotationOverlayCalculator : public CalculatorBase {
   // Indicates if image frame is available as input.
   bool image_frame_available_ = false;
 
+  // Blank CPU canvas, used when there is no input image.
+  Packet blank_canvas_;
+
   bool use_gpu_ = false;
   bool gpu_initialized_ = false;
 #if !MEDIAPIPE_DISABLE_GPU
@@ -167,6 +208,11 @@ class AnnotationOverlayCalculator : public CalculatorBase {
   int height_ = 0;
   int width_canvas_ = 0;  // Size of overlay drawing texture canvas.
   int height_canvas_ = 0;
+  // Overlay drawing canvas, reused across frames, and the regions of it that
+  // were drawn on and not cleared yet.
+  std::unique_ptr<cv::Mat> canvas_;
+  std::vector<cv::Rect> canvas_dirty_rects_;
+  bool canvas_uploaded_ = false;
 #endif  // MEDIAPIPE_DISABLE_GPU
 };
 REGISTER_CALCULATOR(AnnotationOverlayCalculator);
@@ -281,9 +327,13 @@ absl::Status AnnotationOverlayCalculator::Process(CalculatorContext* cc) {
     return absl::OkStatus();
   }
 
+  if (!use_gpu_ && PassThroughCpu(cc)) {
+    return absl::OkStatus();
+  }
+
   // Initialize render target, drawn with OpenCV.
   std::unique_ptr<cv::Mat> image_mat;
-  ImageFormat::Format target_format;
+  std::unique_ptr<ImageFrame> output_frame;
   if (use_gpu_) {
 #if !MEDIAPIPE_DISABLE_GPU
     if (!gpu_initialized_) {
@@ -301,7 +351,9 @@ absl::Status AnnotationOverlayCalculator::Process(CalculatorContext* cc) {
 #endif  // !MEDIAPIPE_DISABLE_GPU
   } else {
     if (cc->Outputs().HasTag(kImageFrameTag)) {
-      MP_RETURN_IF_ERROR(CreateRenderTargetCpu(cc, image_mat, &target_format));
+      MP_RETURN_IF_ERROR(CreateRenderTargetCpu(cc, output_frame));
+      image_mat =
+          absl::make_unique<cv::Mat>(formats::MatView(output_frame.get()));
     }
   }
 
@@ -335,18 +387,30 @@ absl::Status AnnotationOverlayCalculator::Process(CalculatorContext* cc) {
 
   if (use_gpu_) {
 #if !MEDIAPIPE_DISABLE_GPU
+    // Upload the rows cleared or drawn in this frame, all rows at first.
+    std::vector<cv::Rect> dirty_rects = renderer_->GetDirtyRects();
+    int upload_row_begin = canvas_uploaded_ ? height_canvas_ : 0;
+    int upload_row_end = canvas_uploaded_ ? 0 : height_canvas_;
+    for (const auto* rects : {&canvas_dirty_rects_, &dirty_rects}) {
+      for (const cv::Rect& rect : *rects) {
+        upload_row_begin = std::min(upload_row_begin, rect.y);
+        upload_row_end = std::max(upload_row_end, rect.y + rect.height);
+      }
+    }
+    canvas_dirty_rects_ = std::move(dirty_rects);
+    canvas_uploaded_ = true;
+
     // Overlay rendered image in OpenGL, onto a copy of input.
     uchar* image_mat_ptr = image_mat->data;
-    MP_RETURN_IF_ERROR(
-        gpu_helper_.RunInGlContext([this, cc, image_mat_ptr]() -> absl::Status {
+    MP_RETURN_IF_ERROR(gpu_helper_.RunInGlContext(
+        [this, cc, image_mat_ptr, upload_row_begin,
+         upload_row_end]() -> absl::Status {
           return RenderToGpu<mediapipe::GpuBuffer, kGpuBufferTag>(
-              cc, image_mat_ptr);
+              cc, image_mat_ptr, upload_row_begin, upload_row_end);
         }));
 #endif  // !MEDIAPIPE_DISABLE_GPU
   } else {
-    // Copy the rendered image to output.
-    uchar* image_mat_ptr = image_mat->data;
-    MP_RETURN_IF_ERROR(RenderToCpu(cc, target_format, image_mat_ptr));
+    MP_RETURN_IF_ERROR(RenderToCpu(cc, std::move(output_frame)));
   }
 
   return absl::OkStatus();
@@ -366,21 +430,7 @@ absl::Status AnnotationOverlayCalculator::Close(CalculatorContext* cc) {
 }
 
 absl::Status AnnotationOverlayCalculator::RenderToCpu(
-    CalculatorContext* cc, const ImageFormat::Format& target_format,
-    uchar* data_image) {
-  auto output_frame = absl::make_unique<ImageFrame>(
-      target_format, renderer_->GetImageWidth(), renderer_->GetImageHeight());
-
-#if !MEDIAPIPE_DISABLE_GPU
-  output_frame->CopyPixelData(target_format, renderer_->GetImageWidth(),
-                              renderer_->GetImageHeight(), data_image,
-                              ImageFrame::kGlDefaultAlignmentBoundary);
-#else
-  output_frame->CopyPixelData(target_format, renderer_->GetImageWidth(),
-                              renderer_->GetImageHeight(), data_image,
-                              ImageFrame::kDefaultAlignmentBoundary);
-#endif  // !MEDIAPIPE_DISABLE_GPU
-
+    CalculatorContext* cc, std::unique_ptr<ImageFrame> output_frame) {
   if (cc->Outputs().HasTag(kImageFrameTag)) {
     cc->Outputs()
         .Tag(kImageFrameTag)
@@ -390,9 +440,34 @@ absl::Status AnnotationOverlayCalculator::RenderToCpu(
   return absl::OkStatus();
 }
 
+bool AnnotationOverlayCalculator::PassThroughCpu(CalculatorContext* cc) {
+  if (!cc->Outputs().HasTag(kImageFrameTag) || HasAnnotations(cc)) {
+    return false;
+  }
+  if (image_frame_available_) {
+    // GRAY8 input is converted to SRGB.
+    const Packet& input = cc->Inputs().Tag(kImageFrameTag).Value();
+    if (input.Get<ImageFrame>().Format() == ImageFormat::GRAY8) {
+      return false;
+    }
+    cc->Outputs().Tag(kImageFrameTag).AddPacket(input);
+    return true;
+  }
+  if (blank_canvas_.IsEmpty()) {
+    std::unique_ptr<ImageFrame> canvas;
+    if (!CreateRenderTargetCpu(cc, canvas).ok()) return false;
+    blank_canvas_ = Adopt(canvas.release());
+  }
+  cc->Outputs().Tag(kImageFrameTag).AddPacket(
+      blank_canvas_.At(cc->InputTimestamp()));
+  return true;
+}
+
 template <typename Type, const char* Tag>
 absl::Status AnnotationOverlayCalculator::RenderToGpu(CalculatorContext* cc,
-                                                      uchar* overlay_image) {
+                                                      uchar* overlay_image,
+                                                      int upload_row_begin,
+                                                      int upload_row_end) {
 #if !MEDIAPIPE_DISABLE_GPU
   // Source and destination textures.
   const auto& input_frame = cc->Inputs().Tag(Tag).Get<Type>();
@@ -401,11 +476,13 @@ absl::Status AnnotationOverlayCalculator::RenderToGpu(CalculatorContext* cc,
   auto output_texture = gpu_helper_.CreateDestinationTexture(
       width_, height_, mediapipe::GpuBufferFormat::kBGRA32);
 
-  // Upload render target to GPU.
-  {
+  // Upload the changed rows of the render target to GPU.
+  if (upload_row_end > upload_row_begin) {
     glBindTexture(GL_TEXTURE_2D, image_mat_tex_);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_canvas_, height_canvas_,
-                    GL_RGB, GL_UNSIGNED_BYTE, overlay_image);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload_row_begin, width_canvas_,
+                    upload_row_end - upload_row_begin, GL_RGB,
+                    GL_UNSIGNED_BYTE,
+                    overlay_image + upload_row_begin * width_canvas_ * 3);
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
@@ -440,48 +517,65 @@ absl::Status AnnotationOverlayCalculator::RenderToGpu(CalculatorContext* cc,
 }
 
 absl::Status AnnotationOverlayCalculator::CreateRenderTargetCpu(
-    CalculatorContext* cc, std::unique_ptr<cv::Mat>& image_mat,
-    ImageFormat::Format* target_format) {
+    CalculatorContext* cc, std::unique_ptr<ImageFrame>& output_frame) {
+#if !MEDIAPIPE_DISABLE_GPU
+  const uint32 alignment_boundary = ImageFrame::kGlDefaultAlignmentBoundary;
+#else
+  const uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary;
+#endif  // !MEDIAPIPE_DISABLE_GPU
   if (image_frame_available_) {
     const auto& input_frame =
         cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
 
-    int target_mat_type;
+    ImageFormat::Format target_format;
     switch (input_frame.Format()) {
       case ImageFormat::SRGBA:
-        *target_format = ImageFormat::SRGBA;
-        target_mat_type = CV_8UC4;
+        target_format = ImageFormat::SRGBA;
         break;
       case ImageFormat::SRGB:
-        *target_format = ImageFormat::SRGB;
-        target_mat_type = CV_8UC3;
+        target_format = ImageFormat::SRGB;
         break;
       case ImageFormat::GRAY8:
-        *target_format = ImageFormat::SRGB;
-        target_mat_type = CV_8UC3;
+        target_format = ImageFormat::SRGB;
         break;
       default:
         return absl::UnknownError("Unexpected image frame format.");
         break;
     }
 
-    image_mat = absl::make_unique<cv::Mat>(
-        input_frame.Height(), input_frame.Width(), target_mat_type);
-
-    auto input_mat = formats::MatView(&input_frame);
+    // The annotations are drawn directly on the output frame.
     if (input_frame.Format() == ImageFormat::GRAY8) {
-      cv::Mat rgb_mat;
-      cv::cvtColor(input_mat, rgb_mat, CV_GRAY2RGB);
-      rgb_mat.copyTo(*image_mat);
+      output_frame = absl::make_unique<ImageFrame>(
+          target_format, input_frame.Width(), input_frame.Height(),
+          alignment_boundary);
+      cv::Mat output_mat = formats::MatView(output_frame.get());
+      cv::cvtColor(formats::MatView(&input_frame), output_mat, CV_GRAY2RGB);
     } else {
-      input_mat.copyTo(*image_mat);
+      // Draws in place if no other packet refers to the input frame, e.g.
+      // when the upstream calculator created it for this one only.
+      if (input_frame.IsAligned(alignment_boundary)) {
+        auto consumed_frame =
+            cc->Inputs().Tag(kImageFrameTag).Value().Consume<ImageFrame>();
+        if (consumed_frame.ok()) {
+          output_frame = std::move(consumed_frame).value();
+        }
+      }
+      if (!output_frame) {
+        output_frame = absl::make_unique<ImageFrame>();
+        output_frame->CopyFrom(input_frame, alignment_boundary);
+      }
     }
+  } else if (!blank_canvas_.IsEmpty()) {
+    output_frame = absl::make_unique<ImageFrame>();
+    output_frame->CopyFrom(blank_canvas_.Get<ImageFrame>(), alignment_boundary);
   } else {
-    image_mat = absl::make_unique<cv::Mat>(
-        options_.canvas_height_px(), options_.canvas_width_px(), CV_8UC3,
-        cv::Scalar(options_.canvas_color().r(), options_.canvas_color().g(),
-                   options_.canvas_color().b()));
-    *target_format = ImageFormat::SRGB;
+    output_frame = absl::make_unique<ImageFrame>(
+        ImageFormat::SRGB, options_.canvas_width_px(),
+        options_.canvas_height_px(), alignment_boundary);
+    formats::MatView(output_frame.get())
+        .setTo(cv::Scalar(options_.canvas_color().r(),
+                          options_.canvas_color().g(),
+                          options_.canvas_color().b()));
   }
 
   return absl::OkStatus();
@@ -498,16 +592,23 @@ absl::Status AnnotationOverlayCalculator::CreateRenderTargetGpu(
     if (format != mediapipe::ImageFormat::SRGBA &&
         format != mediapipe::ImageFormat::SRGB)
       RET_CHECK_FAIL() << "Unsupported GPU input format: " << format;
-    image_mat =
-        absl::make_unique<cv::Mat>(height_canvas_, width_canvas_, CV_8UC3);
-    memset(image_mat->data, kAnnotationBackgroundColor,
-           height_canvas_ * width_canvas_ * image_mat->elemSize());
+  }
+  const cv::Scalar background_color =
+      image_frame_available_
+          ? cv::Scalar::all(kAnnotationBackgroundColor)
+          : cv::Scalar(options_.canvas_color().r(), options_.canvas_color().g(),
+                       options_.canvas_color().b());
+  if (!canvas_) {
+    canvas_ = absl::make_unique<cv::Mat>(height_canvas_, width_canvas_, CV_8UC3,
+                                         background_color);
   } else {
-    image_mat = absl::make_unique<cv::Mat>(
-        height_canvas_, width_canvas_, CV_8UC3,
-        cv::Scalar(options_.canvas_color().r(), options_.canvas_color().g(),
-                   options_.canvas_color().b()));
+    // Only clear what was drawn in the previous frame.
+    for (const cv::Rect& rect : canvas_dirty_rects_) {
+      (*canvas_)(rect).setTo(background_color);
+    }
   }
+  // Shares the pixel data of the canvas.
+  image_mat = absl::make_unique<cv::Mat>(*canvas_);
 #endif  // !MEDIAPIPE_DISABLE_GPU
 
   return absl::OkStatus();
@@ -15,7 +15,9 @@
 #ifndef MEDIAPIPE_CALCULATORS_UTIL_ASSOCIATION_CALCULATOR_H_
 #define MEDIAPIPE_CALCULATORS_UTIL_ASSOCIATION_CALCULATOR_H_
 
+#include <algorithm>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
@@ -78,30 +80,48 @@ class AssociationCalculator : public CalculatorBase {
   }
 
   absl::Status Process(CalculatorContext* cc) override {
-    auto get_non_overlapping_elements = GetNonOverlappingElements(cc);
-    if (!get_non_overlapping_elements.ok()) {
-      return get_non_overlapping_elements.status();
+    // Gather the elements of all regular input streams, in increasing order of
+    // priority based on input stream index.
+    std::vector<T> elements;
+    for (CollectionItemId id = cc->Inputs().BeginId();
+         id < cc->Inputs().EndId(); ++id) {
+      if (id == prev_input_stream_id_ || cc->Inputs().Get(id).IsEmpty()) {
+        continue;
+      }
+      const std::vector<T>& input_vec =
+          cc->Inputs().Get(id).template Get<std::vector<T>>();
+      elements.insert(elements.end(), input_vec.begin(), input_vec.end());
     }
-    std::list<T> result = get_non_overlapping_elements.value();
 
-    if (has_prev_input_stream_ &&
-        !cc->Inputs().Get(prev_input_stream_id_).IsEmpty()) {
-      // Processed all regular input streams. Now compare the result list
-      // elements with those in the PREV input stream, and propagate IDs from
-      // PREV input stream as appropriate.
+    const bool has_prev_input =
+        has_prev_input_stream_ &&
+        !cc->Inputs().Get(prev_input_stream_id_).IsEmpty();
+    // A single element can't overlap anything, so its rectangle is only needed
+    // to compare it with the PREV input stream.
+    rects_.clear();
+    if (elements.size() > 1 || has_prev_input) {
+      for (const T& element : elements) {
+        ASSIGN_OR_RETURN(Rectangle_f rect, GetRectangle(element));
+        rects_.push_back(rect);
+      }
+    }
+
+    if (elements.size() > 1) {
+      KeepNonOverlappingElements(&elements);
+    }
+    if (has_prev_input && !elements.empty()) {
+      // Processed all regular input streams. Now compare the kept elements
+      // with those in the PREV input stream, and propagate IDs from PREV input
+      // stream as appropriate.
       const std::vector<T>& prev_input_vec =
           cc->Inputs()
               .Get(prev_input_stream_id_)
               .template Get<std::vector<T>>();
 
       MP_RETURN_IF_ERROR(
-          PropagateIdsFromPreviousToCurrent(prev_input_vec, &result));
-    }
-
-    auto output = absl::make_unique<std::vector<T>>();
-    for (auto it = result.begin(); it != result.end(); ++it) {
-      output->push_back(*it);
+          PropagateIdsFromPreviousToCurrent(prev_input_vec, &elements));
     }
+    auto output = absl::make_unique<std::vector<T>>(std::move(elements));
     cc->Outputs().Index(0).Add(output.release(), cc->InputTimestamp());
 
     return absl::OkStatus();
@@ -122,126 +142,89 @@ class AssociationCalculator : public CalculatorBase {
   virtual void SetId(T* input, int id) {}
 
  private:
-  // Get a list of non-overlapping elements from all input streams, with
-  // increasing order of priority based on input stream index.
-  absl::StatusOr<std::list<T>> GetNonOverlappingElements(
-      CalculatorContext* cc) {
-    std::list<T> result;
-
-    // Initialize result with the first non-empty input vector.
-    CollectionItemId non_empty_id = cc->Inputs().BeginId();
-    for (CollectionItemId id = cc->Inputs().BeginId();
-         id < cc->Inputs().EndId(); ++id) {
-      if (id == prev_input_stream_id_ || cc->Inputs().Get(id).IsEmpty()) {
-        continue;
-      }
-      const std::vector<T>& input_vec =
-          cc->Inputs().Get(id).Get<std::vector<T>>();
-      if (!input_vec.empty()) {
-        non_empty_id = id;
-        result.push_back(input_vec[0]);
-        for (int j = 1; j < input_vec.size(); ++j) {
-          MP_RETURN_IF_ERROR(AddElementToList(input_vec[j], &result));
-        }
-        break;
-      }
+  // Removes the elements that overlap with a later element, in place, and
+  // keeps the rectangles in rects_ parallel to the elements. An element that
+  // replaces overlapping elements takes the ID of the last of them that has
+  // one.
+  //
+  // An element is removed by the first later element it overlaps, so all the
+  // overlapping pairs are found at once instead of comparing each element
+  // with all the elements kept so far.
+  void KeepNonOverlappingElements(std::vector<T>* elements) {
+    const int num_elements = elements->size();
+    replaced_by_.assign(num_elements, num_elements);
+    for (const auto& pair : FindOverlappingRectangles(
+             rects_, options_.min_similarity_threshold())) {
+      replaced_by_[pair.first] =
+          std::min(replaced_by_[pair.first], pair.second);
     }
 
-    // Compare remaining input vectors with the non-empty result vector,
-    // remove lower-priority overlapping elements from the result vector and
-    // had corresponding higher-priority elements as necessary.
-    for (CollectionItemId id = non_empty_id + 1; id < cc->Inputs().EndId();
-         ++id) {
-      if (id == prev_input_stream_id_ || cc->Inputs().Get(id).IsEmpty()) {
-        continue;
-      }
-      const std::vector<T>& input_vec =
-          cc->Inputs().Get(id).Get<std::vector<T>>();
-
-      for (int vi = 0; vi < input_vec.size(); ++vi) {
-        MP_RETURN_IF_ERROR(AddElementToList(input_vec[vi], &result));
+    // Elements are visited in order, so the IDs of the elements replaced by
+    // an element are final when it is reached, and the last of them wins.
+    new_ids_.assign(num_elements, {false, -1});
+    int num_kept = 0;
+    for (int i = 0; i < num_elements; ++i) {
+      T& element = (*elements)[i];
+      if (new_ids_[i].first) {
+        SetId(&element, new_ids_[i].second);
       }
-    }
-
-    return result;
-  }
-
-  absl::Status AddElementToList(T element, std::list<T>* current) {
-    // Compare this element with elements of the input collection. If this
-    // element has high overlap with elements of the collection, remove
-    // those elements from the collection and add this element.
-    ASSIGN_OR_RETURN(auto cur_rect, GetRectangle(element));
-
-    bool change_id = false;
-    int new_elem_id = -1;
-
-    for (auto uit = current->begin(); uit != current->end();) {
-      ASSIGN_OR_RETURN(auto prev_rect, GetRectangle(*uit));
-      if (CalculateIou(cur_rect, prev_rect) >
-          options_.min_similarity_threshold()) {
-        std::pair<bool, int> prev_id = GetId(*uit);
-        // If prev_id.first is false when some element doesn't have an ID,
-        // change_id and new_elem_id will not be updated.
-        if (prev_id.first) {
-          change_id = prev_id.first;
-          new_elem_id = prev_id.second;
+      if (replaced_by_[i] < num_elements) {
+        std::pair<bool, int> id = GetId(element);
+        // If id.first is false when some element doesn't have an ID, the ID
+        // of the replacing element will not be updated.
+        if (id.first) {
+          new_ids_[replaced_by_[i]] = id;
         }
-        uit = current->erase(uit);
-      } else {
-        ++uit;
+        continue;
       }
+      if (num_kept != i) {
+        (*elements)[num_kept] = std::move(element);
+        rects_[num_kept] = rects_[i];
+      }
+      ++num_kept;
     }
-
-    if (change_id) {
-      SetId(&element, new_elem_id);
-    }
-    current->push_back(element);
-
-    return absl::OkStatus();
+    elements->erase(elements->begin() + num_kept, elements->end());
+    rects_.resize(num_kept);
   }
 
-  // Compare elements of the current list with elements in from the collection
-  // of elements from the previous input stream, and propagate IDs from the
-  // previous input stream as appropriate.
+  // Compare the kept elements with the elements from the previous input
+  // stream, and propagate IDs from the previous input stream as appropriate.
+  // The rectangles of the kept elements are in rects_.
   absl::Status PropagateIdsFromPreviousToCurrent(
-      const std::vector<T>& prev_input_vec, std::list<T>* current) {
-    for (auto vit = current->begin(); vit != current->end(); ++vit) {
-      auto get_cur_rectangle = GetRectangle(*vit);
-      if (!get_cur_rectangle.ok()) {
-        return get_cur_rectangle.status();
-      }
-      const Rectangle_f& cur_rect = get_cur_rectangle.value();
-
-      bool change_id = false;
-      int id_for_vi = -1;
+      const std::vector<T>& prev_input_vec, std::vector<T>* current) {
+    const int num_current = current->size();
+    for (const T& prev : prev_input_vec) {
+      ASSIGN_OR_RETURN(Rectangle_f rect, GetRectangle(prev));
+      rects_.push_back(rect);
+    }
 
-      for (int ui = 0; ui < prev_input_vec.size(); ++ui) {
-        auto get_prev_rectangle = GetRectangle(prev_input_vec[ui]);
-        if (!get_prev_rectangle.ok()) {
-          return get_prev_rectangle.status();
-        }
-        const Rectangle_f& prev_rect = get_prev_rectangle.value();
-
-        if (CalculateIou(cur_rect, prev_rect) >
-            options_.min_similarity_threshold()) {
-          std::pair<bool, int> prev_id = GetId(prev_input_vec[ui]);
-          // If prev_id.first is false when some element doesn't have an ID,
-          // change_id and id_for_vi will not be updated.
-          if (prev_id.first) {
-            change_id = prev_id.first;
-            id_for_vi = prev_id.second;
-          }
-        }
+    // The last overlapping element from the previous input stream that has an
+    // ID wins.
+    last_prev_with_id_.assign(num_current, -1);
+    for (const auto& pair : FindOverlappingRectangles(
+             rects_, options_.min_similarity_threshold())) {
+      if (pair.first >= num_current || pair.second < num_current) continue;
+      const int ui = pair.second - num_current;
+      if (ui > last_prev_with_id_[pair.first] &&
+          GetId(prev_input_vec[ui]).first) {
+        last_prev_with_id_[pair.first] = ui;
       }
+    }
 
-      if (change_id) {
-        T element = *vit;
-        SetId(&element, id_for_vi);
-        *vit = element;
+    for (int vi = 0; vi < num_current; ++vi) {
+      if (last_prev_with_id_[vi] >= 0) {
+        SetId(&(*current)[vi],
+              GetId(prev_input_vec[last_prev_with_id_[vi]]).second);
       }
     }
     return absl::OkStatus();
   }
+
+  // Scratch buffers, kept to reuse their allocations across Process calls.
+  std::vector<Rectangle_f> rects_;
+  std::vector<int> replaced_by_;
+  std::vector<std::pair<bool, int>> new_ids_;
+  std::vector<int> last_prev_with_id_;
 };
 
 }  // namespace mediapipe
@@ -32,6 +32,7 @@
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/profiler/trace_counter.h"
 #include "mediapipe/framework/tool/options_util.h"
 #include "mediapipe/util/tracking/box_tracker.h"
 #include "mediapipe/util/tracking/tracking.h"
@@ -245,6 +246,9 @@ class BoxTrackerCalculator : public CalculatorBase {
   // should be cleared immediately.
   absl::flat_hash_set<int> actively_discarded_tracked_ids_;
 
+  // Traces the number of boxes tracked in each frame.
+  TraceCounter box_count_{"box_count"};
+
   // Add smooth transition between re-acquisition and previous tracked boxes.
   // `result_box` is the tracking result of one specific timestamp. The smoothed
   // result will be updated in place.
@@ -896,6 +900,8 @@ absl::Status BoxTrackerCalculator::Process(CalculatorContext* cc) {
     }
   }
 
+  box_count_.Set(cc, box_track_list.box_size());
+
   // Always output in batch, only output in streaming if tracking data
   // is present (might be in fast forward mode instead).
   if (cc->Outputs().HasTag(kBoxesTag) &&
@@ -28,6 +28,7 @@
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/profiler/trace_counter.h"
 #include "mediapipe/util/tracking/camera_motion.h"
 #include "mediapipe/util/tracking/camera_motion.pb.h"
 #include "mediapipe/util/tracking/frame_selection.pb.h"
@@ -197,6 +198,9 @@ class MotionAnalysisCalculator : public CalculatorBase {
   std::unique_ptr<MotionAnalysis> motion_analysis_;
 
   std::unique_ptr<MixtureRowWeights> row_weights_;
+
+  // Traces the number of region flow features in each frame.
+  TraceCounter feature_count_{"feature_count"};
 };
 
 REGISTER_CALCULATOR(MotionAnalysisCalculator);
@@ -672,6 +676,8 @@ void MotionAnalysisCalculator::OutputMotionAnalyzedFrames(
       cc->Outputs().Tag(kDenseFgTag).Add(foreground_frame.release(), timestamp);
     }
 
+    feature_count_.Set(cc, feature_list->feature_size());
+
     // Output flow features if requested.
     if (region_flow_feature_output_) {
       cc->Outputs().Tag(kFlowTag).Add(feature_list.release(), timestamp);
@@ -23,6 +23,7 @@
 #include "mediapipe/framework/port/opencv_video_inc.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/tool/status_util.h"
+#include "mediapipe/util/image_frame_pool_util.h"
 
 namespace mediapipe {
 
@@ -95,6 +96,7 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
   static absl::Status GetContract(CalculatorContract* cc) {
     cc->InputSidePackets().Tag(kInputFilePathTag).Set<std::string>();
     cc->Outputs().Tag(kVideoTag).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
     if (cc->Outputs().HasTag(kVideoPrestreamTag)) {
       cc->Outputs().Tag(kVideoPrestreamTag).Set<VideoHeader>();
     }
@@ -187,8 +189,8 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
   }
 
   absl::Status Process(CalculatorContext* cc) override {
-    auto image_frame = absl::make_unique<ImageFrame>(format_, width_, height_,
-                                                     /*alignment_boundary=*/1);
+    auto image_frame = GetPooledImageFrame(cc, format_, width_, height_,
+                                           /*alignment_boundary=*/1);
     // Use microsecond as the unit of time.
     Timestamp timestamp(cap_->get(cv::CAP_PROP_POS_MSEC) * 1000);
     if (format_ == ImageFormat::GRAY8) {
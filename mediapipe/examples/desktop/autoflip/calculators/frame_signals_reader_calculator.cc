@@ -0,0 +1,208 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_split.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_signals_reader_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/quality/frame_signals_index.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputFilePathTag[] = "INPUT_FILE_PATH";
+constexpr char kVideoSizeTag[] = "VIDEO_SIZE";
+constexpr char kKeyFrameSizeTag[] = "KEY_FRAME_SIZE";
+constexpr char kDetectionFeaturesTag[] = "DETECTION_FEATURES";
+constexpr char kStaticFeaturesTag[] = "STATIC_FEATURES";
+constexpr char kShotBoundariesTag[] = "SHOT_BOUNDARIES";
+
+}  // namespace
+
+// Replays the per-frame signals written by FrameSignalsWriterCalculator. This
+// is the source of the cropping pass of a two-pass AutoFlip run, and replaces
+// the decoding, scaling and detection nodes in front of
+// SceneCroppingCalculator.
+//
+// Only the index of each shard is held in memory; records are read lazily, one
+// per Process() call, so the memory use of the reader does not depend on the
+// video length. The memory use of the cropping pass is still dominated by
+// SceneCroppingCalculator, which buffers the frames of each scene, up to
+// max_scene_size, to solve the camera path of the scene.
+// Packets are emitted at the original frame timestamps, so the outputs can be
+// combined with frames from a video decoder.
+//
+// Input side packets:
+// - required tag INPUT_FILE_PATH (type std::string):
+//     Comma-separated list of signals files. When the analysis pass is sharded
+//     by time range, the shards must be listed in time order.
+//
+// Output streams:
+// - optional tag VIDEO_SIZE (type std::pair<int, int>):
+//     Original frame size, emitted on every frame.
+// - optional tag KEY_FRAME_SIZE (type std::pair<int, int>):
+//     Size of the frames the features were detected on, emitted with every
+//     DETECTION_FEATURES packet.
+// - optional tag DETECTION_FEATURES (type DetectionSet)
+// - optional tag STATIC_FEATURES (type StaticFeatures)
+// - optional tag SHOT_BOUNDARIES (type bool)
+//
+// Example config:
+// node {
+//   calculator: "FrameSignalsReaderCalculator"
+//   input_side_packet: "INPUT_FILE_PATH:signals_path"
+//   output_stream: "VIDEO_SIZE:video_size"
+//   output_stream: "KEY_FRAME_SIZE:key_frame_size"
+//   output_stream: "DETECTION_FEATURES:salient_regions"
+//   output_stream: "STATIC_FEATURES:borders"
+//   output_stream: "SHOT_BOUNDARIES:shot_change"
+//   options: {
+//     [mediapipe.autoflip.FrameSignalsReaderCalculatorOptions.ext]: {
+//       start_time_us: 0
+//       end_time_us: 60000000
+//     }
+//   }
+// }
+class FrameSignalsReaderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  // Advances to the next shard that has records in the requested time range.
+  // Returns false when all shards are exhausted.
+  absl::StatusOr<bool> OpenNextShard();
+
+  FrameSignalsReaderCalculatorOptions options_;
+  std::vector<std::string> shard_paths_;
+  int next_shard_ = 0;
+  std::unique_ptr<FrameSignalsReader> reader_;
+  int position_ = 0;
+};
+REGISTER_CALCULATOR(FrameSignalsReaderCalculator);
+
+absl::Status FrameSignalsReaderCalculator::GetContract(
+    CalculatorContract* cc) {
+  cc->InputSidePackets().Tag(kInputFilePathTag).Set<std::string>();
+  if (cc->Outputs().HasTag(kVideoSizeTag)) {
+    cc->Outputs().Tag(kVideoSizeTag).Set<std::pair<int, int>>();
+  }
+  if (cc->Outputs().HasTag(kKeyFrameSizeTag)) {
+    cc->Outputs().Tag(kKeyFrameSizeTag).Set<std::pair<int, int>>();
+  }
+  if (cc->Outputs().HasTag(kDetectionFeaturesTag)) {
+    cc->Outputs().Tag(kDetectionFeaturesTag).Set<DetectionSet>();
+  }
+  if (cc->Outputs().HasTag(kStaticFeaturesTag)) {
+    cc->Outputs().Tag(kStaticFeaturesTag).Set<StaticFeatures>();
+  }
+  if (cc->Outputs().HasTag(kShotBoundariesTag)) {
+    cc->Outputs().Tag(kShotBoundariesTag).Set<bool>();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FrameSignalsReaderCalculator::Open(CalculatorContext* cc) {
+  options_ = cc->Options<FrameSignalsReaderCalculatorOptions>();
+  shard_paths_ = absl::StrSplit(
+      cc->InputSidePackets().Tag(kInputFilePathTag).Get<std::string>(), ',',
+      absl::SkipEmpty());
+  RET_CHECK(!shard_paths_.empty()) << "No signals file was provided.";
+  return absl::OkStatus();
+}
+
+absl::StatusOr<bool> FrameSignalsReaderCalculator::OpenNextShard() {
+  while (next_shard_ < shard_paths_.size()) {
+    reader_ = absl::make_unique<FrameSignalsReader>();
+    MP_RETURN_IF_ERROR(reader_->Open(shard_paths_[next_shard_++]));
+    position_ = reader_->LowerBound(options_.start_time_us());
+    if (position_ < reader_->NumRecords()) {
+      return true;
+    }
+  }
+  reader_.reset();
+  return false;
+}
+
+absl::Status FrameSignalsReaderCalculator::Process(CalculatorContext* cc) {
+  if (!reader_ || position_ >= reader_->NumRecords()) {
+    ASSIGN_OR_RETURN(bool has_records, OpenNextShard());
+    if (!has_records) {
+      return tool::StatusStop();
+    }
+  }
+  const auto& entry = reader_->index().entry(position_);
+  if (options_.end_time_us() >= 0 &&
+      entry.timestamp_us() >= options_.end_time_us()) {
+    return tool::StatusStop();
+  }
+  FrameSignals signals;
+  MP_RETURN_IF_ERROR(reader_->Read(position_++, &signals));
+  const Timestamp timestamp(signals.timestamp_us());
+
+  const auto& index = reader_->index();
+  if (cc->Outputs().HasTag(kVideoSizeTag)) {
+    cc->Outputs()
+        .Tag(kVideoSizeTag)
+        .AddPacket(MakePacket<std::pair<int, int>>(index.frame_width(),
+                                                   index.frame_height())
+                       .At(timestamp));
+  }
+  if (cc->Outputs().HasTag(kShotBoundariesTag) && signals.is_shot_change()) {
+    cc->Outputs()
+        .Tag(kShotBoundariesTag)
+        .AddPacket(MakePacket<bool>(true).At(timestamp));
+  }
+  if (signals.has_detection_features()) {
+    if (cc->Outputs().HasTag(kKeyFrameSizeTag)) {
+      const bool has_key_frame_size =
+          index.has_key_frame_width() && index.has_key_frame_height();
+      cc->Outputs()
+          .Tag(kKeyFrameSizeTag)
+          .AddPacket(
+              MakePacket<std::pair<int, int>>(
+                  has_key_frame_size ? index.key_frame_width()
+                                     : index.frame_width(),
+                  has_key_frame_size ? index.key_frame_height()
+                                     : index.frame_height())
+                  .At(timestamp));
+    }
+    if (cc->Outputs().HasTag(kDetectionFeaturesTag)) {
+      cc->Outputs()
+          .Tag(kDetectionFeaturesTag)
+          .Add(signals.release_detection_features(), timestamp);
+    }
+  }
+  if (cc->Outputs().HasTag(kStaticFeaturesTag) &&
+      signals.has_static_features()) {
+    cc->Outputs()
+        .Tag(kStaticFeaturesTag)
+        .Add(signals.release_static_features(), timestamp);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,290 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_signals_reader_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kVideoFramesTag[] = "VIDEO_FRAMES";
+constexpr char kKeyFramesTag[] = "KEY_FRAMES";
+constexpr char kDetectionFeaturesTag[] = "DETECTION_FEATURES";
+constexpr char kStaticFeaturesTag[] = "STATIC_FEATURES";
+constexpr char kShotBoundariesTag[] = "SHOT_BOUNDARIES";
+constexpr char kOutputFilePathTag[] = "OUTPUT_FILE_PATH";
+constexpr char kInputFilePathTag[] = "INPUT_FILE_PATH";
+constexpr char kVideoSizeTag[] = "VIDEO_SIZE";
+constexpr char kKeyFrameSizeTag[] = "KEY_FRAME_SIZE";
+
+constexpr char kWriterConfig[] = R"(
+  calculator: "FrameSignalsWriterCalculator"
+  input_side_packet: "OUTPUT_FILE_PATH:signals_path"
+  input_stream: "VIDEO_FRAMES:video_frames"
+  input_stream: "KEY_FRAMES:key_frames"
+  input_stream: "DETECTION_FEATURES:salient_regions"
+  input_stream: "STATIC_FEATURES:borders"
+  input_stream: "SHOT_BOUNDARIES:shot_change")";
+
+constexpr char kWriterConfigNoKeyFrames[] = R"(
+  calculator: "FrameSignalsWriterCalculator"
+  input_side_packet: "OUTPUT_FILE_PATH:signals_path"
+  input_stream: "VIDEO_FRAMES:video_frames"
+  input_stream: "DETECTION_FEATURES:salient_regions"
+  input_stream: "STATIC_FEATURES:borders"
+  input_stream: "SHOT_BOUNDARIES:shot_change")";
+
+constexpr char kReaderConfig[] = R"(
+  calculator: "FrameSignalsReaderCalculator"
+  input_side_packet: "INPUT_FILE_PATH:signals_path"
+  output_stream: "VIDEO_SIZE:video_size"
+  output_stream: "KEY_FRAME_SIZE:key_frame_size"
+  output_stream: "DETECTION_FEATURES:salient_regions"
+  output_stream: "STATIC_FEATURES:borders"
+  output_stream: "SHOT_BOUNDARIES:shot_change"
+  options: {
+    [mediapipe.autoflip.FrameSignalsReaderCalculatorOptions.ext]: {
+      start_time_us: $0
+      end_time_us: $1
+    }
+  })";
+
+constexpr int kFrameWidth = 128;
+constexpr int kFrameHeight = 72;
+constexpr int kKeyFrameWidth = 64;
+constexpr int kKeyFrameHeight = 36;
+constexpr int kKeyFrameRate = 2;
+constexpr int kShotChangeFrame = 3;
+constexpr int64 kTimestampDiff = 20000;
+
+std::string TestPath(const std::string& name) {
+  return absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+}
+
+// Returns a detection set that identifies the frame it was computed on.
+DetectionSet MakeDetections(int frame) {
+  DetectionSet detections;
+  auto* region = detections.add_detections();
+  region->mutable_location()->set_x(frame);
+  region->mutable_location()->set_y(2 * frame);
+  region->mutable_location()->set_width(10);
+  region->mutable_location()->set_height(20);
+  region->set_score(0.5f);
+  region->set_is_required(frame % 2 == 0);
+  return detections;
+}
+
+// Returns static features that identify the frame they were computed on.
+StaticFeatures MakeStaticFeatures(int frame) {
+  StaticFeatures features;
+  auto* border = features.add_border();
+  border->mutable_border_position()->set_height(frame + 1);
+  border->set_relative_position(Border::TOP);
+  return features;
+}
+
+// Runs FrameSignalsWriterCalculator on frames [first_frame, last_frame). Key
+// frames and detections are sent on every kKeyFrameRate-th frame, static
+// features on every frame, and a shot boundary packet on the first two frames
+// of the range and on kShotChangeFrame, only the latter being true.
+void WriteSignals(const std::string& path, const char* config,
+                  int first_frame, int last_frame) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(config));
+  runner.MutableSidePackets()->Tag(kOutputFilePathTag) =
+      MakePacket<std::string>(path);
+  auto* inputs = runner.MutableInputs();
+  for (int frame = first_frame; frame < last_frame; ++frame) {
+    const Timestamp timestamp(frame * kTimestampDiff);
+    inputs->Tag(kVideoFramesTag)
+        .packets.push_back(Adopt(new ImageFrame(ImageFormat::SRGB, kFrameWidth,
+                                                kFrameHeight))
+                               .At(timestamp));
+    if (frame % kKeyFrameRate == 0) {
+      if (inputs->HasTag(kKeyFramesTag)) {
+        inputs->Tag(kKeyFramesTag)
+            .packets.push_back(Adopt(new ImageFrame(ImageFormat::SRGB,
+                                                    kKeyFrameWidth,
+                                                    kKeyFrameHeight))
+                                   .At(timestamp));
+      }
+      inputs->Tag(kDetectionFeaturesTag)
+          .packets.push_back(
+              MakePacket<DetectionSet>(MakeDetections(frame)).At(timestamp));
+    }
+    inputs->Tag(kStaticFeaturesTag)
+        .packets.push_back(
+            MakePacket<StaticFeatures>(MakeStaticFeatures(frame))
+                .At(timestamp));
+    if (frame < first_frame + 2 || frame == kShotChangeFrame) {
+      inputs->Tag(kShotBoundariesTag)
+          .packets.push_back(
+              MakePacket<bool>(frame == kShotChangeFrame).At(timestamp));
+    }
+  }
+  MP_ASSERT_OK(runner.Run());
+}
+
+std::unique_ptr<CalculatorRunner> MakeReader(const std::string& paths,
+                                             int64 start_time_us,
+                                             int64 end_time_us) {
+  auto runner = absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+          absl::Substitute(kReaderConfig, start_time_us, end_time_us)));
+  runner->MutableSidePackets()->Tag(kInputFilePathTag) =
+      MakePacket<std::string>(paths);
+  return runner;
+}
+
+std::vector<int64> Timestamps(const std::vector<Packet>& packets) {
+  std::vector<int64> timestamps;
+  for (const Packet& packet : packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+// Checks that the reader outputs the signals given to the writer, at the
+// original timestamps, for frames [first_frame, last_frame).
+void CheckSignals(const CalculatorRunner& runner, int first_frame,
+                  int last_frame, int key_frame_width, int key_frame_height) {
+  const auto& outputs = runner.Outputs();
+  std::vector<int64> frame_timestamps;
+  std::vector<int64> key_frame_timestamps;
+  for (int frame = first_frame; frame < last_frame; ++frame) {
+    frame_timestamps.push_back(frame * kTimestampDiff);
+    if (frame % kKeyFrameRate == 0) {
+      key_frame_timestamps.push_back(frame * kTimestampDiff);
+    }
+  }
+
+  const auto& video_sizes = outputs.Tag(kVideoSizeTag).packets;
+  EXPECT_EQ(Timestamps(video_sizes), frame_timestamps);
+  for (const Packet& packet : video_sizes) {
+    const auto& size = packet.Get<std::pair<int, int>>();
+    EXPECT_EQ(size.first, kFrameWidth);
+    EXPECT_EQ(size.second, kFrameHeight);
+  }
+
+  const auto& key_frame_sizes = outputs.Tag(kKeyFrameSizeTag).packets;
+  EXPECT_EQ(Timestamps(key_frame_sizes), key_frame_timestamps);
+  for (const Packet& packet : key_frame_sizes) {
+    const auto& size = packet.Get<std::pair<int, int>>();
+    EXPECT_EQ(size.first, key_frame_width);
+    EXPECT_EQ(size.second, key_frame_height);
+  }
+
+  const auto& detections = outputs.Tag(kDetectionFeaturesTag).packets;
+  EXPECT_EQ(Timestamps(detections), key_frame_timestamps);
+  for (const Packet& packet : detections) {
+    const int frame = packet.Timestamp().Value() / kTimestampDiff;
+    EXPECT_EQ(packet.Get<DetectionSet>().SerializeAsString(),
+              MakeDetections(frame).SerializeAsString());
+  }
+
+  const auto& static_features = outputs.Tag(kStaticFeaturesTag).packets;
+  EXPECT_EQ(Timestamps(static_features), frame_timestamps);
+  for (const Packet& packet : static_features) {
+    const int frame = packet.Timestamp().Value() / kTimestampDiff;
+    EXPECT_EQ(packet.Get<StaticFeatures>().SerializeAsString(),
+              MakeStaticFeatures(frame).SerializeAsString());
+  }
+
+  // Only true shot boundaries are replayed.
+  std::vector<int64> shot_change_timestamps;
+  if (kShotChangeFrame >= first_frame && kShotChangeFrame < last_frame) {
+    shot_change_timestamps.push_back(kShotChangeFrame * kTimestampDiff);
+  }
+  const auto& shot_boundaries = outputs.Tag(kShotBoundariesTag).packets;
+  EXPECT_EQ(Timestamps(shot_boundaries), shot_change_timestamps);
+  for (const Packet& packet : shot_boundaries) {
+    EXPECT_TRUE(packet.Get<bool>());
+  }
+}
+
+TEST(FrameSignalsReaderCalculatorTest, ReplaysWrittenSignals) {
+  const std::string path = TestPath("replay.signals");
+  WriteSignals(path, kWriterConfig, 0, 9);
+
+  auto runner = MakeReader(path, 0, -1);
+  MP_ASSERT_OK(runner->Run());
+  CheckSignals(*runner, 0, 9, kKeyFrameWidth, kKeyFrameHeight);
+}
+
+TEST(FrameSignalsReaderCalculatorTest, UsesFrameSizeWithoutKeyFrames) {
+  const std::string path = TestPath("no_key_frames.signals");
+  WriteSignals(path, kWriterConfigNoKeyFrames, 0, 5);
+
+  auto runner = MakeReader(path, 0, -1);
+  MP_ASSERT_OK(runner->Run());
+  CheckSignals(*runner, 0, 5, kFrameWidth, kFrameHeight);
+}
+
+TEST(FrameSignalsReaderCalculatorTest, ReadsTimeRange) {
+  const std::string path = TestPath("time_range.signals");
+  WriteSignals(path, kWriterConfig, 0, 9);
+
+  // The range starts between two frames and ends on one, which is excluded.
+  auto runner = MakeReader(path, 2 * kTimestampDiff - 1, 7 * kTimestampDiff);
+  MP_ASSERT_OK(runner->Run());
+  CheckSignals(*runner, 2, 7, kKeyFrameWidth, kKeyFrameHeight);
+}
+
+TEST(FrameSignalsReaderCalculatorTest, ReadsShardsInOrder) {
+  const std::string first_path = TestPath("shard_0.signals");
+  const std::string second_path = TestPath("shard_1.signals");
+  const std::string third_path = TestPath("shard_2.signals");
+  WriteSignals(first_path, kWriterConfig, 0, 4);
+  WriteSignals(second_path, kWriterConfig, 4, 7);
+  WriteSignals(third_path, kWriterConfig, 7, 11);
+
+  auto runner =
+      MakeReader(absl::StrCat(first_path, ",", second_path, ",", third_path),
+                 0, -1);
+  MP_ASSERT_OK(runner->Run());
+  CheckSignals(*runner, 0, 11, kKeyFrameWidth, kKeyFrameHeight);
+
+  // Shards before the range are skipped and shards after it are not read.
+  runner =
+      MakeReader(absl::StrCat(first_path, ",", second_path, ",", third_path),
+                 5 * kTimestampDiff, 7 * kTimestampDiff);
+  MP_ASSERT_OK(runner->Run());
+  CheckSignals(*runner, 5, 7, kKeyFrameWidth, kKeyFrameHeight);
+}
+
+TEST(FrameSignalsReaderCalculatorTest, FailsOnMissingFile) {
+  auto runner = MakeReader(TestPath("missing.signals"), 0, -1);
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,149 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/quality/frame_signals_index.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kVideoFramesTag[] = "VIDEO_FRAMES";
+constexpr char kKeyFramesTag[] = "KEY_FRAMES";
+constexpr char kDetectionFeaturesTag[] = "DETECTION_FEATURES";
+constexpr char kStaticFeaturesTag[] = "STATIC_FEATURES";
+constexpr char kShotBoundariesTag[] = "SHOT_BOUNDARIES";
+constexpr char kOutputFilePathTag[] = "OUTPUT_FILE_PATH";
+
+}  // namespace
+
+// Persists the per-frame signals consumed by SceneCroppingCalculator to an
+// indexed file (see FrameSignalsWriter). This is the last node of the analysis
+// pass of a two-pass AutoFlip run: the cropping pass replays the signals with
+// FrameSignalsReaderCalculator and does not need to run shot, border, face or
+// object detection again, e.g. to produce crops for several aspect ratios.
+//
+// One record is written for each frame on VIDEO_FRAMES. Frames themselves are
+// not stored; only their timestamps and the frame dimensions are.
+//
+// Input streams:
+// - required tag VIDEO_FRAMES (type ImageFrame):
+//     Original video frames.
+// - optional tag KEY_FRAMES (type ImageFrame):
+//     Frames on which features are detected. Only their size is recorded.
+// - optional tag DETECTION_FEATURES (type DetectionSet)
+// - optional tag STATIC_FEATURES (type StaticFeatures)
+// - optional tag SHOT_BOUNDARIES (type bool)
+//
+// Input side packets:
+// - required tag OUTPUT_FILE_PATH (type std::string):
+//     Path of the signals file. The index is written next to it.
+//
+// Example config:
+// node {
+//   calculator: "FrameSignalsWriterCalculator"
+//   input_side_packet: "OUTPUT_FILE_PATH:signals_path"
+//   input_stream: "VIDEO_FRAMES:video_raw"
+//   input_stream: "KEY_FRAMES:video_frames_scaled_downsampled"
+//   input_stream: "DETECTION_FEATURES:salient_regions"
+//   input_stream: "STATIC_FEATURES:borders"
+//   input_stream: "SHOT_BOUNDARIES:shot_change"
+// }
+class FrameSignalsWriterCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+  absl::Status Close(CalculatorContext* cc) override;
+
+ private:
+  FrameSignalsWriter writer_;
+  bool has_frame_size_ = false;
+  bool has_key_frame_size_ = false;
+};
+REGISTER_CALCULATOR(FrameSignalsWriterCalculator);
+
+absl::Status FrameSignalsWriterCalculator::GetContract(
+    CalculatorContract* cc) {
+  cc->Inputs().Tag(kVideoFramesTag).Set<ImageFrame>();
+  if (cc->Inputs().HasTag(kKeyFramesTag)) {
+    cc->Inputs().Tag(kKeyFramesTag).Set<ImageFrame>();
+  }
+  if (cc->Inputs().HasTag(kDetectionFeaturesTag)) {
+    cc->Inputs().Tag(kDetectionFeaturesTag).Set<DetectionSet>();
+  }
+  if (cc->Inputs().HasTag(kStaticFeaturesTag)) {
+    cc->Inputs().Tag(kStaticFeaturesTag).Set<StaticFeatures>();
+  }
+  if (cc->Inputs().HasTag(kShotBoundariesTag)) {
+    cc->Inputs().Tag(kShotBoundariesTag).Set<bool>();
+  }
+  cc->InputSidePackets().Tag(kOutputFilePathTag).Set<std::string>();
+  return absl::OkStatus();
+}
+
+absl::Status FrameSignalsWriterCalculator::Open(CalculatorContext* cc) {
+  return writer_.Open(
+      cc->InputSidePackets().Tag(kOutputFilePathTag).Get<std::string>());
+}
+
+absl::Status FrameSignalsWriterCalculator::Process(CalculatorContext* cc) {
+  if (cc->Inputs().HasTag(kKeyFramesTag) &&
+      !cc->Inputs().Tag(kKeyFramesTag).IsEmpty() && !has_key_frame_size_) {
+    const auto& key_frame = cc->Inputs().Tag(kKeyFramesTag).Get<ImageFrame>();
+    writer_.SetKeyFrameSize(key_frame.Width(), key_frame.Height());
+    has_key_frame_size_ = true;
+  }
+  if (cc->Inputs().Tag(kVideoFramesTag).IsEmpty()) {
+    return absl::OkStatus();
+  }
+  if (!has_frame_size_) {
+    const auto& frame = cc->Inputs().Tag(kVideoFramesTag).Get<ImageFrame>();
+    writer_.SetFrameSize(frame.Width(), frame.Height());
+    has_frame_size_ = true;
+  }
+
+  FrameSignals signals;
+  signals.set_timestamp_us(cc->InputTimestamp().Value());
+  if (cc->Inputs().HasTag(kShotBoundariesTag) &&
+      !cc->Inputs().Tag(kShotBoundariesTag).IsEmpty()) {
+    signals.set_is_shot_change(
+        cc->Inputs().Tag(kShotBoundariesTag).Get<bool>());
+  }
+  if (cc->Inputs().HasTag(kDetectionFeaturesTag) &&
+      !cc->Inputs().Tag(kDetectionFeaturesTag).IsEmpty()) {
+    *signals.mutable_detection_features() =
+        cc->Inputs().Tag(kDetectionFeaturesTag).Get<DetectionSet>();
+  }
+  if (cc->Inputs().HasTag(kStaticFeaturesTag) &&
+      !cc->Inputs().Tag(kStaticFeaturesTag).IsEmpty()) {
+    *signals.mutable_static_features() =
+        cc->Inputs().Tag(kStaticFeaturesTag).Get<StaticFeatures>();
+  }
+  return writer_.Append(signals);
+}
+
+absl::Status FrameSignalsWriterCalculator::Close(CalculatorContext* cc) {
+  return writer_.Close();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -38,6 +38,7 @@ namespace autoflip {
 constexpr char kInputVideoFrames[] = "VIDEO_FRAMES";
 constexpr char kInputVideoSize[] = "VIDEO_SIZE";
 constexpr char kInputKeyFrames[] = "KEY_FRAMES";
+constexpr char kInputKeyFrameSize[] = "KEY_FRAME_SIZE";
 constexpr char kInputDetections[] = "DETECTION_FEATURES";
 constexpr char kInputStaticFeatures[] = "STATIC_FEATURES";
 constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
@@ -85,6 +86,9 @@ absl::Status SceneCroppingCalculator::GetContract(
   if (cc->Inputs().HasTag(kInputKeyFrames)) {
     cc->Inputs().Tag(kInputKeyFrames).Set<ImageFrame>();
   }
+  if (cc->Inputs().HasTag(kInputKeyFrameSize)) {
+    cc->Inputs().Tag(kInputKeyFrameSize).Set<std::pair<int, int>>();
+  }
   cc->Inputs().Tag(kInputDetections).Set<DetectionSet>();
   if (cc->Inputs().HasTag(kInputStaticFeatures)) {
     cc->Inputs().Tag(kInputStaticFeatures).Set<StaticFeatures>();
@@ -128,6 +132,9 @@ absl::Status SceneCroppingCalculator::GetContract(
   RET_CHECK(cc->Inputs().HasTag(kInputVideoFrames) ^
             cc->Inputs().HasTag(kInputVideoSize))
       << "VIDEO_FRAMES or VIDEO_SIZE must be set and not both.";
+  RET_CHECK(!(cc->Inputs().HasTag(kInputKeyFrames) &&
+              cc->Inputs().HasTag(kInputKeyFrameSize)))
+      << "KEY_FRAMES and KEY_FRAME_SIZE cannot be used together.";
   RET_CHECK(!(cc->Inputs().HasTag(kInputVideoSize) &&
               cc->Inputs().HasTag(kOutputCroppedFrames)))
       << "CROPPED_FRAMES (internal cropping) has been set as an output without "
@@ -307,17 +314,19 @@ absl::Status SceneCroppingCalculator::InitializeSceneCroppingCalculator(
   target_aspect_ratio_ = GetRatio(target_width_, target_height_);
 
   // Set keyframe width/height for feature upscaling.
-  RET_CHECK(!(cc->Inputs().HasTag(kInputKeyFrames) &&
-              (options_.has_video_features_width() ||
-               options_.has_video_features_height())))
+  const bool has_key_frame_stream = cc->Inputs().HasTag(kInputKeyFrames) ||
+                                    cc->Inputs().HasTag(kInputKeyFrameSize);
+  RET_CHECK(!(has_key_frame_stream && (options_.has_video_features_width() ||
+                                       options_.has_video_features_height())))
       << "Key frame size must be defined by either providing the input stream "
-         "KEY_FRAMES or setting video_features_width/video_features_height as "
-         "calculator options.  Both methods cannot be used together.";
+         "KEY_FRAMES (or KEY_FRAME_SIZE) or setting "
+         "video_features_width/video_features_height as calculator options.  "
+         "Both methods cannot be used together.";
   if (options_.has_video_features_width() &&
       options_.has_video_features_height()) {
     key_frame_width_ = options_.video_features_width();
     key_frame_height_ = options_.video_features_height();
-  } else if (!cc->Inputs().HasTag(kInputKeyFrames)) {
+  } else if (!has_key_frame_stream) {
     key_frame_width_ = frame_width_;
     key_frame_height_ = frame_height_;
   }
@@ -362,6 +371,14 @@ absl::Status SceneCroppingCalculator::Process(
     key_frame_width_ = key_frame.Width();
     key_frame_height_ = key_frame.Height();
   }
+  if (cc->Inputs().HasTag(kInputKeyFrameSize) &&
+      !cc->Inputs().Tag(kInputKeyFrameSize).Value().IsEmpty() &&
+      key_frame_width_ < 0) {
+    const auto& key_frame_size =
+        cc->Inputs().Tag(kInputKeyFrameSize).Get<std::pair<int, int>>();
+    key_frame_width_ = key_frame_size.first;
+    key_frame_height_ = key_frame_size.second;
+  }
 
   // Processes a scene when shot boundary or buffer is full.
   bool is_end_of_scene = false;
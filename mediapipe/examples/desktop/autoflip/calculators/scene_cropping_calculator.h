@@ -83,6 +83,10 @@ namespace autoflip {
 //     video_feature_width/video_features_height within the options proto to
 //     define this value.  When neither is set, the features frame size is
 //     assumed to be the original scene frame size.
+// - optional tag KEY_FRAME_SIZE (type std::pair<int, int>):
+//     Alternative to KEY_FRAMES when the key frames themselves are not
+//     available, e.g. when replaying signals saved by
+//     FrameSignalsWriterCalculator.
 //
 // Output streams:
 // - required tag CROPPED_FRAMES (type ImageFrame):
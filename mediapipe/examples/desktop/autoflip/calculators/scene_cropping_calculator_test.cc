@@ -50,6 +50,7 @@ constexpr char kVideoSizeTag[] = "VIDEO_SIZE";
 constexpr char kVideoFramesTag[] = "VIDEO_FRAMES";
 constexpr char kDetectionFeaturesTag[] = "DETECTION_FEATURES";
 constexpr char kKeyFramesTag[] = "KEY_FRAMES";
+constexpr char kKeyFrameSizeTag[] = "KEY_FRAME_SIZE";
 
 using ::testing::HasSubstr;
 
@@ -155,6 +156,21 @@ constexpr char kExternalRenderConfigNoVideo[] = R"(
     }
   })";
 
+constexpr char kExternalRenderConfigKeyFrameSize[] = R"(
+  calculator: "SceneCroppingCalculator"
+  input_stream: "VIDEO_SIZE:camera_size"
+  input_stream: "KEY_FRAME_SIZE:key_frame_size"
+  input_stream: "DETECTION_FEATURES:salient_regions"
+  input_stream: "STATIC_FEATURES:border_features"
+  input_stream: "SHOT_BOUNDARIES:shot_boundary_frames"
+  output_stream: "EXTERNAL_RENDERING_PER_FRAME:external_rendering_per_frame"
+  options: {
+    [mediapipe.autoflip.SceneCroppingCalculatorOptions.ext]: {
+      target_width: $0
+      target_height: $1
+    }
+  })";
+
 constexpr int kInputFrameWidth = 1280;
 constexpr int kInputFrameHeight = 720;
 
@@ -253,7 +269,7 @@ std::unique_ptr<ImageFrame> MakeImageFrameFromColor(const cv::Scalar& color,
 // Adds key frame detection features given time (in ms) to the input stream.
 // Randomly generates a number of detections in the range of kMinNumDetections
 // and kMaxNumDetections. Optionally add a key image frame of random solid color
-// and given size.
+// and given size, or only its size.
 void AddKeyFrameFeatures(const int64 time_ms, const int key_frame_width,
                          const int key_frame_height, bool randomize,
                          CalculatorRunner::StreamContentsSet* inputs) {
@@ -264,6 +280,12 @@ void AddKeyFrameFeatures(const int64 time_ms, const int key_frame_width,
     inputs->Tag(kKeyFramesTag)
         .packets.push_back(Adopt(key_frame.release()).At(timestamp));
   }
+  if (inputs->HasTag(kKeyFrameSizeTag)) {
+    inputs->Tag(kKeyFrameSizeTag)
+        .packets.push_back(MakePacket<std::pair<int, int>>(key_frame_width,
+                                                           key_frame_height)
+                               .At(timestamp));
+  }
   if (randomize) {
     const int num_detections = std::uniform_int_distribution<int>(
         kMinNumDetections, kMaxNumDetections)(GetGen());
@@ -920,6 +942,53 @@ TEST(SceneCroppingCalculatorTest, OutputsCropMessageKinematicPathNoVideo) {
     EXPECT_EQ(ext_render_message.render_to_location().height(), 1124);
   }
 }
+
+// Checks that the key frame size can be given without key frames, as when the
+// features are replayed by FrameSignalsReaderCalculator. The detections are
+// in key frame coordinates, so the crop is the same as with KEY_FRAMES.
+TEST(SceneCroppingCalculatorTest, UsesKeyFrameSizeStream) {
+  const CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          kExternalRenderConfigKeyFrameSize, kTargetWidth, kTargetHeight));
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  const int num_frames = kSceneSize;
+  AddScene(0, num_frames, kInputFrameWidth, kInputFrameHeight, kKeyFrameWidth,
+           kKeyFrameHeight, 1, runner->MutableInputs());
+
+  MP_EXPECT_OK(runner->Run());
+  const auto& ext_render_per_frame =
+      runner->Outputs().Tag(kExternalRenderingPerFrameTag).packets;
+  EXPECT_EQ(ext_render_per_frame.size(), num_frames);
+
+  for (int i = 0; i < num_frames - 1; ++i) {
+    const auto& ext_render_message =
+        ext_render_per_frame[i].Get<ExternalRenderFrame>();
+    EXPECT_EQ(ext_render_message.timestamp_us(), i * 20000);
+    EXPECT_EQ(ext_render_message.crop_from_location().x(), 725);
+    EXPECT_EQ(ext_render_message.crop_from_location().y(), 0);
+    EXPECT_EQ(ext_render_message.crop_from_location().width(), 461);
+    EXPECT_EQ(ext_render_message.crop_from_location().height(), 720);
+  }
+}
+
+// Checks that the key frame size can't be given both by KEY_FRAME_SIZE and by
+// the video_features_width/video_features_height options.
+TEST(SceneCroppingCalculatorTest, RejectsKeyFrameSizeStreamWithFeaturesSize) {
+  CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          kExternalRenderConfigKeyFrameSize, kTargetWidth, kTargetHeight));
+  auto* options = config.mutable_options()->MutableExtension(
+      SceneCroppingCalculatorOptions::ext);
+  options->set_video_features_width(kKeyFrameWidth);
+  options->set_video_features_height(kKeyFrameHeight);
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  AddScene(0, kSceneSize, kInputFrameWidth, kInputFrameHeight, kKeyFrameWidth,
+           kKeyFrameHeight, 1, runner->MutableInputs());
+  const auto status = runner->Run();
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.ToString(), HasSubstr("Both methods cannot be used"));
+}
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
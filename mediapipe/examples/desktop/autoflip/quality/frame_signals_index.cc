@@ -0,0 +1,135 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/quality/frame_signals_index.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr int kLengthPrefixSize = 4;
+
+void EncodeLength(uint32 length, char* bytes) {
+  for (int i = 0; i < kLengthPrefixSize; ++i) {
+    bytes[i] = static_cast<char>((length >> (8 * i)) & 0xff);
+  }
+}
+
+}  // namespace
+
+std::string FrameSignalsIndexPath(const std::string& signals_path) {
+  return absl::StrCat(signals_path, ".index");
+}
+
+FrameSignalsWriter::~FrameSignalsWriter() {
+  if (file_.is_open()) {
+    Close().IgnoreError();
+  }
+}
+
+absl::Status FrameSignalsWriter::Open(const std::string& path) {
+  RET_CHECK(!file_.is_open()) << "Writer is already open.";
+  path_ = path;
+  file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  RET_CHECK(file_.is_open()) << "Unable to open " << path << " for writing.";
+  offset_ = 0;
+  index_.Clear();
+  return absl::OkStatus();
+}
+
+void FrameSignalsWriter::SetFrameSize(int width, int height) {
+  index_.set_frame_width(width);
+  index_.set_frame_height(height);
+}
+
+void FrameSignalsWriter::SetKeyFrameSize(int width, int height) {
+  index_.set_key_frame_width(width);
+  index_.set_key_frame_height(height);
+}
+
+absl::Status FrameSignalsWriter::Append(const FrameSignals& signals) {
+  RET_CHECK(file_.is_open()) << "Writer is not open.";
+  const int num_entries = index_.entry_size();
+  RET_CHECK(num_entries == 0 || index_.entry(num_entries - 1).timestamp_us() <
+                                    signals.timestamp_us())
+      << "FrameSignals must be appended in increasing timestamp order.";
+  std::string serialized;
+  RET_CHECK(signals.SerializeToString(&serialized));
+  char prefix[kLengthPrefixSize];
+  EncodeLength(serialized.size(), prefix);
+  file_.write(prefix, kLengthPrefixSize);
+  file_.write(serialized.data(), serialized.size());
+  RET_CHECK(file_.good()) << "Failed to write to " << path_;
+
+  auto* entry = index_.add_entry();
+  entry->set_timestamp_us(signals.timestamp_us());
+  entry->set_offset(offset_ + kLengthPrefixSize);
+  entry->set_size(serialized.size());
+  entry->set_is_shot_change(signals.is_shot_change());
+  offset_ += kLengthPrefixSize + serialized.size();
+  return absl::OkStatus();
+}
+
+absl::Status FrameSignalsWriter::Close() {
+  RET_CHECK(file_.is_open()) << "Writer is not open.";
+  file_.close();
+  RET_CHECK(!file_.fail()) << "Failed to close " << path_;
+  std::string serialized_index;
+  RET_CHECK(index_.SerializeToString(&serialized_index));
+  return file::SetContents(FrameSignalsIndexPath(path_), serialized_index);
+}
+
+absl::Status FrameSignalsReader::Open(const std::string& path) {
+  std::string serialized_index;
+  MP_RETURN_IF_ERROR(
+      file::GetContents(FrameSignalsIndexPath(path), &serialized_index));
+  RET_CHECK(index_.ParseFromString(serialized_index))
+      << "Unable to parse the index of " << path;
+  file_.open(path, std::ios::in | std::ios::binary);
+  RET_CHECK(file_.is_open()) << "Unable to open " << path << " for reading.";
+  return absl::OkStatus();
+}
+
+int FrameSignalsReader::LowerBound(int64 timestamp_us) const {
+  const auto& entries = index_.entry();
+  auto it = std::lower_bound(
+      entries.begin(), entries.end(), timestamp_us,
+      [](const FrameSignalsIndex::Entry& entry, int64 value) {
+        return entry.timestamp_us() < value;
+      });
+  return it - entries.begin();
+}
+
+absl::Status FrameSignalsReader::Read(int position, FrameSignals* signals) {
+  RET_CHECK(position >= 0 && position < NumRecords())
+      << "Record " << position << " is out of range.";
+  const auto& entry = index_.entry(position);
+  buffer_.resize(entry.size());
+  file_.clear();
+  file_.seekg(entry.offset());
+  file_.read(&buffer_[0], entry.size());
+  RET_CHECK(file_.good()) << "Failed to read record " << position;
+  RET_CHECK(signals->ParseFromString(buffer_))
+      << "Unable to parse record " << position;
+  return absl::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
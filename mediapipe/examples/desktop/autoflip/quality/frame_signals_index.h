@@ -0,0 +1,96 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_FRAME_SIGNALS_INDEX_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_FRAME_SIGNALS_INDEX_H_
+
+#include <fstream>
+#include <string>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Returns the path of the sidecar index written next to a signals file.
+std::string FrameSignalsIndexPath(const std::string& signals_path);
+
+// Writes FrameSignals records to a file so that the cropping pass of AutoFlip
+// can be replayed without re-running shot, face and object detection. Each
+// record is stored as a 4-byte little-endian length followed by the serialized
+// proto. On Close(), a FrameSignalsIndex with the offset of every record is
+// written to FrameSignalsIndexPath(path).
+//
+// Records must be appended in increasing timestamp order. Separate time ranges
+// of the same video may be written to separate files (shards).
+class FrameSignalsWriter {
+ public:
+  FrameSignalsWriter() = default;
+  FrameSignalsWriter(const FrameSignalsWriter&) = delete;
+  FrameSignalsWriter& operator=(const FrameSignalsWriter&) = delete;
+  ~FrameSignalsWriter();
+
+  // Opens |path| for writing, truncating any existing content.
+  absl::Status Open(const std::string& path);
+
+  // Records the original and key frame dimensions in the index.
+  void SetFrameSize(int width, int height);
+  void SetKeyFrameSize(int width, int height);
+
+  // Appends a record. Timestamps must be strictly increasing.
+  absl::Status Append(const FrameSignals& signals);
+
+  // Flushes the data file and writes the sidecar index.
+  absl::Status Close();
+
+ private:
+  std::string path_;
+  std::ofstream file_;
+  int64 offset_ = 0;
+  FrameSignalsIndex index_;
+};
+
+// Random access reader for files written by FrameSignalsWriter. Only the
+// index is held in memory; records are read from disk on demand.
+class FrameSignalsReader {
+ public:
+  FrameSignalsReader() = default;
+  FrameSignalsReader(const FrameSignalsReader&) = delete;
+  FrameSignalsReader& operator=(const FrameSignalsReader&) = delete;
+
+  // Opens |path| and loads its sidecar index.
+  absl::Status Open(const std::string& path);
+
+  const FrameSignalsIndex& index() const { return index_; }
+  int NumRecords() const { return index_.entry_size(); }
+
+  // Returns the position of the first record with a timestamp not less than
+  // |timestamp_us|, or NumRecords() if there is none.
+  int LowerBound(int64 timestamp_us) const;
+
+  // Reads the record at |position| (0 <= position < NumRecords()).
+  absl::Status Read(int position, FrameSignals* signals);
+
+ private:
+  std::ifstream file_;
+  FrameSignalsIndex index_;
+  std::string buffer_;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_FRAME_SIGNALS_INDEX_H_
@@ -0,0 +1,102 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/quality/frame_signals_index.h"
+
+#include <cstdlib>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kNumFrames = 30;
+const int64 kFrameDurationUs = 33333;
+
+std::string TestPath(const std::string& name) {
+  return absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+}
+
+FrameSignals MakeFrameSignals(int frame) {
+  FrameSignals signals;
+  signals.set_timestamp_us(frame * kFrameDurationUs);
+  signals.set_is_shot_change(frame % 10 == 0);
+  if (frame % 3 == 0) {
+    auto* region = signals.mutable_detection_features()->add_detections();
+    region->mutable_location()->set_x(frame);
+    region->mutable_location()->set_width(10);
+    region->set_score(0.5);
+  }
+  return signals;
+}
+
+TEST(FrameSignalsIndexTest, WritesAndReadsRecordsInAnyOrder) {
+  const std::string path = TestPath("signals_roundtrip");
+  FrameSignalsWriter writer;
+  MP_ASSERT_OK(writer.Open(path));
+  writer.SetFrameSize(1920, 1080);
+  writer.SetKeyFrameSize(480, 270);
+  for (int i = 0; i < kNumFrames; ++i) {
+    MP_ASSERT_OK(writer.Append(MakeFrameSignals(i)));
+  }
+  MP_ASSERT_OK(writer.Close());
+
+  FrameSignalsReader reader;
+  MP_ASSERT_OK(reader.Open(path));
+  ASSERT_EQ(reader.NumRecords(), kNumFrames);
+  EXPECT_EQ(reader.index().frame_width(), 1920);
+  EXPECT_EQ(reader.index().key_frame_height(), 270);
+  for (int i = kNumFrames - 1; i >= 0; --i) {
+    FrameSignals signals;
+    MP_ASSERT_OK(reader.Read(i, &signals));
+    EXPECT_EQ(signals.SerializeAsString(),
+              MakeFrameSignals(i).SerializeAsString());
+    EXPECT_EQ(reader.index().entry(i).is_shot_change(), i % 10 == 0);
+  }
+}
+
+TEST(FrameSignalsIndexTest, LowerBoundFindsTimeRange) {
+  const std::string path = TestPath("signals_lower_bound");
+  FrameSignalsWriter writer;
+  MP_ASSERT_OK(writer.Open(path));
+  for (int i = 0; i < kNumFrames; ++i) {
+    MP_ASSERT_OK(writer.Append(MakeFrameSignals(i)));
+  }
+  MP_ASSERT_OK(writer.Close());
+
+  FrameSignalsReader reader;
+  MP_ASSERT_OK(reader.Open(path));
+  EXPECT_EQ(reader.LowerBound(0), 0);
+  EXPECT_EQ(reader.LowerBound(kFrameDurationUs), 1);
+  EXPECT_EQ(reader.LowerBound(kFrameDurationUs + 1), 2);
+  EXPECT_EQ(reader.LowerBound(kNumFrames * kFrameDurationUs), kNumFrames);
+}
+
+TEST(FrameSignalsIndexTest, RejectsOutOfOrderTimestamps) {
+  FrameSignalsWriter writer;
+  MP_ASSERT_OK(writer.Open(TestPath("signals_out_of_order")));
+  MP_ASSERT_OK(writer.Append(MakeFrameSignals(2)));
+  EXPECT_FALSE(writer.Append(MakeFrameSignals(1)).ok());
+  MP_EXPECT_OK(writer.Close());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -37,6 +37,7 @@
 #include "mediapipe/framework/calculator_base.h"
 #include "mediapipe/framework/counter_factory.h"
 #include "mediapipe/framework/delegating_executor.h"
+#include "mediapipe/framework/formats/image_frame_multi_pool.h"
 #include "mediapipe/framework/graph_service_manager.h"
 #include "mediapipe/framework/input_stream_manager.h"
 #include "mediapipe/framework/mediapipe_profiling.h"
@@ -443,6 +444,14 @@ absl::Status CalculatorGraph::Initialize(
   return Initialize(std::move(validated_graph), side_packets);
 }
 
+absl::Status CalculatorGraph::Initialize(
+    const PrecompiledGraph& precompiled_graph,
+    const std::map<std::string, Packet>& side_packets) {
+  auto validated_graph = absl::make_unique<ValidatedGraphConfig>();
+  MP_RETURN_IF_ERROR(validated_graph->Initialize(precompiled_graph));
+  return Initialize(std::move(validated_graph), side_packets);
+}
+
 absl::Status CalculatorGraph::ObserveOutputStream(
     const std::string& stream_name,
     std::function<absl::Status(const Packet&)> packet_callback,
@@ -619,6 +628,20 @@ absl::StatusOr<std::map<std::string, Packet>> CalculatorGraph::PrepareGpu(
 }
 #endif  // !MEDIAPIPE_DISABLE_GPU
 
+absl::Status CalculatorGraph::PrepareImageFramePool() {
+  if (service_manager_.GetServiceObject(kImageFramePoolService)) {
+    return absl::OkStatus();
+  }
+  for (const auto& node_type_info : validated_graph_->CalculatorInfos()) {
+    if (mediapipe::ContainsKey(node_type_info.Contract().ServiceRequests(),
+                               kImageFramePoolService.key)) {
+      return service_manager_.SetServiceObject(
+          kImageFramePoolService, std::make_shared<ImageFrameMultiPool>());
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::Status CalculatorGraph::PrepareForRun(
     const std::map<std::string, Packet>& extra_side_packets,
     const std::map<std::string, Packet>& stream_headers) {
@@ -635,6 +658,8 @@ absl::Status CalculatorGraph::PrepareForRun(
   }
   num_closed_graph_input_streams_ = 0;
 
+  MP_RETURN_IF_ERROR(PrepareImageFramePool());
+
   std::map<std::string, Packet> additional_side_packets;
 #if !MEDIAPIPE_DISABLE_GPU
   ASSIGN_OR_RETURN(additional_side_packets, PrepareGpu(extra_side_packets));
@@ -819,14 +844,90 @@ absl::Status CalculatorGraph::WaitForObservedOutput() {
   return scheduler_.WaitForObservedOutput();
 }
 
+CalculatorGraph::InputStreamHandle CalculatorGraph::FindInputStream(
+    const std::string& stream_name) {
+  std::unique_ptr<GraphInputStream>* stream =
+      mediapipe::FindOrNull(graph_input_streams_, stream_name);
+  if (!stream) {
+    return InputStreamHandle();
+  }
+  int node_id = mediapipe::FindOrDie(graph_input_stream_node_ids_, stream_name);
+  CHECK_GE(node_id, validated_graph_->CalculatorInfos().size());
+  return InputStreamHandle(stream->get(), node_id);
+}
+
+absl::StatusOr<CalculatorGraph::InputStreamHandle>
+CalculatorGraph::GetInputStreamHandle(const std::string& stream_name) {
+  RET_CHECK(initialized_).SetNoLogging()
+      << "CalculatorGraph is not initialized.";
+  InputStreamHandle stream = FindInputStream(stream_name);
+  RET_CHECK(stream.IsValid()).SetNoLogging() << absl::Substitute(
+      "GetInputStreamHandle called on input stream \"$0\" which is not a "
+      "graph input stream.",
+      stream_name);
+  return stream;
+}
+
 absl::Status CalculatorGraph::AddPacketToInputStream(
     const std::string& stream_name, const Packet& packet) {
-  return AddPacketToInputStreamInternal(stream_name, packet);
+  InputStreamHandle stream = FindInputStream(stream_name);
+  RET_CHECK(stream.IsValid()).SetNoLogging() << absl::Substitute(
+      "AddPacketToInputStream called on input stream \"$0\" which is not a "
+      "graph input stream.",
+      stream_name);
+  return AddPacketToInputStreamInternal(stream, packet);
 }
 
 absl::Status CalculatorGraph::AddPacketToInputStream(
     const std::string& stream_name, Packet&& packet) {
-  return AddPacketToInputStreamInternal(stream_name, std::move(packet));
+  InputStreamHandle stream = FindInputStream(stream_name);
+  RET_CHECK(stream.IsValid()).SetNoLogging() << absl::Substitute(
+      "AddPacketToInputStream called on input stream \"$0\" which is not a "
+      "graph input stream.",
+      stream_name);
+  return AddPacketToInputStreamInternal(stream, std::move(packet));
+}
+
+absl::Status CalculatorGraph::AddPacketToInputStream(
+    const InputStreamHandle& stream, const Packet& packet) {
+  RET_CHECK(stream.IsValid()) << "Invalid InputStreamHandle.";
+  return AddPacketToInputStreamInternal(stream, packet);
+}
+
+absl::Status CalculatorGraph::AddPacketToInputStream(
+    const InputStreamHandle& stream, Packet&& packet) {
+  RET_CHECK(stream.IsValid()) << "Invalid InputStreamHandle.";
+  return AddPacketToInputStreamInternal(stream, std::move(packet));
+}
+
+absl::Status CalculatorGraph::AddPacketsToInputStream(
+    const std::string& stream_name, std::vector<Packet> packets) {
+  InputStreamHandle stream = FindInputStream(stream_name);
+  RET_CHECK(stream.IsValid()).SetNoLogging() << absl::Substitute(
+      "AddPacketsToInputStream called on input stream \"$0\" which is not a "
+      "graph input stream.",
+      stream_name);
+  return AddPacketsToInputStream(stream, std::move(packets));
+}
+
+absl::Status CalculatorGraph::AddPacketsToInputStream(
+    const InputStreamHandle& stream, std::vector<Packet> packets) {
+  RET_CHECK(stream.IsValid()) << "Invalid InputStreamHandle.";
+  if (packets.empty()) {
+    return absl::OkStatus();
+  }
+  for (int i = 1; i < packets.size(); ++i) {
+    RET_CHECK_LT(packets[i - 1].Timestamp(), packets[i].Timestamp())
+        << "Packets added to graph input stream \""
+        << stream.stream_->GetManager()->Name()
+        << "\" must have increasing timestamps.";
+  }
+  MP_RETURN_IF_ERROR(WaitToAddToInputStream(stream.node_id_));
+  for (Packet& packet : packets) {
+    LogInputStreamPacket(stream.stream_, packet);
+    stream.stream_->AddPacket(std::move(packet));
+  }
+  return PropagateInputStreamPackets(stream.stream_);
 }
 
 // We avoid having two copies of this code for AddPacketToInputStream(
@@ -835,75 +936,78 @@ absl::Status CalculatorGraph::AddPacketToInputStream(
 // std::forward will deduce the correct type as we pass along packet.
 template <typename T>
 absl::Status CalculatorGraph::AddPacketToInputStreamInternal(
-    const std::string& stream_name, T&& packet) {
-  std::unique_ptr<GraphInputStream>* stream =
-      mediapipe::FindOrNull(graph_input_streams_, stream_name);
-  RET_CHECK(stream).SetNoLogging() << absl::Substitute(
-      "AddPacketToInputStream called on input stream \"$0\" which is not a "
-      "graph input stream.",
-      stream_name);
-  int node_id = mediapipe::FindOrDie(graph_input_stream_node_ids_, stream_name);
-  CHECK_GE(node_id, validated_graph_->CalculatorInfos().size());
-  {
-    absl::MutexLock lock(&full_input_streams_mutex_);
-    if (full_input_streams_.empty()) {
-      return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
-             << "CalculatorGraph::AddPacketToInputStream() is called before "
-                "StartRun()";
+    const InputStreamHandle& stream, T&& packet) {
+  MP_RETURN_IF_ERROR(WaitToAddToInputStream(stream.node_id_));
+  LogInputStreamPacket(stream.stream_, packet);
+  // InputStreamManager is thread safe. GraphInputStream is not, so this method
+  // should not be called by multiple threads concurrently. Note that this could
+  // potentially lead to the max queue size being exceeded by one packet at most
+  // because we don't have the lock over the input stream.
+  stream.stream_->AddPacket(std::forward<T>(packet));
+  return PropagateInputStreamPackets(stream.stream_);
+}
+
+absl::Status CalculatorGraph::WaitToAddToInputStream(int node_id) {
+  absl::MutexLock lock(&full_input_streams_mutex_);
+  if (full_input_streams_.empty()) {
+    return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
+           << "CalculatorGraph::AddPacketToInputStream() is called before "
+              "StartRun()";
+  }
+  if (graph_input_stream_add_mode_ ==
+      GraphInputStreamAddMode::ADD_IF_NOT_FULL) {
+    if (has_error_) {
+      absl::Status error_status;
+      GetCombinedErrors("Graph has errors: ", &error_status);
+      return error_status;
     }
-    if (graph_input_stream_add_mode_ ==
-        GraphInputStreamAddMode::ADD_IF_NOT_FULL) {
-      if (has_error_) {
-        absl::Status error_status;
-        GetCombinedErrors("Graph has errors: ", &error_status);
-        return error_status;
-      }
-      // Return with StatusUnavailable if this stream is being throttled.
-      if (!full_input_streams_[node_id].empty()) {
-        return mediapipe::UnavailableErrorBuilder(MEDIAPIPE_LOC)
-               << "Graph is throttled.";
-      }
-    } else if (graph_input_stream_add_mode_ ==
-               GraphInputStreamAddMode::WAIT_TILL_NOT_FULL) {
-      // Wait until this stream is not being throttled.
-      // TODO: instead of checking has_error_, we could just check
-      // if the graph is done. That could also be indicated by returning an
-      // error from WaitUntilGraphInputStreamUnthrottled.
-      while (!has_error_ && !full_input_streams_[node_id].empty()) {
-        // TODO: allow waiting for a specific stream?
-        scheduler_.WaitUntilGraphInputStreamUnthrottled(
-            &full_input_streams_mutex_);
-      }
-      if (has_error_) {
-        absl::Status error_status;
-        GetCombinedErrors("Graph has errors: ", &error_status);
-        return error_status;
-      }
+    // Return with StatusUnavailable if this stream is being throttled.
+    if (!full_input_streams_[node_id].empty()) {
+      return mediapipe::UnavailableErrorBuilder(MEDIAPIPE_LOC)
+             << "Graph is throttled.";
+    }
+  } else if (graph_input_stream_add_mode_ ==
+             GraphInputStreamAddMode::WAIT_TILL_NOT_FULL) {
+    // Wait until this stream is not being throttled.
+    // TODO: instead of checking has_error_, we could just check
+    // if the graph is done. That could also be indicated by returning an
+    // error from WaitUntilGraphInputStreamUnthrottled.
+    while (!has_error_ && !full_input_streams_[node_id].empty()) {
+      // TODO: allow waiting for a specific stream?
+      scheduler_.WaitUntilGraphInputStreamUnthrottled(
+          &full_input_streams_mutex_);
+    }
+    if (has_error_) {
+      absl::Status error_status;
+      GetCombinedErrors("Graph has errors: ", &error_status);
+      return error_status;
     }
   }
+  return absl::OkStatus();
+}
 
+void CalculatorGraph::LogInputStreamPacket(GraphInputStream* stream,
+                                           const Packet& packet) {
   // Adding profiling info for a new packet entering the graph.
-  const std::string* stream_id = &(*stream)->GetManager()->Name();
+  const std::string* stream_id = &stream->GetManager()->Name();
   profiler_->LogEvent(TraceEvent(TraceEvent::PROCESS)
                           .set_is_finish(true)
                           .set_input_ts(packet.Timestamp())
                           .set_stream_id(stream_id)
                           .set_packet_ts(packet.Timestamp())
                           .set_packet_data_id(&packet));
+}
 
-  // InputStreamManager is thread safe. GraphInputStream is not, so this method
-  // should not be called by multiple threads concurrently. Note that this could
-  // potentially lead to the max queue size being exceeded by one packet at most
-  // because we don't have the lock over the input stream.
-  (*stream)->AddPacket(std::forward<T>(packet));
+absl::Status CalculatorGraph::PropagateInputStreamPackets(
+    GraphInputStream* stream) {
   if (has_error_) {
     absl::Status error_status;
     GetCombinedErrors("Graph has errors: ", &error_status);
     return error_status;
   }
-  (*stream)->PropagateUpdatesToMirrors();
+  stream->PropagateUpdatesToMirrors();
 
-  VLOG(2) << "Packet added directly to: " << stream_name;
+  VLOG(2) << "Packet added directly to: " << stream->GetManager()->Name();
   // Note: one reason why we need to call the scheduler here is that we have
   // re-throttled the graph input streams, and we may need to unthrottle them
   // again if the graph is still idle. Unthrottling basically only lets in one
@@ -925,20 +1029,25 @@ bool CalculatorGraph::HasInputStream(const std::string& stream_name) {
 }
 
 absl::Status CalculatorGraph::CloseInputStream(const std::string& stream_name) {
-  std::unique_ptr<GraphInputStream>* stream =
-      mediapipe::FindOrNull(graph_input_streams_, stream_name);
-  RET_CHECK(stream).SetNoLogging() << absl::Substitute(
+  InputStreamHandle stream = FindInputStream(stream_name);
+  RET_CHECK(stream.IsValid()).SetNoLogging() << absl::Substitute(
       "CloseInputStream called on input stream \"$0\" which is not a graph "
       "input stream.",
       stream_name);
+  return CloseInputStream(stream);
+}
+
+absl::Status CalculatorGraph::CloseInputStream(
+    const InputStreamHandle& stream) {
+  RET_CHECK(stream.IsValid()) << "Invalid InputStreamHandle.";
   // The following IsClosed() and Close() sequence is not atomic. Multiple
-  // threads cannot call CloseInputStream() on the same stream_name at the same
+  // threads cannot call CloseInputStream() on the same stream at the same
   // time.
-  if ((*stream)->IsClosed()) {
+  if (stream.stream_->IsClosed()) {
     return absl::OkStatus();
   }
 
-  (*stream)->Close();
+  stream.stream_->Close();
 
   if (++num_closed_graph_input_streams_ == graph_input_streams_.size()) {
     scheduler_.ClosedAllGraphInputStreams();
@@ -51,6 +51,7 @@
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/precompiled_graph.pb.h"
 #include "mediapipe/framework/scheduler.h"
 #include "mediapipe/framework/thread_pool_executor.pb.h"
 
@@ -96,6 +97,10 @@ typedef absl::StatusOr<OutputStreamPoller> StatusOrPoller;
 //   MP_RETURN_IF_ERROR(graph->CloseAllInputStreams());
 //   MP_RETURN_IF_ERROR(graph->WaitUntilDone());
 class CalculatorGraph {
+ private:
+  // Declared here so that InputStreamHandle can refer to it.
+  class GraphInputStream;
+
  public:
   // Defines possible modes for adding a packet to a graph input stream.
   // WAIT_TILL_NOT_FULL can be used to control the memory usage of a graph by
@@ -146,6 +151,14 @@ class CalculatorGraph {
       const std::string& graph_type = "",
       const Subgraph::SubgraphOptions* options = nullptr);
 
+  // Initializes the graph from a graph precompiled by
+  // ValidatedGraphConfig::Precompile(), usually through the
+  // mediapipe_precompiled_graph build macro.  Subgraph expansion, node sorting
+  // and type validation are not repeated.
+  absl::Status Initialize(
+      const PrecompiledGraph& precompiled_graph,
+      const std::map<std::string, Packet>& side_packets = {});
+
   // Returns the canonicalized CalculatorGraphConfig for this graph.
   const CalculatorGraphConfig& Config() const {
     return validated_graph_->Config();
@@ -256,6 +269,48 @@ class CalculatorGraph {
   absl::Status AddPacketToInputStream(const std::string& stream_name,
                                       Packet&& packet);
 
+  // A graph input stream resolved by name once, so that packets can be added
+  // to it without looking up the stream for every packet. A handle stays valid
+  // for the lifetime of the graph, across runs. See also GraphInputStream<T>
+  // in graph_stream_handles.h.
+  class InputStreamHandle {
+   public:
+    InputStreamHandle() = default;
+
+    bool IsValid() const { return stream_ != nullptr; }
+
+   private:
+    friend class CalculatorGraph;
+
+    InputStreamHandle(GraphInputStream* stream, int node_id)
+        : stream_(stream), node_id_(node_id) {}
+
+    GraphInputStream* stream_ = nullptr;
+    int node_id_ = -1;
+  };
+
+  // Returns the handle of a graph input stream. Can be called any time after
+  // the graph is initialized.
+  absl::StatusOr<InputStreamHandle> GetInputStreamHandle(
+      const std::string& stream_name);
+
+  // Same as AddPacketToInputStream(stream_name, packet), for a stream resolved
+  // with GetInputStreamHandle().
+  absl::Status AddPacketToInputStream(const InputStreamHandle& stream,
+                                      const Packet& packet);
+  absl::Status AddPacketToInputStream(const InputStreamHandle& stream,
+                                      Packet&& packet);
+
+  // Adds packets with increasing timestamps to a graph input stream at once.
+  // The graph input stream add mode is applied to the batch as a whole, so a
+  // batch may take the stream queues past max_queue_size, and the packets are
+  // delivered to the consuming input streams together. Returns an error
+  // without adding anything if the timestamps in `packets` do not increase.
+  absl::Status AddPacketsToInputStream(const InputStreamHandle& stream,
+                                       std::vector<Packet> packets);
+  absl::Status AddPacketsToInputStream(const std::string& stream_name,
+                                       std::vector<Packet> packets);
+
   // Sets the queue size of a graph input stream, overriding the graph default.
   absl::Status SetInputStreamMaxQueueSize(const std::string& stream_name,
                                           int max_queue_size);
@@ -269,6 +324,7 @@ class CalculatorGraph {
   // Note that multiple threads cannot call CloseInputStream() on the same
   // stream_name at the same time.
   absl::Status CloseInputStream(const std::string& stream_name);
+  absl::Status CloseInputStream(const InputStreamHandle& stream);
 
   // Closes all the graph input streams.
   // TODO: deprecate this function in favor of CloseAllPacketSources.
@@ -377,6 +433,10 @@ class CalculatorGraph {
   absl::StatusOr<std::map<std::string, Packet>> PrepareGpu(
       const std::map<std::string, Packet>& side_packets);
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  // Helper for PrepareForRun. Creates the graph's ImageFrameMultiPool if a
+  // calculator requests kImageFramePoolService and none was provided.
+  absl::Status PrepareImageFramePool();
+
   template <typename T>
   absl::Status SetServiceObject(const GraphService<T>& service,
                                 std::shared_ptr<T> object) {
@@ -452,9 +512,22 @@ class CalculatorGraph {
   // AddPacketToInputStream(Packet&& packet) or
   // AddPacketToInputStream(const Packet& packet).
   template <typename T>
-  absl::Status AddPacketToInputStreamInternal(const std::string& stream_name,
+  absl::Status AddPacketToInputStreamInternal(const InputStreamHandle& stream,
                                               T&& packet);
 
+  // Returns the handle of a graph input stream, or an invalid handle.
+  InputStreamHandle FindInputStream(const std::string& stream_name);
+
+  // Applies the graph input stream add mode before packets are added to the
+  // graph input stream of the virtual node `node_id`.
+  absl::Status WaitToAddToInputStream(int node_id);
+
+  // Logs a packet entering the graph through `stream` for profiling.
+  void LogInputStreamPacket(GraphInputStream* stream, const Packet& packet);
+
+  // Delivers the packets added to `stream` to the consuming input streams.
+  absl::Status PropagateInputStreamPackets(GraphInputStream* stream);
+
   // Sets the executor that will run the nodes assigned to the executor
   // named |name|.  If |name| is empty, this sets the default executor.
   // Does not check that the graph is uninitialized and |name| is not a
@@ -0,0 +1,185 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr char kOpenedTag[] = "OPENED";
+constexpr char kWaitTag[] = "WAIT";
+
+// Passes its input through. Open() notifies the OPENED side packet and then
+// waits for the WAIT side packet, both of which are optional.
+class BlockingOpenCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).SetSameAs(&cc->Inputs().Index(0));
+    cc->InputSidePackets()
+        .Tag(kOpenedTag)
+        .Set<absl::Notification*>()
+        .Optional();
+    cc->InputSidePackets().Tag(kWaitTag).Set<absl::Notification*>().Optional();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    if (cc->InputSidePackets().HasTag(kOpenedTag)) {
+      cc->InputSidePackets()
+          .Tag(kOpenedTag)
+          .Get<absl::Notification*>()
+          ->Notify();
+    }
+    if (cc->InputSidePackets().HasTag(kWaitTag)) {
+      RET_CHECK(cc->InputSidePackets()
+                    .Tag(kWaitTag)
+                    .Get<absl::Notification*>()
+                    ->WaitForNotificationWithTimeout(absl::Seconds(10)))
+          << "Timed out waiting in Open().";
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+    return absl::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(BlockingOpenCalculator);
+
+CalculatorGraphConfig ChainConfig() {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "in"
+    output_stream: "out"
+    num_threads: 2
+    concurrent_open: true
+    input_side_packet: "upstream_opened"
+    input_side_packet: "downstream_opened"
+    input_side_packet: "release"
+    node {
+      calculator: "BlockingOpenCalculator"
+      input_stream: "in"
+      output_stream: "mid"
+      input_side_packet: "OPENED:upstream_opened"
+      input_side_packet: "WAIT:downstream_opened"
+    }
+    node {
+      calculator: "BlockingOpenCalculator"
+      input_stream: "mid"
+      output_stream: "out"
+      input_side_packet: "OPENED:downstream_opened"
+      input_side_packet: "WAIT:release"
+    }
+    profiler_config { enable_profiler: true }
+  )pb");
+}
+
+TEST(CalculatorGraphConcurrentOpenTest, OpensConnectedNodesConcurrently) {
+  // The upstream Open() only returns once the downstream Open() has started,
+  // which requires the two to run concurrently.
+  absl::Notification upstream_opened;
+  absl::Notification downstream_opened;
+  absl::Notification release;
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(ChainConfig()));
+  std::vector<Packet> outputs;
+  MP_ASSERT_OK(graph.ObserveOutputStream("out", [&](const Packet& packet) {
+    outputs.push_back(packet);
+    return absl::OkStatus();
+  }));
+  MP_ASSERT_OK(graph.StartRun(
+      {{"upstream_opened", MakePacket<absl::Notification*>(&upstream_opened)},
+       {"downstream_opened",
+        MakePacket<absl::Notification*>(&downstream_opened)},
+       {"release", MakePacket<absl::Notification*>(&release)}}));
+
+  // Input is accepted and queued while the nodes are opening.
+  for (int i = 0; i < 3; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "in", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  EXPECT_TRUE(
+      downstream_opened.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  const absl::Time downstream_open_start = absl::Now();
+  EXPECT_TRUE(outputs.empty());
+  const absl::Duration min_downstream_open =
+      absl::Now() - downstream_open_start;
+  release.Notify();
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  ASSERT_EQ(3, outputs.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(i, outputs[i].Get<int>());
+  }
+
+  // The Open() timings are recorded per node. The downstream Open() spans at
+  // least the interval between observing its start and releasing it.
+  std::vector<CalculatorProfile> profiles;
+  MP_ASSERT_OK(graph.profiler()->GetCalculatorProfiles(&profiles));
+  ASSERT_EQ(2, profiles.size());
+  int64 max_open_runtime = 0;
+  for (const CalculatorProfile& profile : profiles) {
+    EXPECT_TRUE(profile.has_open_runtime());
+    max_open_runtime = std::max(max_open_runtime, profile.open_runtime());
+  }
+  EXPECT_GE(max_open_runtime, absl::ToInt64Microseconds(min_downstream_open));
+}
+
+TEST(CalculatorGraphConcurrentOpenTest, WaitsForUpstreamOpenByDefault) {
+  // Without concurrent_open, the downstream node is opened only after the
+  // upstream Open() returns.
+  CalculatorGraphConfig config = ChainConfig();
+  config.set_concurrent_open(false);
+  config.add_input_side_packet("upstream_release");
+  config.mutable_node(0)->set_input_side_packet(1, "WAIT:upstream_release");
+  absl::Notification upstream_opened;
+  absl::Notification upstream_release;
+  absl::Notification downstream_opened;
+  absl::Notification release;
+  release.Notify();
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun(
+      {{"upstream_opened", MakePacket<absl::Notification*>(&upstream_opened)},
+       {"upstream_release", MakePacket<absl::Notification*>(&upstream_release)},
+       {"downstream_opened",
+        MakePacket<absl::Notification*>(&downstream_opened)},
+       {"release", MakePacket<absl::Notification*>(&release)}}));
+  EXPECT_TRUE(
+      upstream_opened.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_FALSE(downstream_opened.WaitForNotificationWithTimeout(
+      absl::Milliseconds(100)));
+  upstream_release.Notify();
+  EXPECT_TRUE(
+      downstream_opened.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+}  // namespace
+}  // namespace mediapipe
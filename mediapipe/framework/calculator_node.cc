@@ -152,6 +152,7 @@ absl::Status CalculatorNode::Initialize(
     executor_ = node_config->executor();
   }
   source_layer_ = node_config->source_layer();
+  concurrent_open_ = validated_graph_->Config().concurrent_open();
 
   const CalculatorContract& contract = node_type_info_->Contract();
 
@@ -441,7 +442,7 @@ absl::Status CalculatorNode::PrepareForRun(
     input_stream_headers_ready_called_ = false;
     input_side_packets_ready_called_ = false;
     input_stream_headers_ready_ =
-        (input_stream_handler_->UnsetHeaderCount() == 0);
+        concurrent_open_ || (input_stream_handler_->UnsetHeaderCount() == 0);
     input_side_packets_ready_ =
         (input_side_packet_handler_.MissingInputSidePacketCount() == 0);
   }
@@ -700,9 +701,13 @@ void CalculatorNode::InputStreamHeadersReady() {
   bool ready_for_open = false;
   {
     absl::MutexLock lock(&status_mutex_);
-    CHECK_EQ(status_, kStatePrepared) << DebugName();
     CHECK(!input_stream_headers_ready_called_);
     input_stream_headers_ready_called_ = true;
+    if (concurrent_open_) {
+      // The node did not wait for the headers, and may already be open.
+      return;
+    }
+    CHECK_EQ(status_, kStatePrepared) << DebugName();
     input_stream_headers_ready_ = true;
     ready_for_open = input_side_packets_ready_;
   }
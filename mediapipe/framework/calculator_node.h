@@ -295,6 +295,9 @@ class CalculatorNode {
   std::string executor_;
   // The layer a source calculator operates on.
   int source_layer_ = 0;
+  // If true, OpenNode() does not wait for the input stream headers.
+  // See CalculatorGraphConfig.concurrent_open.
+  bool concurrent_open_ = false;
   // The status of the current Calculator that this CalculatorNode
   // is wrapping.  kStateActive is currently used only for source nodes.
   enum NodeStatus {
@@ -0,0 +1,86 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_multi_pool.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mediapipe {
+
+const GraphService<ImageFrameMultiPool> kImageFramePoolService(
+    "kImageFramePoolService");
+
+constexpr int ImageFrameMultiPool::kMaxKeepCount;
+constexpr int ImageFrameMultiPool::kMaxPoolCount;
+
+std::size_t ImageFrameMultiPool::FrameSpecHash::operator()(
+    const FrameSpec& spec) const {
+  std::size_t hash = std::hash<int>{}(spec.width);
+  for (int value : {spec.height, static_cast<int>(spec.format),
+                    spec.alignment_boundary}) {
+    hash = hash * 31 + std::hash<int>{}(value);
+  }
+  return hash;
+}
+
+std::shared_ptr<ImageFramePool> ImageFrameMultiPool::GetPool(
+    const FrameSpec& spec) {
+  absl::MutexLock lock(&mutex_);
+  auto pool_it = pools_.find(spec);
+  if (pool_it == pools_.end()) {
+    // Discard the least recently used pool. Its frames that are still in use
+    // are deleted when they are released.
+    if (pools_.size() >= kMaxPoolCount) {
+      pools_.erase(frame_specs_.front());
+      frame_specs_.pop_front();
+    }
+    pool_it = pools_
+                  .emplace(spec, ImageFramePool::Create(
+                                     spec.width, spec.height, spec.format,
+                                     kMaxKeepCount, spec.alignment_boundary))
+                  .first;
+  } else {
+    frame_specs_.erase(
+        std::find(frame_specs_.begin(), frame_specs_.end(), spec));
+  }
+  frame_specs_.push_back(spec);
+  return pool_it->second;
+}
+
+std::unique_ptr<ImageFrame> ImageFrameMultiPool::GetFrame(
+    ImageFormat::Format format, int width, int height, int alignment_boundary,
+    bool* reused) {
+  std::shared_ptr<ImageFramePool> pool =
+      GetPool({width, height, format, alignment_boundary});
+  bool buffer_reused = false;
+  ImageFrameSharedPtr buffer = pool->GetBuffer(&buffer_reused);
+  ++(buffer_reused ? hit_count_ : miss_count_);
+  if (reused) {
+    *reused = buffer_reused;
+  }
+
+  // The returned frame borrows the pixel data of the pooled frame, which goes
+  // back to the pool when the deleter releases it.
+  uint8* pixel_data = buffer->MutablePixelData();
+  const int width_step = buffer->WidthStep();
+  return absl::make_unique<ImageFrame>(
+      format, width, height, width_step, pixel_data,
+      [buffer](uint8*) mutable { buffer.reset(); });
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,104 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This class lets CPU calculators allocate ImageFrames of various sizes,
+// caching and reusing their pixel data. It does so by automatically creating
+// and using an ImageFramePool for each requested size, format and alignment.
+//
+// A graph owns one ImageFrameMultiPool, available to calculators through
+// kImageFramePoolService. Calculators normally use it through
+// GetPooledImageFrame() in mediapipe/util/image_frame_pool_util.h.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_MULTI_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_MULTI_POOL_H_
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+class ImageFrameMultiPool {
+ public:
+  // The largest number of released frames kept for each size. Pools keep
+  // fewer if fewer frames of that size were ever in use at the same time.
+  static constexpr int kMaxKeepCount = 8;
+  // The largest number of sizes kept. When the limit is reached, the pool of
+  // the least recently used size is dropped.
+  static constexpr int kMaxPoolCount = 20;
+
+  ImageFrameMultiPool() = default;
+  ImageFrameMultiPool(const ImageFrameMultiPool&) = delete;
+  ImageFrameMultiPool& operator=(const ImageFrameMultiPool&) = delete;
+
+  // Returns a frame of the given format and size. Its pixel data is reused
+  // from a released frame when possible, and is returned to the pool when the
+  // frame is destroyed (e.g. when the last packet holding it is released).
+  // The pixel values are unspecified. If reused is not null, it is set to
+  // whether the pixel data was reused.
+  std::unique_ptr<ImageFrame> GetFrame(
+      ImageFormat::Format format, int width, int height,
+      int alignment_boundary = ImageFrame::kDefaultAlignmentBoundary,
+      bool* reused = nullptr);
+
+  // The number of GetFrame() calls that reused pixel data, and that allocated
+  // new pixel data.
+  int64 hit_count() const { return hit_count_; }
+  int64 miss_count() const { return miss_count_; }
+
+ private:
+  struct FrameSpec {
+    int width;
+    int height;
+    ImageFormat::Format format;
+    int alignment_boundary;
+
+    bool operator==(const FrameSpec& other) const {
+      return width == other.width && height == other.height &&
+             format == other.format &&
+             alignment_boundary == other.alignment_boundary;
+    }
+  };
+
+  struct FrameSpecHash {
+    std::size_t operator()(const FrameSpec& spec) const;
+  };
+
+  std::shared_ptr<ImageFramePool> GetPool(const FrameSpec& spec);
+
+  absl::Mutex mutex_;
+  std::unordered_map<FrameSpec, std::shared_ptr<ImageFramePool>, FrameSpecHash>
+      pools_ ABSL_GUARDED_BY(mutex_);
+  // The specs in pools_, from least to most recently used.
+  std::deque<FrameSpec> frame_specs_ ABSL_GUARDED_BY(mutex_);
+
+  std::atomic<int64> hit_count_{0};
+  std::atomic<int64> miss_count_{0};
+};
+
+// The graph-level ImageFrameMultiPool. A CalculatorGraph creates one when any
+// of its calculators requests this service.
+extern const GraphService<ImageFrameMultiPool> kImageFramePoolService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_MULTI_POOL_H_
@@ -0,0 +1,89 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_multi_pool.h"
+
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ImageFrameMultiPoolTest, ReusesReleasedFrames) {
+  ImageFrameMultiPool pool;
+  bool reused = true;
+  auto frame = pool.GetFrame(ImageFormat::SRGB, 7, 5,
+                             ImageFrame::kDefaultAlignmentBoundary, &reused);
+  EXPECT_FALSE(reused);
+  EXPECT_EQ(ImageFormat::SRGB, frame->Format());
+  EXPECT_EQ(7, frame->Width());
+  EXPECT_EQ(5, frame->Height());
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+  const uint8* pixel_data = frame->PixelData();
+  frame.reset();
+
+  frame = pool.GetFrame(ImageFormat::SRGB, 7, 5,
+                        ImageFrame::kDefaultAlignmentBoundary, &reused);
+  EXPECT_TRUE(reused);
+  EXPECT_EQ(pixel_data, frame->PixelData());
+
+  // A different format, size or alignment uses a different pool.
+  auto gray = pool.GetFrame(ImageFormat::GRAY8, 7, 5,
+                            ImageFrame::kDefaultAlignmentBoundary, &reused);
+  EXPECT_FALSE(reused);
+  auto packed = pool.GetFrame(ImageFormat::SRGB, 7, 5, 1, &reused);
+  EXPECT_FALSE(reused);
+  EXPECT_EQ(7 * 3, packed->WidthStep());
+
+  EXPECT_EQ(1, pool.hit_count());
+  EXPECT_EQ(3, pool.miss_count());
+}
+
+TEST(ImageFrameMultiPoolTest, KeepsFramesUpToPeakUsage) {
+  ImageFrameMultiPool pool;
+  std::vector<std::unique_ptr<ImageFrame>> frames;
+  for (int i = 0; i < 3; ++i) {
+    frames.push_back(pool.GetFrame(ImageFormat::GRAY8, 4, 4));
+  }
+  frames.clear();
+  // All three frames are kept, since three were in use at the same time.
+  for (int i = 0; i < 3; ++i) {
+    frames.push_back(pool.GetFrame(ImageFormat::GRAY8, 4, 4));
+  }
+  EXPECT_EQ(3, pool.hit_count());
+  EXPECT_EQ(3, pool.miss_count());
+}
+
+TEST(ImageFrameMultiPoolTest, FramesOutliveEvictedPools) {
+  ImageFrameMultiPool pool;
+  auto frame = pool.GetFrame(ImageFormat::GRAY8, 1, 1);
+  // Evicts the pool of the first frame, which stays valid.
+  for (int i = 0; i < ImageFrameMultiPool::kMaxPoolCount; ++i) {
+    pool.GetFrame(ImageFormat::GRAY8, 2 + i, 1);
+  }
+  frame->MutablePixelData()[0] = 42;
+  EXPECT_EQ(42, frame->PixelData()[0]);
+  frame.reset();
+  bool reused = true;
+  pool.GetFrame(ImageFormat::GRAY8, 1, 1, ImageFrame::kDefaultAlignmentBoundary,
+                &reused);
+  EXPECT_FALSE(reused);
+}
+
+}  // namespace
+}  // namespace mediapipe
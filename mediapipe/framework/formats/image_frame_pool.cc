@@ -14,26 +14,33 @@
 
 #include "mediapipe/framework/formats/image_frame_pool.h"
 
+#include <algorithm>
+
 #include "absl/synchronization/mutex.h"
 
 namespace mediapipe {
 
 ImageFramePool::ImageFramePool(int width, int height,
-                               ImageFormat::Format format, int keep_count)
+                               ImageFormat::Format format, int keep_count,
+                               int alignment_boundary)
     : width_(width),
       height_(height),
       format_(format),
-      keep_count_(keep_count) {}
+      keep_count_(keep_count),
+      alignment_boundary_(alignment_boundary) {}
 
-ImageFrameSharedPtr ImageFramePool::GetBuffer() {
+ImageFrameSharedPtr ImageFramePool::GetBuffer(bool* reused) {
   std::unique_ptr<ImageFrame> buffer;
 
   {
     absl::MutexLock lock(&mutex_);
+    if (reused) {
+      *reused = !available_.empty();
+    }
     if (available_.empty()) {
-      // Fix alignment at 4 for best compatability with OpenGL.
-      buffer = std::make_unique<ImageFrame>(
-          format_, width_, height_, ImageFrame::kGlDefaultAlignmentBoundary);
+      // The alignment defaults to 4 for best compatability with OpenGL.
+      buffer = std::make_unique<ImageFrame>(format_, width_, height_,
+                                            alignment_boundary_);
       if (!buffer) return nullptr;
     } else {
       buffer = std::move(available_.back());
@@ -41,6 +48,7 @@ ImageFrameSharedPtr ImageFramePool::GetBuffer() {
     }
 
     ++in_use_count_;
+    max_in_use_count_ = std::max(max_in_use_count_, in_use_count_);
   }
 
   // Return a shared_ptr with a custom deleter that adds the buffer back
@@ -75,7 +83,8 @@ void ImageFramePool::Return(ImageFrame* buf) {
 
 void ImageFramePool::TrimAvailable(
     std::vector<std::unique_ptr<ImageFrame>>* trimmed) {
-  int keep = std::max(keep_count_ - in_use_count_, 0);
+  int keep =
+      std::max(std::min(keep_count_, max_in_use_count_) - in_use_count_, 0);
   if (available_.size() > keep) {
     auto trim_it = std::next(available_.begin(), keep);
     if (trimmed) {
@@ -31,35 +31,39 @@ using ImageFrameSharedPtr = std::shared_ptr<ImageFrame>;
 class ImageFramePool : public std::enable_shared_from_this<ImageFramePool> {
  public:
   // Creates a pool. This pool will manage buffers of the specified dimensions,
-  // and will keep keep_count buffers around for reuse.
+  // and will keep up to keep_count buffers around for reuse. Fewer buffers are
+  // kept if no more than that were ever in use at the same time.
   // We enforce creation as a shared_ptr so that we can use a weak reference in
   // the buffers' deleters.
-  static std::shared_ptr<ImageFramePool> Create(int width, int height,
-                                                ImageFormat::Format format,
-                                                int keep_count) {
-    return std::shared_ptr<ImageFramePool>(
-        new ImageFramePool(width, height, format, keep_count));
+  static std::shared_ptr<ImageFramePool> Create(
+      int width, int height, ImageFormat::Format format, int keep_count,
+      int alignment_boundary = ImageFrame::kGlDefaultAlignmentBoundary) {
+    return std::shared_ptr<ImageFramePool>(new ImageFramePool(
+        width, height, format, keep_count, alignment_boundary));
   }
 
-  // Obtains a buffers. May either be reused or created anew.
-  ImageFrameSharedPtr GetBuffer();
+  // Obtains a buffers. May either be reused or created anew. If reused is not
+  // null, it is set to whether an available buffer was reused.
+  ImageFrameSharedPtr GetBuffer(bool* reused = nullptr);
 
   int width() const { return width_; }
   int height() const { return height_; }
   ImageFormat::Format format() const { return format_; }
+  int alignment_boundary() const { return alignment_boundary_; }
 
   // This method is meant for testing.
   std::pair<int, int> GetInUseAndAvailableCounts();
 
  private:
   ImageFramePool(int width, int height, ImageFormat::Format format,
-                 int keep_count);
+                 int keep_count, int alignment_boundary);
 
   // Return a buffer to the pool.
   void Return(ImageFrame* buf);
 
-  // If the total number of buffers is greater than keep_count, destroys any
-  // surplus buffers that are no longer in use.
+  // If the total number of buffers is greater than keep_count, or than the
+  // largest number of buffers ever in use at once, destroys any surplus
+  // buffers that are no longer in use.
   void TrimAvailable(std::vector<std::unique_ptr<ImageFrame>>* trimmed)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
@@ -67,9 +71,11 @@ class ImageFramePool : public std::enable_shared_from_this<ImageFramePool> {
   const int height_;
   const ImageFormat::Format format_;
   const int keep_count_;
+  const int alignment_boundary_;
 
   absl::Mutex mutex_;
   int in_use_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  int max_in_use_count_ ABSL_GUARDED_BY(mutex_) = 0;
   std::vector<std::unique_ptr<ImageFrame>> available_ ABSL_GUARDED_BY(mutex_);
 };
 
@@ -0,0 +1,150 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Typed handles of graph input and output streams. The streams are resolved by
+// name once, instead of on every packet:
+//
+//   ASSIGN_OR_RETURN(auto output, GraphOutputStream<Detections>::Create(
+//                                     &graph, "detections"));
+//   MP_RETURN_IF_ERROR(graph.StartRun({}));
+//   ASSIGN_OR_RETURN(auto input,
+//                    GraphInputStream<ImuSample>::Create(&graph, "imu"));
+//   MP_RETURN_IF_ERROR(input.Add(samples, timestamps));
+//   MP_RETURN_IF_ERROR(input.Close());
+//   Packet packet;
+//   while (output.Next(&packet)) {
+//     const Detections& detections = packet.Get<Detections>();
+//   }
+
+#ifndef MEDIAPIPE_FRAMEWORK_GRAPH_STREAM_HANDLES_H_
+#define MEDIAPIPE_FRAMEWORK_GRAPH_STREAM_HANDLES_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "mediapipe/framework/calculator_graph.h"
+#include "mediapipe/framework/output_stream_poller.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+
+// A graph input stream carrying packets of type T.
+template <typename T>
+class GraphInputStream {
+ public:
+  // Resolves the graph input stream `stream_name` of `graph`, which must be
+  // initialized and must outlive the handle.
+  static absl::StatusOr<GraphInputStream<T>> Create(
+      CalculatorGraph* graph, const std::string& stream_name) {
+    ASSIGN_OR_RETURN(CalculatorGraph::InputStreamHandle handle,
+                     graph->GetInputStreamHandle(stream_name));
+    return GraphInputStream<T>(graph, handle);
+  }
+
+  // Adds `value` at `timestamp`.
+  absl::Status Add(T value, Timestamp timestamp) {
+    return graph_->AddPacketToInputStream(
+        handle_, MakePacket<T>(std::move(value)).At(timestamp));
+  }
+
+  // Adds `values` at the corresponding increasing `timestamps` as one batch.
+  // See CalculatorGraph::AddPacketsToInputStream().
+  absl::Status Add(std::vector<T> values,
+                   const std::vector<Timestamp>& timestamps) {
+    RET_CHECK_EQ(values.size(), timestamps.size());
+    std::vector<Packet> packets;
+    packets.reserve(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+      packets.push_back(MakePacket<T>(std::move(values[i])).At(timestamps[i]));
+    }
+    return graph_->AddPacketsToInputStream(handle_, std::move(packets));
+  }
+
+  // Adds packets holding T with increasing timestamps as one batch.
+  absl::Status AddPackets(std::vector<Packet> packets) {
+    for (const Packet& packet : packets) {
+      MP_RETURN_IF_ERROR(packet.ValidateAsType<T>());
+    }
+    return graph_->AddPacketsToInputStream(handle_, std::move(packets));
+  }
+
+  absl::Status Close() { return graph_->CloseInputStream(handle_); }
+
+ private:
+  GraphInputStream(CalculatorGraph* graph,
+                   CalculatorGraph::InputStreamHandle handle)
+      : graph_(graph), handle_(handle) {}
+
+  CalculatorGraph* graph_;
+  CalculatorGraph::InputStreamHandle handle_;
+};
+
+// A graph output stream carrying packets of type T.
+template <typename T>
+class GraphOutputStream {
+ public:
+  // Adds a poller for the output stream `stream_name` of `graph`. Must be
+  // called before the graph run starts.
+  static absl::StatusOr<GraphOutputStream<T>> Create(
+      CalculatorGraph* graph, const std::string& stream_name,
+      bool observe_timestamp_bounds = false) {
+    ASSIGN_OR_RETURN(
+        OutputStreamPoller poller,
+        graph->AddOutputStreamPoller(stream_name, observe_timestamp_bounds));
+    return GraphOutputStream<T>(std::move(poller));
+  }
+
+  // Calls `callback` with the value and timestamp of every packet emitted by
+  // the output stream `stream_name`. Returns an error from the graph run if a
+  // packet does not hold T. Must be called before the graph run starts.
+  static absl::Status Observe(
+      CalculatorGraph* graph, const std::string& stream_name,
+      std::function<absl::Status(const T&, Timestamp)> callback) {
+    return graph->ObserveOutputStream(
+        stream_name,
+        [callback = std::move(callback)](
+            const Packet& packet) -> absl::Status {
+          MP_RETURN_IF_ERROR(packet.ValidateAsType<T>());
+          return callback(packet.Get<T>(), packet.Timestamp());
+        });
+  }
+
+  // Blocks until the next packet is available and returns true, or returns
+  // false once the stream is done. With observe_timestamp_bounds, empty
+  // packets report timestamp bound updates.
+  ABSL_MUST_USE_RESULT bool Next(Packet* packet) {
+    return poller_.Next(packet);
+  }
+
+  void SetMaxQueueSize(int queue_size) { poller_.SetMaxQueueSize(queue_size); }
+
+  int QueueSize() { return poller_.QueueSize(); }
+
+ private:
+  explicit GraphOutputStream(OutputStreamPoller poller)
+      : poller_(std::move(poller)) {}
+
+  OutputStreamPoller poller_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_GRAPH_STREAM_HANDLES_H_
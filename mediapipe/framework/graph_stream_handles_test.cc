@@ -0,0 +1,141 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/graph_stream_handles.h"
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+CalculatorGraphConfig PassThroughConfig() {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "in"
+    output_stream: "out"
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "in"
+      output_stream: "out"
+    }
+  )pb");
+}
+
+template <typename T>
+T ValueOrDie(absl::StatusOr<T> status_or_value) {
+  MP_EXPECT_OK(status_or_value);
+  return std::move(status_or_value).value();
+}
+
+TEST(GraphStreamHandlesTest, AddsSinglePacketsAndBatches) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(PassThroughConfig()));
+  auto output =
+      ValueOrDie(GraphOutputStream<int>::Create(&graph, "out"));
+  MP_ASSERT_OK(graph.StartRun({}));
+  auto input = ValueOrDie(GraphInputStream<int>::Create(&graph, "in"));
+
+  MP_ASSERT_OK(input.Add(0, Timestamp(0)));
+  MP_ASSERT_OK(input.Add({1, 2, 3}, {Timestamp(1), Timestamp(2), Timestamp(5)}));
+  MP_ASSERT_OK(input.AddPackets(
+      {MakePacket<int>(4).At(Timestamp(6)), MakePacket<int>(5).At(Timestamp(7))}));
+  MP_ASSERT_OK(input.Close());
+
+  std::vector<int> values;
+  std::vector<Timestamp> timestamps;
+  Packet packet;
+  while (output.Next(&packet)) {
+    values.push_back(packet.Get<int>());
+    timestamps.push_back(packet.Timestamp());
+  }
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  EXPECT_THAT(values, testing::ElementsAre(0, 1, 2, 3, 4, 5));
+  EXPECT_THAT(timestamps,
+              testing::ElementsAre(Timestamp(0), Timestamp(1), Timestamp(2),
+                                   Timestamp(5), Timestamp(6), Timestamp(7)));
+}
+
+TEST(GraphStreamHandlesTest, RejectsInvalidBatches) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(PassThroughConfig()));
+  std::vector<int> values;
+  MP_ASSERT_OK(GraphOutputStream<int>::Observe(
+      &graph, "out", [&values](const int& value, Timestamp timestamp) {
+        values.push_back(value);
+        return absl::OkStatus();
+      }));
+  MP_ASSERT_OK(graph.StartRun({}));
+  auto input = ValueOrDie(GraphInputStream<int>::Create(&graph, "in"));
+
+  // Nothing from a rejected batch is added.
+  EXPECT_FALSE(input.Add({1, 2}, {Timestamp(1), Timestamp(1)}).ok());
+  EXPECT_FALSE(input.Add({1, 2}, {Timestamp(1)}).ok());
+  EXPECT_FALSE(
+      input.AddPackets({MakePacket<std::string>("a").At(Timestamp(1))}).ok());
+  MP_ASSERT_OK(input.Add({7, 8}, {Timestamp(1), Timestamp(2)}));
+  MP_ASSERT_OK(input.Close());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  EXPECT_THAT(values, testing::ElementsAre(7, 8));
+}
+
+TEST(GraphStreamHandlesTest, ResolvesStreamsOnce) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(PassThroughConfig()));
+  EXPECT_FALSE(graph.GetInputStreamHandle("out").ok());
+  EXPECT_FALSE(GraphOutputStream<int>::Create(&graph, "missing").ok());
+
+  // Handles can be resolved before the run and stay valid across runs.
+  auto handle = ValueOrDie(graph.GetInputStreamHandle("in"));
+  ASSERT_TRUE(handle.IsValid());
+  EXPECT_EQ(absl::StatusCode::kFailedPrecondition,
+            graph.AddPacketToInputStream(handle, MakePacket<int>(0).At(
+                                                     Timestamp(0)))
+                .code());
+  for (int run = 0; run < 2; ++run) {
+    int num_packets = 0;
+    auto poller = ValueOrDie(graph.AddOutputStreamPoller("out"));
+    MP_ASSERT_OK(graph.StartRun({}));
+    MP_ASSERT_OK(
+        graph.AddPacketToInputStream(handle, MakePacket<int>(0).At(Timestamp(0))));
+    MP_ASSERT_OK(graph.AddPacketsToInputStream(
+        "in", {MakePacket<int>(1).At(Timestamp(1))}));
+    MP_ASSERT_OK(graph.CloseInputStream(handle));
+    Packet packet;
+    while (poller.Next(&packet)) ++num_packets;
+    MP_ASSERT_OK(graph.WaitUntilDone());
+    EXPECT_EQ(2, num_packets);
+  }
+}
+
+TEST(GraphStreamHandlesTest, ObserveFailsOnWrongType) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(PassThroughConfig()));
+  MP_ASSERT_OK(GraphOutputStream<int>::Observe(
+      &graph, "out",
+      [](const int& value, Timestamp timestamp) { return absl::OkStatus(); }));
+  MP_ASSERT_OK(graph.StartRun({}));
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "in", MakePacket<std::string>("a").At(Timestamp(0))));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  EXPECT_FALSE(graph.WaitUntilDone().ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
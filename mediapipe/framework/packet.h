@@ -245,6 +245,14 @@ Packet Adopt(const T* ptr);
 template <typename T>
 Packet PointToForeign(const T* ptr);
 
+// Returns a Packet that points into the payload of another Packet, such as to
+// an element of a collection, without copying the data. The returned Packet
+// and its copies keep the payload of owner alive. Like PointToForeign, the
+// returned Packet can't be consumed. The timestamp of the returned Packet is
+// Timestamp::Unset().
+template <typename T>
+Packet PointIntoPacket(const T* ptr, Packet owner);
+
 // Adopts the data but places it in a std::unique_ptr inside the
 // resulting Packet, leaving the timestamp unset. This allows the
 // adopted data to be mutated, with the mutable data accessible as
@@ -593,6 +601,18 @@ class ForeignHolder : public Holder<T> {
   bool HasForeignOwner() const final { return true; }
 };
 
+// Like ForeignHolder, but shares the ownership of the Packet whose payload
+// holds the data.
+template <typename T>
+class AliasingHolder : public ForeignHolder<T> {
+ public:
+  AliasingHolder(const T* ptr, Packet owner)
+      : ForeignHolder<T>(ptr), owner_(std::move(owner)) {}
+
+ private:
+  Packet owner_;
+};
+
 template <typename T>
 Holder<T>* HolderBase::As() {
   if (PayloadIsOfType<T>()) {
@@ -771,6 +791,14 @@ Packet PointToForeign(const T* ptr) {
   return packet_internal::Create(new packet_internal::ForeignHolder<T>(ptr));
 }
 
+template <typename T>
+Packet PointIntoPacket(const T* ptr, Packet owner) {
+  CHECK(ptr != nullptr);
+  CHECK(!owner.IsEmpty());
+  return packet_internal::Create(
+      new packet_internal::AliasingHolder<T>(ptr, std::move(owner)));
+}
+
 // Equal Packets refer to the same memory contents, like equal pointers.
 inline bool operator==(const Packet& p1, const Packet& p2) {
   return packet_internal::GetHolder(p1) == packet_internal::GetHolder(p2);
@@ -412,6 +412,27 @@ TEST(PacketTest, TestForeignHolderConsumeOrCopy) {
   EXPECT_EQ(33, *result2.value());
 }
 
+TEST(PacketTest, PointIntoPacketKeepsOwnerAlive) {
+  Packet item;
+  {
+    Packet collection = MakePacket<std::vector<int>>(std::vector<int>{1, 2});
+    const std::vector<int>& values = collection.Get<std::vector<int>>();
+    item = PointIntoPacket(&values[1], collection).At(Timestamp(5));
+    EXPECT_EQ(&values[1], &item.Get<int>());
+  }
+  EXPECT_EQ(2, item.Get<int>());
+  EXPECT_EQ(Timestamp(5), item.Timestamp());
+
+  // The data is not owned by the item packet, so it is copied on consumption.
+  EXPECT_FALSE(item.Consume<int>().ok());
+  bool was_copied = false;
+  absl::StatusOr<std::unique_ptr<int>> result =
+      item.ConsumeOrCopy<int>(&was_copied);
+  MP_ASSERT_OK(result);
+  EXPECT_TRUE(was_copied);
+  EXPECT_EQ(2, *result.value());
+}
+
 TEST(PacketTest, TestConsumeBoundedArray) {
   Packet packet1 = MakePacket<int[3]>(10, 20, 30);
   Packet packet_copy = packet1;
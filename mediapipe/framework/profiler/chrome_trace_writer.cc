@@ -0,0 +1,259 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/chrome_trace_writer.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+namespace mediapipe {
+namespace {
+
+int GetProcessId() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+std::string JsonString(absl::string_view value) {
+  std::string result = "\"";
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", c);
+        } else {
+          result += c;
+        }
+    }
+  }
+  result += "\"";
+  return result;
+}
+
+// Returns true for the event types traced with a start and a finish time.
+bool IsDurationEvent(GraphTrace::EventType event_type) {
+  switch (event_type) {
+    case GraphTrace::OPEN:
+    case GraphTrace::PROCESS:
+    case GraphTrace::CLOSE:
+    case GraphTrace::CPU_TASK_USER:
+    case GraphTrace::CPU_TASK_SYSTEM:
+    case GraphTrace::GPU_TASK:
+    case GraphTrace::DSP_TASK:
+    case GraphTrace::TPU_TASK:
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::string StreamName(const GraphTrace& trace, int stream_id) {
+  return stream_id < trace.stream_name_size() ? trace.stream_name(stream_id)
+                                              : absl::StrCat(stream_id);
+}
+
+}  // namespace
+
+ChromeTraceWriter::ChromeTraceWriter(std::ostream* output)
+    : output_(output), process_id_(GetProcessId()) {}
+
+ChromeTraceWriter::~ChromeTraceWriter() { Close(); }
+
+void ChromeTraceWriter::SetCalculatorNames(std::vector<std::string> names) {
+  calculator_names_ = std::move(names);
+}
+
+void ChromeTraceWriter::WriteTrace(const GraphTrace& trace) {
+  if (closed_) {
+    return;
+  }
+  if (trace.calculator_name_size() > 0) {
+    calculator_names_.assign(trace.calculator_name().begin(),
+                             trace.calculator_name().end());
+  }
+  for (const auto& calc_trace : trace.calculator_trace()) {
+    WriteCalculatorTrace(trace, calc_trace);
+  }
+  FlushStartedCalls(/*all=*/false);
+  finished_calls_.clear();
+  ++trace_count_;
+  output_->flush();
+}
+
+void ChromeTraceWriter::Close() {
+  if (closed_) {
+    return;
+  }
+  FlushStartedCalls(/*all=*/true);
+  *output_ << (started_ ? "\n]\n" : "[]\n");
+  output_->flush();
+  closed_ = true;
+}
+
+void ChromeTraceWriter::WriteEvent(absl::string_view name,
+                                   absl::string_view category, char phase,
+                                   int64 time, int thread_id,
+                                   absl::string_view extra_fields,
+                                   absl::string_view args) {
+  std::string event = absl::StrCat(
+      started_ ? ",\n" : "[\n", "{\"name\":", JsonString(name),
+      ",\"cat\":", JsonString(category), ",\"ph\":\"", std::string(1, phase),
+      "\",\"ts\":", time, ",\"pid\":", process_id_, ",\"tid\":", thread_id);
+  if (!extra_fields.empty()) {
+    absl::StrAppend(&event, ",", extra_fields);
+  }
+  if (!args.empty()) {
+    absl::StrAppend(&event, ",\"args\":{", args, "}");
+  }
+  event += "}";
+  *output_ << event;
+  started_ = true;
+}
+
+void ChromeTraceWriter::WriteThreadName(int thread_id) {
+  if (!named_threads_.insert(thread_id).second) {
+    return;
+  }
+  WriteEvent("thread_name", "__metadata", 'M', 0, thread_id, "",
+             absl::StrCat("\"name\":",
+                          JsonString(absl::StrCat("mediapipe_", thread_id))));
+}
+
+std::string ChromeTraceWriter::NodeName(int node_id) const {
+  // Packets added to graph input streams are traced with node id -1.
+  if (node_id < 0) {
+    return "graph_input";
+  }
+  return node_id < calculator_names_.size() ? calculator_names_[node_id]
+                                            : absl::StrCat("node_", node_id);
+}
+
+void ChromeTraceWriter::WriteCalculatorTrace(
+    const GraphTrace& trace, const GraphTrace::CalculatorTrace& calc_trace) {
+  const int64 base_time = trace.base_time();
+  const std::string node_name = NodeName(calc_trace.node_id());
+  const GraphTrace::EventType event_type = calc_trace.event_type();
+  const std::string category = GraphTrace::EventType_Name(event_type);
+  const int thread_id = calc_trace.thread_id();
+
+  if (event_type == GraphTrace::PACKET_QUEUED) {
+    for (const auto& stream_trace : calc_trace.input_trace()) {
+      // Queue sizes are also logged for the packet at the head of the queue.
+      if (stream_trace.packet_timestamp() != calc_trace.input_timestamp()) {
+        continue;
+      }
+      const int64 time = stream_trace.has_finish_time()
+                             ? stream_trace.finish_time()
+                             : calc_trace.start_time();
+      WriteEvent(absl::StrCat(node_name, " queue ",
+                              StreamName(trace, stream_trace.stream_id())),
+                 category, 'C', base_time + time, thread_id, "",
+                 absl::StrCat("\"size\":", stream_trace.event_data()));
+    }
+    return;
+  }
+  if (event_type == GraphTrace::COUNTER) {
+    for (const auto& stream_trace : calc_trace.input_trace()) {
+      WriteEvent(absl::StrCat(node_name, " ",
+                              StreamName(trace, stream_trace.stream_id())),
+                 category, 'C', base_time + calc_trace.start_time(),
+                 thread_id, "",
+                 absl::StrCat("\"value\":", stream_trace.event_data()));
+    }
+    return;
+  }
+
+  WriteThreadName(thread_id);
+  const int64 input_timestamp =
+      trace.base_timestamp() + calc_trace.input_timestamp();
+  if (calc_trace.has_start_time() && calc_trace.has_finish_time()) {
+    WriteEvent(
+        node_name, category, 'X', base_time + calc_trace.start_time(),
+        thread_id,
+        absl::StrCat("\"dur\":",
+                     calc_trace.finish_time() - calc_trace.start_time()),
+        absl::StrCat("\"input_timestamp\":", input_timestamp));
+  } else if (IsDurationEvent(event_type)) {
+    // The start and the finish of a call may be traced separately, possibly
+    // in different GraphTraces, and with trace_log_instant_events once for
+    // each input and output packet.
+    const CallKey key(calc_trace.node_id(), event_type, input_timestamp);
+    auto started = started_calls_.find(key);
+    if (calc_trace.has_start_time()) {
+      const int64 start_time = base_time + calc_trace.start_time();
+      if (started == started_calls_.end()) {
+        started_calls_[key] = {start_time, thread_id, trace_count_};
+      } else {
+        started->second.start_time =
+            std::min(started->second.start_time, start_time);
+      }
+    } else if (finished_calls_.insert(key).second) {
+      const int64 finish_time = base_time + calc_trace.finish_time();
+      const std::string args =
+          absl::StrCat("\"input_timestamp\":", input_timestamp);
+      if (started != started_calls_.end()) {
+        WriteEvent(node_name, category, 'X', started->second.start_time,
+                   started->second.thread_id,
+                   absl::StrCat("\"dur\":",
+                                finish_time - started->second.start_time),
+                   args);
+        started_calls_.erase(started);
+      } else {
+        // The start was not traced, e.g. for source calculators.
+        WriteEvent(node_name, category, 'i', finish_time, thread_id,
+                   "\"s\":\"t\"", args);
+      }
+    }
+  } else {
+    const int64 time = calc_trace.has_start_time() ? calc_trace.start_time()
+                                                   : calc_trace.finish_time();
+    WriteEvent(absl::StrCat(node_name, " ", category), category, 'i',
+               base_time + time, thread_id, "\"s\":\"t\"", "");
+  }
+}
+
+void ChromeTraceWriter::FlushStartedCalls(bool all) {
+  for (auto it = started_calls_.begin(); it != started_calls_.end();) {
+    if (!all && it->second.trace_count == trace_count_) {
+      ++it;
+      continue;
+    }
+    const GraphTrace::EventType event_type = std::get<1>(it->first);
+    const std::string category = GraphTrace::EventType_Name(event_type);
+    WriteEvent(NodeName(std::get<0>(it->first)), category, 'i',
+               it->second.start_time, it->second.thread_id, "\"s\":\"t\"",
+               absl::StrCat("\"input_timestamp\":", std::get<2>(it->first)));
+    it = started_calls_.erase(it);
+  }
+}
+
+}  // namespace mediapipe
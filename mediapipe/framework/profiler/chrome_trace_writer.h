@@ -0,0 +1,106 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_WRITER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_WRITER_H_
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <tuple>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// Converts GraphTraces to the Chrome trace-event format, which can be viewed
+// in chrome://tracing and ui.perfetto.dev, alongside traces from other
+// profilers of the same process.
+//
+// Calculator calls show up as slices on the thread that ran them, scheduling
+// events as instant events, and input queue sizes and TraceCounter values as
+// counter tracks. Times are in microseconds since the epoch, according to the
+// profiler clock.
+//
+// Events are written as each GraphTrace is added, so that memory use does not
+// grow with the length of the trace. The output is a JSON array of events,
+// which trace viewers also accept without the closing bracket written by
+// Close(), e.g. if the process is killed.
+//
+// A call whose start and finish are traced separately is written once its
+// finish is found in the same or the next GraphTrace. Calls with only a start
+// or only a finish traced, e.g. calls without input or output packets, are
+// written as instant events.
+class ChromeTraceWriter {
+ public:
+  // The output must outlive the writer.
+  explicit ChromeTraceWriter(std::ostream* output);
+  ~ChromeTraceWriter();
+  ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+  ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+
+  // Sets the names of the calculators, indexed by node id. Names found in a
+  // GraphTrace take precedence.
+  void SetCalculatorNames(std::vector<std::string> names);
+
+  // Writes the events of a GraphTrace, and flushes the output.
+  void WriteTrace(const GraphTrace& trace);
+
+  // Ends the array of events. Nothing is written after this.
+  void Close();
+
+ private:
+  // Writes one event with the given fields. extra_fields and args are JSON
+  // members without the enclosing braces, and may be empty.
+  void WriteEvent(absl::string_view name, absl::string_view category,
+                  char phase, int64 time, int thread_id,
+                  absl::string_view extra_fields, absl::string_view args);
+  // Names a thread the first time it appears.
+  void WriteThreadName(int thread_id);
+  void WriteCalculatorTrace(const GraphTrace& trace,
+                            const GraphTrace::CalculatorTrace& calc_trace);
+  // Writes the calls started before the previous GraphTrace that have not
+  // finished, or all unfinished calls, as instant events.
+  void FlushStartedCalls(bool all);
+  std::string NodeName(int node_id) const;
+
+  // Identifies a call by node id, event type, and input timestamp.
+  using CallKey = std::tuple<int, GraphTrace::EventType, int64>;
+  struct StartedCall {
+    int64 start_time;
+    int thread_id;
+    // The number of GraphTraces written before the call started.
+    int64 trace_count;
+  };
+
+  std::ostream* output_;
+  const int process_id_;
+  bool started_ = false;
+  bool closed_ = false;
+  std::vector<std::string> calculator_names_;
+  std::set<int> named_threads_;
+  std::map<CallKey, StartedCall> started_calls_;
+  // The calls finished in the current GraphTrace, whose finish may be traced
+  // once for each output packet.
+  std::set<CallKey> finished_calls_;
+  int64 trace_count_ = 0;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_WRITER_H_
@@ -0,0 +1,150 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/chrome_trace_writer.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Returns the written events, one per line, without pid and thread names.
+std::vector<std::string> Events(const std::string& output) {
+  std::vector<std::string> result;
+  for (absl::string_view line : absl::StrSplit(output, '\n')) {
+    if (line.empty() || line == "[" || line == "]" ||
+        absl::StrContains(line, "thread_name")) {
+      continue;
+    }
+    std::string event(line);
+    if (event.back() == ',') {
+      event.pop_back();
+    }
+    const size_t pid = event.find(",\"pid\":");
+    event.erase(pid, event.find(",\"tid\"") - pid);
+    result.push_back(event);
+  }
+  return result;
+}
+
+TEST(ChromeTraceWriterTest, WritesCalculatorCalls) {
+  std::ostringstream output;
+  ChromeTraceWriter writer(&output);
+  writer.SetCalculatorNames({"Source", "Sink\"1"});
+  writer.WriteTrace(ParseTextProtoOrDie<GraphTrace>(R"pb(
+    base_time: 1000
+    base_timestamp: 50
+    stream_name: [ "", "in" ]
+    calculator_trace {
+      node_id: 1
+      input_timestamp: 10
+      event_type: PROCESS
+      start_time: 5
+      finish_time: 8
+      thread_id: 2
+    }
+    calculator_trace { node_id: 1 event_type: READY_FOR_PROCESS start_time: 4 }
+    calculator_trace {
+      node_id: 1
+      input_timestamp: 10
+      event_type: PACKET_QUEUED
+      start_time: 3
+      input_trace { finish_time: 3 packet_timestamp: 10 stream_id: 1 event_data: 2 }
+      input_trace { finish_time: 3 packet_timestamp: 0 stream_id: 1 event_data: 2 }
+    }
+  )pb"));
+  writer.Close();
+
+  EXPECT_THAT(
+      Events(output.str()),
+      ElementsAre(
+          R"({"name":"Sink\"1","cat":"PROCESS","ph":"X","ts":1005,"tid":2,)"
+          R"("dur":3,"args":{"input_timestamp":60}})",
+          R"({"name":"Sink\"1 READY_FOR_PROCESS","cat":"READY_FOR_PROCESS",)"
+          R"("ph":"i","ts":1004,"tid":0,"s":"t"})",
+          R"({"name":"Sink\"1 queue in","cat":"PACKET_QUEUED","ph":"C",)"
+          R"("ts":1003,"tid":0,"args":{"size":2}})"));
+  EXPECT_THAT(output.str(), HasSubstr("\n]\n"));
+}
+
+TEST(ChromeTraceWriterTest, MatchesStartAndFinishAcrossTraces) {
+  std::ostringstream output;
+  ChromeTraceWriter writer(&output);
+  // Traced with trace_log_instant_events: a start for each input packet and a
+  // finish for each output packet.
+  writer.WriteTrace(ParseTextProtoOrDie<GraphTrace>(R"pb(
+    base_time: 1000
+    calculator_name: [ "A", "B" ]
+    calculator_trace { node_id: 0 input_timestamp: 1 event_type: PROCESS start_time: 2 }
+    calculator_trace { node_id: 0 input_timestamp: 1 event_type: PROCESS start_time: 2 }
+    calculator_trace { node_id: 1 input_timestamp: 1 event_type: PROCESS start_time: 3 }
+  )pb"));
+  EXPECT_THAT(Events(output.str()), ElementsAre());
+
+  writer.WriteTrace(ParseTextProtoOrDie<GraphTrace>(R"pb(
+    base_time: 1000
+    calculator_trace { node_id: 0 input_timestamp: 1 event_type: PROCESS finish_time: 9 }
+    calculator_trace { node_id: 0 input_timestamp: 1 event_type: PROCESS finish_time: 9 }
+    calculator_trace { node_id: 0 input_timestamp: 2 event_type: PROCESS finish_time: 12 }
+  )pb"));
+  // Node B never finishes, e.g. because it has no outputs. It is written as
+  // an instant event once a full trace has passed.
+  EXPECT_THAT(
+      Events(output.str()),
+      ElementsAre(R"({"name":"A","cat":"PROCESS","ph":"X","ts":1002,"tid":0,)"
+                  R"("dur":7,"args":{"input_timestamp":1}})",
+                  R"({"name":"A","cat":"PROCESS","ph":"i","ts":1012,"tid":0,)"
+                  R"("s":"t","args":{"input_timestamp":2}})",
+                  R"({"name":"B","cat":"PROCESS","ph":"i","ts":1003,"tid":0,)"
+                  R"("s":"t","args":{"input_timestamp":1}})"));
+}
+
+TEST(ChromeTraceWriterTest, WritesCounters) {
+  std::ostringstream output;
+  ChromeTraceWriter writer(&output);
+  writer.WriteTrace(ParseTextProtoOrDie<GraphTrace>(R"pb(
+    base_time: 1000
+    calculator_name: [ "Tracker" ]
+    stream_name: [ "", "box_count" ]
+    calculator_trace {
+      node_id: 0
+      event_type: COUNTER
+      start_time: 7
+      input_trace { stream_id: 1 event_data: 12 }
+    }
+  )pb"));
+  EXPECT_THAT(Events(output.str()),
+              ElementsAre(R"({"name":"Tracker box_count","cat":"COUNTER",)"
+                          R"("ph":"C","ts":1007,"tid":0,"args":{"value":12}})"));
+}
+
+TEST(ChromeTraceWriterTest, WritesEmptyArray) {
+  std::ostringstream output;
+  { ChromeTraceWriter writer(&output); }
+  EXPECT_EQ("[]\n", output.str());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -28,6 +28,7 @@
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/profiler/profiler_resource_util.h"
+#include "mediapipe/framework/profiler/time_histogram_util.h"
 #include "mediapipe/framework/tool/name_util.h"
 #include "mediapipe/framework/tool/tag_map.h"
 #include "mediapipe/framework/tool/validate_name.h"
@@ -188,6 +189,11 @@ void GraphProfiler::Initialize(
                              &profile);
     }
 
+    if (profiler_config_.histogram_precision_bits() > 0) {
+      InitializeLogBuckets(profiler_config_.histogram_precision_bits(),
+                           &profile);
+    }
+
     auto iter = calculator_profiles_.insert({node_name, profile});
     CHECK(iter.second) << absl::Substitute(
         "Calculator \"$0\" has already been added.", node_name);
@@ -338,6 +344,25 @@ void GraphProfiler::InitializeTimeHistogram(int64 interval_size_usec,
   ResetTimeHistogram(histogram);
 }
 
+void GraphProfiler::InitializeLogBuckets(
+    int precision_bits, CalculatorProfile* calculator_profile) {
+  mediapipe::InitializeLogBuckets(precision_bits,
+                                  calculator_profile->mutable_process_runtime());
+  if (calculator_profile->has_process_input_latency()) {
+    mediapipe::InitializeLogBuckets(
+        precision_bits, calculator_profile->mutable_process_input_latency());
+  }
+  if (calculator_profile->has_process_output_latency()) {
+    mediapipe::InitializeLogBuckets(
+        precision_bits, calculator_profile->mutable_process_output_latency());
+  }
+  for (auto& input_stream_profile :
+       *calculator_profile->mutable_input_stream_profiles()) {
+    mediapipe::InitializeLogBuckets(precision_bits,
+                                    input_stream_profile.mutable_latency());
+  }
+}
+
 void GraphProfiler::InitializeOutputStreams(
     const CalculatorGraphConfig::Node& node_config) {}
 
@@ -389,6 +414,9 @@ void GraphProfiler::ResetTimeHistogram(TimeHistogram* histogram) {
   for (auto& count : *(histogram->mutable_count())) {
     count = 0;
   }
+  for (auto& count : *(histogram->mutable_log_count())) {
+    count = 0;
+  }
 }
 
 void GraphProfiler::AddPacketInfoInternal(const PacketId& packet_id,
@@ -476,13 +504,7 @@ void GraphProfiler::AddTimeSample(int64 start_time_usec, int64 end_time_usec,
     return;
   }
 
-  int64 time_usec = end_time_usec - start_time_usec;
-  histogram->set_total(histogram->total() + time_usec);
-  int64 interval_index = time_usec / histogram->interval_size_usec();
-  if (interval_index > histogram->num_intervals() - 1) {
-    interval_index = histogram->num_intervals() - 1;
-  }
-  histogram->set_count(interval_index, histogram->count(interval_index) + 1);
+  AddTimeHistogramSample(end_time_usec - start_time_usec, histogram);
 }
 
 int64 GraphProfiler::AddInputStreamTimeSamples(
@@ -617,6 +639,12 @@ void CleanTimeHistogram(TimeHistogram* histogram) {
   if (histogram->interval_size_usec() == 1000000) {
     histogram->clear_interval_size_usec();
   }
+  auto* log_count = histogram->mutable_log_count();
+  int log_count_size = log_count->size();
+  while (log_count_size > 0 && log_count->Get(log_count_size - 1) == 0) {
+    --log_count_size;
+  }
+  log_count->Truncate(log_count_size);
 }
 
 // Clears fields containing their default values.
@@ -677,6 +705,33 @@ absl::Status GraphProfiler::CaptureProfile(GraphProfile* result) {
   return status;
 }
 
+absl::Status GraphProfiler::WriteChromeTrace(const GraphTrace& trace) {
+  const std::string& path = profiler_config_.chrome_trace_path();
+  if (path.empty()) {
+    return absl::OkStatus();
+  }
+  absl::MutexLock lock(&chrome_trace_mutex_);
+  if (!chrome_trace_writer_) {
+    chrome_trace_file_ = absl::make_unique<std::ofstream>(
+        path, std::ofstream::out | std::ofstream::trunc);
+    RET_CHECK(chrome_trace_file_->is_open())
+        << "Could not open chrome_trace_path: " << path;
+    chrome_trace_writer_ =
+        absl::make_unique<ChromeTraceWriter>(chrome_trace_file_.get());
+    std::vector<std::string> names;
+    for (int node_id = 0; node_id < validated_graph_->CalculatorInfos().size();
+         ++node_id) {
+      names.push_back(
+          tool::CanonicalNodeName(validated_graph_->Config(), node_id));
+    }
+    chrome_trace_writer_->SetCalculatorNames(std::move(names));
+  }
+  chrome_trace_writer_->WriteTrace(trace);
+  RET_CHECK(*chrome_trace_file_)
+      << "Could not write Chrome trace events to: " << path;
+  return absl::OkStatus();
+}
+
 absl::Status GraphProfiler::WriteProfile() {
   if (profiler_config_.trace_log_disabled()) {
     // Logging is disabled, so we can exit writing without error.
@@ -693,6 +748,7 @@ absl::Status GraphProfiler::WriteProfile() {
   if (is_tracing_ && trace.calculator_trace().empty()) {
     return absl::OkStatus();
   }
+  MP_RETURN_IF_ERROR(WriteChromeTrace(trace));
 
   // Record the CalculatorGraphConfig, once per log file.
   ++previous_log_index_;
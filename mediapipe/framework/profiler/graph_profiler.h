@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <cstddef>
+#include <fstream>
 #include <memory>
 #include <set>
 #include <string>
@@ -30,6 +31,7 @@
 #include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/profiler/chrome_trace_writer.h"
 #include "mediapipe/framework/profiler/graph_tracer.h"
 #include "mediapipe/framework/profiler/sharded_map.h"
 #include "mediapipe/framework/validated_graph_config.h"
@@ -139,7 +141,9 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
 
   // Collects the runtime profile for Open(), Process(), and Close() of each
   // calculator in the graph. May be called at any time after the graph has been
-  // initialized.
+  // initialized. If histogram_precision_bits is set in the ProfilerConfig,
+  // percentiles of the histograms can be queried with TimeHistogramPercentile,
+  // and profiles can be combined with MergeTimeHistogram.
   absl::Status GetCalculatorProfiles(std::vector<CalculatorProfile>*) const
       ABSL_LOCKS_EXCLUDED(profiler_mutex_);
 
@@ -235,6 +239,9 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
                                       int64 num_intervals,
                                       TimeHistogram* histogram);
   static void ResetTimeHistogram(TimeHistogram* histogram);
+  // Enables the log-linear buckets of all histograms in a calculator profile.
+  static void InitializeLogBuckets(int precision_bits,
+                                   CalculatorProfile* calculator_profile);
   // Add a sample to a time histogram.
   static void AddTimeSample(int64 start_time_usec, int64 end_time_usec,
                             TimeHistogram* histogram);
@@ -292,6 +299,9 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // trace_log_path.
   absl::StatusOr<std::string> GetTraceLogPath();
 
+  // Appends the events of a GraphTrace to the chrome_trace_path, if set.
+  absl::Status WriteChromeTrace(const GraphTrace& trace);
+
   // Helper method to get the clock time in microsecond.
   int64 TimeNowUsec() { return ToUnixMicros(clock_->TimeNow()); }
 
@@ -338,6 +348,13 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // The configuration for the graph being profiled.
   const ValidatedGraphConfig* validated_graph_;
 
+  // The output file for chrome_trace_path and its writer.
+  absl::Mutex chrome_trace_mutex_;
+  std::unique_ptr<std::ofstream> chrome_trace_file_
+      ABSL_GUARDED_BY(chrome_trace_mutex_);
+  std::unique_ptr<ChromeTraceWriter> chrome_trace_writer_
+      ABSL_GUARDED_BY(chrome_trace_mutex_);
+
   // A private resource for creating GraphProfiles.
   class GraphProfileBuilder;
   std::unique_ptr<GraphProfileBuilder> profile_builder_;
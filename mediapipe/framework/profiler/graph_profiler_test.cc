@@ -25,6 +25,7 @@
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/framework/port/statusor.h"
 #include "mediapipe/framework/profiler/test_context_builder.h"
+#include "mediapipe/framework/profiler/time_histogram_util.h"
 #include "mediapipe/framework/tool/simulation_clock.h"
 #include "mediapipe/framework/tool/tag_map_helper.h"
 
@@ -1132,6 +1133,53 @@ TEST_F(GraphProfilerTestPeer, AddProcessSampleWithStreamLatency) {
   ASSERT_NE(GetPacketInfo(GetPacketsInfoMap(), {"stream_1", 100}), nullptr);
 }
 
+// Tests that histogram_precision_bits enables the log-linear buckets of all
+// histograms, and that Reset() clears them.
+TEST_F(GraphProfilerTestPeer, AddProcessSampleWithLogBuckets) {
+  InitializeProfilerWithGraphConfig(R"(
+    profiler_config {
+      enable_profiler: true
+      enable_stream_latency: true
+      histogram_precision_bits: 4
+    }
+    input_stream: "input_stream"
+    node {
+      calculator: "DummyTestCalculator"
+      input_stream: "input_stream"
+      output_stream: "output_stream"
+    })");
+  std::shared_ptr<mediapipe::SimulationClock> simulation_clock(
+      new SimulationClock());
+  simulation_clock->ThreadStart();
+  profiler_.SetClock(simulation_clock);
+
+  TestContextBuilder context(kDummyTestCalculatorName, /*node_id=*/0,
+                             {"input_stream"}, {"output_stream"});
+  context.AddInputs({MakePacket<std::string>("5").At(Timestamp(100))});
+  for (int64 runtime_usec : {3, 150, 2000000}) {
+    GraphProfiler::Scope profiler_scope(GraphTrace::PROCESS, context.get(),
+                                        &profiler_);
+    simulation_clock->Sleep(absl::Microseconds(runtime_usec));
+  }
+
+  CalculatorProfile profile = Profiles()[0];
+  const TimeHistogram& runtime = profile.process_runtime();
+  EXPECT_EQ(runtime.log_precision_bits(), 4);
+  EXPECT_EQ(runtime.log_count_size(), NumLogBuckets(4));
+  EXPECT_EQ(TimeHistogramCount(runtime), 3);
+  EXPECT_THAT(TimeHistogramPercentile(runtime, 0), IsOkAndHolds(3));
+  // 150 usec is in the bucket [144, 159].
+  EXPECT_THAT(TimeHistogramPercentile(runtime, 50), IsOkAndHolds(159));
+  EXPECT_EQ(profile.process_input_latency().log_precision_bits(), 4);
+  EXPECT_EQ(profile.input_stream_profiles(0).latency().log_precision_bits(), 4);
+
+  profiler_.Reset();
+  profile = Profiles()[0];
+  EXPECT_EQ(profile.process_runtime().log_count_size(), NumLogBuckets(4));
+  EXPECT_EQ(TimeHistogramCount(profile.process_runtime()), 0);
+  simulation_clock->ThreadFinish();
+}
+
 // This test shows that CalculatorGraph::GetCalculatorProfiles and
 // GraphProfiler::AddProcessSample() can be called in parallel.
 // Without the GraphProfiler::profiler_mutex_ this test should
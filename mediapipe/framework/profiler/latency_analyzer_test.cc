@@ -0,0 +1,259 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/reporter/latency_analyzer.h"
+
+#include <sstream>
+#include <vector>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+
+namespace mediapipe {
+namespace {
+
+using reporter::LatencyAnalyzer;
+using reporter::NodeLatency;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Nodes "A" and "C" both read the graph input stream "in", and node "B" reads
+// their outputs. Timestamp 0 is traced with the default trace format, and
+// timestamp 100 with trace_log_instant_events and no input events.
+GraphProfile TestProfile() {
+  return ParseTextProtoOrDie<GraphProfile>(R"pb(
+    graph_trace {
+      base_time: 1000
+      base_timestamp: 0
+      stream_name: [ "", "in", "a_out", "c_out" ]
+      calculator_name: [ "A", "B", "C" ]
+      calculator_trace {
+        node_id: 0
+        input_timestamp: 0
+        event_type: PACKET_QUEUED
+        start_time: 0
+        input_trace { finish_time: 0 packet_timestamp: 0 stream_id: 1 }
+      }
+      calculator_trace {
+        node_id: 2
+        input_timestamp: 0
+        event_type: PACKET_QUEUED
+        start_time: 0
+        input_trace { finish_time: 0 packet_timestamp: 0 stream_id: 1 }
+      }
+      calculator_trace { node_id: 0 event_type: READY_FOR_PROCESS start_time: 1 }
+      calculator_trace { node_id: 2 event_type: READY_FOR_PROCESS start_time: 2 }
+      calculator_trace {
+        node_id: 2
+        input_timestamp: 0
+        event_type: PROCESS
+        start_time: 3
+        finish_time: 30
+        input_trace { finish_time: 3 packet_timestamp: 0 stream_id: 1 }
+        output_trace { packet_timestamp: 0 stream_id: 3 }
+      }
+      calculator_trace {
+        node_id: 0
+        input_timestamp: 0
+        event_type: PROCESS
+        start_time: 5
+        finish_time: 15
+        input_trace { finish_time: 5 packet_timestamp: 0 stream_id: 1 }
+        output_trace { packet_timestamp: 0 stream_id: 2 }
+      }
+      calculator_trace {
+        node_id: 1
+        input_timestamp: 0
+        event_type: PACKET_QUEUED
+        start_time: 15
+        input_trace {
+          start_time: 15
+          finish_time: 15
+          packet_timestamp: 0
+          stream_id: 2
+        }
+      }
+      calculator_trace {
+        node_id: 1
+        input_timestamp: 0
+        event_type: PACKET_QUEUED
+        start_time: 30
+        input_trace {
+          start_time: 30
+          finish_time: 30
+          packet_timestamp: 0
+          stream_id: 3
+        }
+      }
+      calculator_trace { node_id: 1 event_type: READY_FOR_PROCESS start_time: 31 }
+      calculator_trace {
+        node_id: 1
+        input_timestamp: 0
+        event_type: PROCESS
+        start_time: 40
+        finish_time: 50
+        input_trace {
+          start_time: 15
+          finish_time: 40
+          packet_timestamp: 0
+          stream_id: 2
+        }
+        input_trace {
+          start_time: 30
+          finish_time: 40
+          packet_timestamp: 0
+          stream_id: 3
+        }
+      }
+    }
+    graph_trace {
+      base_time: 1000
+      base_timestamp: 0
+      calculator_trace {
+        node_id: 0
+        input_timestamp: 100
+        event_type: PROCESS
+        start_time: 60
+        input_trace { packet_timestamp: 100 stream_id: 1 }
+      }
+      calculator_trace {
+        node_id: 2
+        input_timestamp: 100
+        event_type: PROCESS
+        start_time: 61
+        input_trace { packet_timestamp: 100 stream_id: 1 }
+      }
+      calculator_trace {
+        node_id: 0
+        input_timestamp: 100
+        event_type: PROCESS
+        finish_time: 65
+        output_trace { packet_timestamp: 100 stream_id: 2 }
+      }
+      calculator_trace {
+        node_id: 2
+        input_timestamp: 100
+        event_type: PROCESS
+        finish_time: 70
+        output_trace { packet_timestamp: 100 stream_id: 3 }
+      }
+      calculator_trace {
+        node_id: 1
+        input_timestamp: 100
+        event_type: PROCESS
+        start_time: 80
+        input_trace { packet_timestamp: 100 stream_id: 2 }
+        input_trace { packet_timestamp: 100 stream_id: 3 }
+      }
+      calculator_trace {
+        node_id: 1
+        input_timestamp: 100
+        event_type: PROCESS
+        finish_time: 85
+      }
+    }
+  )pb");
+}
+
+std::vector<std::string> CriticalPath(const LatencyAnalyzer& analyzer,
+                                      int timestamp_index) {
+  std::vector<std::string> result;
+  for (int i : analyzer.timestamps()[timestamp_index].critical_path) {
+    result.push_back(analyzer.NodeName(analyzer.nodes()[i].node_id));
+  }
+  return result;
+}
+
+TEST(LatencyAnalyzerTest, SplitsLatencyIntoStages) {
+  LatencyAnalyzer analyzer;
+  analyzer.Accumulate(TestProfile());
+  analyzer.Analyze();
+
+  ASSERT_EQ(6, analyzer.nodes().size());
+  // Nodes are ordered by start time: C, A, B at timestamp 0.
+  const NodeLatency& c = analyzer.nodes()[0];
+  EXPECT_EQ(2, c.node_id);
+  EXPECT_EQ(1000, c.arrival_time);
+  EXPECT_EQ(2, c.queue_time());
+  EXPECT_EQ(1, c.wait_time());
+  EXPECT_EQ(27, c.compute_time());
+  const NodeLatency& b = analyzer.nodes()[2];
+  EXPECT_EQ(1, b.node_id);
+  EXPECT_EQ(1030, b.arrival_time);
+  EXPECT_EQ(1, b.queue_time());
+  EXPECT_EQ(9, b.wait_time());
+  EXPECT_EQ(10, b.compute_time());
+  EXPECT_EQ(0, b.critical_input);
+}
+
+TEST(LatencyAnalyzerTest, FindsCriticalPaths) {
+  LatencyAnalyzer analyzer;
+  analyzer.Accumulate(TestProfile());
+  analyzer.Analyze();
+
+  ASSERT_EQ(2, analyzer.timestamps().size());
+  EXPECT_EQ(0, analyzer.timestamps()[0].input_timestamp);
+  EXPECT_EQ(50, analyzer.timestamps()[0].latency());
+  EXPECT_THAT(CriticalPath(analyzer, 0), ElementsAre("C", "B"));
+
+  // Without input events, inputs arrive when their producers finish.
+  EXPECT_EQ(100, analyzer.timestamps()[1].input_timestamp);
+  EXPECT_EQ(25, analyzer.timestamps()[1].latency());
+  EXPECT_THAT(CriticalPath(analyzer, 1), ElementsAre("C", "B"));
+  const NodeLatency& b = analyzer.nodes().back();
+  EXPECT_EQ(1070, b.arrival_time);
+  EXPECT_EQ(0, b.queue_time());
+  EXPECT_EQ(10, b.wait_time());
+  EXPECT_EQ(5, b.compute_time());
+
+  const auto& stages = analyzer.stages();
+  ASSERT_EQ(3, stages.size());
+  EXPECT_EQ("A", stages.at(0).name);
+  EXPECT_EQ(2, stages.at(0).count);
+  EXPECT_EQ(0, stages.at(0).critical_count);
+  EXPECT_EQ(2, stages.at(1).critical_count);
+  EXPECT_EQ(27, stages.at(2).compute.p99);
+  EXPECT_EQ(9, stages.at(2).compute.p50);
+}
+
+TEST(LatencyAnalyzerTest, PrintsSlowestTimestamps) {
+  LatencyAnalyzer analyzer;
+  analyzer.Accumulate(TestProfile());
+  analyzer.Analyze();
+
+  std::ostringstream output;
+  analyzer.Print(output, 1);
+  EXPECT_THAT(output.str(), HasSubstr("input timestamps: 2"));
+  EXPECT_THAT(output.str(), HasSubstr("latency: p50 25 us, p99 50 us"));
+  EXPECT_THAT(output.str(), HasSubstr("timestamp 0: latency 50 us"));
+  EXPECT_THAT(output.str(), ::testing::Not(HasSubstr("timestamp 100:")));
+}
+
+TEST(LatencyAnalyzerTest, ComputesNearestRankPercentiles) {
+  std::vector<int64_t> durations;
+  for (int i = 100; i >= 1; --i) {
+    durations.push_back(i);
+  }
+  reporter::LatencyPercentiles percentiles =
+      reporter::ComputePercentiles(durations);
+  EXPECT_EQ(50, percentiles.p50);
+  EXPECT_EQ(99, percentiles.p99);
+  EXPECT_EQ(100, percentiles.max);
+  EXPECT_EQ(0, reporter::ComputePercentiles({}).max);
+}
+
+}  // namespace
+}  // namespace mediapipe
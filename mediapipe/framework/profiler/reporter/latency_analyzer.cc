@@ -0,0 +1,406 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/reporter/latency_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+namespace mediapipe {
+namespace reporter {
+namespace {
+
+using PacketKey = std::pair<int64_t, int32_t>;
+using TaskKey = std::pair<int, int64_t>;
+
+std::string ToString(int64_t value) { return absl::StrCat(value); }
+
+std::string ToPercent(double part, double total) {
+  return absl::StrFormat("%1.1f%%", total == 0 ? 0.0 : 100 * part / total);
+}
+
+// Prints rows of values with each column padded to its widest value.
+void PrintTable(const std::vector<std::vector<std::string>>& rows,
+                const std::string& indent, std::ostream& output) {
+  std::vector<size_t> widths;
+  for (const auto& row : rows) {
+    widths.resize(std::max(widths.size(), row.size()));
+    for (size_t i = 0; i < row.size(); ++i) {
+      widths[i] = std::max(widths[i], row[i].length());
+    }
+  }
+  for (const auto& row : rows) {
+    output << indent;
+    for (size_t i = 0; i < row.size(); ++i) {
+      std::string value = row[i];
+      if (i + 1 < row.size()) {
+        value.append(widths[i] + 1 - value.length(), ' ');
+      }
+      output << value;
+    }
+    output << std::endl;
+  }
+}
+
+}  // namespace
+
+LatencyPercentiles ComputePercentiles(std::vector<int64_t> durations) {
+  LatencyPercentiles result;
+  if (durations.empty()) {
+    return result;
+  }
+  std::sort(durations.begin(), durations.end());
+  auto percentile = [&durations](double p) {
+    int rank = static_cast<int>(std::ceil(p * durations.size()));
+    return durations[std::max(rank, 1) - 1];
+  };
+  result.p50 = percentile(0.5);
+  result.p99 = percentile(0.99);
+  result.max = durations.back();
+  return result;
+}
+
+void LatencyAnalyzer::Accumulate(const mediapipe::GraphProfile& profile) {
+  for (const auto& graph_trace : profile.graph_trace()) {
+    for (int i = 0; i < graph_trace.calculator_name_size(); ++i) {
+      node_names_[i] = graph_trace.calculator_name(i);
+    }
+    const int64_t base_time = graph_trace.base_time();
+    const int64_t base_timestamp = graph_trace.base_timestamp();
+    for (const auto& calc_trace : graph_trace.calculator_trace()) {
+      switch (calc_trace.event_type()) {
+        case GraphTrace::PROCESS:
+          AccumulateProcess(base_time, base_timestamp, calc_trace);
+          break;
+        case GraphTrace::READY_FOR_PROCESS:
+          if (calc_trace.has_start_time()) {
+            ready_times_[calc_trace.node_id()].push_back(
+                base_time + calc_trace.start_time());
+          }
+          break;
+        case GraphTrace::PACKET_QUEUED:
+          AccumulatePacketQueued(base_time, base_timestamp, calc_trace);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+void LatencyAnalyzer::AccumulateProcess(
+    int64_t base_time, int64_t base_timestamp,
+    const GraphTrace::CalculatorTrace& trace) {
+  // Traces written with trace_log_instant_events hold the start and the
+  // finish of a PROCESS call in separate CalculatorTraces.
+  Task& task = tasks_[{trace.node_id(),
+                       base_timestamp + trace.input_timestamp()}];
+  if (trace.has_start_time()) {
+    const int64_t start_time = base_time + trace.start_time();
+    task.start_time = task.start_time < 0
+                          ? start_time
+                          : std::min(task.start_time, start_time);
+  }
+  if (trace.has_finish_time()) {
+    const int64_t finish_time = base_time + trace.finish_time();
+    task.finish_time = task.finish_time < 0
+                           ? finish_time
+                           : std::min(task.finish_time, finish_time);
+  }
+  for (const auto& stream_trace : trace.input_trace()) {
+    task.inputs.emplace_back(base_timestamp + stream_trace.packet_timestamp(),
+                             stream_trace.stream_id());
+    // The start_time of an input is the finish_time of the PROCESS call that
+    // output the packet.
+    task.input_times.push_back(stream_trace.has_start_time()
+                                   ? base_time + stream_trace.start_time()
+                                   : -1);
+  }
+  for (const auto& stream_trace : trace.output_trace()) {
+    task.outputs.emplace_back(base_timestamp + stream_trace.packet_timestamp(),
+                              stream_trace.stream_id());
+  }
+}
+
+void LatencyAnalyzer::AccumulatePacketQueued(
+    int64_t base_time, int64_t base_timestamp,
+    const GraphTrace::CalculatorTrace& trace) {
+  const int64_t input_timestamp = base_timestamp + trace.input_timestamp();
+  for (const auto& stream_trace : trace.input_trace()) {
+    const int64_t packet_timestamp =
+        base_timestamp + stream_trace.packet_timestamp();
+    // PACKET_QUEUED is also logged for the head of the queue. Only the packet
+    // that was added, at the input_timestamp, arrived at this time.
+    if (packet_timestamp != input_timestamp) {
+      continue;
+    }
+    int64_t time = stream_trace.has_finish_time() ? stream_trace.finish_time()
+                                                  : trace.start_time();
+    time += base_time;
+    auto key = std::make_pair(trace.node_id(),
+                              std::make_pair(stream_trace.stream_id(),
+                                             packet_timestamp));
+    auto it = queued_times_.find(key);
+    if (it == queued_times_.end()) {
+      queued_times_[key] = time;
+    } else {
+      it->second = std::min(it->second, time);
+    }
+  }
+}
+
+void LatencyAnalyzer::Analyze() {
+  nodes_.clear();
+  timestamps_.clear();
+  stages_.clear();
+
+  std::map<PacketKey, TaskKey> producers;
+  for (const auto& entry : tasks_) {
+    for (const PacketKey& output : entry.second.outputs) {
+      producers[output] = entry.first;
+    }
+  }
+
+  // Find the arrival time of the last input of each complete PROCESS call.
+  std::vector<TaskKey> keys;
+  std::vector<TaskKey> critical_inputs;
+  for (const auto& entry : tasks_) {
+    const Task& task = entry.second;
+    if (task.start_time < 0 || task.finish_time < 0) {
+      continue;
+    }
+    NodeLatency node;
+    node.node_id = entry.first.first;
+    node.input_timestamp = entry.first.second;
+    node.start_time = task.start_time;
+    node.finish_time = task.finish_time;
+    node.arrival_time = -1;
+    TaskKey critical_input(-1, 0);
+    for (size_t i = 0; i < task.inputs.size(); ++i) {
+      const PacketKey& input = task.inputs[i];
+      auto producer = producers.find(input);
+      int64_t time = task.input_times[i];
+      auto queued = queued_times_.find(
+          {node.node_id, {input.second, input.first}});
+      if (queued != queued_times_.end()) {
+        time = queued->second;
+      } else if (producer != producers.end() &&
+                 tasks_.at(producer->second).finish_time >= 0) {
+        time = tasks_.at(producer->second).finish_time;
+      }
+      if (time < 0 || time <= node.arrival_time) {
+        continue;
+      }
+      node.arrival_time = time;
+      critical_input = producer != producers.end() ? producer->second
+                                                   : TaskKey(-1, 0);
+    }
+    if (node.arrival_time < 0 || node.arrival_time > node.start_time) {
+      node.arrival_time = node.start_time;
+    }
+    node.ready_time = node.arrival_time;
+    nodes_.push_back(node);
+    keys.push_back(entry.first);
+    critical_inputs.push_back(critical_input);
+  }
+
+  // Order the calls by start time, and link them to their critical inputs.
+  std::vector<int> order(nodes_.size());
+  for (int i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+    return nodes_[a].start_time < nodes_[b].start_time;
+  });
+  std::vector<NodeLatency> sorted_nodes;
+  std::map<TaskKey, int> indices;
+  for (int i : order) {
+    indices[keys[i]] = sorted_nodes.size();
+    sorted_nodes.push_back(nodes_[i]);
+  }
+  for (int i = 0; i < order.size(); ++i) {
+    const TaskKey& input = critical_inputs[order[i]];
+    auto it = indices.find(input);
+    if (it != indices.end() &&
+        input.second == sorted_nodes[i].input_timestamp) {
+      sorted_nodes[i].critical_input = it->second;
+    }
+  }
+  nodes_.swap(sorted_nodes);
+
+  // READY_FOR_PROCESS events carry no timestamp. Each one is matched to the
+  // next PROCESS call of the node, skipping those for calls that started
+  // before the trace.
+  std::map<int, size_t> next_ready;
+  for (NodeLatency& node : nodes_) {
+    auto it = ready_times_.find(node.node_id);
+    if (it == ready_times_.end()) {
+      continue;
+    }
+    std::vector<int64_t>& ready_times = it->second;
+    size_t& next = next_ready[node.node_id];
+    if (next == 0) {
+      std::sort(ready_times.begin(), ready_times.end());
+    }
+    while (next < ready_times.size() &&
+           ready_times[next] < node.arrival_time) {
+      ++next;
+    }
+    if (next < ready_times.size() && ready_times[next] <= node.start_time) {
+      node.ready_time = ready_times[next];
+      ++next;
+    }
+  }
+
+  ComputeTimestamps();
+  ComputeStages();
+}
+
+void LatencyAnalyzer::ComputeTimestamps() {
+  std::map<int64_t, std::vector<int>> nodes_by_timestamp;
+  for (int i = 0; i < nodes_.size(); ++i) {
+    nodes_by_timestamp[nodes_[i].input_timestamp].push_back(i);
+  }
+  for (const auto& entry : nodes_by_timestamp) {
+    TimestampLatency timestamp;
+    timestamp.input_timestamp = entry.first;
+    timestamp.start_time = nodes_[entry.second.front()].arrival_time;
+    int last = entry.second.front();
+    for (int i : entry.second) {
+      timestamp.start_time =
+          std::min(timestamp.start_time, nodes_[i].arrival_time);
+      if (nodes_[i].finish_time >= nodes_[last].finish_time) {
+        last = i;
+      }
+    }
+    timestamp.finish_time = nodes_[last].finish_time;
+
+    // Walk back from the last call to finish. Links point to calls with
+    // earlier finish times, but loops are guarded against anyway.
+    std::set<int> visited;
+    for (int i = last; i >= 0 && visited.insert(i).second;
+         i = nodes_[i].critical_input) {
+      timestamp.critical_path.push_back(i);
+    }
+    std::reverse(timestamp.critical_path.begin(),
+                 timestamp.critical_path.end());
+    timestamps_.push_back(std::move(timestamp));
+  }
+}
+
+void LatencyAnalyzer::ComputeStages() {
+  struct Samples {
+    std::vector<int64_t> queue;
+    std::vector<int64_t> wait;
+    std::vector<int64_t> compute;
+    std::vector<int64_t> latency;
+  };
+  std::map<int, Samples> samples;
+  for (const NodeLatency& node : nodes_) {
+    Samples& node_samples = samples[node.node_id];
+    node_samples.queue.push_back(node.queue_time());
+    node_samples.wait.push_back(node.wait_time());
+    node_samples.compute.push_back(node.compute_time());
+    node_samples.latency.push_back(node.latency());
+  }
+  for (auto& entry : samples) {
+    StageLatency& stage = stages_[entry.first];
+    stage.name = NodeName(entry.first);
+    stage.count = entry.second.latency.size();
+    stage.queue = ComputePercentiles(std::move(entry.second.queue));
+    stage.wait = ComputePercentiles(std::move(entry.second.wait));
+    stage.compute = ComputePercentiles(std::move(entry.second.compute));
+    stage.latency = ComputePercentiles(std::move(entry.second.latency));
+  }
+
+  std::vector<int64_t> latencies;
+  for (const TimestampLatency& timestamp : timestamps_) {
+    latencies.push_back(timestamp.latency());
+    for (int i : timestamp.critical_path) {
+      ++stages_[nodes_[i].node_id].critical_count;
+    }
+  }
+  graph_latency_ = ComputePercentiles(std::move(latencies));
+}
+
+std::string LatencyAnalyzer::NodeName(int node_id) const {
+  auto it = node_names_.find(node_id);
+  return it != node_names_.end() ? it->second : absl::StrCat("node_", node_id);
+}
+
+void LatencyAnalyzer::Print(std::ostream& output, int num_slowest) const {
+  output << "input timestamps: " << timestamps_.size() << std::endl;
+  output << "latency: p50 " << graph_latency_.p50 << " us, p99 "
+         << graph_latency_.p99 << " us, max " << graph_latency_.max << " us"
+         << std::endl;
+
+  // The share of the critical paths spent in each stage.
+  double queue = 0, wait = 0, compute = 0;
+  for (const TimestampLatency& timestamp : timestamps_) {
+    for (int i : timestamp.critical_path) {
+      queue += nodes_[i].queue_time();
+      wait += nodes_[i].wait_time();
+      compute += nodes_[i].compute_time();
+    }
+  }
+  const double total = queue + wait + compute;
+  output << "critical path: queue " << ToPercent(queue, total) << ", wait "
+         << ToPercent(wait, total) << ", compute "
+         << ToPercent(compute, total) << std::endl
+         << std::endl;
+
+  std::vector<std::vector<std::string>> rows = {
+      {"calculator", "count", "critical", "queue_p50", "queue_p99", "wait_p50",
+       "wait_p99", "compute_p50", "compute_p99", "latency_p50",
+       "latency_p99"}};
+  for (const auto& entry : stages_) {
+    const StageLatency& stage = entry.second;
+    rows.push_back({stage.name, ToString(stage.count),
+                    ToString(stage.critical_count), ToString(stage.queue.p50),
+                    ToString(stage.queue.p99), ToString(stage.wait.p50),
+                    ToString(stage.wait.p99), ToString(stage.compute.p50),
+                    ToString(stage.compute.p99), ToString(stage.latency.p50),
+                    ToString(stage.latency.p99)});
+  }
+  PrintTable(rows, "", output);
+
+  std::vector<const TimestampLatency*> slowest;
+  for (const TimestampLatency& timestamp : timestamps_) {
+    slowest.push_back(&timestamp);
+  }
+  num_slowest = std::min<int>(std::max(num_slowest, 0), slowest.size());
+  std::partial_sort(slowest.begin(), slowest.begin() + num_slowest,
+                    slowest.end(),
+                    [](const TimestampLatency* a, const TimestampLatency* b) {
+                      return a->latency() > b->latency();
+                    });
+  for (int i = 0; i < num_slowest; ++i) {
+    output << std::endl
+           << "timestamp " << slowest[i]->input_timestamp << ": latency "
+           << slowest[i]->latency() << " us" << std::endl;
+    rows = {{"calculator", "queue", "wait", "compute"}};
+    for (int node : slowest[i]->critical_path) {
+      rows.push_back({NodeName(nodes_[node].node_id),
+                      ToString(nodes_[node].queue_time()),
+                      ToString(nodes_[node].wait_time()),
+                      ToString(nodes_[node].compute_time())});
+    }
+    PrintTable(rows, "  ", output);
+  }
+}
+
+}  // namespace reporter
+}  // namespace mediapipe
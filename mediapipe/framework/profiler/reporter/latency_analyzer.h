@@ -0,0 +1,175 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_REPORTER_LATENCY_ANALYZER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_REPORTER_LATENCY_ANALYZER_H_
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+
+namespace mediapipe {
+namespace reporter {
+
+// The time one calculator spent on one input timestamp. All times are in
+// microseconds since the epoch.
+struct NodeLatency {
+  int node_id = 0;
+  int64_t input_timestamp = 0;
+
+  // When the last input packet of the node arrived. Equal to start_time for
+  // calculators without inputs.
+  int64_t arrival_time = 0;
+  // When the input stream handler found the node ready for Process. Equal to
+  // arrival_time if no READY_FOR_PROCESS event was traced.
+  int64_t ready_time = 0;
+  // When Process started and finished.
+  int64_t start_time = 0;
+  int64_t finish_time = 0;
+
+  // The time spent waiting for the node to become ready after the inputs
+  // arrived, e.g. behind earlier timestamps or max_in_flight.
+  int64_t queue_time() const { return ready_time - arrival_time; }
+  // The time spent waiting for an executor thread after the node was ready.
+  int64_t wait_time() const { return start_time - ready_time; }
+  // The time spent in Process.
+  int64_t compute_time() const { return finish_time - start_time; }
+  int64_t latency() const { return finish_time - arrival_time; }
+
+  // The index in LatencyAnalyzer::nodes() of the calculator that produced the
+  // last input packet to arrive, if it ran at the same input timestamp.
+  // Otherwise -1.
+  int critical_input = -1;
+};
+
+// The latency of the calculators that ran at one input timestamp.
+struct TimestampLatency {
+  int64_t input_timestamp = 0;
+  // The earliest input arrival and the latest Process finish.
+  int64_t start_time = 0;
+  int64_t finish_time = 0;
+  int64_t latency() const { return finish_time - start_time; }
+
+  // Indices in LatencyAnalyzer::nodes() of the chain of calculators that
+  // determined finish_time, from the first to the last calculator.
+  std::vector<int> critical_path;
+};
+
+// Percentiles of a set of durations, in microseconds.
+struct LatencyPercentiles {
+  int64_t p50 = 0;
+  int64_t p99 = 0;
+  int64_t max = 0;
+};
+
+// Latency statistics for one calculator.
+struct StageLatency {
+  std::string name;
+  // The number of input timestamps the calculator processed, and the number
+  // of them in which it was on the critical path.
+  int count = 0;
+  int critical_count = 0;
+  LatencyPercentiles queue;
+  LatencyPercentiles wait;
+  LatencyPercentiles compute;
+  LatencyPercentiles latency;
+};
+
+// Returns the percentiles of the given durations, using the nearest rank.
+LatencyPercentiles ComputePercentiles(std::vector<int64_t> durations);
+
+// Reconstructs the dependencies between the calculator invocations in
+// GraphTrace logs, to explain where the latency of each input timestamp
+// comes from.
+//
+// For each PROCESS call, the inputs are linked to the calculators that output
+// them, and the time from the arrival of the last input to the end of Process
+// is split into queueing, scheduler wait and compute time, using the
+// PACKET_QUEUED and READY_FOR_PROCESS events when they were traced. For each
+// input timestamp, the critical path is found by walking back from the last
+// calculator to finish through the producers of the last inputs to arrive.
+//
+// Both the traces written by default and those written with
+// trace_log_instant_events are supported. All accumulated profiles should
+// come from the same run of a graph.
+class LatencyAnalyzer {
+ public:
+  // Adds the traces of a given profile.
+  void Accumulate(const mediapipe::GraphProfile& profile);
+
+  // Computes the latencies of the accumulated traces. Invalidates the results
+  // of any previous call.
+  void Analyze();
+
+  // The calculator invocations that both started and finished within the
+  // traces, ordered by start time.
+  const std::vector<NodeLatency>& nodes() const { return nodes_; }
+  // The input timestamps, in increasing order.
+  const std::vector<TimestampLatency>& timestamps() const {
+    return timestamps_;
+  }
+  // Statistics for each calculator, ordered by node id.
+  const std::map<int, StageLatency>& stages() const { return stages_; }
+  // Percentiles of the end-to-end latency of all input timestamps.
+  const LatencyPercentiles& graph_latency() const { return graph_latency_; }
+
+  // Returns the name of a calculator, or its node id if it has no name.
+  std::string NodeName(int node_id) const;
+
+  // Prints the statistics of each calculator, the share of the critical path
+  // spent in each stage, and the critical paths of the num_slowest input
+  // timestamps with the highest latency.
+  void Print(std::ostream& output, int num_slowest) const;
+
+ private:
+  struct Task {
+    int64_t start_time = -1;
+    int64_t finish_time = -1;
+    // The (packet_timestamp, stream_id) of each input and output packet.
+    std::vector<std::pair<int64_t, int32_t>> inputs;
+    std::vector<std::pair<int64_t, int32_t>> outputs;
+    // The arrival times of the inputs, if known from the trace.
+    std::vector<int64_t> input_times;
+  };
+
+  void AccumulateProcess(int64_t base_time, int64_t base_timestamp,
+                         const GraphTrace::CalculatorTrace& trace);
+  void AccumulatePacketQueued(int64_t base_time, int64_t base_timestamp,
+                              const GraphTrace::CalculatorTrace& trace);
+  void ComputeTimestamps();
+  void ComputeStages();
+
+  // PROCESS calls by (node_id, input_timestamp).
+  std::map<std::pair<int, int64_t>, Task> tasks_;
+  // READY_FOR_PROCESS times by node_id.
+  std::map<int, std::vector<int64_t>> ready_times_;
+  // PACKET_QUEUED times by (node_id, stream_id, packet_timestamp).
+  std::map<std::pair<int, std::pair<int32_t, int64_t>>, int64_t> queued_times_;
+  std::map<int, std::string> node_names_;
+
+  std::vector<NodeLatency> nodes_;
+  std::vector<TimestampLatency> timestamps_;
+  std::map<int, StageLatency> stages_;
+  LatencyPercentiles graph_latency_;
+};
+
+}  // namespace reporter
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_REPORTER_LATENCY_ANALYZER_H_
@@ -31,6 +31,14 @@ const LazyRE2 kReplace0toNWildcharRegex = {"\\*"};
 std::string ToStringF(double d) { return absl::StrFormat("%1.2f", d); }
 std::string ToString(double d) { return absl::StrFormat("%1.0f", d); }
 
+// The precision of the histograms used for percentiles, which are within
+// 1/64 of the exact percentiles.
+constexpr int kHistogramPrecisionBits = 7;
+
+std::string ToPercentile(const TimeHistogram& histogram, double percentile) {
+  return ToString(TimeHistogramPercentile(histogram, percentile).value());
+}
+
 absl::btree_map<std::string,
                 std::function<const std::string(const CalculatorData&)>>
     kColumns = {
@@ -76,6 +84,14 @@ absl::btree_map<std::string,
          [](const CalculatorData& d) -> const std::string {
            return ToString(d.time_stat.total());
          }},
+        {"time_p50",
+         [](const CalculatorData& d) -> const std::string {
+           return ToPercentile(d.time_histogram, 50);
+         }},
+        {"time_p99",
+         [](const CalculatorData& d) -> const std::string {
+           return ToPercentile(d.time_histogram, 99);
+         }},
         {"time_percent",
          [](const CalculatorData& d) -> const std::string {
            return ToStringF(d.time_percent);
@@ -84,6 +100,14 @@ absl::btree_map<std::string,
          [](const CalculatorData& d) -> const std::string {
            return ToStringF(d.input_latency_stat.mean());
          }},
+        {"input_latency_p50",
+         [](const CalculatorData& d) -> const std::string {
+           return ToPercentile(d.input_latency_histogram, 50);
+         }},
+        {"input_latency_p99",
+         [](const CalculatorData& d) -> const std::string {
+           return ToPercentile(d.input_latency_histogram, 99);
+         }},
         {"input_latency_stddev",
          [](const CalculatorData& d) -> const std::string {
            return ToStringF(d.input_latency_stat.stddev());
@@ -246,6 +270,12 @@ void Reporter::Accumulate(const mediapipe::GraphProfile& profile) {
       auto& calc_data = calculator_data_[node_name];
 
       calc_data.name = node_name;
+      if (calc_data.time_histogram.log_precision_bits() == 0) {
+        InitializeLogBuckets(kHistogramPrecisionBits,
+                             &calc_data.time_histogram);
+        InitializeLogBuckets(kHistogramPrecisionBits,
+                             &calc_data.input_latency_histogram);
+      }
       calc_data.threads.insert(calc_trace.thread_id());
 
       // If there is a start time, update the domain of the trace time, and
@@ -287,9 +317,12 @@ void Reporter::Accumulate(const mediapipe::GraphProfile& profile) {
           const auto input_latency =
               CalculateInputLatency(output_trace_lookup, profile, calc_trace);
           calc_data.input_latency_stat.Push(input_latency);
+          AddTimeHistogramSample(input_latency,
+                                 &calc_data.input_latency_histogram);
           const auto duration =
               finish_time - (start_time.value() + graph_trace.base_time());
           calc_data.time_stat.Push(duration);
+          AddTimeHistogramSample(duration, &calc_data.time_histogram);
           total_time += duration;
         }
       }
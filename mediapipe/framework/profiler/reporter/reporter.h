@@ -10,6 +10,7 @@
 #include "mediapipe/framework/calculator_profile.pb.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/profiler/reporter/statistic.h"
+#include "mediapipe/framework/profiler/time_histogram_util.h"
 
 namespace mediapipe {
 namespace reporter {
@@ -61,6 +62,11 @@ struct CalculatorData {
   // from their origin.
   Statistic input_latency_stat;
 
+  // Histograms of the time spent in PROCESS and of the input latency
+  // (microseconds), used to report percentiles.
+  TimeHistogram time_histogram;
+  TimeHistogram input_latency_histogram;
+
   // The threads on which this calculator ran.
   std::set<int> threads;
 };
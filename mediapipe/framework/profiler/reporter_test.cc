@@ -98,6 +98,7 @@ TEST(Reporter, ReportColumnsWithWildcards) {
   MEDIAPIPE_CHECK_OK(reporter->set_columns({"*_m??n", "*l?t*cy*"}));
   EXPECT_THAT(reporter->Report()->headers(),
               ElementsAre("calculator", "input_latency_mean", "time_mean",
+                          "input_latency_p50", "input_latency_p99",
                           "input_latency_stddev", "input_latency_total"));
 }
 
@@ -108,8 +109,9 @@ TEST(Reporter, AggregatesAreRecorded) {
   const auto& lines = report->lines();
   EXPECT_EQ(lines.size(), 3);
   EXPECT_THAT(lines[2],
-              ElementsAre("OpenCvWriteTextCalculator", "13823.77", "100.00",
-                          "5541.47", "1976799", "245.13", "464.27", "35054"));
+              ElementsAre("OpenCvWriteTextCalculator", "13823.77", "11519",
+                          "34303", "100.00", "5541.47", "1976799", "245.13",
+                          "213", "363", "464.27", "35054"));
 }
 
 TEST(Reporter, JoinsFiles) {
@@ -122,8 +124,9 @@ TEST(Reporter, JoinsFiles) {
   const auto& lines = report->lines();
   EXPECT_EQ(lines.size(), 3);
   EXPECT_THAT(lines[2],
-              ElementsAre("OpenCvWriteTextCalculator", "14707.77", "100.00",
-                          "5630.52", "3000385", "237.50", "389.35", "48449"));
+              ElementsAre("OpenCvWriteTextCalculator", "14707.77", "13183",
+                          "34303", "100.00", "5630.52", "3000385", "237.50",
+                          "219", "339", "389.35", "48449"));
 }
 
 TEST(Reporter, PrintAllColumns) {
@@ -0,0 +1,163 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/time_histogram_util.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+
+namespace {
+
+int ClampPrecisionBits(int precision_bits) {
+  return std::min(std::max(precision_bits, 1), kMaxLogPrecisionBits);
+}
+
+// Returns the number of bits needed to represent a positive value.
+int BitWidth(int64 value) {
+  int bits = 0;
+  while (value >> bits) {
+    ++bits;
+  }
+  return bits;
+}
+
+}  // namespace
+
+int NumLogBuckets(int precision_bits) {
+  precision_bits = ClampPrecisionBits(precision_bits);
+  return LogBucketIndex((int64{1} << kLogBucketMaxBits) - 1, precision_bits) +
+         1;
+}
+
+// Values below 2^precision_bits are their own bucket. Larger values keep
+// their precision_bits most significant bits, and the bucket is their
+// position among the values with the same number of bits.
+int LogBucketIndex(int64 time_usec, int precision_bits) {
+  precision_bits = ClampPrecisionBits(precision_bits);
+  const int64 half = int64{1} << (precision_bits - 1);
+  time_usec = std::min(std::max(time_usec, int64{0}),
+                       (int64{1} << kLogBucketMaxBits) - 1);
+  if (time_usec < 2 * half) {
+    return time_usec;
+  }
+  const int shift = BitWidth(time_usec) - precision_bits;
+  return shift * half + (time_usec >> shift);
+}
+
+int64 LogBucketLowerBound(int index, int precision_bits) {
+  precision_bits = ClampPrecisionBits(precision_bits);
+  const int64 half = int64{1} << (precision_bits - 1);
+  if (index < 2 * half) {
+    return index;
+  }
+  const int shift = index / half - 1;
+  return (index - shift * half) << shift;
+}
+
+int64 LogBucketUpperBound(int index, int precision_bits) {
+  return LogBucketLowerBound(index + 1, precision_bits) - 1;
+}
+
+void InitializeLogBuckets(int precision_bits, TimeHistogram* histogram) {
+  precision_bits = ClampPrecisionBits(precision_bits);
+  histogram->set_log_precision_bits(precision_bits);
+  histogram->mutable_log_count()->Clear();
+  histogram->mutable_log_count()->Resize(NumLogBuckets(precision_bits),
+                                         /*value=*/0);
+}
+
+void AddTimeHistogramSample(int64 time_usec, TimeHistogram* histogram) {
+  histogram->set_total(histogram->total() + time_usec);
+  if (histogram->count_size() > 0) {
+    int64 interval_index = time_usec / histogram->interval_size_usec();
+    if (interval_index > histogram->num_intervals() - 1) {
+      interval_index = histogram->num_intervals() - 1;
+    }
+    histogram->set_count(interval_index, histogram->count(interval_index) + 1);
+  }
+  if (histogram->log_precision_bits() > 0) {
+    const int index =
+        LogBucketIndex(time_usec, histogram->log_precision_bits());
+    if (index >= histogram->log_count_size()) {
+      histogram->mutable_log_count()->Resize(index + 1, /*value=*/0);
+    }
+    histogram->set_log_count(index, histogram->log_count(index) + 1);
+  }
+}
+
+int64 TimeHistogramCount(const TimeHistogram& histogram) {
+  const auto& counts = histogram.log_precision_bits() > 0
+                           ? histogram.log_count()
+                           : histogram.count();
+  int64 result = 0;
+  for (int64 count : counts) {
+    result += count;
+  }
+  return result;
+}
+
+absl::Status MergeTimeHistogram(const TimeHistogram& from,
+                                TimeHistogram* into) {
+  RET_CHECK_EQ(from.interval_size_usec(), into->interval_size_usec());
+  RET_CHECK_EQ(from.num_intervals(), into->num_intervals());
+  RET_CHECK_EQ(from.count_size(), into->count_size());
+  RET_CHECK_EQ(from.log_precision_bits(), into->log_precision_bits());
+  into->set_total(into->total() + from.total());
+  for (int i = 0; i < from.count_size(); ++i) {
+    into->set_count(i, into->count(i) + from.count(i));
+  }
+  if (into->log_count_size() < from.log_count_size()) {
+    into->mutable_log_count()->Resize(from.log_count_size(), /*value=*/0);
+  }
+  for (int i = 0; i < from.log_count_size(); ++i) {
+    into->set_log_count(i, into->log_count(i) + from.log_count(i));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int64> TimeHistogramPercentile(const TimeHistogram& histogram,
+                                              double percentile) {
+  RET_CHECK(percentile >= 0 && percentile <= 100)
+      << "Percentile " << percentile << " is not in [0, 100].";
+  const int64 num_samples = TimeHistogramCount(histogram);
+  if (num_samples == 0) {
+    return 0;
+  }
+  const int64 rank = std::max(
+      int64{1}, static_cast<int64>(std::ceil(percentile * num_samples / 100)));
+  const bool log_buckets = histogram.log_precision_bits() > 0;
+  const auto& counts =
+      log_buckets ? histogram.log_count() : histogram.count();
+  int64 seen = 0;
+  for (int i = 0; i < counts.size(); ++i) {
+    seen += counts.Get(i);
+    if (seen < rank) {
+      continue;
+    }
+    if (log_buckets) {
+      return LogBucketUpperBound(i, histogram.log_precision_bits());
+    }
+    if (i == histogram.num_intervals() - 1) {
+      return i * histogram.interval_size_usec();
+    }
+    return (i + 1) * histogram.interval_size_usec() - 1;
+  }
+  RET_CHECK_FAIL() << "Unreachable: rank " << rank << " of " << num_samples;
+}
+
+}  // namespace mediapipe
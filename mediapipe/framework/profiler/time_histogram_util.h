@@ -0,0 +1,71 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_TIME_HISTOGRAM_UTIL_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_TIME_HISTOGRAM_UTIL_H_
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Times of 2^kLogBucketMaxBits usec (about 12 days) or more are counted in
+// the last log-linear bucket.
+constexpr int kLogBucketMaxBits = 40;
+
+// The maximum log_precision_bits of a TimeHistogram.
+constexpr int kMaxLogPrecisionBits = 8;
+
+// Returns the number of log-linear buckets for a given precision.
+int NumLogBuckets(int precision_bits);
+
+// Returns the log-linear bucket counting a given time.
+int LogBucketIndex(int64 time_usec, int precision_bits);
+
+// Returns the smallest and the largest time counted in a log-linear bucket.
+int64 LogBucketLowerBound(int index, int precision_bits);
+int64 LogBucketUpperBound(int index, int precision_bits);
+
+// Enables the log-linear buckets of a histogram. All buckets are allocated,
+// so that adding samples never resizes the histogram. precision_bits is
+// clamped to [1, kMaxLogPrecisionBits].
+void InitializeLogBuckets(int precision_bits, TimeHistogram* histogram);
+
+// Adds a time to the total, the interval counts and, if enabled, the
+// log-linear bucket counts of a histogram.
+void AddTimeHistogramSample(int64 time_usec, TimeHistogram* histogram);
+
+// Returns the number of samples counted in a histogram.
+int64 TimeHistogramCount(const TimeHistogram& histogram);
+
+// Adds the samples of one histogram to another. Both histograms must have
+// the same intervals and log_precision_bits, e.g. profiles of the same
+// calculator from different runs or hosts.
+absl::Status MergeTimeHistogram(const TimeHistogram& from,
+                                TimeHistogram* into);
+
+// Returns the given percentile, in [0, 100], of the times counted in a
+// histogram, using the nearest rank. The result is the largest time of the
+// bucket holding that rank, so it overestimates the percentile by at most the
+// bucket width. Histograms without log-linear buckets use the intervals
+// instead, in which case a percentile in the last interval is reported as the
+// start of that interval. Returns 0 for an empty histogram.
+absl::StatusOr<int64> TimeHistogramPercentile(const TimeHistogram& histogram,
+                                              double percentile);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_TIME_HISTOGRAM_UTIL_H_
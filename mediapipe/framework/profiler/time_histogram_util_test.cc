@@ -0,0 +1,118 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/time_histogram_util.h"
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(TimeHistogramUtilTest, LogBucketsCoverAllTimes) {
+  for (int bits = 1; bits <= kMaxLogPrecisionBits; ++bits) {
+    EXPECT_EQ(0, LogBucketLowerBound(0, bits));
+    for (int i = 0; i + 1 < NumLogBuckets(bits); ++i) {
+      const int64 lower = LogBucketLowerBound(i, bits);
+      const int64 upper = LogBucketUpperBound(i, bits);
+      ASSERT_LE(lower, upper) << bits << " " << i;
+      ASSERT_EQ(i, LogBucketIndex(lower, bits)) << bits;
+      ASSERT_EQ(i, LogBucketIndex(upper, bits)) << bits;
+      ASSERT_EQ(upper + 1, LogBucketLowerBound(i + 1, bits)) << bits;
+      // Short times are exact, and longer buckets are no wider than
+      // 2^(1 - bits) of the times they hold.
+      if (lower < (int64{1} << bits)) {
+        ASSERT_EQ(lower, upper);
+      } else {
+        ASSERT_LE((upper - lower + 1) << (bits - 1), lower)
+            << bits << " " << i;
+      }
+    }
+    EXPECT_EQ(NumLogBuckets(bits) - 1,
+              LogBucketIndex(int64{1} << kLogBucketMaxBits, bits));
+  }
+}
+
+TEST(TimeHistogramUtilTest, ResolvesShortAndLongTimes) {
+  TimeHistogram histogram;
+  InitializeLogBuckets(/*precision_bits=*/7, &histogram);
+  // 98 sub-millisecond calls and two calls of about 3 seconds.
+  for (int i = 0; i < 98; ++i) {
+    AddTimeHistogramSample(100 + i, &histogram);
+  }
+  AddTimeHistogramSample(3000000, &histogram);
+  AddTimeHistogramSample(3100000, &histogram);
+  EXPECT_EQ(100, TimeHistogramCount(histogram));
+  EXPECT_EQ(98 * 100 + 97 * 98 / 2 + 6100000, histogram.total());
+
+  EXPECT_THAT(TimeHistogramPercentile(histogram, 0), IsOkAndHolds(100));
+  // Times below 128 usec are exact, above they are within 1/64.
+  EXPECT_THAT(TimeHistogramPercentile(histogram, 10), IsOkAndHolds(109));
+  int64 p50 = TimeHistogramPercentile(histogram, 50).value();
+  EXPECT_GE(p50, 149);
+  EXPECT_LE(p50, 149 + 149 / 64);
+  int64 p99 = TimeHistogramPercentile(histogram, 99).value();
+  EXPECT_GE(p99, 3000000);
+  EXPECT_LE(p99, 3000000 + 3000000 / 64);
+  int64 p100 = TimeHistogramPercentile(histogram, 100).value();
+  EXPECT_GE(p100, 3100000);
+  EXPECT_LE(p100, 3100000 + 3100000 / 64);
+
+  EXPECT_FALSE(TimeHistogramPercentile(histogram, 101).ok());
+  EXPECT_THAT(TimeHistogramPercentile(TimeHistogram(), 50), IsOkAndHolds(0));
+}
+
+TEST(TimeHistogramUtilTest, PercentilesOfIntervals) {
+  TimeHistogram histogram;
+  histogram.set_interval_size_usec(100);
+  histogram.set_num_intervals(3);
+  histogram.mutable_count()->Resize(3, 0);
+  AddTimeHistogramSample(50, &histogram);
+  AddTimeHistogramSample(150, &histogram);
+  AddTimeHistogramSample(5000, &histogram);
+  EXPECT_EQ(0, histogram.log_count_size());
+  EXPECT_THAT(TimeHistogramPercentile(histogram, 30), IsOkAndHolds(99));
+  EXPECT_THAT(TimeHistogramPercentile(histogram, 50), IsOkAndHolds(199));
+  // The last interval extends to +inf.
+  EXPECT_THAT(TimeHistogramPercentile(histogram, 99), IsOkAndHolds(200));
+}
+
+TEST(TimeHistogramUtilTest, MergesHistograms) {
+  TimeHistogram first;
+  InitializeLogBuckets(/*precision_bits=*/5, &first);
+  TimeHistogram second = first;
+  for (int i = 0; i < 10; ++i) {
+    AddTimeHistogramSample(10, &first);
+    AddTimeHistogramSample(1000, &second);
+  }
+  // Trailing empty buckets can be dropped from snapshots.
+  second.mutable_log_count()->Truncate(LogBucketIndex(1000, 5) + 1);
+
+  TimeHistogram merged = second;
+  MP_ASSERT_OK(MergeTimeHistogram(first, &merged));
+  EXPECT_EQ(20, TimeHistogramCount(merged));
+  EXPECT_EQ(10 * 10 + 10 * 1000, merged.total());
+  EXPECT_THAT(TimeHistogramPercentile(merged, 50), IsOkAndHolds(10));
+  EXPECT_THAT(TimeHistogramPercentile(merged, 51),
+              IsOkAndHolds(LogBucketUpperBound(LogBucketIndex(1000, 5), 5)));
+
+  TimeHistogram other_precision;
+  InitializeLogBuckets(/*precision_bits=*/6, &other_precision);
+  EXPECT_FALSE(MergeTimeHistogram(other_precision, &merged).ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
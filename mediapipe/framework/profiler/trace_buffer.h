@@ -87,7 +87,7 @@ struct TraceEvent {
     this->is_finish = is_finish;
     return *this;
   }
-  inline TraceEvent& set_event_data(int data) {
+  inline TraceEvent& set_event_data(int64 data) {
     this->event_data = data;
     return *this;
   }
@@ -109,6 +109,7 @@ struct TraceEvent {
   static constexpr EventType TPU_TASK = GraphTrace::TPU_TASK;
   static constexpr EventType GPU_CALIBRATION = GraphTrace::GPU_CALIBRATION;
   static constexpr EventType PACKET_QUEUED = GraphTrace::PACKET_QUEUED;
+  static constexpr EventType COUNTER = GraphTrace::COUNTER;
 };
 
 // Packet trace log buffer.
@@ -84,6 +84,8 @@ void BasicTraceEventTypes(TraceEventRegistry* result) {
        "A time measured by GPU clock and by CPU clock.", true, false},
       {TraceEvent::PACKET_QUEUED, "An input queue size when a packet arrives.",
        true, true, false},
+      {TraceEvent::COUNTER, "A value of a custom counter.", false, true,
+       false},
   };
   for (const TraceEventType& t : basic_types) {
     (*result)[t.event_type()] = t;
@@ -0,0 +1,46 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/trace_counter.h"
+
+#include "absl/container/node_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/mediapipe_profiling.h"
+
+namespace mediapipe {
+namespace {
+
+const std::string* InternCounterName(absl::string_view name) {
+  ABSL_CONST_INIT static absl::Mutex mutex(absl::kConstInit);
+  static auto* names = new absl::node_hash_set<std::string>();
+  absl::MutexLock lock(&mutex);
+  return &*names->emplace(name).first;
+}
+
+}  // namespace
+
+TraceCounter::TraceCounter(absl::string_view name)
+    : name_(InternCounterName(name)) {}
+
+void TraceCounter::Set(CalculatorContext* cc, int64 value) const {
+  LogEvent(cc->GetProfilingContext(),
+           TraceEvent(TraceEvent::COUNTER)
+               .set_node_id(cc->NodeId())
+               .set_input_ts(cc->InputTimestamp())
+               .set_packet_ts(cc->InputTimestamp())
+               .set_stream_id(name_)
+               .set_event_data(value));
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,59 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_TRACE_COUNTER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_TRACE_COUNTER_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/calculator_context.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// A custom metric that a calculator records in the graph trace, e.g. the
+// number of features tracked in a frame. Each value is logged as a COUNTER
+// event of the calculator, at the current input timestamp, and shows up as a
+// counter track in Chrome trace-event output.
+//
+// Values are only recorded when tracing is enabled in the ProfilerConfig.
+//
+//   class FeatureTrackerCalculator : public CalculatorBase {
+//     ...
+//     TraceCounter feature_count_{"feature_count"};
+//   };
+//
+//   absl::Status FeatureTrackerCalculator::Process(CalculatorContext* cc) {
+//     ...
+//     feature_count_.Set(cc, features.size());
+//   }
+class TraceCounter {
+ public:
+  explicit TraceCounter(absl::string_view name);
+
+  // Records the value of the counter.
+  void Set(CalculatorContext* cc, int64 value) const;
+
+  const std::string& name() const { return *name_; }
+
+ private:
+  // Trace events refer to the name by pointer, so names are interned and
+  // never deleted.
+  const std::string* name_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_TRACE_COUNTER_H_
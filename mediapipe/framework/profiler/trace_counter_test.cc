@@ -0,0 +1,113 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/trace_counter.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::HasSubstr;
+
+// Records each input value in the "item_count" counter.
+class ItemCountCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    item_count_.Set(cc, cc->Inputs().Index(0).Get<int>());
+    return absl::OkStatus();
+  }
+
+ private:
+  TraceCounter item_count_{"item_count"};
+};
+REGISTER_CALCULATOR(ItemCountCalculator);
+
+TEST(TraceCounterTest, InternsNames) {
+  TraceCounter counter_1("item_count");
+  TraceCounter counter_2(std::string("item_count"));
+  EXPECT_EQ(&counter_1.name(), &counter_2.name());
+}
+
+TEST(TraceCounterTest, RecordsValuesInTrace) {
+  const std::string chrome_trace_path =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/trace_counter_test.json");
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "items"
+    node { calculator: "ItemCountCalculator" input_stream: "items" }
+    profiler_config { trace_enabled: true trace_log_interval_usec: -1 }
+  )pb");
+  config.mutable_profiler_config()->set_trace_log_path(
+      absl::StrCat(getenv("TEST_TMPDIR"), "/trace_counter_test_"));
+  config.mutable_profiler_config()->set_chrome_trace_path(chrome_trace_path);
+
+  {
+    CalculatorGraph graph;
+    MP_ASSERT_OK(graph.Initialize(config));
+    MP_ASSERT_OK(graph.StartRun({}));
+    for (int i = 0; i < 3; ++i) {
+      MP_ASSERT_OK(graph.AddPacketToInputStream(
+          "items", MakePacket<int>(i * 10).At(Timestamp(i))));
+    }
+    MP_ASSERT_OK(graph.WaitUntilIdle());
+
+    GraphProfile profile;
+    MP_ASSERT_OK(graph.profiler()->CaptureProfile(&profile));
+    const GraphTrace& trace = profile.graph_trace(0);
+    std::vector<int64> values;
+    for (const auto& calc_trace : trace.calculator_trace()) {
+      if (calc_trace.event_type() == GraphTrace::COUNTER) {
+        ASSERT_EQ(1, calc_trace.input_trace_size());
+        const auto& stream_trace = calc_trace.input_trace(0);
+        EXPECT_EQ("item_count", trace.stream_name(stream_trace.stream_id()));
+        EXPECT_EQ(values.size(), calc_trace.input_timestamp());
+        values.push_back(stream_trace.event_data());
+      }
+    }
+    EXPECT_EQ(std::vector<int64>({0, 10, 20}), values);
+
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "items", MakePacket<int>(30).At(Timestamp(3))));
+    MP_ASSERT_OK(graph.CloseAllInputStreams());
+    MP_ASSERT_OK(graph.WaitUntilDone());
+  }
+
+  // The events after CaptureProfile are written to the chrome_trace_path.
+  std::ifstream ifs(chrome_trace_path);
+  std::stringstream chrome_trace;
+  chrome_trace << ifs.rdbuf();
+  EXPECT_THAT(chrome_trace.str(),
+              HasSubstr(R"({"name":"ItemCountCalculator item_count",)"
+                        R"("cat":"COUNTER","ph":"C")"));
+  EXPECT_THAT(chrome_trace.str(), HasSubstr(R"("args":{"value":30}})"));
+  EXPECT_THAT(chrome_trace.str(), HasSubstr("\n]\n"));
+}
+
+}  // namespace
+}  // namespace mediapipe
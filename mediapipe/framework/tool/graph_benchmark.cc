@@ -0,0 +1,430 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/tool/graph_benchmark.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/profiler/time_histogram_util.h"
+#include "mediapipe/framework/tool/validate_name.h"
+
+namespace mediapipe {
+namespace tool {
+
+namespace {
+
+// The precision of the latency and Process time histograms, within 1/64 of
+// the exact percentiles.
+constexpr int kHistogramPrecisionBits = 7;
+
+// Returns the stream name in a "TAG:index:name" stream specification.
+absl::StatusOr<std::string> StreamName(const std::string& spec) {
+  std::string tag;
+  int index;
+  std::string name;
+  MP_RETURN_IF_ERROR(ParseTagIndexName(spec, &tag, &index, &name));
+  return name;
+}
+
+// The measurements of one output stream.
+struct OutputStreamStats {
+  int64 num_packets = 0;
+  TimeHistogram latency;
+  int64 max_latency_usec = 0;
+  int64 last_arrival_usec = 0;
+};
+
+// The state of one run shared with the output stream observers.
+struct RunState {
+  absl::Mutex mutex;
+  // The send time of each measured input timestamp.
+  absl::flat_hash_map<int64, int64> send_times_usec ABSL_GUARDED_BY(mutex);
+  std::vector<OutputStreamStats> stats ABSL_GUARDED_BY(mutex);
+
+  void AddOutput(int stream_index, Timestamp timestamp) {
+    const int64 now_usec = absl::ToUnixMicros(absl::Now());
+    absl::MutexLock lock(&mutex);
+    auto iter = send_times_usec.find(timestamp.Value());
+    if (iter == send_times_usec.end()) {
+      return;
+    }
+    OutputStreamStats& stream_stats = stats[stream_index];
+    const int64 latency_usec = now_usec - iter->second;
+    ++stream_stats.num_packets;
+    AddTimeHistogramSample(latency_usec, &stream_stats.latency);
+    stream_stats.max_latency_usec =
+        std::max(stream_stats.max_latency_usec, latency_usec);
+    stream_stats.last_arrival_usec =
+        std::max(stream_stats.last_arrival_usec, now_usec);
+  }
+};
+
+int64 Percentile(const TimeHistogram& histogram, double percentile) {
+  return TimeHistogramPercentile(histogram, percentile).value();
+}
+
+}  // namespace
+
+GraphBenchmark::GraphBenchmark(CalculatorGraphConfig graph_config,
+                               GraphBenchmarkConfig benchmark_config)
+    : graph_config_(std::move(graph_config)),
+      benchmark_config_(std::move(benchmark_config)) {}
+
+void GraphBenchmark::SetInputPackets(const std::string& stream_name,
+                                     std::vector<Packet> packets) {
+  input_packets_[stream_name] = std::move(packets);
+}
+
+absl::StatusOr<GraphBenchmarkReport> GraphBenchmark::Run() {
+  MP_RETURN_IF_ERROR(PrepareInputs());
+  std::vector<int> thread_counts(benchmark_config_.num_threads().begin(),
+                                 benchmark_config_.num_threads().end());
+  if (thread_counts.empty()) {
+    thread_counts.push_back(0);
+  }
+  std::vector<int> queue_sizes(benchmark_config_.max_queue_size().begin(),
+                               benchmark_config_.max_queue_size().end());
+  if (queue_sizes.empty()) {
+    queue_sizes.push_back(0);
+  }
+  GraphBenchmarkReport report;
+  // Resetting the peak of each run also resets the one getrusage reports, so
+  // the peak of the process is tracked here.
+  int64 process_peak_rss_kb = PeakResidentSetSizeKb();
+  for (int num_threads : thread_counts) {
+    for (int max_queue_size : queue_sizes) {
+      ASSIGN_OR_RETURN(GraphBenchmarkResult result,
+                       RunOnce(num_threads, max_queue_size));
+      process_peak_rss_kb = std::max(
+          {process_peak_rss_kb, result.peak_rss_kb(), PeakResidentSetSizeKb()});
+      *report.add_result() = std::move(result);
+    }
+  }
+  report.set_peak_rss_kb(process_peak_rss_kb);
+  return report;
+}
+
+absl::Status GraphBenchmark::PrepareInputs() {
+  RET_CHECK_GT(benchmark_config_.frame_rate(), 0);
+  for (const auto& input_stream : benchmark_config_.input_stream()) {
+    if (input_stream.has_synthetic_image() &&
+        input_packets_.find(input_stream.name()) == input_packets_.end()) {
+      input_packets_[input_stream.name()] =
+          CreateSyntheticImages(input_stream.synthetic_image());
+    }
+  }
+  std::set<std::string> graph_inputs;
+  for (const std::string& spec : graph_config_.input_stream()) {
+    ASSIGN_OR_RETURN(std::string name, StreamName(spec));
+    auto iter = input_packets_.find(name);
+    RET_CHECK(iter != input_packets_.end() && !iter->second.empty())
+        << "No packets are specified for the graph input stream \"" << name
+        << "\".";
+    graph_inputs.insert(name);
+  }
+  for (const auto& entry : input_packets_) {
+    RET_CHECK(graph_inputs.count(entry.first))
+        << "\"" << entry.first << "\" is not a graph input stream.";
+  }
+
+  output_streams_.assign(benchmark_config_.output_stream().begin(),
+                         benchmark_config_.output_stream().end());
+  if (output_streams_.empty()) {
+    for (const std::string& spec : graph_config_.output_stream()) {
+      ASSIGN_OR_RETURN(std::string name, StreamName(spec));
+      output_streams_.push_back(name);
+    }
+  }
+  RET_CHECK(!output_streams_.empty()) << "No output streams to measure.";
+  return absl::OkStatus();
+}
+
+absl::StatusOr<GraphBenchmarkResult> GraphBenchmark::RunOnce(
+    int num_threads, int max_queue_size) {
+  CalculatorGraphConfig config = graph_config_;
+  if (num_threads > 0) {
+    for (const auto& executor : config.executor()) {
+      RET_CHECK(!executor.name().empty())
+          << "num_threads cannot be swept for graphs that configure the "
+             "default executor.";
+    }
+    config.set_num_threads(num_threads);
+  }
+  if (max_queue_size != 0) {
+    config.set_max_queue_size(max_queue_size);
+  }
+  ProfilerConfig* profiler_config = config.mutable_profiler_config();
+  profiler_config->set_enable_profiler(true);
+  if (profiler_config->histogram_precision_bits() == 0) {
+    profiler_config->set_histogram_precision_bits(kHistogramPrecisionBits);
+  }
+
+  // Declared before the graph, which refers to it in output observers.
+  RunState state;
+  {
+    absl::MutexLock lock(&state.mutex);
+    state.stats.resize(output_streams_.size());
+    for (OutputStreamStats& stream_stats : state.stats) {
+      InitializeLogBuckets(kHistogramPrecisionBits, &stream_stats.latency);
+    }
+  }
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  for (int i = 0; i < output_streams_.size(); ++i) {
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        output_streams_[i], [&state, i](const Packet& packet) {
+          state.AddOutput(i, packet.Timestamp());
+          return absl::OkStatus();
+        }));
+  }
+  MP_RETURN_IF_ERROR(graph.StartRun({}));
+
+  const double frame_rate = benchmark_config_.frame_rate();
+  auto send_frames = [&](int begin, int end, bool measured) -> absl::Status {
+    const absl::Time start_time = absl::Now();
+    for (int index = begin; index < end; ++index) {
+      if (benchmark_config_.real_time()) {
+        absl::SleepFor(start_time + absl::Seconds((index - begin) / frame_rate) -
+                       absl::Now());
+      }
+      const Timestamp timestamp(std::llround(index * 1e6 / frame_rate));
+      if (measured) {
+        absl::MutexLock lock(&state.mutex);
+        state.send_times_usec[timestamp.Value()] =
+            absl::ToUnixMicros(absl::Now());
+      }
+      for (const auto& entry : input_packets_) {
+        const std::vector<Packet>& packets = entry.second;
+        MP_RETURN_IF_ERROR(graph.AddPacketToInputStream(
+            entry.first, packets[index % packets.size()].At(timestamp)));
+      }
+    }
+    return absl::OkStatus();
+  };
+
+  const int num_warmup_frames = benchmark_config_.num_warmup_frames();
+  const int num_frames = benchmark_config_.num_frames();
+  MP_RETURN_IF_ERROR(send_frames(0, num_warmup_frames, /*measured=*/false));
+  MP_RETURN_IF_ERROR(graph.WaitUntilIdle());
+  graph.profiler()->Reset();
+
+  const bool measure_peak_rss = ResetPeakResidentSetSize();
+  const double start_cpu_sec = ProcessCpuTimeSec();
+  const absl::Time start_time = absl::Now();
+  MP_RETURN_IF_ERROR(send_frames(num_warmup_frames,
+                                 num_warmup_frames + num_frames,
+                                 /*measured=*/true));
+  MP_RETURN_IF_ERROR(graph.CloseAllInputStreams());
+  MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+  const absl::Time end_time = absl::Now();
+
+  GraphBenchmarkResult result;
+  result.set_num_threads(num_threads);
+  result.set_max_queue_size(max_queue_size);
+  result.set_num_frames(num_frames);
+  result.set_wall_time_sec(absl::ToDoubleSeconds(end_time - start_time));
+  result.set_cpu_time_sec(ProcessCpuTimeSec() - start_cpu_sec);
+  if (measure_peak_rss) {
+    result.set_peak_rss_kb(CurrentPeakResidentSetSizeKb());
+  }
+  {
+    absl::MutexLock lock(&state.mutex);
+    const int64 start_usec = absl::ToUnixMicros(start_time);
+    for (int i = 0; i < output_streams_.size(); ++i) {
+      const OutputStreamStats& stream_stats = state.stats[i];
+      auto* stream_result = result.add_output_stream();
+      stream_result->set_name(output_streams_[i]);
+      stream_result->set_num_packets(stream_stats.num_packets);
+      if (stream_stats.num_packets == 0) {
+        continue;
+      }
+      const int64 duration_usec =
+          std::max(stream_stats.last_arrival_usec - start_usec, int64{1});
+      stream_result->set_throughput_fps(stream_stats.num_packets * 1e6 /
+                                        duration_usec);
+      stream_result->set_latency_p50_usec(
+          Percentile(stream_stats.latency, 50));
+      stream_result->set_latency_p90_usec(
+          Percentile(stream_stats.latency, 90));
+      stream_result->set_latency_p99_usec(
+          Percentile(stream_stats.latency, 99));
+      stream_result->set_latency_max_usec(stream_stats.max_latency_usec);
+    }
+  }
+
+  std::vector<CalculatorProfile> profiles;
+  MP_RETURN_IF_ERROR(graph.profiler()->GetCalculatorProfiles(&profiles));
+  for (const CalculatorProfile& profile : profiles) {
+    const TimeHistogram& process_runtime = profile.process_runtime();
+    auto* calculator_result = result.add_calculator();
+    calculator_result->set_name(profile.name());
+    calculator_result->set_num_calls(TimeHistogramCount(process_runtime));
+    calculator_result->set_process_time_usec(process_runtime.total());
+    calculator_result->set_process_time_p50_usec(
+        Percentile(process_runtime, 50));
+    calculator_result->set_process_time_p99_usec(
+        Percentile(process_runtime, 99));
+  }
+  return result;
+}
+
+std::vector<Packet> CreateSyntheticImages(
+    const GraphBenchmarkConfig::SyntheticImage& options) {
+  std::vector<Packet> images;
+  for (int i = 0; i < options.num_images(); ++i) {
+    auto image = absl::make_unique<ImageFrame>(
+        options.format(), options.width(), options.height(),
+        ImageFrame::kDefaultAlignmentBoundary);
+    std::mt19937 random(i);
+    const int row_size = image->Width() * image->NumberOfChannels();
+    for (int y = 0; y < image->Height(); ++y) {
+      uint8* row = image->MutablePixelData() + y * image->WidthStep();
+      if (image->ByteDepth() == 4) {
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+        float* values = reinterpret_cast<float*>(row);
+        for (int x = 0; x < row_size; ++x) {
+          values[x] = distribution(random);
+        }
+      } else {
+        for (int x = 0; x < row_size * image->ByteDepth(); ++x) {
+          row[x] = random() & 0xff;
+        }
+      }
+    }
+    images.push_back(Adopt(image.release()));
+  }
+  return images;
+}
+
+int64 PeakResidentSetSizeKb() {
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  // Reported in bytes rather than kilobytes.
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif  // __APPLE__
+#else
+  return 0;
+#endif
+}
+
+bool ResetPeakResidentSetSize() {
+#if defined(__linux__)
+  // Writing "5" to clear_refs resets VmHWM to the current resident set size.
+  // It fails on kernels older than 4.0 and where /proc is read-only.
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return clear_refs.good() && CurrentPeakResidentSetSizeKb() > 0;
+#else
+  return false;
+#endif
+}
+
+int64 CurrentPeakResidentSetSizeKb() {
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    absl::string_view value(line);
+    if (absl::ConsumePrefix(&value, "VmHWM:")) {
+      absl::ConsumeSuffix(&value, "kB");
+      int64 peak_kb;
+      return absl::SimpleAtoi(value, &peak_kb) ? peak_kb : 0;
+    }
+  }
+  return 0;
+#else
+  return 0;
+#endif
+}
+
+double ProcessCpuTimeSec() {
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#else
+  return 0;
+#endif
+}
+
+void PrintGraphBenchmarkReport(const GraphBenchmarkReport& report,
+                               std::ostream& output) {
+  output << "graph: " << report.graph_name() << "\n";
+  output << absl::StrFormat("process peak_rss: %d KB\n", report.peak_rss_kb());
+  for (const GraphBenchmarkResult& result : report.result()) {
+    output << absl::StrFormat(
+        "\nnum_threads: %d  max_queue_size: %d  frames: %d  wall: %.2f s  "
+        "cpu: %.2f s",
+        result.num_threads(), result.max_queue_size(), result.num_frames(),
+        result.wall_time_sec(), result.cpu_time_sec());
+    if (result.has_peak_rss_kb()) {
+      output << absl::StrFormat("  peak_rss: %d KB", result.peak_rss_kb());
+    }
+    output << "\n";
+    output << absl::StrFormat("%-40s %8s %8s %9s %9s %9s %9s\n",
+                              "output_stream", "packets", "fps", "p50_ms",
+                              "p90_ms", "p99_ms", "max_ms");
+    for (const auto& stream : result.output_stream()) {
+      output << absl::StrFormat(
+          "%-40s %8d %8.2f %9.2f %9.2f %9.2f %9.2f\n", stream.name(),
+          stream.num_packets(), stream.throughput_fps(),
+          stream.latency_p50_usec() / 1e3, stream.latency_p90_usec() / 1e3,
+          stream.latency_p99_usec() / 1e3, stream.latency_max_usec() / 1e3);
+    }
+    output << absl::StrFormat("%-40s %8s %9s %9s %9s\n", "calculator", "calls",
+                              "total_ms", "p50_ms", "p99_ms");
+    for (const auto& calculator : result.calculator()) {
+      output << absl::StrFormat(
+          "%-40s %8d %9.2f %9.2f %9.2f\n", calculator.name(),
+          calculator.num_calls(), calculator.process_time_usec() / 1e3,
+          calculator.process_time_p50_usec() / 1e3,
+          calculator.process_time_p99_usec() / 1e3);
+    }
+  }
+}
+
+}  // namespace tool
+}  // namespace mediapipe
@@ -0,0 +1,103 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_TOOL_GRAPH_BENCHMARK_H_
+#define MEDIAPIPE_FRAMEWORK_TOOL_GRAPH_BENCHMARK_H_
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/tool/graph_benchmark.pb.h"
+
+namespace mediapipe {
+namespace tool {
+
+// Measures the throughput and latency of a graph, fed with synthetic or
+// prerecorded packets.
+//
+// The graph is run once for each combination of the num_threads and
+// max_queue_size values in the GraphBenchmarkConfig. Each run sends
+// num_warmup_frames input timestamps, waits for the graph to become idle,
+// then sends num_frames timestamps and measures the latency of each output
+// stream, the time each calculator spent in Process, the CPU time of the
+// process and, where it can be reset, the peak memory during the run. The
+// graph must not have source calculators.
+//
+//   GraphBenchmark benchmark(graph_config, benchmark_config);
+//   ASSIGN_OR_RETURN(GraphBenchmarkReport report, benchmark.Run());
+//   PrintGraphBenchmarkReport(report, std::cout);
+class GraphBenchmark {
+ public:
+  GraphBenchmark(CalculatorGraphConfig graph_config,
+                 GraphBenchmarkConfig benchmark_config);
+
+  // Sets the packets sent to an input stream, e.g. decoded video frames.
+  // The packets are sent in turn, at timestamps set by the benchmark. Input
+  // streams with a synthetic_image source don't need to be set.
+  void SetInputPackets(const std::string& stream_name,
+                       std::vector<Packet> packets);
+
+  // Runs the graph with each combination of settings.
+  absl::StatusOr<GraphBenchmarkReport> Run();
+
+ private:
+  absl::Status PrepareInputs();
+  absl::StatusOr<GraphBenchmarkResult> RunOnce(int num_threads,
+                                               int max_queue_size);
+
+  const CalculatorGraphConfig graph_config_;
+  const GraphBenchmarkConfig benchmark_config_;
+  std::map<std::string, std::vector<Packet>> input_packets_;
+  std::vector<std::string> output_streams_;
+};
+
+// Returns image frames of the given size and format filled with
+// deterministic noise.
+std::vector<Packet> CreateSyntheticImages(
+    const GraphBenchmarkConfig::SyntheticImage& options);
+
+// Returns the peak resident set size of the process in kilobytes, or 0 if it
+// is not available on this platform.
+int64 PeakResidentSetSizeKb();
+
+// Resets the peak returned by CurrentPeakResidentSetSizeKb() to the current
+// resident set size. Returns false if this is not supported, which is the
+// case outside Linux. On Linux this also lowers the peak that
+// PeakResidentSetSizeKb() returns.
+bool ResetPeakResidentSetSize();
+
+// Returns the peak resident set size of the process in kilobytes since it
+// started or since the last ResetPeakResidentSetSize(), or 0 if it is not
+// available on this platform.
+int64 CurrentPeakResidentSetSizeKb();
+
+// Returns the user and system CPU time used by the process, or 0 if it is
+// not available on this platform.
+double ProcessCpuTimeSec();
+
+// Prints a report as one table per run.
+void PrintGraphBenchmarkReport(const GraphBenchmarkReport& report,
+                               std::ostream& output);
+
+}  // namespace tool
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_TOOL_GRAPH_BENCHMARK_H_
@@ -0,0 +1,134 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Runs a GraphBenchmark on a graph and prints the report. Usually built with
+// the mediapipe_graph_benchmark macro, which supplies the flags:
+//
+//   bazel run -c opt \
+//     mediapipe/graphs/face_mesh:face_mesh_desktop_live_benchmark
+
+#include <cstdlib>
+#include <iostream>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/match.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/opencv_video_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/tool/graph_benchmark.h"
+
+ABSL_FLAG(std::string, calculator_graph_config_file, "",
+          "Name of file containing text format CalculatorGraphConfig proto.");
+ABSL_FLAG(std::string, benchmark_config_file, "",
+          "Name of file containing text format GraphBenchmarkConfig proto.");
+ABSL_FLAG(std::string, output_path, "",
+          "If set, the GraphBenchmarkReport is also written to this file, in "
+          "binary format if the name ends with .binarypb and in text format "
+          "otherwise.");
+
+namespace mediapipe {
+namespace {
+
+template <typename T>
+absl::StatusOr<T> ReadTextProto(const std::string& path) {
+  std::string contents;
+  MP_RETURN_IF_ERROR(file::GetContents(path, &contents));
+  T proto;
+  RET_CHECK(ParseTextProto<T>(contents, &proto))
+      << "Failed to parse " << path;
+  return proto;
+}
+
+// Decodes up to max_frames frames of a video into SRGB image frames.
+absl::StatusOr<std::vector<Packet>> DecodeVideo(const std::string& path,
+                                                int max_frames) {
+  cv::VideoCapture capture(path);
+  RET_CHECK(capture.isOpened()) << "Failed to open " << path;
+  std::vector<Packet> frames;
+  cv::Mat camera_frame;
+  while (frames.size() < max_frames && capture.read(camera_frame)) {
+    auto input_frame = absl::make_unique<ImageFrame>(
+        ImageFormat::SRGB, camera_frame.cols, camera_frame.rows,
+        ImageFrame::kDefaultAlignmentBoundary);
+    cv::Mat input_frame_mat = formats::MatView(input_frame.get());
+    cv::cvtColor(camera_frame, input_frame_mat, cv::COLOR_BGR2RGB);
+    frames.push_back(Adopt(input_frame.release()));
+  }
+  RET_CHECK(!frames.empty()) << "No frames decoded from " << path;
+  return frames;
+}
+
+absl::Status RunGraphBenchmark() {
+  const std::string graph_path =
+      absl::GetFlag(FLAGS_calculator_graph_config_file);
+  ASSIGN_OR_RETURN(CalculatorGraphConfig graph_config,
+                   ReadTextProto<CalculatorGraphConfig>(graph_path));
+  GraphBenchmarkConfig benchmark_config;
+  if (!absl::GetFlag(FLAGS_benchmark_config_file).empty()) {
+    ASSIGN_OR_RETURN(benchmark_config,
+                     ReadTextProto<GraphBenchmarkConfig>(
+                         absl::GetFlag(FLAGS_benchmark_config_file)));
+  }
+
+  tool::GraphBenchmark benchmark(graph_config, benchmark_config);
+  // Videos are decoded up front so that decoding is not measured.
+  for (const auto& input_stream : benchmark_config.input_stream()) {
+    if (input_stream.has_video_path()) {
+      ASSIGN_OR_RETURN(
+          std::vector<Packet> frames,
+          DecodeVideo(input_stream.video_path(),
+                      benchmark_config.num_warmup_frames() +
+                          benchmark_config.num_frames()));
+      benchmark.SetInputPackets(input_stream.name(), std::move(frames));
+    }
+  }
+
+  ASSIGN_OR_RETURN(GraphBenchmarkReport report, benchmark.Run());
+  report.set_graph_name(graph_path);
+  tool::PrintGraphBenchmarkReport(report, std::cout);
+
+  const std::string output_path = absl::GetFlag(FLAGS_output_path);
+  if (!output_path.empty()) {
+    std::string contents;
+    if (absl::EndsWith(output_path, ".binarypb")) {
+      RET_CHECK(report.SerializeToString(&contents));
+    } else {
+      RET_CHECK(proto_ns::TextFormat::PrintToString(report, &contents));
+    }
+    MP_RETURN_IF_ERROR(file::SetContents(output_path, contents));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  absl::Status run_status = mediapipe::RunGraphBenchmark();
+  if (!run_status.ok()) {
+    LOG(ERROR) << "Failed to run the benchmark: " << run_status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/tool/graph_benchmark.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace tool {
+namespace {
+
+CalculatorGraphConfig PassThroughGraph() {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "input_video"
+    input_stream: "input_count"
+    output_stream: "output_video"
+    node {
+      calculator: "PassThroughCalculator"
+      name: "pass_through"
+      input_stream: "input_video"
+      input_stream: "input_count"
+      output_stream: "output_video"
+      output_stream: "output_count"
+    }
+  )pb");
+}
+
+TEST(GraphBenchmarkTest, CreatesSyntheticImages) {
+  GraphBenchmarkConfig::SyntheticImage options;
+  options.set_width(32);
+  options.set_height(16);
+  options.set_num_images(3);
+  std::vector<Packet> images = CreateSyntheticImages(options);
+  ASSERT_EQ(3, images.size());
+  const ImageFrame& first = images[0].Get<ImageFrame>();
+  const ImageFrame& second = images[1].Get<ImageFrame>();
+  EXPECT_EQ(32, first.Width());
+  EXPECT_EQ(16, first.Height());
+  EXPECT_EQ(ImageFormat::SRGB, first.Format());
+  EXPECT_NE(0, std::memcmp(first.PixelData(), second.PixelData(),
+                           first.WidthStep() * first.Height()));
+  // The noise is deterministic.
+  std::vector<Packet> again = CreateSyntheticImages(options);
+  EXPECT_EQ(0, std::memcmp(first.PixelData(),
+                           again[0].Get<ImageFrame>().PixelData(),
+                           first.WidthStep() * first.Height()));
+}
+
+TEST(GraphBenchmarkTest, SweepsSettings) {
+  GraphBenchmarkConfig benchmark_config =
+      ParseTextProtoOrDie<GraphBenchmarkConfig>(R"pb(
+        input_stream {
+          name: "input_video"
+          synthetic_image { width: 64 height: 48 num_images: 2 }
+        }
+        num_frames: 20
+        num_warmup_frames: 5
+        num_threads: 1
+        num_threads: 2
+        max_queue_size: 4
+      )pb");
+  GraphBenchmark benchmark(PassThroughGraph(), benchmark_config);
+  std::vector<Packet> counts;
+  for (int i = 0; i < 4; ++i) {
+    counts.push_back(MakePacket<int>(i));
+  }
+  benchmark.SetInputPackets("input_count", counts);
+
+  absl::StatusOr<GraphBenchmarkReport> status_or_report = benchmark.Run();
+  MP_ASSERT_OK(status_or_report);
+  const GraphBenchmarkReport& report = status_or_report.value();
+  ASSERT_EQ(2, report.result_size());
+  EXPECT_EQ(1, report.result(0).num_threads());
+  EXPECT_EQ(2, report.result(1).num_threads());
+  for (const GraphBenchmarkResult& result : report.result()) {
+    EXPECT_EQ(4, result.max_queue_size());
+    EXPECT_EQ(20, result.num_frames());
+    EXPECT_GT(result.wall_time_sec(), 0);
+    ASSERT_EQ(1, result.output_stream_size());
+    const auto& output = result.output_stream(0);
+    EXPECT_EQ("output_video", output.name());
+    // Warm-up outputs are not measured.
+    EXPECT_EQ(20, output.num_packets());
+    EXPECT_GT(output.throughput_fps(), 0);
+    EXPECT_LE(output.latency_p50_usec(), output.latency_p90_usec());
+    EXPECT_LE(output.latency_p90_usec(), output.latency_p99_usec());
+    ASSERT_EQ(1, result.calculator_size());
+    EXPECT_EQ("pass_through", result.calculator(0).name());
+    EXPECT_EQ(20, result.calculator(0).num_calls());
+#if defined(__linux__)
+    if (result.has_peak_rss_kb()) {
+      EXPECT_GT(result.peak_rss_kb(), 0);
+      EXPECT_LE(result.peak_rss_kb(), report.peak_rss_kb());
+    }
+#endif  // __linux__
+  }
+#if defined(__linux__) || defined(__APPLE__)
+  EXPECT_GT(report.peak_rss_kb(), 0);
+#endif
+
+  std::ostringstream printed;
+  PrintGraphBenchmarkReport(report, printed);
+  EXPECT_THAT(printed.str(), testing::HasSubstr("output_video"));
+  EXPECT_THAT(printed.str(), testing::HasSubstr("pass_through"));
+}
+
+TEST(GraphBenchmarkTest, RequiresAllInputStreams) {
+  GraphBenchmarkConfig benchmark_config;
+  benchmark_config.add_input_stream()->set_name("input_video");
+  benchmark_config.mutable_input_stream(0)->mutable_synthetic_image();
+  GraphBenchmark benchmark(PassThroughGraph(), benchmark_config);
+  EXPECT_FALSE(benchmark.Run().ok());
+}
+
+}  // namespace
+}  // namespace tool
+}  // namespace mediapipe
@@ -3,6 +3,10 @@
 mediapipe_binary_graph() converts a graph from text format to serialized binary
 format.
 
+mediapipe_precompiled_graph() expands and validates a graph and serializes it
+as a mediapipe.PrecompiledGraph, which CalculatorGraph loads without repeating
+the expansion and validation.
+
 Example:
   mediapipe_binary_graph(
     name = "make_graph_binarypb",
@@ -62,6 +66,80 @@ def mediapipe_binary_graph(name, graph = None, output_name = None, deps = [], te
         testonly = testonly,
     )
 
+def mediapipe_precompiled_graph(name, graph = None, output_name = None, deps = [], testonly = False, **kwargs):
+    """Expands and validates a graph into a binary PrecompiledGraph.
+
+    Args:
+      name: The name of the target.
+      graph: The graph in CalculatorGraphConfig text format.
+      output_name: The name of the output PrecompiledGraph file.
+      deps: The calculators, subgraphs and stream handlers used by the graph.
+      testonly: pass 1 if the graph is to be used only for tests.
+      **kwargs: Remaining keyword args, forwarded to the genrule.
+    """
+
+    if not graph:
+        fail("No input graph file specified.")
+
+    if not output_name:
+        fail("Must specify the output_name.")
+
+    # Compile the graph precompiler with the calculators linked in, since their
+    # contracts are needed to validate the graph.
+    native.cc_binary(
+        name = name + "_precompile_graph",
+        visibility = ["//visibility:private"],
+        deps = [clean_dep("//mediapipe/framework/tool:precompile_graph")] + deps,
+        tags = ["manual"],
+        testonly = testonly,
+    )
+
+    native.genrule(
+        name = name,
+        srcs = [graph],
+        outs = [output_name],
+        cmd = (
+            "$(location " + name + "_precompile_graph" + ") " +
+            ("--proto_source=$(location %s) " % graph) +
+            ("--proto_output=\"$@\" ")
+        ),
+        tools = [name + "_precompile_graph"],
+        testonly = testonly,
+        **kwargs
+    )
+
+def mediapipe_graph_benchmark(name, graph = None, benchmark_config = None, deps = [], **kwargs):
+    """Builds a binary that benchmarks a graph with tool::GraphBenchmark.
+
+    Run it with "bazel run -c opt"; extra flags such as --output_path are
+    passed through.
+
+    Args:
+      name: The name of the target.
+      graph: The graph in CalculatorGraphConfig text format.
+      benchmark_config: The inputs and settings in GraphBenchmarkConfig text
+        format.
+      deps: The calculators, subgraphs and stream handlers used by the graph.
+      **kwargs: Remaining keyword args, forwarded to the cc_binary.
+    """
+
+    if not graph:
+        fail("No input graph file specified.")
+
+    if not benchmark_config:
+        fail("No benchmark config file specified.")
+
+    native.cc_binary(
+        name = name,
+        data = [graph, benchmark_config],
+        args = [
+            "--calculator_graph_config_file=$(location %s)" % graph,
+            "--benchmark_config_file=$(location %s)" % benchmark_config,
+        ],
+        deps = [clean_dep("//mediapipe/framework/tool:graph_benchmark_main")] + deps,
+        **kwargs
+    )
+
 def data_as_c_string(
         name,
         srcs,
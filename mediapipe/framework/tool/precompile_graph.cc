@@ -0,0 +1,110 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A command line utility to expand and validate a CalculatorGraphConfig and
+// output it as a binary PrecompiledGraph. The calculators, subgraphs and
+// stream handlers used by the graph must be linked into the binary.
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/port/advanced_proto_inc.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/precompiled_graph.pb.h"
+#include "mediapipe/framework/validated_graph_config.h"
+
+ABSL_FLAG(std::string, proto_source, "",
+          "The source file containing a CalculatorGraphConfig protobuf.");
+ABSL_FLAG(bool, proto_source_is_text, true,
+          "Whether --proto_source is in text format rather than binary.");
+ABSL_FLAG(std::string, proto_output, "",
+          "An output file in binary PrecompiledGraph form.");
+
+#define EXIT_IF_ERROR(status) \
+  if (!status.ok()) {         \
+    LOG(ERROR) << status;     \
+    return EXIT_FAILURE;      \
+  }
+
+namespace mediapipe {
+
+absl::Status ReadGraphConfig(const std::string& proto_source, bool read_text,
+                             CalculatorGraphConfig* result) {
+  std::ifstream ifs(proto_source, std::ios_base::in | std::ios_base::binary);
+  RET_CHECK(ifs) << "could not open: " << proto_source;
+  proto_ns::io::IstreamInputStream in(&ifs);
+  if (read_text) {
+    RET_CHECK(proto_ns::TextFormat::Parse(&in, result))
+        << "could not parse text proto: " << proto_source;
+  } else {
+    RET_CHECK(result->ParseFromZeroCopyStream(&in))
+        << "could not parse binary proto: " << proto_source;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status WritePrecompiledGraph(const std::string& proto_output,
+                                   const PrecompiledGraph& precompiled_graph) {
+  std::ofstream ofs(proto_output, std::ios_base::out | std::ios_base::trunc |
+                                      std::ios_base::binary);
+  proto_ns::io::OstreamOutputStream out(&ofs);
+  RET_CHECK(precompiled_graph.SerializeToZeroCopyStream(&out))
+      << "could not write binary proto to: " << proto_output;
+  return absl::OkStatus();
+}
+
+absl::Status PrecompileGraph(const std::string& proto_source, bool read_text,
+                             const std::string& proto_output) {
+  CalculatorGraphConfig config;
+  MP_RETURN_IF_ERROR(ReadGraphConfig(proto_source, read_text, &config));
+  ValidatedGraphConfig validated_graph;
+  MP_RETURN_IF_ERROR(validated_graph.Initialize(config));
+  ASSIGN_OR_RETURN(PrecompiledGraph precompiled_graph,
+                   validated_graph.Precompile());
+  return WritePrecompiledGraph(proto_output, precompiled_graph);
+}
+
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  // Validate command line options.
+  absl::Status status;
+  if (absl::GetFlag(FLAGS_proto_source).empty()) {
+    status.Update(
+        absl::InvalidArgumentError("--proto_source must be specified"));
+  }
+  if (absl::GetFlag(FLAGS_proto_output).empty()) {
+    status.Update(
+        absl::InvalidArgumentError("--proto_output must be specified"));
+  }
+  EXIT_IF_ERROR(status);
+  status = mediapipe::PrecompileGraph(
+      absl::GetFlag(FLAGS_proto_source),
+      absl::GetFlag(FLAGS_proto_source_is_text),
+      absl::GetFlag(FLAGS_proto_output));
+  EXIT_IF_ERROR(status);
+  return EXIT_SUCCESS;
+}
@@ -49,6 +49,9 @@ namespace mediapipe {
 
 namespace {
 
+// The PrecompiledGraph format produced by ValidatedGraphConfig::Precompile().
+constexpr int kPrecompiledGraphVersion = 1;
+
 // Create a debug std::string name for a set of edge.  An edge can be either
 // a stream or a side packet.
 std::string DebugEdgeNames(
@@ -362,26 +365,7 @@ absl::Status ValidatedGraphConfig::Initialize(
       input_config, graph_registry, graph_options, service_manager, &config_));
 
   // Initialize the basic node information.
-  MP_RETURN_IF_ERROR(InitializeGeneratorInfo());
-  MP_RETURN_IF_ERROR(InitializeCalculatorInfo());
-  MP_RETURN_IF_ERROR(InitializeStatusHandlerInfo());
-
-  sorted_nodes_.reserve(generators_.size() + calculators_.size());
-  // Initialize sorted_nodes_ to list generators before calculators.
-  for (int index = 0; index < generators_.size(); ++index) {
-    NodeTypeInfo* node_type_info = &generators_[index];
-    RET_CHECK(node_type_info->Node().type ==
-              NodeTypeInfo::NodeType::PACKET_GENERATOR);
-    RET_CHECK_EQ(node_type_info->Node().index, index);
-    sorted_nodes_.push_back(node_type_info);
-  }
-  for (int index = 0; index < calculators_.size(); ++index) {
-    NodeTypeInfo* node_type_info = &calculators_[index];
-    RET_CHECK(node_type_info->Node().type ==
-              NodeTypeInfo::NodeType::CALCULATOR);
-    RET_CHECK_EQ(node_type_info->Node().index, index);
-    sorted_nodes_.push_back(node_type_info);
-  }
+  MP_RETURN_IF_ERROR(InitializeNodeInfo());
 
   // Initialize the side packet information.
   bool need_sorting = false;
@@ -463,6 +447,97 @@ absl::Status ValidatedGraphConfig::Initialize(
                     service_manager);
 }
 
+absl::Status ValidatedGraphConfig::Initialize(
+    const PrecompiledGraph& precompiled_graph) {
+  RET_CHECK(!initialized_)
+      << "ValidatedGraphConfig can be initialized only once.";
+  RET_CHECK_EQ(precompiled_graph.version(), kPrecompiledGraphVersion)
+      << "Unsupported PrecompiledGraph version.";
+  config_ = precompiled_graph.config();
+
+  MP_RETURN_IF_ERROR(InitializeNodeInfo());
+  // The nodes are already sorted, so the edges are resolved in one pass.
+  MP_RETURN_IF_ERROR(InitializeSidePacketInfo(nullptr));
+  MP_RETURN_IF_ERROR(InitializeStreamInfo(nullptr));
+  if (input_streams_.size() != precompiled_graph.num_input_streams() ||
+      output_streams_.size() != precompiled_graph.num_output_streams() ||
+      input_side_packets_.size() !=
+          precompiled_graph.num_input_side_packets() ||
+      output_side_packets_.size() !=
+          precompiled_graph.num_output_side_packets()) {
+    return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
+           << "PrecompiledGraph does not match the contracts of the linked "
+              "calculators and must be regenerated.";
+  }
+  MP_RETURN_IF_ERROR(FillUpstreamFieldForBackEdges());
+
+  MP_RETURN_IF_ERROR(ResolveAnyTypes(&input_streams_, &output_streams_));
+  MP_RETURN_IF_ERROR(
+      ResolveAnyTypes(&input_side_packets_, &output_side_packets_));
+
+  MP_RETURN_IF_ERROR(ComputeSourceDependence());
+  initialized_ = true;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<PrecompiledGraph> ValidatedGraphConfig::Precompile() const {
+  RET_CHECK(initialized_) << "ValidatedGraphConfig is not initialized.";
+  PrecompiledGraph precompiled_graph;
+  precompiled_graph.set_version(kPrecompiledGraphVersion);
+  CalculatorGraphConfig* config = precompiled_graph.mutable_config();
+  *config = config_;
+  // Resolve the input stream handler of every node the same way as
+  // CalculatorNode: a handler set in the graph takes priority over the one
+  // requested by the calculator contract.
+  for (int index = 0; index < calculators_.size(); ++index) {
+    InputStreamHandlerConfig* handler_config =
+        config->mutable_node(index)->mutable_input_stream_handler();
+    const NodeTypeInfo& node_type_info = calculators_[index];
+    if (handler_config->has_input_stream_handler()) {
+      continue;
+    }
+    if (node_type_info.GetInputStreamHandler().empty()) {
+      // Make the default handler explicit.
+      handler_config->set_input_stream_handler(
+          handler_config->input_stream_handler());
+    } else {
+      handler_config->set_input_stream_handler(
+          node_type_info.GetInputStreamHandler());
+      *handler_config->mutable_options() =
+          node_type_info.GetInputStreamHandlerOptions();
+    }
+  }
+  precompiled_graph.set_num_input_streams(input_streams_.size());
+  precompiled_graph.set_num_output_streams(output_streams_.size());
+  precompiled_graph.set_num_input_side_packets(input_side_packets_.size());
+  precompiled_graph.set_num_output_side_packets(output_side_packets_.size());
+  return precompiled_graph;
+}
+
+absl::Status ValidatedGraphConfig::InitializeNodeInfo() {
+  MP_RETURN_IF_ERROR(InitializeGeneratorInfo());
+  MP_RETURN_IF_ERROR(InitializeCalculatorInfo());
+  MP_RETURN_IF_ERROR(InitializeStatusHandlerInfo());
+
+  sorted_nodes_.reserve(generators_.size() + calculators_.size());
+  // Initialize sorted_nodes_ to list generators before calculators.
+  for (int index = 0; index < generators_.size(); ++index) {
+    NodeTypeInfo* node_type_info = &generators_[index];
+    RET_CHECK(node_type_info->Node().type ==
+              NodeTypeInfo::NodeType::PACKET_GENERATOR);
+    RET_CHECK_EQ(node_type_info->Node().index, index);
+    sorted_nodes_.push_back(node_type_info);
+  }
+  for (int index = 0; index < calculators_.size(); ++index) {
+    NodeTypeInfo* node_type_info = &calculators_[index];
+    RET_CHECK(node_type_info->Node().type ==
+              NodeTypeInfo::NodeType::CALCULATOR);
+    RET_CHECK_EQ(node_type_info->Node().index, index);
+    sorted_nodes_.push_back(node_type_info);
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ValidatedGraphConfig::InitializeCalculatorInfo() {
   std::vector<absl::Status> statuses;
   calculators_.reserve(config_.node_size());
@@ -27,6 +27,7 @@
 #include "mediapipe/framework/port/map_util.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/precompiled_graph.pb.h"
 #include "mediapipe/framework/status_handler.pb.h"
 #include "mediapipe/framework/subgraph.h"
 
@@ -224,6 +225,16 @@ class ValidatedGraphConfig {
       const Subgraph::SubgraphOptions* graph_options = nullptr,
       const GraphServiceManager* service_manager = nullptr);
 
+  // Initializes the ValidatedGraphConfig from a graph produced by
+  // Precompile().  The canonical config is used as is: subgraph expansion,
+  // topological sorting and type validation are skipped.  The contracts of
+  // the nodes are still collected from the linked calculators.
+  absl::Status Initialize(const PrecompiledGraph& precompiled_graph);
+
+  // Returns a snapshot of this graph which can be loaded with
+  // Initialize(const PrecompiledGraph&) without repeating the validation.
+  absl::StatusOr<PrecompiledGraph> Precompile() const;
+
   // Returns true if the ValidatedGraphConfig has been initialized.
   bool Initialized() const { return initialized_; }
 
@@ -309,6 +320,9 @@ class ValidatedGraphConfig {
   absl::Status InitializeCalculatorInfo();
   // Initialize the StatusHandler information.
   absl::Status InitializeStatusHandlerInfo();
+  // Initialize the info objects of all nodes and list the generators and
+  // calculators in sorted_nodes_.
+  absl::Status InitializeNodeInfo();
 
   // Initialize the EdgeInfo objects for side packets.
   //
@@ -12,6 +12,7 @@
 #include "mediapipe/framework/graph_service.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 
 namespace mediapipe {
@@ -163,4 +164,95 @@ TEST(ValidatedGraphConfigTest, InitializeSubgraphWithServiceCalculatorB) {
   }
 }
 
+// Nodes listed out of order, with a subgraph to expand.
+CalculatorGraphConfig UnsortedGraphConfig() {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "NN:a"
+    node {
+      calculator: "CalculatorB"
+      input_stream: "NN:b"
+      output_stream: "NN:c"
+    }
+    node {
+      calculator: "CalculatorA"
+      input_stream: "NN:a"
+      output_stream: "NN:b"
+    }
+    node { calculator: "AlwaysCalculatorASubgraph" }
+  )pb");
+}
+
+TEST(ValidatedGraphConfigTest, PrecompileStoresSortedExpandedConfig) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedGraphConfig()));
+  absl::StatusOr<PrecompiledGraph> precompiled = config.Precompile();
+  MP_ASSERT_OK(precompiled);
+
+  const CalculatorGraphConfig& snapshot = precompiled->config();
+  ASSERT_EQ(3, snapshot.node_size());
+  EXPECT_EQ("CalculatorA", snapshot.node(0).calculator());
+  EXPECT_EQ("CalculatorB", snapshot.node(1).calculator());
+  EXPECT_EQ("alwayscalculatorasubgraph__CalculatorA", snapshot.node(2).name());
+  for (const auto& node : snapshot.node()) {
+    EXPECT_TRUE(node.input_stream_handler().has_input_stream_handler());
+    EXPECT_EQ("DefaultInputStreamHandler",
+              node.input_stream_handler().input_stream_handler());
+  }
+  EXPECT_EQ(config.InputStreamInfos().size(), precompiled->num_input_streams());
+  EXPECT_EQ(config.OutputStreamInfos().size(),
+            precompiled->num_output_streams());
+}
+
+TEST(ValidatedGraphConfigTest, InitializeFromPrecompiledGraph) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedGraphConfig()));
+  absl::StatusOr<PrecompiledGraph> precompiled = config.Precompile();
+  MP_ASSERT_OK(precompiled);
+
+  ValidatedGraphConfig loaded;
+  MP_ASSERT_OK(loaded.Initialize(*precompiled));
+  ASSERT_TRUE(loaded.Initialized());
+  EXPECT_THAT(loaded.Config(), EqualsProto(precompiled->config()));
+  ASSERT_EQ(config.InputStreamInfos().size(), loaded.InputStreamInfos().size());
+  for (int i = 0; i < config.InputStreamInfos().size(); ++i) {
+    EXPECT_EQ(config.InputStreamInfos()[i].name,
+              loaded.InputStreamInfos()[i].name);
+    EXPECT_EQ(config.InputStreamInfos()[i].upstream,
+              loaded.InputStreamInfos()[i].upstream);
+  }
+  EXPECT_EQ(config.OutputStreamIndex("c"), loaded.OutputStreamIndex("c"));
+}
+
+TEST(ValidatedGraphConfigTest, RejectsMismatchedPrecompiledGraph) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedGraphConfig()));
+  absl::StatusOr<PrecompiledGraph> precompiled = config.Precompile();
+  MP_ASSERT_OK(precompiled);
+
+  PrecompiledGraph wrong_version = *precompiled;
+  wrong_version.set_version(precompiled->version() + 1);
+  EXPECT_FALSE(ValidatedGraphConfig().Initialize(wrong_version).ok());
+
+  PrecompiledGraph wrong_streams = *precompiled;
+  wrong_streams.set_num_output_streams(precompiled->num_output_streams() + 1);
+  EXPECT_EQ(ValidatedGraphConfig().Initialize(wrong_streams).code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST(ValidatedGraphConfigTest, RunsCalculatorGraphFromPrecompiledGraph) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedGraphConfig()));
+  absl::StatusOr<PrecompiledGraph> precompiled = config.Precompile();
+  MP_ASSERT_OK(precompiled);
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(*precompiled));
+  EXPECT_THAT(graph.Config(), EqualsProto(precompiled->config()));
+  MP_ASSERT_OK(graph.StartRun({}));
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "a", MakePacket<int>(1).At(Timestamp(0))));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
 }  // namespace mediapipe
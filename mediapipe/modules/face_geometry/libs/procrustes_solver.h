@@ -19,6 +19,7 @@
 
 #include "Eigen/Dense"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
 
 namespace mediapipe::face_geometry {
 
@@ -65,6 +66,45 @@ class ProcrustesSolver {
 
 std::unique_ptr<ProcrustesSolver> CreateFloatPrecisionProcrustesSolver();
 
+// Encapsulates a solver for the WEOP Problem with a fixed source point cloud
+// and point weights, and a changing target point cloud, such as the canonical
+// face landmarks fitted to the runtime face landmarks.
+//
+// The source center of mass and spread are computed upon creation, and points
+// with a zero weight are skipped, so that each solution takes a single pass
+// over the weighted target points and no memory allocation. The estimated
+// transformation is the same as that of `ProcrustesSolver`, up to the floating
+// point rounding.
+class FixedSourceProcrustesSolver {
+ public:
+  virtual ~FixedSourceProcrustesSolver() = default;
+
+  // Solves the WEOP Problem for the source points and point weights passed
+  // upon creation.
+  //
+  // `target_points` must define the same number of points as the source
+  // points. The same numerical limitations as for
+  // `ProcrustesSolver::SolveWeightedOrthogonalProblem()` apply.
+  //
+  // Note: the output `transform_mat` argument is used instead of `StatusOr<>`
+  // return type in order to avoid Eigen memory alignment issues. Details:
+  // https://eigen.tuxfamily.org/dox/group__TopicStructHavingEigenMembers.html
+  virtual absl::Status SolveWeightedOrthogonalProblem(
+      const Eigen::Matrix3Xf& target_points,
+      Eigen::Matrix4f& transform_mat) const = 0;
+};
+
+// Creates a `FixedSourceProcrustesSolver` for `source_points` and
+// `point_weights`.
+//
+// Both must define the same positive number of points, elements of
+// `point_weights` must be non-negative and the weighted source point cloud
+// must be neither too light nor too compact.
+absl::StatusOr<std::unique_ptr<FixedSourceProcrustesSolver>>
+CreateFloatPrecisionFixedSourceProcrustesSolver(
+    const Eigen::Matrix3Xf& source_points,
+    const Eigen::VectorXf& point_weights);
+
 }  // namespace mediapipe::face_geometry
 
 #endif  // MEDIAPIPE_FACE_GEOMETRY_LIBS_PROCRUSTES_SOLVER_H_
@@ -0,0 +1,295 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/modules/face_geometry/libs/procrustes_solver.h"
+
+#include <memory>
+#include <random>
+#include <string>
+
+#include "Eigen/Dense"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/modules/face_geometry/protos/geometry_pipeline_metadata.pb.h"
+#include "mediapipe/modules/face_geometry/protos/mesh_3d.pb.h"
+
+namespace mediapipe::face_geometry {
+namespace {
+
+constexpr char kDataDir[] = "mediapipe/modules/face_geometry/data";
+
+// The relative tolerance of the fixed-source solver, which sums the same
+// terms as the reference solver in a different order.
+constexpr float kTolerance = 1e-4f;
+
+struct ProcrustesProblem {
+  Eigen::Matrix3Xf source_points;
+  Eigen::VectorXf point_weights;
+};
+
+// Returns the canonical mesh vertices and the Procrustes landmark basis
+// weights of a geometry pipeline metadata file. Vertices outside the basis
+// have a zero weight.
+ProcrustesProblem LoadProblem(const std::string& metadata_file) {
+  std::string metadata_blob;
+  MP_EXPECT_OK(file::GetContents(
+      file::JoinPath("./", kDataDir, metadata_file), &metadata_blob));
+  GeometryPipelineMetadata metadata;
+  EXPECT_TRUE(metadata.ParseFromString(metadata_blob));
+
+  const Mesh3d& mesh = metadata.canonical_mesh();
+  EXPECT_EQ(mesh.vertex_type(), Mesh3d::VERTEX_PT);
+  constexpr int kVertexSize = 5;
+  const int num_points = mesh.vertex_buffer_size() / kVertexSize;
+
+  ProcrustesProblem problem;
+  problem.source_points.resize(3, num_points);
+  for (int i = 0; i < num_points; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      problem.source_points(j, i) = mesh.vertex_buffer(i * kVertexSize + j);
+    }
+  }
+  problem.point_weights = Eigen::VectorXf::Zero(num_points);
+  for (const auto& landmark : metadata.procrustes_landmark_basis()) {
+    problem.point_weights(landmark.landmark_id()) = landmark.weight();
+  }
+  return problem;
+}
+
+// Returns a random scaled rotation, optionally composed with a reflection,
+// and translation.
+Eigen::Matrix4f RandomTransform(std::mt19937& random, bool reflect) {
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  std::uniform_real_distribution<float> scale(0.5f, 2.f);
+  const Eigen::Quaternionf rotation =
+      Eigen::Quaternionf(unit(random), unit(random), unit(random),
+                         unit(random))
+          .normalized();
+
+  Eigen::Matrix4f transform = Eigen::Matrix4f::Identity();
+  transform.topLeftCorner<3, 3>() = scale(random) * rotation.matrix();
+  if (reflect) {
+    transform.col(0).head<3>() *= -1.f;
+  }
+  transform.col(3).head<3>() =
+      20.f * Eigen::Vector3f(unit(random), unit(random), unit(random));
+  return transform;
+}
+
+// Maps the source points with `transform` and adds Gaussian noise.
+Eigen::Matrix3Xf TransformPoints(const Eigen::Matrix3Xf& source_points,
+                                 const Eigen::Matrix4f& transform,
+                                 float noise_stddev, std::mt19937& random) {
+  std::normal_distribution<float> noise(0.f, noise_stddev);
+  Eigen::Matrix3Xf target_points =
+      (transform.topLeftCorner<3, 3>() * source_points).colwise() +
+      transform.col(3).head<3>();
+  for (int i = 0; i < target_points.size(); ++i) {
+    target_points.data()[i] += noise(random);
+  }
+  return target_points;
+}
+
+void ExpectSameTransform(const Eigen::Matrix4f& actual,
+                         const Eigen::Matrix4f& expected) {
+  EXPECT_TRUE(actual.isApprox(expected, kTolerance))
+      << "actual:\n"
+      << actual << "\nexpected:\n"
+      << expected;
+}
+
+// Solves the problem for `target_points` with both solvers and expects the
+// same transformation.
+void ExpectSameSolution(const ProcrustesProblem& problem,
+                        const FixedSourceProcrustesSolver& fixed_solver,
+                        const Eigen::Matrix3Xf& target_points) {
+  Eigen::Matrix4f expected;
+  MP_ASSERT_OK(CreateFloatPrecisionProcrustesSolver()
+                   ->SolveWeightedOrthogonalProblem(
+                       problem.source_points, target_points,
+                       problem.point_weights, expected));
+  Eigen::Matrix4f actual;
+  MP_ASSERT_OK(
+      fixed_solver.SolveWeightedOrthogonalProblem(target_points, actual));
+  ExpectSameTransform(actual, expected);
+}
+
+class ProcrustesSolverMetadataTest
+    : public testing::TestWithParam<std::string> {};
+
+TEST_P(ProcrustesSolverMetadataTest, FixedSourceMatchesReference) {
+  const ProcrustesProblem problem = LoadProblem(GetParam());
+  auto fixed_solver = CreateFloatPrecisionFixedSourceProcrustesSolver(
+      problem.source_points, problem.point_weights);
+  MP_ASSERT_OK(fixed_solver);
+
+  std::mt19937 random(0);
+  for (int i = 0; i < 100; ++i) {
+    const Eigen::Matrix3Xf target_points = TransformPoints(
+        problem.source_points, RandomTransform(random, /*reflect=*/false),
+        /*noise_stddev=*/0.5f, random);
+    ExpectSameSolution(problem, *fixed_solver.value(), target_points);
+  }
+}
+
+TEST_P(ProcrustesSolverMetadataTest, FixedSourceMatchesReferenceOnReflection) {
+  const ProcrustesProblem problem = LoadProblem(GetParam());
+  auto fixed_solver = CreateFloatPrecisionFixedSourceProcrustesSolver(
+      problem.source_points, problem.point_weights);
+  MP_ASSERT_OK(fixed_solver);
+
+  std::mt19937 random(0);
+  for (int i = 0; i < 100; ++i) {
+    const Eigen::Matrix3Xf target_points = TransformPoints(
+        problem.source_points, RandomTransform(random, /*reflect=*/true),
+        /*noise_stddev=*/0.f, random);
+    ExpectSameSolution(problem, *fixed_solver.value(), target_points);
+
+    // A reflection is never estimated.
+    Eigen::Matrix4f transform;
+    MP_ASSERT_OK(fixed_solver.value()->SolveWeightedOrthogonalProblem(
+        target_points, transform));
+    const Eigen::Matrix3f rotation_and_scale = transform.topLeftCorner<3, 3>();
+    EXPECT_GT(rotation_and_scale.determinant(), 0.f);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    GeometryPipelineMetadata, ProcrustesSolverMetadataTest,
+    testing::Values("geometry_pipeline_metadata_landmarks.binarypb",
+                    "geometry_pipeline_metadata_detection.binarypb"));
+
+TEST(ProcrustesSolverTest, FixedSourceMatchesReferenceOnRandomClouds) {
+  std::mt19937 random(0);
+  std::uniform_real_distribution<float> coordinate(-10.f, 10.f);
+  std::uniform_real_distribution<float> weight(0.f, 1.f);
+  for (int i = 0; i < 100; ++i) {
+    ProcrustesProblem problem;
+    problem.source_points.resize(3, 50);
+    problem.point_weights.resize(50);
+    for (int j = 0; j < 50; ++j) {
+      problem.source_points.col(j) = Eigen::Vector3f(
+          coordinate(random), coordinate(random), coordinate(random));
+      // About a third of the points have a zero weight.
+      const float w = weight(random);
+      problem.point_weights(j) = w < 0.3f ? 0.f : w;
+    }
+    auto fixed_solver = CreateFloatPrecisionFixedSourceProcrustesSolver(
+        problem.source_points, problem.point_weights);
+    MP_ASSERT_OK(fixed_solver);
+
+    Eigen::Matrix3Xf target_points = TransformPoints(
+        problem.source_points, RandomTransform(random, /*reflect=*/i % 2),
+        /*noise_stddev=*/1.f, random);
+    ExpectSameSolution(problem, *fixed_solver.value(), target_points);
+
+    // Zero-weight target points don't affect the solution.
+    Eigen::Matrix4f expected;
+    MP_ASSERT_OK(fixed_solver.value()->SolveWeightedOrthogonalProblem(
+        target_points, expected));
+    for (int j = 0; j < 50; ++j) {
+      if (problem.point_weights(j) == 0.f) {
+        target_points.col(j).setConstant(1e6f);
+      }
+    }
+    Eigen::Matrix4f actual;
+    MP_ASSERT_OK(fixed_solver.value()->SolveWeightedOrthogonalProblem(
+        target_points, actual));
+    EXPECT_EQ(actual, expected);
+  }
+}
+
+TEST(ProcrustesSolverTest, FixedSourceRecoversExactTransform) {
+  const ProcrustesProblem problem =
+      LoadProblem("geometry_pipeline_metadata_landmarks.binarypb");
+  auto fixed_solver = CreateFloatPrecisionFixedSourceProcrustesSolver(
+      problem.source_points, problem.point_weights);
+  MP_ASSERT_OK(fixed_solver);
+
+  std::mt19937 random(0);
+  const Eigen::Matrix4f expected = RandomTransform(random, /*reflect=*/false);
+  Eigen::Matrix4f actual;
+  MP_ASSERT_OK(fixed_solver.value()->SolveWeightedOrthogonalProblem(
+      TransformPoints(problem.source_points, expected, /*noise_stddev=*/0.f,
+                      random),
+      actual));
+  ExpectSameTransform(actual, expected);
+}
+
+TEST(ProcrustesSolverTest, FixedSourceRejectsInvalidWeights) {
+  const Eigen::Matrix3Xf source_points = Eigen::Matrix3Xf::Random(3, 4);
+
+  EXPECT_FALSE(CreateFloatPrecisionFixedSourceProcrustesSolver(
+                   source_points, Eigen::VectorXf::Ones(3))
+                   .ok());
+  EXPECT_FALSE(CreateFloatPrecisionFixedSourceProcrustesSolver(
+                   source_points, Eigen::VectorXf::Zero(4))
+                   .ok());
+  Eigen::VectorXf negative_weights = Eigen::VectorXf::Ones(4);
+  negative_weights(2) = -1.f;
+  EXPECT_FALSE(CreateFloatPrecisionFixedSourceProcrustesSolver(
+                   source_points, negative_weights)
+                   .ok());
+  EXPECT_FALSE(CreateFloatPrecisionFixedSourceProcrustesSolver(
+                   Eigen::Matrix3Xf(3, 0), Eigen::VectorXf(0))
+                   .ok());
+}
+
+TEST(ProcrustesSolverTest, FixedSourceRejectsCompactSource) {
+  // The weighted source points coincide, only the zero-weight one differs.
+  Eigen::Matrix3Xf source_points(3, 4);
+  source_points << 1.f, 1.f, 1.f, 5.f,  //
+      2.f, 2.f, 2.f, 6.f,               //
+      3.f, 3.f, 3.f, 7.f;
+  Eigen::VectorXf point_weights(4);
+  point_weights << 1.f, 0.5f, 2.f, 0.f;
+
+  EXPECT_FALSE(CreateFloatPrecisionFixedSourceProcrustesSolver(
+                   source_points, point_weights)
+                   .ok());
+}
+
+TEST(ProcrustesSolverTest, BothSolversRejectDegenerateTargets) {
+  const ProcrustesProblem problem =
+      LoadProblem("geometry_pipeline_metadata_landmarks.binarypb");
+  auto fixed_solver = CreateFloatPrecisionFixedSourceProcrustesSolver(
+      problem.source_points, problem.point_weights);
+  MP_ASSERT_OK(fixed_solver);
+  const auto reference_solver = CreateFloatPrecisionProcrustesSolver();
+  const int num_points = problem.source_points.cols();
+
+  // All target points are at the origin.
+  const Eigen::Matrix3Xf target_points = Eigen::Matrix3Xf::Zero(3, num_points);
+  Eigen::Matrix4f transform;
+  EXPECT_FALSE(
+      reference_solver
+          ->SolveWeightedOrthogonalProblem(problem.source_points, target_points,
+                                           problem.point_weights, transform)
+          .ok());
+  EXPECT_FALSE(fixed_solver.value()
+                   ->SolveWeightedOrthogonalProblem(target_points, transform)
+                   .ok());
+
+  // The number of target points differs.
+  EXPECT_FALSE(fixed_solver.value()
+                   ->SolveWeightedOrthogonalProblem(
+                       Eigen::Matrix3Xf::Zero(3, num_points - 1), transform)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace mediapipe::face_geometry
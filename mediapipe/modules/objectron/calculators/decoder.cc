@@ -14,7 +14,9 @@
 
 #include "mediapipe/modules/objectron/calculators/decoder.h"
 
+#include <algorithm>
 #include <limits>
+#include <utility>
 #include <vector>
 
 #include "Eigen/Core"
@@ -22,7 +24,6 @@
 #include "absl/status/status.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/logging.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/modules/objectron/calculators/annotation_data.pb.h"
 #include "mediapipe/modules/objectron/calculators/box.h"
@@ -36,6 +37,10 @@ constexpr int kNumKeypoints = 9;
 
 namespace {
 
+// The (x, y) coordinates of the 8 box vertices, one vertex per column. The
+// memory layout matches the offset channels of a pixel.
+using KeypointArray = Eigen::Array<float, 2, Decoder::kNumOffsetmaps / 2>;
+
 inline void SetPoint3d(const Eigen::Vector3f& point_vec, Point3D* point_3d) {
   point_3d->set_x(point_vec.x());
   point_3d->set_y(point_vec.y());
@@ -50,30 +55,47 @@ FrameAnnotation Decoder::DecodeBoundingBoxKeypoints(
   CHECK_EQ(kNumOffsetmaps, offsetmap.channels());
   CHECK_EQ(heatmap.cols, offsetmap.cols);
   CHECK_EQ(heatmap.rows, offsetmap.rows);
+  CHECK_EQ(CV_32F, heatmap.depth());
+  CHECK_EQ(CV_32F, offsetmap.depth());
+
+  // Matrices wrapping tensors are continuous, other ones are copied.
+  const cv::Mat continuous_heatmap =
+      heatmap.isContinuous() ? heatmap : heatmap.clone();
+  const cv::Mat continuous_offsetmap =
+      offsetmap.isContinuous() ? offsetmap : offsetmap.clone();
+  return DecodeBoundingBoxKeypoints(continuous_heatmap.ptr<float>(),
+                                    continuous_offsetmap.ptr<float>(),
+                                    heatmap.cols, heatmap.rows);
+}
 
-  const float offset_scale = std::min(offsetmap.cols, offsetmap.rows);
-  const std::vector<cv::Point> center_points = ExtractCenterKeypoints(heatmap);
+FrameAnnotation Decoder::DecodeBoundingBoxKeypoints(const float* heatmap,
+                                                    const float* offsetmap,
+                                                    int width,
+                                                    int height) const {
+  const float offset_scale = std::min(width, height);
+  const std::vector<std::pair<int, int>> center_points =
+      ExtractCenterKeypoints(heatmap, width, height);
   std::vector<BeliefBox> boxes;
   for (const auto& center_point : center_points) {
+    const int center_x = center_point.first;
+    const int center_y = center_point.second;
     BeliefBox box;
-    box.box_2d.emplace_back(center_point.x, center_point.y);
-    const int center_x = static_cast<int>(std::round(center_point.x));
-    const int center_y = static_cast<int>(std::round(center_point.y));
-    box.belief = heatmap.at<float>(center_y, center_x);
+    box.box_2d.emplace_back(center_x, center_y);
+    box.belief = heatmap[center_y * width + center_x];
     if (config_.voting_radius() > 1) {
-      DecodeByVoting(heatmap, offsetmap, center_x, center_y, offset_scale,
-                     offset_scale, &box);
+      DecodeByVoting(heatmap, offsetmap, width, height, center_x, center_y,
+                     offset_scale, offset_scale, &box);
     } else {
-      DecodeByPeak(offsetmap, center_x, center_y, offset_scale, offset_scale,
-                   &box);
+      DecodeByPeak(offsetmap, width, center_x, center_y, offset_scale,
+                   offset_scale, &box);
     }
     if (IsNewBox(&boxes, &box)) {
       boxes.push_back(std::move(box));
     }
   }
 
-  const float x_scale = 1.0f / offsetmap.cols;
-  const float y_scale = 1.0f / offsetmap.rows;
+  const float x_scale = 1.0f / width;
+  const float y_scale = 1.0f / height;
   FrameAnnotation frame_annotations;
   for (const auto& box : boxes) {
     auto* object = frame_annotations.add_annotations();
@@ -86,11 +108,11 @@ FrameAnnotation Decoder::DecodeBoundingBoxKeypoints(
   return frame_annotations;
 }
 
-void Decoder::DecodeByPeak(const cv::Mat& offsetmap, int center_x, int center_y,
-                           float offset_scale_x, float offset_scale_y,
-                           BeliefBox* box) const {
-  const auto& offset = offsetmap.at<cv::Vec<float, kNumOffsetmaps>>(
-      /*row*/ center_y, /*col*/ center_x);
+void Decoder::DecodeByPeak(const float* offsetmap, int width, int center_x,
+                           int center_y, float offset_scale_x,
+                           float offset_scale_y, BeliefBox* box) const {
+  const float* offset =
+      offsetmap + (center_y * width + center_x) * kNumOffsetmaps;
   for (int i = 0; i < kNumOffsetmaps / 2; ++i) {
     const float x_offset = offset[2 * i] * offset_scale_x;
     const float y_offset = offset[2 * i + 1] * offset_scale_y;
@@ -98,58 +120,62 @@ void Decoder::DecodeByPeak(const cv::Mat& offsetmap, int center_x, int center_y,
   }
 }
 
-void Decoder::DecodeByVoting(const cv::Mat& heatmap, const cv::Mat& offsetmap,
-                             int center_x, int center_y, float offset_scale_x,
-                             float offset_scale_y, BeliefBox* box) const {
+void Decoder::DecodeByVoting(const float* heatmap, const float* offsetmap,
+                             int width, int height, int center_x, int center_y,
+                             float offset_scale_x, float offset_scale_y,
+                             BeliefBox* box) const {
+  // The (x, y) votes for all the keypoints are computed at once, with one
+  // column per keypoint, in the memory layout of the offset channels.
+  KeypointArray offset_scale;
+  offset_scale.row(0).setConstant(offset_scale_x);
+  offset_scale.row(1).setConstant(offset_scale_y);
+  const auto votes_at = [&](int x, int y) -> KeypointArray {
+    KeypointArray pixel;
+    pixel.row(0).setConstant(x);
+    pixel.row(1).setConstant(y);
+    return pixel +
+           Eigen::Map<const KeypointArray>(
+               offsetmap + (y * width + x) * kNumOffsetmaps) *
+               offset_scale;
+  };
+
   // Votes at the center.
-  const auto& center_offset = offsetmap.at<cv::Vec<float, kNumOffsetmaps>>(
-      /*row*/ center_y, /*col*/ center_x);
-  std::vector<float> center_votes(kNumOffsetmaps, 0.f);
-  for (int i = 0; i < kNumOffsetmaps / 2; ++i) {
-    center_votes[2 * i] = center_x + center_offset[2 * i] * offset_scale_x;
-    center_votes[2 * i + 1] =
-        center_y + center_offset[2 * i + 1] * offset_scale_y;
-  }
+  const KeypointArray center_votes = votes_at(center_x, center_y);
 
   // Find voting window.
-  int x_min = std::max(0, center_x - config_.voting_radius());
-  int y_min = std::max(0, center_y - config_.voting_radius());
-  int width = std::min(heatmap.cols - x_min, config_.voting_radius() * 2 + 1);
-  int height = std::min(heatmap.rows - y_min, config_.voting_radius() * 2 + 1);
-  cv::Rect rect(x_min, y_min, width, height);
-  cv::Mat heat = heatmap(rect);
-  cv::Mat offset = offsetmap(rect);
+  const int x_min = std::max(0, center_x - config_.voting_radius());
+  const int y_min = std::max(0, center_y - config_.voting_radius());
+  const int x_end =
+      x_min + std::min(width - x_min, config_.voting_radius() * 2 + 1);
+  const int y_end =
+      y_min + std::min(height - y_min, config_.voting_radius() * 2 + 1);
 
-  for (int i = 0; i < kNumOffsetmaps / 2; ++i) {
-    float x_sum = 0.f;
-    float y_sum = 0.f;
-    float votes = 0.f;
-    for (int r = 0; r < heat.rows; ++r) {
-      for (int c = 0; c < heat.cols; ++c) {
-        const float belief = heat.at<float>(r, c);
-        if (belief < config_.voting_threshold()) {
-          continue;
-        }
-        float offset_x =
-            offset.at<cv::Vec<float, kNumOffsetmaps>>(r, c)[2 * i] *
-            offset_scale_x;
-        float offset_y =
-            offset.at<cv::Vec<float, kNumOffsetmaps>>(r, c)[2 * i + 1] *
-            offset_scale_y;
-        float vote_x = c + rect.x + offset_x;
-        float vote_y = r + rect.y + offset_y;
-        float x_diff = std::abs(vote_x - center_votes[2 * i]);
-        float y_diff = std::abs(vote_y - center_votes[2 * i + 1]);
-        if (x_diff > config_.voting_allowance() ||
-            y_diff > config_.voting_allowance()) {
-          continue;
-        }
-        x_sum += vote_x * belief;
-        y_sum += vote_y * belief;
-        votes += belief;
+  const float voting_allowance = config_.voting_allowance();
+  KeypointArray weighted_votes = KeypointArray::Zero();
+  Eigen::Array<float, 1, kNumOffsetmaps / 2> votes =
+      Eigen::Array<float, 1, kNumOffsetmaps / 2>::Zero();
+  for (int r = y_min; r < y_end; ++r) {
+    for (int c = x_min; c < x_end; ++c) {
+      const float belief = heatmap[r * width + c];
+      if (belief < config_.voting_threshold()) {
+        continue;
       }
+      const KeypointArray pixel_votes = votes_at(c, r);
+      // A pixel votes for a keypoint if both coordinates of its vote are
+      // within the allowance of the vote at the center.
+      const Eigen::Array<float, 1, kNumOffsetmaps / 2> weights =
+          ((pixel_votes - center_votes).abs() <= voting_allowance)
+              .colwise()
+              .all()
+              .cast<float>() *
+          belief;
+      weighted_votes += pixel_votes.rowwise() * weights;
+      votes += weights;
     }
-    box->box_2d.emplace_back(x_sum / votes, y_sum / votes);
+  }
+  for (int i = 0; i < kNumOffsetmaps / 2; ++i) {
+    box->box_2d.emplace_back(weighted_votes(0, i) / votes(i),
+                             weighted_votes(1, i) / votes(i));
   }
 }
 
@@ -181,20 +207,59 @@ bool Decoder::IsIdentical(const BeliefBox& box_1,
   return true;
 }
 
-std::vector<cv::Point> Decoder::ExtractCenterKeypoints(
-    const cv::Mat& center_heatmap) const {
-  cv::Mat max_filtered_heatmap(center_heatmap.rows, center_heatmap.cols,
-                               center_heatmap.type());
-  const int kernel_size =
-      static_cast<int>(config_.local_max_distance() * 2 + 1 + 0.5f);
-  const cv::Size morph_size(kernel_size, kernel_size);
-  cv::dilate(center_heatmap, max_filtered_heatmap,
-             cv::getStructuringElement(cv::MORPH_RECT, morph_size));
-  cv::Mat peak_map;
-  cv::bitwise_and((center_heatmap >= max_filtered_heatmap),
-                  (center_heatmap >= config_.heatmap_threshold()), peak_map);
-  std::vector<cv::Point> locations;  // output, locations of non-zero pixels
-  cv::findNonZero(peak_map, locations);
+std::vector<std::pair<int, int>> Decoder::ExtractCenterKeypoints(
+    const float* center_heatmap, int width, int height) const {
+  // A peak is a pixel that is the maximum of the kernel window around it, like
+  // in a dilation with a square kernel. The window is separable: the maxima
+  // along each row are computed once, for a ring of kernel_size rows, and
+  // the pixels above the threshold are compared with the maxima of the rows
+  // around them. This reads the heatmap once, row by row.
+  const int kernel_size = std::max(
+      1, static_cast<int>(config_.local_max_distance() * 2 + 1 + 0.5f));
+  const int before = kernel_size / 2;
+  const int after = kernel_size - 1 - before;
+  const float heatmap_threshold = config_.heatmap_threshold();
+
+  std::vector<float> row_maxima(kernel_size * width);
+  const auto compute_row_maxima = [&](int y) {
+    const float* row = center_heatmap + y * width;
+    float* maxima = &row_maxima[(y % kernel_size) * width];
+    std::copy(row, row + width, maxima);
+    for (int d = 1; d <= before && d < width; ++d) {
+      for (int x = d; x < width; ++x) {
+        maxima[x] = std::max(maxima[x], row[x - d]);
+      }
+    }
+    for (int d = 1; d <= after && d < width; ++d) {
+      for (int x = 0; x < width - d; ++x) {
+        maxima[x] = std::max(maxima[x], row[x + d]);
+      }
+    }
+  };
+
+  std::vector<std::pair<int, int>> locations;
+  int next_row = 0;
+  for (int y = 0; y < height; ++y) {
+    const int last_row = std::min(height - 1, y + after);
+    for (; next_row <= last_row; ++next_row) {
+      compute_row_maxima(next_row);
+    }
+    const int first_row = std::max(0, y - before);
+    const float* row = center_heatmap + y * width;
+    for (int x = 0; x < width; ++x) {
+      const float value = row[x];
+      if (!(value >= heatmap_threshold)) {
+        continue;
+      }
+      bool is_peak = true;
+      for (int r = first_row; r <= last_row && is_peak; ++r) {
+        is_peak = value >= row_maxima[(r % kernel_size) * width + x];
+      }
+      if (is_peak) {
+        locations.emplace_back(x, y);
+      }
+    }
+  }
   return locations;
 }
 
@@ -15,6 +15,7 @@
 #ifndef MEDIAPIPE_MODULES_OBJECTRON_CALCULATORS_DECODER_H_
 #define MEDIAPIPE_MODULES_OBJECTRON_CALCULATORS_DECODER_H_
 
+#include <utility>
 #include <vector>
 
 #include "Eigen/Dense"
@@ -50,6 +51,13 @@ class Decoder {
   FrameAnnotation DecodeBoundingBoxKeypoints(const cv::Mat& heatmap,
                                              const cv::Mat& offsetmap) const;
 
+  // Same as above, on the native layout of the network output tensors:
+  //   heatmap: height x width floats, row by row
+  //   offsetmap: height x width x kNumOffsetmaps floats, row by row
+  FrameAnnotation DecodeBoundingBoxKeypoints(const float* heatmap,
+                                             const float* offsetmap, int width,
+                                             int height) const;
+
   // Lifts the estimated 2D projections of bounding box vertices to 3D.
   // This function uses the EPnP approach described in this paper:
   // https://icwww.epfl.ch/~lepetit/papers/lepetit_ijcv08.pdf .
@@ -76,18 +84,21 @@ class Decoder {
     std::vector<std::pair<float, float>> box_2d;
   };
 
-  std::vector<cv::Point> ExtractCenterKeypoints(
-      const cv::Mat& center_heatmap) const;
+  // Returns the (x, y) locations of the local maxima of the heatmap that are
+  // above the heatmap threshold, row by row.
+  std::vector<std::pair<int, int>> ExtractCenterKeypoints(
+      const float* center_heatmap, int width, int height) const;
 
   // Decodes 2D keypoints at the peak point.
-  void DecodeByPeak(const cv::Mat& offsetmap, int center_x, int center_y,
-                    float offset_scale_x, float offset_scale_y,
+  void DecodeByPeak(const float* offsetmap, int width, int center_x,
+                    int center_y, float offset_scale_x, float offset_scale_y,
                     BeliefBox* box) const;
 
   // Decodes 2D keypoints by voting around the peak.
-  void DecodeByVoting(const cv::Mat& heatmap, const cv::Mat& offsetmap,
-                      int center_x, int center_y, float offset_scale_x,
-                      float offset_scale_y, BeliefBox* box) const;
+  void DecodeByVoting(const float* heatmap, const float* offsetmap, int width,
+                      int height, int center_x, int center_y,
+                      float offset_scale_x, float offset_scale_y,
+                      BeliefBox* box) const;
 
   // Returns true if it is a new box. Otherwise, it may replace an existing box
   // if the new box's belief is higher.
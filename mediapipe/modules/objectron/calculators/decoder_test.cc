@@ -0,0 +1,127 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/modules/objectron/calculators/decoder.h"
+
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/modules/objectron/calculators/annotation_data.pb.h"
+#include "mediapipe/modules/objectron/calculators/belief_decoder_config.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kWidth = 16;
+constexpr int kHeight = 16;
+constexpr float kOffsetScale = 16.0f;
+
+class DecoderTest : public ::testing::Test {
+ protected:
+  DecoderTest()
+      : heatmap_(kWidth * kHeight, 0.0f),
+        offsetmap_(kWidth * kHeight * Decoder::kNumOffsetmaps, 0.0f) {}
+
+  float& Heat(int x, int y) { return heatmap_[y * kWidth + x]; }
+
+  // Sets the offsets of the given keypoint at (x, y) to point at the target.
+  void SetKeypointTarget(int x, int y, int keypoint, float target_x,
+                         float target_y) {
+    float* offset =
+        &offsetmap_[(y * kWidth + x) * Decoder::kNumOffsetmaps + 2 * keypoint];
+    offset[0] = (target_x - x) / kOffsetScale;
+    offset[1] = (target_y - y) / kOffsetScale;
+  }
+
+  FrameAnnotation Decode(const std::string& config) {
+    Decoder decoder(ParseTextProtoOrDie<BeliefDecoderConfig>(config));
+    return decoder.DecodeBoundingBoxKeypoints(
+        heatmap_.data(), offsetmap_.data(), kWidth, kHeight);
+  }
+
+  static void ExpectKeypoint(const ObjectAnnotation& object, int keypoint,
+                             float x, float y) {
+    EXPECT_FLOAT_EQ(x / kWidth, object.keypoints(keypoint).point_2d().x());
+    EXPECT_FLOAT_EQ(y / kHeight, object.keypoints(keypoint).point_2d().y());
+  }
+
+  std::vector<float> heatmap_;
+  std::vector<float> offsetmap_;
+};
+
+TEST_F(DecoderTest, DecodesLocalMaxima) {
+  Heat(5, 4) = 1.0f;
+  // Not a local maximum.
+  Heat(6, 4) = 0.95f;
+  Heat(12, 9) = 0.95f;
+  // Below the threshold.
+  Heat(1, 14) = 0.5f;
+  for (int i = 0; i < Decoder::kNumOffsetmaps / 2; ++i) {
+    SetKeypointTarget(5, 4, i, i, 1.0f);
+    SetKeypointTarget(12, 9, i, 15.0f, i);
+  }
+
+  const FrameAnnotation annotations = Decode(R"pb(
+    heatmap_threshold: 0.9 local_max_distance: 2
+  )pb");
+  ASSERT_EQ(2, annotations.annotations_size());
+  const ObjectAnnotation& first = annotations.annotations(0);
+  const ObjectAnnotation& second = annotations.annotations(1);
+  ASSERT_EQ(9, first.keypoints_size());
+  ASSERT_EQ(9, second.keypoints_size());
+  ExpectKeypoint(first, 0, 5.0f, 4.0f);
+  ExpectKeypoint(second, 0, 12.0f, 9.0f);
+  for (int i = 0; i < Decoder::kNumOffsetmaps / 2; ++i) {
+    ExpectKeypoint(first, i + 1, i, 1.0f);
+    ExpectKeypoint(second, i + 1, 15.0f, i);
+  }
+}
+
+TEST_F(DecoderTest, VotesAroundPeak) {
+  Heat(6, 6) = 1.0f;
+  Heat(7, 6) = 0.5f;
+  Heat(6, 7) = 0.5f;
+  // Below the voting threshold.
+  Heat(5, 6) = 0.1f;
+  // All pixels vote for the first keypoint at (10, 3), except for (6, 7),
+  // whose vote is beyond the allowance. The other keypoints are voted at the
+  // pixels themselves.
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      SetKeypointTarget(x, y, 0, 10.0f, 3.0f);
+    }
+  }
+  SetKeypointTarget(6, 7, 0, 13.0f, 3.0f);
+  SetKeypointTarget(5, 6, 0, 13.0f, 3.0f);
+
+  const FrameAnnotation annotations = Decode(R"pb(
+    heatmap_threshold: 0.9
+    local_max_distance: 2
+    voting_radius: 2
+    voting_allowance: 1
+    voting_threshold: 0.2
+  )pb");
+  ASSERT_EQ(1, annotations.annotations_size());
+  const ObjectAnnotation& object = annotations.annotations(0);
+  ASSERT_EQ(9, object.keypoints_size());
+  ExpectKeypoint(object, 0, 6.0f, 6.0f);
+  ExpectKeypoint(object, 1, 10.0f, 3.0f);
+  for (int i = 2; i < 9; ++i) {
+    ExpectKeypoint(object, i, 6.25f, 6.25f);
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
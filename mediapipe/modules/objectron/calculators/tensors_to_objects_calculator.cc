@@ -23,12 +23,10 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/tensor.h"
-#include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/modules/objectron/calculators/annotation_data.pb.h"
 #include "mediapipe/modules/objectron/calculators/belief_decoder_config.pb.h"
 #include "mediapipe/modules/objectron/calculators/decoder.h"
-#include "mediapipe/modules/objectron/calculators/tensor_util.h"
 #include "mediapipe/modules/objectron/calculators/tensors_to_objects_calculator.pb.h"
 
 namespace {
@@ -140,11 +138,23 @@ absl::Status TensorsToObjectsCalculator::ProcessCPU(
   const auto& input_tensors =
       cc->Inputs().Tag(kInputStreamTag).Get<std::vector<mediapipe::Tensor>>();
 
-  cv::Mat prediction_heatmap = ConvertTensorToCvMat(input_tensors[0]);
-  cv::Mat offsetmap = ConvertTensorToCvMat(input_tensors[1]);
-
-  *output_objects =
-      decoder_->DecodeBoundingBoxKeypoints(prediction_heatmap, offsetmap);
+  // The heatmap and offset maps are 1 x height x width x channels tensors.
+  const auto& heatmap_dims = input_tensors[0].shape().dims;
+  const auto& offsetmap_dims = input_tensors[1].shape().dims;
+  RET_CHECK(heatmap_dims.size() == 4 && heatmap_dims[0] == 1 &&
+            heatmap_dims[3] == 1);
+  RET_CHECK(offsetmap_dims.size() == 4 && offsetmap_dims[0] == 1 &&
+            offsetmap_dims[3] == Decoder::kNumOffsetmaps);
+  RET_CHECK(heatmap_dims[1] == offsetmap_dims[1] &&
+            heatmap_dims[2] == offsetmap_dims[2]);
+  RET_CHECK(input_tensors[0].element_type() == Tensor::ElementType::kFloat32 &&
+            input_tensors[1].element_type() == Tensor::ElementType::kFloat32);
+
+  auto prediction_heatmap = input_tensors[0].GetCpuReadView();
+  auto offsetmap = input_tensors[1].GetCpuReadView();
+  *output_objects = decoder_->DecodeBoundingBoxKeypoints(
+      prediction_heatmap.buffer<float>(), offsetmap.buffer<float>(),
+      /*width=*/heatmap_dims[2], /*height=*/heatmap_dims[1]);
   auto status = decoder_->Lift2DTo3D(projection_matrix_, /*portrait*/ true,
                                      output_objects);
   if (!status.ok()) {
@@ -22,12 +22,10 @@
 #include "absl/types/span.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/deps/file_path.h"
-#include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/modules/objectron/calculators/annotation_data.pb.h"
 #include "mediapipe/modules/objectron/calculators/belief_decoder_config.pb.h"
 #include "mediapipe/modules/objectron/calculators/decoder.h"
-#include "mediapipe/modules/objectron/calculators/tensor_util.h"
 #include "mediapipe/modules/objectron/calculators/tflite_tensors_to_objects_calculator.pb.h"
 #include "tensorflow/lite/interpreter.h"
 
@@ -146,11 +144,21 @@ absl::Status TfLiteTensorsToObjectsCalculator::ProcessCPU(
   const auto& input_tensors =
       cc->Inputs().Tag(kInputStreamTag).Get<std::vector<TfLiteTensor>>();
 
-  cv::Mat prediction_heatmap = ConvertTfliteTensorToCvMat(input_tensors[0]);
-  cv::Mat offsetmap = ConvertTfliteTensorToCvMat(input_tensors[1]);
-
-  *output_objects =
-      decoder_->DecodeBoundingBoxKeypoints(prediction_heatmap, offsetmap);
+  // The heatmap and offset maps are 1 x height x width x channels tensors.
+  const TfLiteIntArray* heatmap_dims = input_tensors[0].dims;
+  const TfLiteIntArray* offsetmap_dims = input_tensors[1].dims;
+  RET_CHECK(heatmap_dims->size == 4 && heatmap_dims->data[0] == 1 &&
+            heatmap_dims->data[3] == 1);
+  RET_CHECK(offsetmap_dims->size == 4 && offsetmap_dims->data[0] == 1 &&
+            offsetmap_dims->data[3] == Decoder::kNumOffsetmaps);
+  RET_CHECK(heatmap_dims->data[1] == offsetmap_dims->data[1] &&
+            heatmap_dims->data[2] == offsetmap_dims->data[2]);
+  RET_CHECK(input_tensors[0].type == kTfLiteFloat32 &&
+            input_tensors[1].type == kTfLiteFloat32);
+
+  *output_objects = decoder_->DecodeBoundingBoxKeypoints(
+      input_tensors[0].data.f, input_tensors[1].data.f,
+      /*width=*/heatmap_dims->data[2], /*height=*/heatmap_dims->data[1]);
   auto status = decoder_->Lift2DTo3D(projection_matrix_, /*portrait*/ true,
                                      output_objects);
   if (!status.ok()) {
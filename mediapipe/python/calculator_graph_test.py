@@ -238,6 +238,52 @@ class GraphTest(absltest.TestCase):
       self.assertEqual(out[i].timestamp, i)
       self.assertEqual(mp.packet_getter.get_str(out[i]), 'hello world')
 
+  def test_observe_output_streams_by_timestamp(self):
+    text_config = """
+      input_stream: 'in'
+      input_stream: 'in2'
+      output_stream: 'out'
+      output_stream: 'out2'
+      node {
+        calculator: 'PassThroughCalculator'
+        input_stream: 'in'
+        input_stream: 'in2'
+        output_stream: 'out'
+        output_stream: 'out2'
+      }
+    """
+    graph = mp.CalculatorGraph(graph_config=text_config)
+    collector = graph.observe_output_streams_by_timestamp(['out', 'out2'])
+    graph.start_run()
+
+    num_frames = 10
+    for i in range(num_frames):
+      packets = {'in': mp.packet_creator.create_string(f'frame {i}')}
+      # The second stream only has a packet in every other frame.
+      if i % 2 == 0:
+        packets['in2'] = mp.packet_creator.create_int(i)
+      graph.add_packets_to_input_streams(packets, timestamp=i)
+      collector.expect(i)
+    self.assertEqual(collector.num_in_flight, num_frames)
+    with self.assertRaisesRegex(ValueError, 'Timestamps must be increasing'):
+      collector.expect(num_frames - 1)
+
+    for i in range(num_frames - 1):
+      timestamp, packets = collector.pop(timeout=10)
+      self.assertEqual(timestamp, i)
+      self.assertEqual(mp.packet_getter.get_str(packets['out']), f'frame {i}')
+      if i % 2 == 0:
+        self.assertEqual(mp.packet_getter.get_int(packets['out2']), i)
+      else:
+        self.assertNotIn('out2', packets)
+    # The last frame stays incomplete until the graph is closed, since the
+    # bound of 'in2' has not moved past it.
+    graph.close()
+    timestamp, packets = collector.pop(force=True)
+    self.assertEqual(timestamp, num_frames - 1)
+    self.assertIn('out', packets)
+    self.assertEqual(collector.num_in_flight, 0)
+
 
 if __name__ == '__main__':
   absltest.main()
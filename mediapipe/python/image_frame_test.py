@@ -181,6 +181,24 @@ class ImageFrameTest(absltest.TestCase):
     gc.collect()
     self.assertEqual(sys.getrefcount(image_frame), initial_ref_count)
 
+  def test_image_frame_reference_mode(self):
+    w, h = random.randrange(3, 100), random.randrange(3, 100)
+    mat = np.random.randint(2**8 - 1, size=(h, w, 3), dtype=np.uint8)
+    mat.flags.writeable = False
+    initial_ref_count = sys.getrefcount(mat)
+    image_frame = mp.ImageFrame(image_format=mp.ImageFormat.SRGB, data=mat)
+    # Read-only data is referenced instead of copied.
+    self.assertEqual(sys.getrefcount(mat), initial_ref_count + 1)
+    self.assertTrue(np.shares_memory(image_frame.numpy_view(), mat))
+    del image_frame
+    gc.collect()
+    self.assertEqual(sys.getrefcount(mat), initial_ref_count)
+    # copy=True always copies.
+    image_frame = mp.ImageFrame(image_format=mp.ImageFormat.SRGB, data=mat, copy=True)
+    self.assertEqual(sys.getrefcount(mat), initial_ref_count)
+    self.assertFalse(np.shares_memory(image_frame.numpy_view(), mat))
+    self.assertTrue(np.array_equal(image_frame.numpy_view(), mat))
+
 
 if __name__ == '__main__':
   absltest.main()
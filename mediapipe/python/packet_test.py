@@ -502,5 +502,50 @@ class PacketTest(absltest.TestCase):
         np.allclose(output_matrix,
                     np.array([[.1, .2, .3], [.4, .5, .6]])[:, ::-1]))
 
+  def test_image_numpy_view_in_reference_mode(self):
+    w, h, channels = random.randrange(3, 100), random.randrange(3, 100), 3
+    rgb_data = np.random.randint(255, size=(h, w, channels), dtype=np.uint8)
+    rgb_data.flags.writeable = False
+    rgb_data_copy = np.copy(rgb_data)
+    for create in (mp.packet_creator.create_image_frame,
+                   mp.packet_creator.create_image):
+      p = create(image_format=mp.ImageFormat.SRGB, data=rgb_data)
+      output_ndarray = mp.packet_getter.get_image_numpy_view(p)
+      # The view references the input data without any copy.
+      self.assertTrue(np.shares_memory(output_ndarray, rgb_data))
+      with self.assertRaisesRegex(ValueError,
+                                  'assignment destination is read-only'):
+        output_ndarray[0, 0, 0] = 0
+      del p
+      gc.collect()
+      # The view keeps the packet payload alive.
+      self.assertTrue(np.array_equal(output_ndarray, rgb_data_copy))
+
+  def test_image_numpy_view_with_non_contiguous_data(self):
+    w, h, channels = 641, 481, 3
+    rgb_data = np.random.randint(255, size=(h, w, channels), dtype=np.uint8)
+    p = mp.packet_creator.create_image_frame(
+        image_format=mp.ImageFormat.SRGB, data=rgb_data)
+    self.assertFalse(mp.packet_getter.get_image_frame(p).is_contiguous())
+    output_ndarray = mp.packet_getter.get_image_numpy_view(p)
+    del p
+    gc.collect()
+    self.assertTrue(np.array_equal(output_ndarray, rgb_data))
+
+  def test_tensor_packet(self):
+    np_tensor = np.float32(np.random.random_sample((2, 3, 4)))
+    p = mp.packet_creator.create_tensor(np_tensor)
+    output_ndarray = mp.packet_getter.get_tensor_numpy_view(p)
+    self.assertEqual(output_ndarray.dtype, np.float32)
+    with self.assertRaisesRegex(ValueError,
+                                'assignment destination is read-only'):
+      output_ndarray[0, 0, 0] = 0
+    del p
+    gc.collect()
+    self.assertTrue(np.array_equal(output_ndarray, np_tensor))
+    with self.assertRaisesRegex(ValueError, 'Tensor'):
+      mp.packet_getter.get_tensor_numpy_view(mp.packet_creator.create_int(1))
+
+
 if __name__ == '__main__':
   absltest.main()
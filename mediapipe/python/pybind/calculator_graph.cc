@@ -14,8 +14,17 @@
 
 #include "mediapipe/python/pybind/calculator_graph.h"
 
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_graph.h"
 #include "mediapipe/framework/packet.h"
@@ -49,6 +58,134 @@ T ParseProto(const py::object& proto_object) {
 
 namespace py = pybind11;
 
+// Groups the packets of several observed output streams by timestamp, so that
+// Python can keep several frames in flight and collect the outputs of each
+// frame once it is complete.
+//
+// The observers run on graph threads and never take the GIL. A frame is
+// complete when the timestamp bound of every observed stream has passed its
+// timestamp. Python only blocks in Pop(), with the GIL released.
+class TimestampedOutputCollector {
+ public:
+  static absl::StatusOr<std::shared_ptr<TimestampedOutputCollector>> Create(
+      CalculatorGraph* graph, const std::vector<std::string>& stream_names) {
+    auto collector = std::shared_ptr<TimestampedOutputCollector>(
+        new TimestampedOutputCollector(graph, stream_names));
+    for (int i = 0; i < stream_names.size(); ++i) {
+      MP_RETURN_IF_ERROR(graph->ObserveOutputStream(
+          stream_names[i],
+          [collector, i](const Packet& packet) {
+            collector->OnPacket(i, packet);
+            return absl::OkStatus();
+          },
+          /*observe_timestamp_bounds=*/true));
+    }
+    return collector;
+  }
+
+  // Registers the timestamp of a frame whose outputs will be popped.
+  // Timestamps must be registered in increasing order.
+  absl::Status Expect(Timestamp timestamp) {
+    absl::MutexLock lock(&mutex_);
+    if (!expected_.empty() && expected_.back() >= timestamp) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Timestamps must be increasing, but ", timestamp.DebugString(),
+          " follows ", expected_.back().DebugString()));
+    }
+    expected_.push_back(timestamp);
+    return absl::OkStatus();
+  }
+
+  // Waits up to `timeout` until the oldest expected frame is complete and
+  // moves its packets to `packets`. Returns false on timeout. If `force` is
+  // true, does not wait, e.g. when the graph is idle or done and no more
+  // bounds will arrive.
+  absl::StatusOr<bool> Pop(absl::Duration timeout, bool force,
+                           Timestamp* timestamp,
+                           std::map<std::string, Packet>* packets) {
+    const absl::Time deadline = absl::Now() + timeout;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (expected_.empty()) {
+        return absl::FailedPreconditionError("No frame is in flight.");
+      }
+      while (!force && !FrontComplete()) {
+        if (graph_->HasError()) break;
+        if (absl::Now() >= deadline) return false;
+        // Wakes up periodically to check for graph errors, which no observer
+        // reports.
+        mutex_.AwaitWithDeadline(
+            absl::Condition(this, &TimestampedOutputCollector::FrontComplete),
+            std::min(deadline, absl::Now() + kErrorPollInterval));
+      }
+      if (force || FrontComplete()) {
+        *timestamp = expected_.front();
+        expected_.pop_front();
+        packets->clear();
+        auto it = packets_.find(*timestamp);
+        if (it != packets_.end()) *packets = std::move(it->second);
+        // Packets at timestamps that were never expected are dropped.
+        packets_.erase(packets_.begin(), packets_.upper_bound(*timestamp));
+        return true;
+      }
+    }
+    absl::Status error;
+    graph_->GetCombinedErrors(&error);
+    return error.ok() ? absl::UnknownError("The graph has failed.") : error;
+  }
+
+  // Forgets all frames, e.g. before restarting the graph.
+  void Reset() {
+    absl::MutexLock lock(&mutex_);
+    expected_.clear();
+    packets_.clear();
+    std::fill(settled_.begin(), settled_.end(), Timestamp::Unstarted());
+  }
+
+  int NumInFlight() {
+    absl::MutexLock lock(&mutex_);
+    return expected_.size();
+  }
+
+ private:
+  static constexpr absl::Duration kErrorPollInterval = absl::Milliseconds(100);
+
+  TimestampedOutputCollector(CalculatorGraph* graph,
+                             const std::vector<std::string>& stream_names)
+      : graph_(graph),
+        stream_names_(stream_names),
+        settled_(stream_names.size(), Timestamp::Unstarted()) {}
+
+  void OnPacket(int stream_index, const Packet& packet) {
+    absl::MutexLock lock(&mutex_);
+    // Both packets and timestamp bound updates settle the stream up to the
+    // packet timestamp.
+    settled_[stream_index] =
+        std::max(settled_[stream_index], packet.Timestamp());
+    if (!packet.IsEmpty()) {
+      packets_[packet.Timestamp()][stream_names_[stream_index]] = packet;
+    }
+  }
+
+  bool FrontComplete() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    for (const Timestamp& settled : settled_) {
+      if (settled < expected_.front()) return false;
+    }
+    return true;
+  }
+
+  CalculatorGraph* const graph_;
+  const std::vector<std::string> stream_names_;
+  absl::Mutex mutex_;
+  // The timestamp up to which each stream is settled.
+  std::vector<Timestamp> settled_ ABSL_GUARDED_BY(mutex_);
+  std::deque<Timestamp> expected_ ABSL_GUARDED_BY(mutex_);
+  std::map<Timestamp, std::map<std::string, Packet>> packets_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+constexpr absl::Duration TimestampedOutputCollector::kErrorPollInterval;
+
 void CalculatorGraphSubmodule(pybind11::module* module) {
   py::module m = module->def_submodule("calculator_graph",
                                        "MediaPipe calculator graph module.");
@@ -207,6 +344,48 @@ void CalculatorGraphSubmodule(pybind11::module* module) {
       py::arg("stream"), py::arg("packet"),
       py::arg("timestamp") = Timestamp::Unset());
 
+  calculator_graph.def(
+      "add_packets_to_input_streams",
+      [](CalculatorGraph* self, const std::map<std::string, Packet>& packets,
+         const Timestamp& timestamp) {
+        if (!timestamp.IsAllowedInStream()) {
+          throw RaisePyError(
+              PyExc_ValueError,
+              absl::StrCat(timestamp.DebugString(),
+                           " can't be the timestamp of a Packet in a stream.")
+                  .c_str());
+        }
+        py::gil_scoped_release gil_release;
+        for (const auto& stream_packet : packets) {
+          RaisePyErrorIfNotOk(
+              self->AddPacketToInputStream(stream_packet.first,
+                                           stream_packet.second.At(timestamp)),
+              /**acquire_gil=*/true);
+        }
+      },
+      R"doc(Add one packet per graph input stream, all at the same timestamp.
+
+  Equivalent to calling add_packet_to_input_stream() for each stream, but
+  releases the GIL only once for the whole frame.
+
+  Args:
+    packets: A mapping from the graph input stream name to the packet to add.
+    timestamp: The timestamp of the packets.
+
+  Raises:
+    RuntimeError: If a stream is not a graph input stream or a packet can't be
+      added into its input stream.
+    ValueError: If the timestamp is invalid to be the timestamp of a Packet in a
+      stream.
+
+  Examples:
+    graph.add_packets_to_input_streams(
+        {'in': packet_creator.create_string('hello'),
+         'in2': packet_creator.create_int(1)},
+        timestamp=1)
+)doc",
+      py::arg("packets"), py::arg("timestamp"));
+
   calculator_graph.def(
       "close_input_stream",
       [](CalculatorGraph* self, const std::string& stream) {
@@ -442,6 +621,112 @@ void CalculatorGraphSubmodule(pybind11::module* module) {
       py::arg("stream_name"), py::arg("callback_fn"),
       py::arg("observe_timestamp_bounds") = false);
 
+  py::class_<TimestampedOutputCollector,
+             std::shared_ptr<TimestampedOutputCollector>>
+      output_collector(m, "TimestampedOutputCollector",
+                       R"doc(Collects the outputs of a graph frame by frame.
+
+  Created by CalculatorGraph.observe_output_streams_by_timestamp(). Register the
+  timestamp of every frame sent to the graph with expect(), then collect the
+  outputs of the frames in order with pop().)doc");
+
+  output_collector.def(
+      "expect",
+      [](TimestampedOutputCollector* self, const Timestamp& timestamp) {
+        RaisePyErrorIfNotOk(self->Expect(timestamp));
+      },
+      R"doc(Register the timestamp of a frame sent to the graph.
+
+  Args:
+    timestamp: The input timestamp of the frame. Must be larger than the
+      previously registered timestamp.
+
+  Raises:
+    ValueError: If the timestamp is not increasing.
+)doc",
+      py::arg("timestamp"));
+
+  output_collector.def(
+      "pop",
+      [](TimestampedOutputCollector* self, py::object timeout,
+         bool force) -> py::object {
+        const absl::Duration wait_time =
+            timeout.is_none() ? absl::InfiniteDuration()
+                              : absl::Seconds(timeout.cast<double>());
+        Timestamp timestamp;
+        std::map<std::string, Packet> packets;
+        absl::StatusOr<bool> popped;
+        {
+          py::gil_scoped_release gil_release;
+          popped = self->Pop(wait_time, force, &timestamp, &packets);
+        }
+        RaisePyErrorIfNotOk(popped.status());
+        if (!popped.value()) return py::none();
+        return py::make_tuple(timestamp, packets);
+      },
+      R"doc(Wait for the outputs of the oldest registered frame.
+
+  A frame is complete once all the observed output streams have either emitted a
+  packet at its timestamp or moved their timestamp bounds past it.
+
+  Args:
+    timeout: The maximum time to wait, in seconds. Waits indefinitely if None.
+    force: If true, returns the packets received so far without waiting. Use
+      this once the graph is idle or done.
+
+  Returns:
+    A (timestamp, {stream_name: packet}) tuple, or None on timeout. Streams
+    without a packet at the frame timestamp are absent from the mapping.
+
+  Raises:
+    RuntimeError: If the graph fails while waiting or no frame is registered.
+
+  Examples:
+    collector = graph.observe_output_streams_by_timestamp(['out'])
+    graph.start_run()
+    collector.expect(mp.Timestamp(1))
+    graph.add_packet_to_input_stream('in', packet, timestamp=1)
+    timestamp, packets = collector.pop()
+)doc",
+      py::arg("timeout") = py::none(), py::arg("force") = false);
+
+  output_collector.def(
+      "reset", [](TimestampedOutputCollector* self) { self->Reset(); },
+      R"doc(Forget all registered frames, e.g. before the graph is restarted.)doc");
+
+  output_collector.def_property_readonly(
+      "num_in_flight",
+      [](TimestampedOutputCollector* self) { return self->NumInFlight(); });
+
+  calculator_graph.def(
+      "observe_output_streams_by_timestamp",
+      [](CalculatorGraph* self, const std::vector<std::string>& stream_names) {
+        auto status_or_collector =
+            TimestampedOutputCollector::Create(self, stream_names);
+        RaisePyErrorIfNotOk(status_or_collector.status());
+        return status_or_collector.value();
+      },
+      R"doc(Observe output streams and collect their packets frame by frame.
+
+  Unlike observe_output_stream(), no Python code runs on the graph threads, so
+  the outputs of several frames in flight can be collected without contention
+  on the GIL. This method can only be called before start_run().
+
+  Args:
+    stream_names: The names of the output streams.
+
+  Returns:
+    A TimestampedOutputCollector that keeps the graph alive.
+
+  Raises:
+    RuntimeError: If the calculator graph isn't initialized or a stream doesn't
+      exist.
+
+  Examples:
+    collector = graph.observe_output_streams_by_timestamp(['out1', 'out2'])
+)doc",
+      py::arg("stream_names"), py::keep_alive<0, 1>());
+
   calculator_graph.def(
       "close",
       [](CalculatorGraph* self) {
@@ -43,6 +43,11 @@ void ImageSubmodule(pybind11::module* module) {
   default alignment boundary during creation. The data in an Image will
   become immutable after creation.
 
+  If the ndarray is not writable, the Image references the ndarray buffer
+  instead of copying it and keeps the ndarray alive. Pass copy=True to always
+  copy, or copy=False to reference a writable ndarray, which must then not be
+  modified while the Image is in use.
+
   Creation examples:
     import cv2
     cv_mat = cv2.imread(input_file)[:, :, ::-1]
@@ -76,7 +81,8 @@ void ImageSubmodule(pybind11::module* module) {
   image
       .def(
           py::init([](mediapipe::ImageFormat::Format format,
-                      const py::array_t<uint8, py::array::c_style>& data) {
+                      const py::array_t<uint8, py::array::c_style>& data,
+                      const py::object& copy) {
             if (format != mediapipe::ImageFormat::GRAY8 &&
                 format != mediapipe::ImageFormat::SRGB &&
                 format != mediapipe::ImageFormat::SRGBA) {
@@ -84,14 +90,16 @@ void ImageSubmodule(pybind11::module* module) {
                                  "uint8 image data should be one of the GRAY8, "
                                  "SRGB, and SRGBA MediaPipe image formats.");
             }
-            return Image(std::make_shared<ImageFrame>(
-                std::move(*CreateImageFrame<uint8>(format, data).release())));
+            return Image(CreateSharedImageFrame<uint8>(
+                format, data, ShouldCopyImageData(data, copy)));
           }),
           R"doc(For uint8 data type, valid ImageFormat are GRAY8, SGRB, and SRGBA.)doc",
-          py::arg("image_format"), py::arg("data").noconvert())
+          py::arg("image_format"), py::arg("data").noconvert(),
+          py::arg("copy") = py::none())
       .def(
           py::init([](mediapipe::ImageFormat::Format format,
-                      const py::array_t<uint16, py::array::c_style>& data) {
+                      const py::array_t<uint16, py::array::c_style>& data,
+                      const py::object& copy) {
             if (format != mediapipe::ImageFormat::GRAY16 &&
                 format != mediapipe::ImageFormat::SRGB48 &&
                 format != mediapipe::ImageFormat::SRGBA64) {
@@ -100,14 +108,16 @@ void ImageSubmodule(pybind11::module* module) {
                   "uint16 image data should be one of the GRAY16, "
                   "SRGB48, and SRGBA64 MediaPipe image formats.");
             }
-            return Image(std::make_shared<ImageFrame>(
-                std::move(*CreateImageFrame<uint16>(format, data).release())));
+            return Image(CreateSharedImageFrame<uint16>(
+                format, data, ShouldCopyImageData(data, copy)));
           }),
           R"doc(For uint16 data type, valid ImageFormat are GRAY16, SRGB48, and SRGBA64.)doc",
-          py::arg("image_format"), py::arg("data").noconvert())
+          py::arg("image_format"), py::arg("data").noconvert(),
+          py::arg("copy") = py::none())
       .def(
           py::init([](mediapipe::ImageFormat::Format format,
-                      const py::array_t<float, py::array::c_style>& data) {
+                      const py::array_t<float, py::array::c_style>& data,
+                      const py::object& copy) {
             if (format != mediapipe::ImageFormat::VEC32F1 &&
                 format != mediapipe::ImageFormat::VEC32F2) {
               throw RaisePyError(
@@ -115,11 +125,12 @@ void ImageSubmodule(pybind11::module* module) {
                   "float image data should be either VEC32F1 or VEC32F2 "
                   "MediaPipe image formats.");
             }
-            return Image(std::make_shared<ImageFrame>(
-                std::move(*CreateImageFrame<float>(format, data).release())));
+            return Image(CreateSharedImageFrame<float>(
+                format, data, ShouldCopyImageData(data, copy)));
           }),
           R"doc(For float data type, valid ImageFormat are VEC32F1 and VEC32F2.)doc",
-          py::arg("image_format"), py::arg("data").noconvert());
+          py::arg("image_format"), py::arg("data").noconvert(),
+          py::arg("copy") = py::none());
 
   image.def(
       "numpy_view",
@@ -15,6 +15,8 @@
 #ifndef MEDIAPIPE_PYTHON_PYBIND_IMAGE_FRAME_UTIL_H_
 #define MEDIAPIPE_PYTHON_PYBIND_IMAGE_FRAME_UTIL_H_
 
+#include <memory>
+
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
@@ -29,14 +31,42 @@ namespace python {
 
 namespace py = pybind11;
 
+// Returns whether an ImageFrame created from `data` should copy it. If `copy`
+// is None, writable arrays are copied and read-only arrays are referenced, so
+// that the ImageFrame data stays immutable.
+inline bool ShouldCopyImageData(const py::array& data, const py::object& copy) {
+  if (copy.is_none()) {
+    return data.writeable();
+  }
+  return copy.cast<bool>();
+}
+
+// Creates an ImageFrame from the pixel data in `data`. If `copy` is false, the
+// ImageFrame wraps the numpy array buffer without copying it and holds a
+// reference to the array until the ImageFrame is destroyed.
 template <typename T>
 std::unique_ptr<ImageFrame> CreateImageFrame(
     mediapipe::ImageFormat::Format format,
     const py::array_t<T, py::array::c_style>& data, bool copy = true) {
+  const int num_channels = ImageFrame::NumberOfChannelsForFormat(format);
+  if (data.ndim() != 2 && data.ndim() != 3) {
+    throw RaisePyError(
+        PyExc_RuntimeError,
+        absl::StrCat("Image data should have 2 or 3 dimensions, got ",
+                     data.ndim())
+            .c_str());
+  }
+  const int data_channels = data.ndim() == 3 ? data.shape()[2] : 1;
+  if (data_channels != num_channels) {
+    throw RaisePyError(
+        PyExc_RuntimeError,
+        absl::StrCat("Image data has ", data_channels,
+                     " channels but the image format requires ", num_channels)
+            .c_str());
+  }
   int rows = data.shape()[0];
   int cols = data.shape()[1];
-  int width_step = ImageFrame::NumberOfChannelsForFormat(format) *
-                   ImageFrame::ByteDepthForFormat(format) * cols;
+  int width_step = num_channels * ImageFrame::ByteDepthForFormat(format) * cols;
   if (copy) {
     auto image_frame = absl::make_unique<ImageFrame>(
         format, /*width=*/cols, /*height=*/rows, width_step,
@@ -50,12 +80,26 @@ std::unique_ptr<ImageFrame> CreateImageFrame(
     return image_frame_copy;
   }
   PyObject* data_pyobject = data.ptr();
-  auto image_frame = absl::make_unique<ImageFrame>(
+  Py_XINCREF(data_pyobject);
+  // The last owner of the ImageFrame is often a calculator thread, so the
+  // reference is released with the GIL held.
+  return absl::make_unique<ImageFrame>(
       format, /*width=*/cols, /*height=*/rows, width_step,
       static_cast<uint8*>(data.request().ptr),
-      /*deleter=*/[data_pyobject](uint8*) { Py_XDECREF(data_pyobject); });
-  Py_XINCREF(data_pyobject);
-  return image_frame;
+      /*deleter=*/[data_pyobject](uint8*) {
+        if (!Py_IsInitialized()) return;
+        py::gil_scoped_acquire acquire;
+        Py_XDECREF(data_pyobject);
+      });
+}
+
+// Creates a shared ImageFrame for an Image. See CreateImageFrame().
+template <typename T>
+std::shared_ptr<ImageFrame> CreateSharedImageFrame(
+    mediapipe::ImageFormat::Format format,
+    const py::array_t<T, py::array::c_style>& data, bool copy = true) {
+  return std::shared_ptr<ImageFrame>(
+      CreateImageFrame<T>(format, data, copy).release());
 }
 
 template <typename T>
@@ -14,10 +14,13 @@
 
 #include "mediapipe/python/pybind/packet_creator.h"
 
+#include <cstring>
+
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "mediapipe/framework/formats/image.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/timestamp.h"
@@ -55,17 +58,17 @@ Packet CreateImagePacket(mediapipe::ImageFormat::Format format,
   if (format == mediapipe::ImageFormat::SRGB ||
       format == mediapipe::ImageFormat::SRGBA ||
       format == mediapipe::ImageFormat::GRAY8) {
-    return MakePacket<Image>(std::make_shared<ImageFrame>(
-        std::move(*CreateImageFrame<uint8>(format, data, copy).release())));
+    return MakePacket<Image>(
+        CreateSharedImageFrame<uint8>(format, data, copy));
   } else if (format == mediapipe::ImageFormat::GRAY16 ||
              format == mediapipe::ImageFormat::SRGB48 ||
              format == mediapipe::ImageFormat::SRGBA64) {
-    return MakePacket<Image>(std::make_shared<ImageFrame>(
-        std::move(*CreateImageFrame<uint16>(format, data, copy).release())));
+    return MakePacket<Image>(
+        CreateSharedImageFrame<uint16>(format, data, copy));
   } else if (format == mediapipe::ImageFormat::VEC32F1 ||
              format == mediapipe::ImageFormat::VEC32F2) {
-    return MakePacket<Image>(std::make_shared<ImageFrame>(
-        std::move(*CreateImageFrame<float>(format, data, copy).release())));
+    return MakePacket<Image>(
+        CreateSharedImageFrame<float>(format, data, copy));
   }
   throw RaisePyError(PyExc_RuntimeError,
                      absl::StrCat("Unsupported ImageFormat: ", format).c_str());
@@ -602,6 +605,38 @@ void PublicPacketCreators(pybind11::module* m) {
     matrix = mp.packet_getter.get_matrix(packet)
 )doc",
       py::return_value_policy::move);
+
+  m->def(
+      "create_tensor",
+      [](const py::array_t<float, py::array::c_style>& data) {
+        std::vector<int> dims(data.shape(), data.shape() + data.ndim());
+        Tensor tensor(Tensor::ElementType::kFloat32, Tensor::Shape(dims));
+        {
+          auto view = tensor.GetCpuWriteView();
+          std::memcpy(view.buffer<float>(), data.data(), tensor.bytes());
+        }
+        return MakePacket<Tensor>(std::move(tensor));
+      },
+      R"doc(Create a MediaPipe float32 Tensor Packet from a numpy ndarray.
+
+  The method copies data from the input ndarray into the CPU buffer of the
+  Tensor.
+
+  Args:
+    data: A numpy float32 ndarray.
+
+  Returns:
+    A MediaPipe Tensor Packet.
+
+  Raises:
+    TypeError: If the input is not a numpy float32 ndarray.
+
+  Examples:
+    packet = mp.packet_creator.create_tensor(
+        np.array([[.1, .2, .3], [.4, .5, .6]], dtype=np.float32))
+    data = mp.packet_getter.get_tensor_numpy_view(packet)
+)doc",
+      py::arg("data").noconvert(), py::return_value_policy::move);
 }
 
 void InternalPacketCreators(pybind11::module* m) {
@@ -628,13 +663,12 @@ void InternalPacketCreators(pybind11::module* m) {
   m->def(
       "_create_image_from_image",
       [](Image& image) {
-        auto image_frame_copy = absl::make_unique<ImageFrame>();
+        auto image_frame_copy = std::make_shared<ImageFrame>();
         // Set alignment_boundary to kGlDefaultAlignmentBoundary so that
         // both GPU and CPU can process it.
         image_frame_copy->CopyFrom(*image.GetImageFrameSharedPtr(),
                                    ImageFrame::kGlDefaultAlignmentBoundary);
-        return MakePacket<Image>(std::make_shared<ImageFrame>(
-            std::move(*image_frame_copy.release())));
+        return MakePacket<Image>(std::move(image_frame_copy));
       },
       py::arg("image").noconvert(), py::return_value_policy::move);
 
@@ -17,12 +17,14 @@
 #include "absl/status/statusor.h"
 #include "mediapipe/framework/formats/image.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/timestamp.h"
 #include "mediapipe/python/pybind/image_frame_util.h"
 #include "mediapipe/python/pybind/util.h"
 #include "pybind11/eigen.h"
+#include "pybind11/numpy.h"
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
 
@@ -36,6 +38,38 @@ const T& GetContent(const Packet& packet) {
   return packet.Get<T>();
 }
 
+// Returns a capsule holding a copy of `packet`, which keeps the packet payload
+// alive for as long as the numpy arrays viewing it.
+py::capsule PacketOwner(const Packet& packet) {
+  return py::capsule(new Packet(packet), [](void* packet) {
+    delete reinterpret_cast<Packet*>(packet);
+  });
+}
+
+// Returns an unwritable numpy ndarray referencing the CPU buffer of `tensor`.
+py::array GenerateTensorDataPyArray(const Tensor& tensor,
+                                    const py::object& owner) {
+  py::dtype dtype;
+  switch (tensor.element_type()) {
+    case Tensor::ElementType::kFloat32:
+      dtype = py::dtype::of<float>();
+      break;
+    case Tensor::ElementType::kFloat16:
+      dtype = py::dtype("float16");
+      break;
+    default:
+      throw RaisePyError(PyExc_ValueError, "Unsupported Tensor element type.");
+  }
+  // The read view is released right away, since holding it would block other
+  // views of the tensor. The CPU buffer stays valid while the packet holding
+  // the tensor is alive.
+  const void* data = tensor.GetCpuReadView().buffer<void>();
+  py::array data_array(dtype, tensor.shape().dims, data, owner);
+  py::detail::array_proxy(data_array.ptr())->flags &=
+      ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+  return data_array;
+}
+
 }  // namespace
 
 namespace py = pybind11;
@@ -363,6 +397,91 @@ void PublicPacketGetters(pybind11::module* m) {
 )doc",
          py::return_value_policy::reference_internal);
 
+  m->def(
+      "get_image_numpy_view",
+      [](const Packet& packet) {
+        if (packet.ValidateAsType<Image>().ok()) {
+          return GenerateContiguousDataArray(
+              *packet.Get<Image>().GetImageFrameSharedPtr(),
+              PacketOwner(packet));
+        }
+        return GenerateContiguousDataArray(GetContent<ImageFrame>(packet),
+                                           PacketOwner(packet));
+      },
+      R"doc(Get the pixel data of a MediaPipe ImageFrame or Image Packet as an unwritable numpy ndarray.
+
+  If the pixel data is stored contiguously, the returned ndarray references the
+  packet payload without copying it and keeps the payload alive. Otherwise, the
+  pixel data is realigned and copied.
+
+  Args:
+    packet: A MediaPipe ImageFrame or Image Packet.
+
+  Returns:
+    An unwritable numpy ndarray.
+
+  Raises:
+    ValueError: If the Packet doesn't contain ImageFrame or Image.
+
+  Examples:
+    packet = packet_creator.create_image_frame(frame)
+    data = packet_getter.get_image_numpy_view(packet)
+)doc");
+
+  m->def(
+      "get_tensor_numpy_view",
+      [](const Packet& packet) {
+        return GenerateTensorDataPyArray(GetContent<Tensor>(packet),
+                                         PacketOwner(packet));
+      },
+      R"doc(Get the content of a MediaPipe Tensor Packet as an unwritable numpy ndarray.
+
+  The returned ndarray references the CPU buffer of the Tensor without copying
+  it and keeps the packet payload alive.
+
+  Args:
+    packet: A MediaPipe Tensor Packet.
+
+  Returns:
+    An unwritable numpy ndarray of float32 or float16.
+
+  Raises:
+    ValueError: If the Packet doesn't contain Tensor.
+
+  Examples:
+    packet = packet_creator.create_tensor(data)
+    data = packet_getter.get_tensor_numpy_view(packet)
+)doc");
+
+  m->def(
+      "get_tensor_numpy_views",
+      [](const Packet& packet) {
+        const auto& tensors = GetContent<std::vector<Tensor>>(packet);
+        py::capsule owner = PacketOwner(packet);
+        py::list views;
+        for (const Tensor& tensor : tensors) {
+          views.append(GenerateTensorDataPyArray(tensor, owner));
+        }
+        return views;
+      },
+      R"doc(Get the content of a MediaPipe std::vector<Tensor> Packet as a list of unwritable numpy ndarrays.
+
+  The returned ndarrays reference the CPU buffers of the Tensors without
+  copying them and keep the packet payload alive.
+
+  Args:
+    packet: A MediaPipe std::vector<Tensor> Packet.
+
+  Returns:
+    A list of unwritable numpy ndarrays.
+
+  Raises:
+    ValueError: If the Packet doesn't contain std::vector<Tensor>.
+
+  Examples:
+    tensors = packet_getter.get_tensor_numpy_views(output_packet)
+)doc");
+
   m->def(
       "get_matrix",
       [](const Packet& packet) {
@@ -22,9 +22,11 @@ class.
 """
 
 import collections
+from concurrent import futures
 import enum
 import os
-from typing import Any, Iterable, List, Mapping, NamedTuple, Optional, Union
+import threading
+from typing import Any, Iterable, Iterator, List, Mapping, NamedTuple, Optional, Union
 
 import numpy as np
 
@@ -57,6 +59,9 @@ import mediapipe.python.packet_creator as packet_creator
 import mediapipe.python.packet_getter as packet_getter
 
 RGB_CHANNELS = 3
+# The timestamp increment, in microseconds, used when no input timestamp is
+# given. It simulates a 30 fps video input.
+_DEFAULT_TIMESTAMP_INCREMENT = 33333
 # TODO: Enable calculator options modification for more calculators.
 CALCULATOR_TO_OPTIONS = {
     'ConstantSidePacketCalculator':
@@ -188,6 +193,13 @@ class SolutionBase:
       results = hand_tracker.process(input_image)
       print(results.palm_detections)
       print(results.multi_hand_landmarks)
+
+  process() waits for the graph to be idle after every input. To use the
+  pipeline parallelism of the graph, keep several inputs in flight with
+  process_async() or process_batch() instead:
+    with solution_base.SolutionBase(...) as hand_tracker:
+      for results in hand_tracker.process_batch(video_frames):
+        print(results.multi_hand_landmarks)
   """
 
   def __init__(
@@ -196,7 +208,8 @@ class SolutionBase:
       graph_config: Optional[calculator_pb2.CalculatorGraphConfig] = None,
       calculator_params: Optional[Mapping[str, Any]] = None,
       side_inputs: Optional[Mapping[str, Any]] = None,
-      outputs: Optional[List[str]] = None):
+      outputs: Optional[List[str]] = None,
+      max_in_flight: int = 4):
     """Initializes the SolutionBase object.
 
     Args:
@@ -209,6 +222,8 @@ class SolutionBase:
       outputs: A list of the graph output stream names to observe. If the list
         is empty, all the output streams listed in the graph config will be
         automatically observed by default.
+      max_in_flight: The maximum number of inputs submitted by process_async()
+        or process_batch() whose outputs are not available yet.
 
     Raises:
       FileNotFoundError: If the binary graph file can't be found.
@@ -225,7 +240,10 @@ class SolutionBase:
         e) If the calculator options field is a repeated field but the field
         value to be set is not iterable.
         f) If not all calculator params are valid.
+        g) If max_in_flight is not positive.
     """
+    if max_in_flight < 1:
+      raise ValueError('max_in_flight must be positive.')
     if bool(binary_graph_path) == bool(graph_config):
       raise ValueError(
           "Must provide exactly one of 'binary_graph_path' or 'graph_config'.")
@@ -246,14 +264,18 @@ class SolutionBase:
                                       calculator_params)
     self._graph = calculator_graph.CalculatorGraph(
         graph_config=canonical_graph_config_proto)
-    self._simulated_timestamp = 0
-    self._graph_outputs = {}
-
-    def callback(stream_name: str, output_packet: packet.Packet) -> None:
-      self._graph_outputs[stream_name] = output_packet
-
-    for stream_name in self._output_stream_type_info.keys():
-      self._graph.observe_output_stream(stream_name, callback, True)
+    # Collects the output packets of each input timestamp without running
+    # Python code on the graph threads.
+    self._output_collector = self._graph.observe_output_streams_by_timestamp(
+        list(self._output_stream_type_info.keys()))
+    self._timestamp = None
+    # State of process_async(). The futures of the inputs in flight are kept in
+    # input order, and are completed by the results thread.
+    self._in_flight = threading.BoundedSemaphore(max_in_flight)
+    self._results_condition = threading.Condition()
+    self._pending_futures = collections.deque()
+    self._stopping_results_thread = False
+    self._results_thread = None
 
     self._input_side_packets = {
         name: self._make_packet(self._side_input_type_info[name], data)
@@ -294,8 +316,145 @@ class SolutionBase:
           {'video_in' : cv2.imread('/tmp/hand1.png')[:, :, ::-1]})
       print(results.hand_landmarks)
     """
-    self._graph_outputs.clear()
+    with self._results_condition:
+      if self._pending_futures:
+        raise RuntimeError(
+            'process() can\'t be called while inputs submitted by '
+            'process_async() are in flight.')
+    timestamp = self._next_timestamp(None)
+    self._add_input_packets(input_data, timestamp)
+    self._output_collector.expect(timestamp)
+    self._graph.wait_until_idle()
+    _, output_packets = self._output_collector.pop(force=True)
+    return self._make_solution_outputs(output_packets)
+
+  def process_async(
+      self,
+      input_data: Union[np.ndarray, Mapping[str, Union[np.ndarray,
+                                                       message.Message]]],
+      timestamp: Optional[int] = None) -> futures.Future:
+    """Submits a set of input data without waiting for the outputs.
+
+    Up to max_in_flight inputs are processed by the graph concurrently. When
+    that many are in flight, blocks until the outputs of the oldest one are
+    available. The outputs of an input are complete once every output stream
+    has either produced a packet at its timestamp or moved past it.
+
+    Args:
+      input_data: The same as the input_data of process().
+      timestamp: The input timestamp in microseconds, e.g. the capture time of
+        a video frame. Must be larger than the timestamps of the previous
+        inputs. If None, the previous timestamp plus 33333 us is used.
+
+    Raises:
+      NotImplementedError: If input_data contains audio data or a list of proto
+        objects.
+      RuntimeError: If the underlying graph occurs any error.
+      ValueError: If the input image data is not three channel RGB or the
+        timestamp is not increasing.
+
+    Returns:
+      A Future of the NamedTuple object that process() would return for the
+      input data. The future fails if the graph fails.
+
+    Examples:
+      future = solution.process_async(frame, timestamp=capture_time_us)
+      ...
+      print(future.result().multi_hand_landmarks)
+    """
+    self._in_flight.acquire()
+    try:
+      timestamp = self._next_timestamp(timestamp)
+      self._add_input_packets(input_data, timestamp)
+    except:
+      self._in_flight.release()
+      raise
+    future = futures.Future()
+    with self._results_condition:
+      self._output_collector.expect(timestamp)
+      self._pending_futures.append(future)
+      if self._results_thread is None:
+        self._stopping_results_thread = False
+        self._results_thread = threading.Thread(
+            target=self._deliver_results, daemon=True)
+        self._results_thread.start()
+      self._results_condition.notify()
+    return future
+
+  def process_batch(
+      self,
+      inputs: Iterable[Union[np.ndarray, Mapping[str, Union[np.ndarray,
+                                                            message.Message]]]],
+      timestamps: Optional[Iterable[int]] = None) -> Iterator[NamedTuple]:
+    """Processes a sequence of inputs, keeping up to max_in_flight in flight.
+
+    Args:
+      inputs: The input data of each frame, as accepted by process().
+      timestamps: The input timestamps in microseconds. If None, the inputs are
+        assumed to be 33333 us apart.
+
+    Raises:
+      ValueError: If timestamps and inputs have different lengths, and all the
+        errors of process_async().
+
+    Yields:
+      The outputs of each input, in input order.
+
+    Examples:
+      for results in solution.process_batch(frames, timestamps=frame_times_us):
+        print(results.multi_hand_landmarks)
+    """
+    timestamp_iterator = iter(timestamps) if timestamps is not None else None
+    pending = collections.deque()
+    for input_data in inputs:
+      timestamp = None
+      if timestamp_iterator is not None:
+        timestamp = next(timestamp_iterator, None)
+        if timestamp is None:
+          raise ValueError('There are fewer timestamps than inputs.')
+      pending.append(self.process_async(input_data, timestamp))
+      while pending and pending[0].done():
+        yield pending.popleft().result()
+    while pending:
+      yield pending.popleft().result()
 
+  def close(self) -> None:
+    """Closes all the input sources and the graph."""
+    try:
+      self._graph.close()
+    finally:
+      self._stop_results_thread()
+    self._graph = None
+    self._input_stream_type_info = None
+    self._output_stream_type_info = None
+
+  def reset(self) -> None:
+    """Resets the graph for another run."""
+    if self._graph:
+      try:
+        self._graph.close()
+      finally:
+        self._stop_results_thread()
+      self._output_collector.reset()
+      self._timestamp = None
+      self._graph.start_run(self._input_side_packets)
+
+  def _next_timestamp(self, timestamp: Optional[int]) -> int:
+    """Returns the timestamp of the next input and makes it the latest one."""
+    if timestamp is None:
+      timestamp = (self._timestamp or 0) + _DEFAULT_TIMESTAMP_INCREMENT
+    elif self._timestamp is not None and timestamp <= self._timestamp:
+      raise ValueError(
+          f'Input timestamps must be increasing, but {timestamp} follows '
+          f'{self._timestamp}.')
+    self._timestamp = timestamp
+    return timestamp
+
+  def _add_input_packets(
+      self, input_data: Union[np.ndarray, Mapping[str, Union[np.ndarray,
+                                                             message.Message]]],
+      timestamp: int) -> None:
+    """Adds the packets of one input to the graph input streams."""
     if isinstance(input_data, np.ndarray):
       if len(self._input_stream_type_info.keys()) != 1:
         raise ValueError(
@@ -305,9 +464,7 @@ class SolutionBase:
     else:
       input_dict = input_data
 
-    # Set the timestamp increment to 33333 us to simulate the 30 fps video
-    # input.
-    self._simulated_timestamp += 33333
+    input_packets = {}
     for stream_name, data in input_dict.items():
       input_stream_type = self._input_stream_type_info[stream_name]
       if (input_stream_type == _PacketDataType.PROTO_LIST or
@@ -321,44 +478,71 @@ class SolutionBase:
             input_stream_type == _PacketDataType.IMAGE):
         if data.shape[2] != RGB_CHANNELS:
           raise ValueError('Input image must contain three channel rgb data.')
-        self._graph.add_packet_to_input_stream(
-            stream=stream_name,
-            packet=self._make_packet(input_stream_type,
-                                     data).at(self._simulated_timestamp))
-      else:
-        self._graph.add_packet_to_input_stream(
-            stream=stream_name,
-            packet=self._make_packet(input_stream_type,
-                                     data).at(self._simulated_timestamp))
+      input_packets[stream_name] = self._make_packet(input_stream_type, data)
+    self._graph.add_packets_to_input_streams(input_packets, timestamp)
 
-    self._graph.wait_until_idle()
+  def _make_solution_outputs(
+      self, output_packets: Mapping[str, packet.Packet]) -> NamedTuple:
+    """Creates the outputs of a graph run from the output packets."""
     # Create a NamedTuple object where the field names are mapping to the graph
     # output stream names.
     solution_outputs = collections.namedtuple(
         'SolutionOutputs', self._output_stream_type_info.keys())
     for stream_name in self._output_stream_type_info.keys():
-      if stream_name in self._graph_outputs:
+      if stream_name in output_packets:
         setattr(
             solution_outputs, stream_name,
             self._get_packet_content(self._output_stream_type_info[stream_name],
-                                     self._graph_outputs[stream_name]))
+                                     output_packets[stream_name]))
       else:
         setattr(solution_outputs, stream_name, None)
 
     return solution_outputs
 
-  def close(self) -> None:
-    """Closes all the input sources and the graph."""
-    self._graph.close()
-    self._graph = None
-    self._input_stream_type_info = None
-    self._output_stream_type_info = None
-
-  def reset(self) -> None:
-    """Resets the graph for another run."""
-    if self._graph:
-      self._graph.close()
-      self._graph.start_run(self._input_side_packets)
+  def _deliver_results(self) -> None:
+    """Completes the futures of process_async() in input order."""
+    while True:
+      with self._results_condition:
+        while not self._pending_futures and not self._stopping_results_thread:
+          self._results_condition.wait()
+        if not self._pending_futures:
+          return
+        # Once the graph is closed, no more timestamp bounds arrive and the
+        # remaining outputs are complete.
+        force = self._stopping_results_thread
+      try:
+        result = self._output_collector.pop(timeout=0.1, force=force)
+      except RuntimeError as e:
+        with self._results_condition:
+          failed_futures = list(self._pending_futures)
+          self._pending_futures.clear()
+          # Later inputs start a new thread, which fails them as well.
+          if self._results_thread is threading.current_thread():
+            self._results_thread = None
+        for future in failed_futures:
+          self._in_flight.release()
+          future.set_exception(e)
+        return
+      if result is None:
+        continue
+      _, output_packets = result
+      with self._results_condition:
+        future = self._pending_futures.popleft()
+      self._in_flight.release()
+      try:
+        future.set_result(self._make_solution_outputs(output_packets))
+      except Exception as e:  # pylint: disable=broad-except
+        future.set_exception(e)
+
+  def _stop_results_thread(self) -> None:
+    """Delivers the outputs in flight and stops the results thread."""
+    with self._results_condition:
+      results_thread = self._results_thread
+      self._results_thread = None
+      self._stopping_results_thread = True
+      self._results_condition.notify()
+    if results_thread is not None:
+      results_thread.join()
 
   def _initialize_graph_interface(
       self,
@@ -531,8 +715,8 @@ class SolutionBase:
       return packet_getter.get_str(output_packet)
     elif (packet_data_type == _PacketDataType.IMAGE_FRAME or
           packet_data_type == _PacketDataType.IMAGE):
-      return getattr(packet_getter, 'get_' +
-                     packet_data_type.value)(output_packet).numpy_view()
+      # The returned ndarray references the packet payload and keeps it alive.
+      return packet_getter.get_image_numpy_view(output_packet)
     else:
       return getattr(packet_getter, 'get_' + packet_data_type.value)(
           output_packet)
@@ -348,6 +348,50 @@ class SolutionBaseTest(parameterized.TestCase):
         self.assertTrue(np.array_equal(input_image, outputs.image_out))
         solution.reset()
 
+  def test_solution_process_batch(self):
+    config_proto = text_format.Parse(CALCULATOR_OPTIONS_TEST_GRAPH_CONFIG,
+                                     calculator_pb2.CalculatorGraphConfig())
+    input_images = [
+        np.full((3, 3, 3), i, dtype=np.uint8) for i in range(20)
+    ]
+    with solution_base.SolutionBase(
+        graph_config=config_proto, max_in_flight=3) as solution:
+      outputs = list(
+          solution.process_batch(
+              input_images, timestamps=[i * 1000 for i in range(20)]))
+    self.assertLen(outputs, 20)
+    for i, output in enumerate(outputs):
+      self.assertEqual(output.image_out.shape, (10, 10, 3))
+      self.assertTrue(np.all(output.image_out == i))
+
+  def test_solution_process_async(self):
+    config_proto = text_format.Parse(CALCULATOR_OPTIONS_TEST_GRAPH_CONFIG,
+                                     calculator_pb2.CalculatorGraphConfig())
+    input_image = np.arange(27, dtype=np.uint8).reshape(3, 3, 3)
+    with solution_base.SolutionBase(graph_config=config_proto) as solution:
+      futures = [solution.process_async(input_image) for _ in range(8)]
+      for future in futures:
+        self.assertEqual(future.result().image_out.shape, (10, 10, 3))
+      with self.assertRaisesRegex(ValueError, 'must be increasing'):
+        solution.process_async(input_image, timestamp=1)
+      # process() can be used again once all the outputs are delivered.
+      self.assertEqual(solution.process(input_image).image_out.shape,
+                       (10, 10, 3))
+
+  def test_solution_timestamps_start_at_zero(self):
+    config_proto = text_format.Parse(CALCULATOR_OPTIONS_TEST_GRAPH_CONFIG,
+                                     calculator_pb2.CalculatorGraphConfig())
+    input_image = np.arange(27, dtype=np.uint8).reshape(3, 3, 3)
+    with solution_base.SolutionBase(graph_config=config_proto) as solution:
+      future = solution.process_async(input_image, timestamp=0)
+      self.assertEqual(future.result().image_out.shape, (10, 10, 3))
+      with self.assertRaisesRegex(ValueError, 'must be increasing'):
+        solution.process_async(input_image, timestamp=0)
+      # A new run starts without a previous timestamp.
+      solution.reset()
+      future = solution.process_async(input_image, timestamp=0)
+      self.assertEqual(future.result().image_out.shape, (10, 10, 3))
+
   def _process_and_verify(self,
                           config_proto,
                           side_inputs=None,
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/vector.h"
@@ -89,6 +90,12 @@ void cv_line2(cv::Mat& img, const cv::Point& start, const cv::Point& end,
 
 void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
   for (const auto& annotation : render_data.render_annotations()) {
+    // Consecutive lines, e.g. landmark connections, are drawn in batches.
+    if (annotation.data_case() == RenderAnnotation::kLine) {
+      BatchLine(annotation);
+      continue;
+    }
+    FlushLines();
     if (annotation.data_case() == RenderAnnotation::kRectangle) {
       DrawRectangle(annotation);
     } else if (annotation.data_case() == RenderAnnotation::kRoundedRectangle) {
@@ -106,8 +113,6 @@ void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
       DrawText(annotation);
     } else if (annotation.data_case() == RenderAnnotation::kPoint) {
       DrawPoint(annotation);
-    } else if (annotation.data_case() == RenderAnnotation::kLine) {
-      DrawLine(annotation);
     } else if (annotation.data_case() == RenderAnnotation::kGradientLine) {
       DrawGradientLine(annotation);
     } else if (annotation.data_case() == RenderAnnotation::kArrow) {
@@ -116,6 +121,7 @@ void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
       LOG(FATAL) << "Unknown annotation type: " << annotation.data_case();
     }
   }
+  FlushLines();
 }
 
 void AnnotationRenderer::AdoptImage(cv::Mat* input_image) {
@@ -124,6 +130,67 @@ void AnnotationRenderer::AdoptImage(cv::Mat* input_image) {
 
   // No pixel data copy here, only headers are copied.
   mat_image_ = *input_image;
+  ResetDirtyTiles();
+}
+
+void AnnotationRenderer::ResetDirtyTiles() {
+  num_tiles_x_ = (image_width_ + kDirtyTileSize - 1) / kDirtyTileSize;
+  num_tiles_y_ = (image_height_ + kDirtyTileSize - 1) / kDirtyTileSize;
+  dirty_tiles_.assign(std::max(0, num_tiles_x_ * num_tiles_y_), false);
+  num_dirty_tiles_ = 0;
+}
+
+void AnnotationRenderer::MarkDirty(const cv::Rect& rect) {
+  const cv::Rect clipped = rect & cv::Rect(0, 0, image_width_, image_height_);
+  if (clipped.empty()) return;
+  const int tile_x_end = (clipped.x + clipped.width - 1) / kDirtyTileSize;
+  const int tile_y_end = (clipped.y + clipped.height - 1) / kDirtyTileSize;
+  for (int ty = clipped.y / kDirtyTileSize; ty <= tile_y_end; ++ty) {
+    for (int tx = clipped.x / kDirtyTileSize; tx <= tile_x_end; ++tx) {
+      const int index = ty * num_tiles_x_ + tx;
+      if (!dirty_tiles_[index]) {
+        dirty_tiles_[index] = true;
+        ++num_dirty_tiles_;
+      }
+    }
+  }
+}
+
+void AnnotationRenderer::MarkDirty(const cv::Point* points, int num_points,
+                                   int margin) {
+  if (num_points == 0) return;
+  int left = points[0].x, right = points[0].x;
+  int top = points[0].y, bottom = points[0].y;
+  for (int i = 1; i < num_points; ++i) {
+    left = std::min(left, points[i].x);
+    right = std::max(right, points[i].x);
+    top = std::min(top, points[i].y);
+    bottom = std::max(bottom, points[i].y);
+  }
+  MarkDirty(cv::Rect(cv::Point(left - margin, top - margin),
+                     cv::Point(right + margin + 1, bottom + margin + 1)));
+}
+
+std::vector<cv::Rect> AnnotationRenderer::GetDirtyRects() const {
+  std::vector<cv::Rect> rects;
+  if (num_dirty_tiles_ == 0) return rects;
+  const cv::Rect image_rect(0, 0, image_width_, image_height_);
+  for (int ty = 0; ty < num_tiles_y_; ++ty) {
+    int tx = 0;
+    while (tx < num_tiles_x_) {
+      if (!dirty_tiles_[ty * num_tiles_x_ + tx]) {
+        ++tx;
+        continue;
+      }
+      const int run_begin = tx;
+      while (tx < num_tiles_x_ && dirty_tiles_[ty * num_tiles_x_ + tx]) ++tx;
+      rects.push_back(cv::Rect(run_begin * kDirtyTileSize, ty * kDirtyTileSize,
+                               (tx - run_begin) * kDirtyTileSize,
+                               kDirtyTileSize) &
+                      image_rect);
+    }
+  }
+  return rects;
 }
 
 int AnnotationRenderer::GetImageWidth() const { return mat_image_.cols; }
@@ -166,13 +233,18 @@ void AnnotationRenderer::DrawRectangle(const RenderAnnotation& annotation) {
     const int kNumVertices = 4;
     cv::Point2f vertices[kNumVertices];
     rect.points(vertices);
+    cv::Point points[kNumVertices];
     for (int i = 0; i < kNumVertices; i++) {
       cv::line(mat_image_, vertices[i], vertices[(i + 1) % kNumVertices], color,
                thickness);
+      points[i] = vertices[i];
     }
+    MarkDirty(points, kNumVertices, thickness + 1);
   } else {
     cv::Rect rect(left, top, right - left, bottom - top);
     cv::rectangle(mat_image_, rect, color, thickness);
+    const cv::Point points[] = {{left, top}, {right, bottom}};
+    MarkDirty(points, 2, thickness + 1);
   }
 }
 
@@ -210,9 +282,12 @@ void AnnotationRenderer::DrawFilledRectangle(
       vertices[i] = vertices2f[i];
     }
     cv::fillConvexPoly(mat_image_, vertices, kNumVertices, color);
+    MarkDirty(vertices, kNumVertices, 1);
   } else {
     cv::Rect rect(left, top, right - left, bottom - top);
     cv::rectangle(mat_image_, rect, color, -1);
+    const cv::Point points[] = {{left, top}, {right, bottom}};
+    MarkDirty(points, 2, 1);
   }
 }
 
@@ -246,6 +321,8 @@ void AnnotationRenderer::DrawRoundedRectangle(
   DrawRoundedRectangle(mat_image_, cv::Point(left, top),
                        cv::Point(right, bottom), color, thickness, line_type,
                        corner_radius);
+  const cv::Point points[] = {{left, top}, {right, bottom}};
+  MarkDirty(points, 2, thickness + 1);
 }
 
 void AnnotationRenderer::DrawFilledRoundedRectangle(
@@ -277,6 +354,8 @@ void AnnotationRenderer::DrawFilledRoundedRectangle(
   DrawRoundedRectangle(mat_image_, cv::Point(left, top),
                        cv::Point(right, bottom), color, -1, line_type,
                        corner_radius);
+  const cv::Point points[] = {{left, top}, {right, bottom}};
+  MarkDirty(points, 2, 1);
 }
 
 void AnnotationRenderer::DrawRoundedRectangle(cv::Mat src, cv::Point top_left,
@@ -349,6 +428,9 @@ void AnnotationRenderer::DrawOval(const RenderAnnotation& annotation) {
   const int thickness =
       ClampThickness(round(annotation.thickness() * scale_factor_));
   cv::ellipse(mat_image_, center, size, rotation, 0, 360, color, thickness);
+  // Bounds the ellipse for any rotation.
+  const int radius = std::max(std::abs(size.width), std::abs(size.height));
+  MarkDirty(&center, 1, radius + thickness + 1);
 }
 
 void AnnotationRenderer::DrawFilledOval(const RenderAnnotation& annotation) {
@@ -377,6 +459,7 @@ void AnnotationRenderer::DrawFilledOval(const RenderAnnotation& annotation) {
   const double rotation = enclosing_rectangle.rotation() / M_PI * 180.f;
   const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
   cv::ellipse(mat_image_, center, size, rotation, 0, 360, color, -1);
+  MarkDirty(&center, 1, std::max(size.width, size.height) + 1);
 }
 
 void AnnotationRenderer::DrawArrow(const RenderAnnotation& annotation) {
@@ -427,6 +510,9 @@ void AnnotationRenderer::DrawArrow(const RenderAnnotation& annotation) {
                                  static_cast<int>(round(arrowtip_right[1])));
   cv::line(mat_image_, arrowtip_left_start, arrow_end, color, thickness);
   cv::line(mat_image_, arrowtip_right_start, arrow_end, color, thickness);
+  const cv::Point points[] = {arrow_start, arrow_end, arrowtip_left_start,
+                              arrowtip_right_start};
+  MarkDirty(points, 4, thickness + 1);
 }
 
 void AnnotationRenderer::DrawPoint(const RenderAnnotation& annotation) {
@@ -446,9 +532,12 @@ void AnnotationRenderer::DrawPoint(const RenderAnnotation& annotation) {
   const int thickness =
       ClampThickness(round(annotation.thickness() * scale_factor_));
   cv::circle(mat_image_, point_to_draw, thickness, color, -1);
+  MarkDirty(&point_to_draw, 1, thickness + 1);
 }
 
-void AnnotationRenderer::DrawLine(const RenderAnnotation& annotation) {
+void AnnotationRenderer::GetLinePoints(const RenderAnnotation& annotation,
+                                       cv::Point* start, cv::Point* end,
+                                       int* thickness) const {
   int x_start = -1;
   int y_start = -1;
   int x_end = -1;
@@ -468,12 +557,40 @@ void AnnotationRenderer::DrawLine(const RenderAnnotation& annotation) {
     y_end = static_cast<int>(line.y_end() * scale_factor_);
   }
 
-  cv::Point start(x_start, y_start);
-  cv::Point end(x_end, y_end);
+  *start = cv::Point(x_start, y_start);
+  *end = cv::Point(x_end, y_end);
+  *thickness = ClampThickness(round(annotation.thickness() * scale_factor_));
+}
+
+void AnnotationRenderer::BatchLine(const RenderAnnotation& annotation) {
+  cv::Point start, end;
+  int thickness;
+  GetLinePoints(annotation, &start, &end, &thickness);
   const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
-  const int thickness =
-      ClampThickness(round(annotation.thickness() * scale_factor_));
-  cv::line(mat_image_, start, end, color, thickness);
+  if (!line_batch_.empty() &&
+      (color != line_batch_color_ || thickness != line_batch_thickness_)) {
+    FlushLines();
+  }
+  line_batch_color_ = color;
+  line_batch_thickness_ = thickness;
+  line_batch_.push_back(start);
+  line_batch_.push_back(end);
+  MarkDirty(&line_batch_[line_batch_.size() - 2], 2, thickness + 1);
+}
+
+void AnnotationRenderer::FlushLines() {
+  if (line_batch_.empty()) return;
+  // cv::polylines() draws each open 2-point contour exactly like cv::line().
+  const int num_lines = line_batch_.size() / 2;
+  line_batch_contours_.resize(num_lines);
+  line_batch_sizes_.assign(num_lines, 2);
+  for (int i = 0; i < num_lines; ++i) {
+    line_batch_contours_[i] = &line_batch_[2 * i];
+  }
+  cv::polylines(mat_image_, line_batch_contours_.data(),
+                line_batch_sizes_.data(), num_lines, /*isClosed=*/false,
+                line_batch_color_, line_batch_thickness_);
+  line_batch_.clear();
 }
 
 void AnnotationRenderer::DrawGradientLine(const RenderAnnotation& annotation) {
@@ -503,6 +620,9 @@ void AnnotationRenderer::DrawGradientLine(const RenderAnnotation& annotation) {
   const cv::Scalar color1 = MediapipeColorToOpenCVColor(line.color1());
   const cv::Scalar color2 = MediapipeColorToOpenCVColor(line.color2());
   cv_line2(mat_image_, start, end, color1, color2, thickness);
+  // cv_line2() draws thickness x thickness squares below and right of the line.
+  const cv::Point points[] = {start, end};
+  MarkDirty(points, 2, thickness + 1);
 }
 
 void AnnotationRenderer::DrawText(const RenderAnnotation& annotation) {
@@ -543,6 +663,12 @@ void AnnotationRenderer::DrawText(const RenderAnnotation& annotation) {
   cv::putText(mat_image_, text.display_text(), origin, font_face, font_scale,
               color, thickness, /*lineType=*/8,
               /*bottomLeftOrigin=*/flip_text_vertically_);
+  // The text extends above the origin, or below it if flipped.
+  const int text_height = text_size.height + text_baseline;
+  const cv::Point points[] = {
+      {origin.x, origin.y - text_height},
+      {origin.x + text_size.width, origin.y + text_height}};
+  MarkDirty(points, 2, thickness + 1);
 }
 
 double AnnotationRenderer::ComputeFontScale(int font_face, int font_size,
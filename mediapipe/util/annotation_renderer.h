@@ -16,6 +16,7 @@
 #define MEDIAPIPE_UTIL_ANNOTATION_RENDERER_H_
 
 #include <string>
+#include <vector>
 
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
@@ -45,22 +46,42 @@ namespace mediapipe {
 // renderer.RenderDataOnImage(render_data_1);
 //
 // UseRenderedImage(mat_image.get());
+//
+// The renderer records which tiles of the image have been drawn on since the
+// image was adopted, see GetDirtyRects().
 class AnnotationRenderer {
  public:
+  // Size in pixels of the square tiles used to track the drawn regions.
+  static constexpr int kDirtyTileSize = 32;
+
   explicit AnnotationRenderer() {}
 
   explicit AnnotationRenderer(const cv::Mat& mat_image)
       : image_width_(mat_image.cols),
         image_height_(mat_image.rows),
-        mat_image_(mat_image.clone()) {}
+        mat_image_(mat_image.clone()) {
+    ResetDirtyTiles();
+  }
 
   // Renders the image with the input render data.
   void RenderDataOnImage(const RenderData& render_data);
 
   // Resets the renderer with a new image. Does not own input_image. input_image
-  // must not be modified by caller during rendering.
+  // must not be modified by caller during rendering. Clears the dirty tiles.
   void AdoptImage(cv::Mat* input_image);
 
+  // Returns whether anything has been drawn since the image was adopted.
+  bool HasDirtyTiles() const { return num_dirty_tiles_ > 0; }
+
+  // Returns rectangles, clipped to the image, that cover all pixels drawn on
+  // since the image was adopted. Horizontally adjacent dirty tiles are merged,
+  // and the rectangles are sorted top to bottom.
+  std::vector<cv::Rect> GetDirtyRects() const;
+
+  // Marks the pixels in `rect` as drawn, e.g. when they were modified by the
+  // caller.
+  void MarkDirty(const cv::Rect& rect);
+
   // Gets image dimensions.
   int GetImageWidth() const;
   int GetImageHeight() const;
@@ -97,8 +118,13 @@ class AnnotationRenderer {
   // Draws a point on the image as described in the annotation.
   void DrawPoint(const RenderAnnotation& annotation);
 
-  // Draws a line segment on the image as described in the annotation.
-  void DrawLine(const RenderAnnotation& annotation);
+  // Adds the line segment described in the annotation to the pending batch of
+  // line segments, which is drawn at once when an annotation of another
+  // color, thickness or type follows.
+  void BatchLine(const RenderAnnotation& annotation);
+
+  // Draws and clears the pending batch of line segments.
+  void FlushLines();
 
   // Draws a 2-tone line segment on the image as described in the annotation.
   void DrawGradientLine(const RenderAnnotation& annotation);
@@ -125,6 +151,16 @@ class AnnotationRenderer {
   // Computes the font scale from font_face, size and thickness.
   double ComputeFontScale(int font_face, int font_size, int thickness);
 
+  // Computes the end points and thickness of a line annotation in pixels.
+  void GetLinePoints(const RenderAnnotation& annotation, cv::Point* start,
+                     cv::Point* end, int* thickness) const;
+
+  // Marks the bounding box of `points`, extended by `margin` pixels, as drawn.
+  void MarkDirty(const cv::Point* points, int num_points, int margin);
+
+  // Clears the dirty tiles and resizes them to the image.
+  void ResetDirtyTiles();
+
   // Width and Height of the image (in pixels).
   int image_width_ = -1;
   int image_height_ = -1;
@@ -137,6 +173,20 @@ class AnnotationRenderer {
 
   // See SetScaleFactor(float)
   float scale_factor_ = 1.0;
+
+  // Tiles of kDirtyTileSize pixels drawn on since the image was adopted.
+  std::vector<bool> dirty_tiles_;
+  int num_tiles_x_ = 0;
+  int num_tiles_y_ = 0;
+  int num_dirty_tiles_ = 0;
+
+  // End points of the pending line segments of the same color and thickness,
+  // see BatchLine(). The buffers are reused across images.
+  std::vector<cv::Point> line_batch_;
+  std::vector<const cv::Point*> line_batch_contours_;
+  std::vector<int> line_batch_sizes_;
+  cv::Scalar line_batch_color_;
+  int line_batch_thickness_ = 0;
 };
 }  // namespace mediapipe
 
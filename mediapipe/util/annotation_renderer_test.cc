@@ -0,0 +1,291 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/annotation_renderer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/util/render_data.pb.h"
+
+namespace mediapipe {
+namespace {
+
+// Not a multiple of the tile size, so that the last tiles are clipped.
+constexpr int kImageWidth = 150;
+constexpr int kImageHeight = 100;
+
+struct AnnotationTestCase {
+  std::string name;
+  std::string annotation;
+};
+
+// Returns the number of pixels that differ between `before` and `after` and
+// lie outside all of `rects`.
+int CountChangedPixelsOutside(const cv::Mat& before, const cv::Mat& after,
+                              const std::vector<cv::Rect>& rects) {
+  cv::Mat changed;
+  cv::absdiff(before, after, changed);
+  cv::cvtColor(changed, changed, cv::COLOR_RGB2GRAY);
+  cv::threshold(changed, changed, 0, 255, cv::THRESH_BINARY);
+  for (const cv::Rect& rect : rects) {
+    changed(rect).setTo(0);
+  }
+  return cv::countNonZero(changed);
+}
+
+class AnnotationRendererDirtyRectsTest
+    : public testing::TestWithParam<AnnotationTestCase> {};
+
+TEST_P(AnnotationRendererDirtyRectsTest, CoverAllChangedPixels) {
+  RenderData render_data;
+  *render_data.add_render_annotations() =
+      ParseTextProtoOrDie<RenderAnnotation>(GetParam().annotation);
+
+  for (float scale_factor : {1.0f, 0.5f}) {
+    cv::Mat image(kImageHeight, kImageWidth, CV_8UC3, cv::Scalar(10, 20, 30));
+    const cv::Mat original = image.clone();
+    AnnotationRenderer renderer;
+    renderer.SetScaleFactor(scale_factor);
+    renderer.AdoptImage(&image);
+    EXPECT_FALSE(renderer.HasDirtyTiles());
+    renderer.RenderDataOnImage(render_data);
+
+    ASSERT_GT(cv::norm(original, image, cv::NORM_INF), 0)
+        << "Nothing was drawn at scale " << scale_factor;
+    EXPECT_TRUE(renderer.HasDirtyTiles());
+    const std::vector<cv::Rect> rects = renderer.GetDirtyRects();
+    ASSERT_FALSE(rects.empty());
+    for (const cv::Rect& rect : rects) {
+      EXPECT_EQ(rect, rect & cv::Rect(0, 0, kImageWidth, kImageHeight));
+    }
+    EXPECT_EQ(0, CountChangedPixelsOutside(original, image, rects))
+        << "at scale " << scale_factor;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Primitives, AnnotationRendererDirtyRectsTest,
+    testing::ValuesIn(std::vector<AnnotationTestCase>{
+        {"Rectangle", R"pb(
+           rectangle { left: 40 top: 30 right: 90 bottom: 70 }
+           thickness: 3
+           color { r: 255 g: 0 b: 0 }
+         )pb"},
+        {"NormalizedRectangle", R"pb(
+           rectangle {
+             left: 0.1
+             top: 0.2
+             right: 0.6
+             bottom: 0.9
+             normalized: true
+           }
+           thickness: 2
+           color { r: 255 g: 0 b: 0 }
+         )pb"},
+        {"RotatedRectangle", R"pb(
+           rectangle {
+             left: 40
+             top: 30
+             right: 110
+             bottom: 70
+             rotation: 0.7
+           }
+           thickness: 4
+           color { r: 0 g: 255 b: 0 }
+         )pb"},
+        {"RectangleCrossingTheBorder", R"pb(
+           rectangle { left: -20 top: 80 right: 170 bottom: 130 }
+           thickness: 5
+           color { r: 0 g: 255 b: 0 }
+         )pb"},
+        {"FilledRectangle", R"pb(
+           filled_rectangle {
+             rectangle { left: 70 top: 10 right: 140 bottom: 50 }
+             fill_color { r: 0 g: 0 b: 255 }
+           }
+           thickness: 2
+           color { r: 255 g: 255 b: 0 }
+         )pb"},
+        {"RotatedFilledRectangle", R"pb(
+           filled_rectangle {
+             rectangle {
+               left: 70
+               top: 10
+               right: 140
+               bottom: 50
+               rotation: -0.4
+             }
+             fill_color { r: 0 g: 0 b: 255 }
+           }
+           color { r: 255 g: 255 b: 0 }
+         )pb"},
+        {"RoundedRectangle", R"pb(
+           rounded_rectangle {
+             rectangle { left: 20 top: 20 right: 100 bottom: 80 }
+             corner_radius: 10
+           }
+           thickness: 3
+           color { r: 255 g: 0 b: 255 }
+         )pb"},
+        {"Oval", R"pb(
+           oval { rectangle { left: 30 top: 10 right: 120 bottom: 90 } }
+           thickness: 6
+           color { r: 200 g: 100 b: 0 }
+         )pb"},
+        {"FilledOval", R"pb(
+           filled_oval {
+             oval { rectangle { left: 100 top: 60 right: 160 bottom: 110 } }
+             fill_color { r: 0 g: 100 b: 200 }
+           }
+           thickness: 2
+           color { r: 200 g: 100 b: 0 }
+         )pb"},
+        {"Point", R"pb(
+           point { x: 75 y: 50 }
+           thickness: 9
+           color { r: 255 g: 255 b: 255 }
+         )pb"},
+        {"NormalizedPoint", R"pb(
+           point { x: 0.99 y: 0.01 normalized: true }
+           thickness: 6
+           color { r: 255 g: 255 b: 255 }
+         )pb"},
+        {"Line", R"pb(
+           line { x_start: 5 y_start: 95 x_end: 145 y_end: 3 }
+           thickness: 4
+           color { r: 255 g: 128 b: 0 }
+         )pb"},
+        {"ThickLine", R"pb(
+           line { x_start: 60 y_start: 31 x_end: 66 y_end: 33 }
+           thickness: 20
+           color { r: 255 g: 128 b: 0 }
+         )pb"},
+        {"GradientLine", R"pb(
+           gradient_line {
+             x_start: 10
+             y_start: 10
+             x_end: 140
+             y_end: 90
+             color1 { r: 255 g: 0 b: 0 }
+             color2 { r: 0 g: 0 b: 255 }
+           }
+           thickness: 5
+         )pb"},
+        {"Arrow", R"pb(
+           arrow { x_start: 20 y_start: 80 x_end: 130 y_end: 20 }
+           thickness: 3
+           color { r: 0 g: 255 b: 128 }
+         )pb"},
+        {"Text", R"pb(
+           text {
+             display_text: "MediaPipe"
+             left: 10
+             baseline: 60
+             font_height: 30
+           }
+           thickness: 2
+           color { r: 255 g: 255 b: 255 }
+         )pb"},
+        {"CenteredText", R"pb(
+           text {
+             display_text: "Wide text"
+             left: 75
+             baseline: 50
+             font_height: 25
+             center_horizontally: true
+             center_vertically: true
+           }
+           thickness: 3
+           color { r: 255 g: 255 b: 255 }
+         )pb"},
+    }),
+    [](const testing::TestParamInfo<AnnotationTestCase>& info) {
+      return info.param.name;
+    });
+
+TEST(AnnotationRendererTest, AdoptImageClearsDirtyRects) {
+  cv::Mat image(kImageHeight, kImageWidth, CV_8UC3, cv::Scalar(0, 0, 0));
+  AnnotationRenderer renderer;
+  renderer.AdoptImage(&image);
+  renderer.MarkDirty(cv::Rect(40, 40, 1, 1));
+  EXPECT_THAT(renderer.GetDirtyRects(),
+              testing::ElementsAre(cv::Rect(32, 32, 32, 32)));
+
+  renderer.AdoptImage(&image);
+  EXPECT_FALSE(renderer.HasDirtyTiles());
+  EXPECT_TRUE(renderer.GetDirtyRects().empty());
+}
+
+TEST(AnnotationRendererTest, MergesAdjacentDirtyTilesAndClipsToImage) {
+  cv::Mat image(kImageHeight, kImageWidth, CV_8UC3, cv::Scalar(0, 0, 0));
+  AnnotationRenderer renderer;
+  renderer.AdoptImage(&image);
+  renderer.MarkDirty(cv::Rect(100, 70, 100, 5));
+  renderer.MarkDirty(cv::Rect(-10, -10, 20, 20));
+  EXPECT_THAT(renderer.GetDirtyRects(),
+              testing::ElementsAre(cv::Rect(0, 0, 32, 32),
+                                   cv::Rect(96, 64, 54, 32)));
+}
+
+// Consecutive lines are drawn with one cv::polylines() call per color and
+// thickness, which must give the same pixels as one cv::line() call per
+// segment.
+TEST(AnnotationRendererTest, BatchedLinesMatchSegmentByLineDrawing) {
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> x(-20, kImageWidth + 20);
+  std::uniform_real_distribution<double> y(-20, kImageHeight + 20);
+  const cv::Scalar colors[] = {{255, 0, 0}, {0, 255, 0}};
+  const int thicknesses[] = {1, 2, 5};
+
+  RenderData render_data;
+  cv::Mat expected(kImageHeight, kImageWidth, CV_8UC3, cv::Scalar(0, 0, 0));
+  for (int i = 0; i < 200; ++i) {
+    // Runs of a few lines share their color and thickness.
+    const cv::Scalar& color = colors[(i / 7) % 2];
+    const int thickness = thicknesses[(i / 5) % 3];
+    RenderAnnotation* annotation = render_data.add_render_annotations();
+    annotation->set_thickness(thickness);
+    annotation->mutable_color()->set_r(color[0]);
+    annotation->mutable_color()->set_g(color[1]);
+    annotation->mutable_color()->set_b(color[2]);
+    auto* line = annotation->mutable_line();
+    line->set_x_start(x(random));
+    line->set_y_start(y(random));
+    line->set_x_end(x(random));
+    line->set_y_end(y(random));
+
+    cv::line(expected,
+             cv::Point(static_cast<int>(line->x_start()),
+                       static_cast<int>(line->y_start())),
+             cv::Point(static_cast<int>(line->x_end()),
+                       static_cast<int>(line->y_end())),
+             color, thickness);
+  }
+
+  cv::Mat image(kImageHeight, kImageWidth, CV_8UC3, cv::Scalar(0, 0, 0));
+  AnnotationRenderer renderer;
+  renderer.AdoptImage(&image);
+  renderer.RenderDataOnImage(render_data);
+  EXPECT_EQ(0, cv::norm(expected, image, cv::NORM_INF));
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,42 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/image_frame_pool_util.h"
+
+#include "absl/memory/memory.h"
+
+namespace mediapipe {
+
+const char kImageFramePoolHitsCounter[] = "ImageFramePoolHits";
+const char kImageFramePoolMissesCounter[] = "ImageFramePoolMisses";
+
+std::unique_ptr<ImageFrame> GetPooledImageFrame(CalculatorContext* cc,
+                                                ImageFormat::Format format,
+                                                int width, int height,
+                                                int alignment_boundary) {
+  auto pool = cc->Service(kImageFramePoolService);
+  if (!pool.IsAvailable()) {
+    return absl::make_unique<ImageFrame>(format, width, height,
+                                         alignment_boundary);
+  }
+  bool reused = false;
+  auto frame = pool.GetObject().GetFrame(format, width, height,
+                                         alignment_boundary, &reused);
+  cc->GetCounter(reused ? kImageFramePoolHitsCounter
+                        : kImageFramePoolMissesCounter)
+      ->Increment();
+  return frame;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,55 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Helpers for CPU calculators that allocate their output ImageFrames from the
+// graph's ImageFrameMultiPool. A calculator requests the pool in GetContract():
+//
+//   cc->UseService(kImageFramePoolService).Optional();
+//
+// and then allocates its outputs with:
+//
+//   std::unique_ptr<ImageFrame> output =
+//       GetPooledImageFrame(cc, ImageFormat::SRGB, width, height);
+//   ...
+//   cc->Outputs().Tag(kImageFrameTag).Add(output.release(), timestamp);
+//
+// The pixel data returns to the pool when the last packet holding the frame
+// is released.
+
+#ifndef MEDIAPIPE_UTIL_IMAGE_FRAME_POOL_UTIL_H_
+#define MEDIAPIPE_UTIL_IMAGE_FRAME_POOL_UTIL_H_
+
+#include <memory>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_multi_pool.h"
+
+namespace mediapipe {
+
+// The names of the node counters that count pool hits and misses.
+extern const char kImageFramePoolHitsCounter[];
+extern const char kImageFramePoolMissesCounter[];
+
+// Returns a frame from the graph's ImageFrameMultiPool, and counts whether its
+// pixel data was reused in the node's counters. Returns a newly allocated
+// frame if the pool is not available. The pixel values are unspecified.
+std::unique_ptr<ImageFrame> GetPooledImageFrame(
+    CalculatorContext* cc, ImageFormat::Format format, int width, int height,
+    int alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_IMAGE_FRAME_POOL_UTIL_H_
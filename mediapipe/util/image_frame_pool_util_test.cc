@@ -0,0 +1,109 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/image_frame_pool_util.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Outputs a pooled 8x8 GRAY8 frame for every input packet.
+class PooledFrameCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    auto frame = GetPooledImageFrame(cc, ImageFormat::GRAY8, 8, 8);
+    frame->SetToZero();
+    cc->Outputs().Index(0).Add(frame.release(), cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(PooledFrameCalculator);
+
+int64 GetNodeCounter(CalculatorGraph* graph, const std::string& name) {
+  return graph->GetCounterFactory()
+      ->GetCounter(absl::StrCat("pooled-", name))
+      ->Get();
+}
+
+TEST(ImageFramePoolUtilTest, GraphProvidesPoolToCalculators) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "in"
+    node {
+      name: "pooled"
+      calculator: "PooledFrameCalculator"
+      input_stream: "in"
+      output_stream: "out"
+    }
+  )pb")));
+  // Each output is released by the observer before the next one is made.
+  std::vector<const uint8*> pixel_data;
+  MP_ASSERT_OK(graph.ObserveOutputStream("out", [&](const Packet& packet) {
+    pixel_data.push_back(packet.Get<ImageFrame>().PixelData());
+    return absl::OkStatus();
+  }));
+  MP_ASSERT_OK(graph.StartRun({}));
+  EXPECT_NE(nullptr, graph.GetServiceObject(kImageFramePoolService));
+  for (int i = 0; i < 4; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "in", MakePacket<int>(i).At(Timestamp(i))));
+    MP_ASSERT_OK(graph.WaitUntilIdle());
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(4, pixel_data.size());
+  for (const uint8* data : pixel_data) {
+    EXPECT_EQ(pixel_data[0], data);
+  }
+  EXPECT_EQ(1, GetNodeCounter(&graph, kImageFramePoolMissesCounter));
+  EXPECT_EQ(3, GetNodeCounter(&graph, kImageFramePoolHitsCounter));
+}
+
+TEST(ImageFramePoolUtilTest, CreatesPoolOnlyWhenRequested) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "in"
+    output_stream: "out"
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "in"
+      output_stream: "out"
+    }
+  )pb")));
+  MP_ASSERT_OK(graph.StartRun({}));
+  EXPECT_EQ(nullptr, graph.GetServiceObject(kImageFramePoolService));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -15,8 +15,11 @@
 #include "mediapipe/util/image_frame_util.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -24,7 +27,10 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "libyuv/convert.h"
+#include "libyuv/convert_argb.h"
 #include "libyuv/convert_from.h"
+#include "libyuv/convert_from_argb.h"
+#include "libyuv/planar_functions.h"
 #include "libyuv/row.h"
 #include "libyuv/video_common.h"
 #include "mediapipe/framework/deps/mathutil.h"
@@ -35,12 +41,195 @@
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/port.h"
+#include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status_macros.h"
 
 namespace mediapipe {
 
 namespace image_frame_util {
 
+namespace {
+
+// The BT.601 luma weights used by cv::COLOR_RGB2GRAY, in 14-bit fixed point.
+constexpr int kLumaShift = 14;
+constexpr int kLumaRound = 1 << (kLumaShift - 1);
+constexpr int kLumaRedWeight = 4899;
+constexpr int kLumaGreenWeight = 9617;
+constexpr int kLumaBlueWeight = 1868;
+
+// The planes of an 8-bit 4:2:0 image with separate U and V planes.
+struct I420Planes {
+  const uint8* y;
+  int y_stride;
+  const uint8* u;
+  int u_stride;
+  const uint8* v;
+  int v_stride;
+};
+
+// Runs row_function(source_row, destination_row, width) on every row. Rows of
+// contiguous images are coalesced into a single long row, which gives the
+// vectorized loops longer runs.
+template <typename RowFunction>
+void ForEachRow(const uint8* source, int source_step, bool source_contiguous,
+                uint8* destination, int destination_step,
+                bool destination_contiguous, int width, int height,
+                RowFunction row_function) {
+  if (source_contiguous && destination_contiguous) {
+    row_function(source, destination, width * height);
+    return;
+  }
+  for (int row = 0; row < height; ++row) {
+    row_function(source + row * source_step,
+                 destination + row * destination_step, width);
+  }
+}
+
+// Computes BT.601 luma from pixels with kChannels channels, where red is
+// channel kRed and blue is channel 2 - kRed.
+template <int kChannels, int kRed>
+void RgbRowToGray(const uint8* source, uint8* destination, int width) {
+  constexpr int kBlue = 2 - kRed;
+  for (int x = 0; x < width; ++x) {
+    const uint8* pixel = source + x * kChannels;
+    destination[x] = static_cast<uint8>(
+        (kLumaRedWeight * pixel[kRed] + kLumaGreenWeight * pixel[1] +
+         kLumaBlueWeight * pixel[kBlue] + kLumaRound) >>
+        kLumaShift);
+  }
+}
+
+// Replicates gray values into kChannels channels, with opaque alpha.
+template <int kChannels>
+void GrayRowToRgb(const uint8* source, uint8* destination, int width) {
+  for (int x = 0; x < width; ++x) {
+    uint8* pixel = destination + x * kChannels;
+    pixel[0] = source[x];
+    pixel[1] = source[x];
+    pixel[2] = source[x];
+    if (kChannels == 4) {
+      pixel[3] = 255;
+    }
+  }
+}
+
+// Maps every value of a row through a 256 entry lookup table.
+void LookupRow(const std::array<uint8, 256>& lut, const uint8* source,
+               uint8* destination, int width) {
+  for (int x = 0; x < width; ++x) {
+    destination[x] = lut[source[x]];
+  }
+}
+
+// Lookup tables between MPEG (studio range) luma and full range gray values.
+const std::array<uint8, 256>& GetMpegLumaToGrayLut() {
+  static const std::array<uint8, 256> kLut = [] {
+    std::array<uint8, 256> lut;
+    for (int i = 0; i < 256; ++i) {
+      lut[i] = mediapipe::MathUtil::SafeRound<uint8, double>(255.0 / 219.0 *
+                                                             (i - 16.0));
+    }
+    return lut;
+  }();
+  return kLut;
+}
+
+const std::array<uint8, 256>& GetGrayToMpegLumaLut() {
+  static const std::array<uint8, 256> kLut = [] {
+    std::array<uint8, 256> lut;
+    for (int i = 0; i < 256; ++i) {
+      lut[i] = mediapipe::MathUtil::SafeRound<uint8, double>(16.0 +
+                                                             219.0 / 255.0 * i);
+    }
+    return lut;
+  }();
+  return kLut;
+}
+
+absl::Status CheckSameSize(int source_width, int source_height,
+                           int destination_width, int destination_height) {
+  RET_CHECK(source_width == destination_width &&
+            source_height == destination_height)
+      << "Source is " << source_width << "x" << source_height
+      << " but destination is " << destination_width << "x"
+      << destination_height;
+  return absl::OkStatus();
+}
+
+absl::Status I420ToImageFrame(const I420Planes& planes, int width, int height,
+                              bool use_bt709, ImageFrame* image_frame) {
+  uint8* dst = image_frame->MutablePixelData();
+  const int dst_step = image_frame->WidthStep();
+  int rv;
+  switch (image_frame->Format()) {
+    case ImageFormat::SRGB:
+      rv = (use_bt709 ? libyuv::H420ToRAW : libyuv::I420ToRAW)(
+          planes.y, planes.y_stride, planes.u, planes.u_stride, planes.v,
+          planes.v_stride, dst, dst_step, width, height);
+      break;
+    case ImageFormat::SRGBA:
+      rv = (use_bt709 ? libyuv::H420ToABGR : libyuv::I420ToABGR)(
+          planes.y, planes.y_stride, planes.u, planes.u_stride, planes.v,
+          planes.v_stride, dst, dst_step, width, height);
+      break;
+    case ImageFormat::SBGRA:
+      rv = (use_bt709 ? libyuv::H420ToARGB : libyuv::I420ToARGB)(
+          planes.y, planes.y_stride, planes.u, planes.u_stride, planes.v,
+          planes.v_stride, dst, dst_step, width, height);
+      break;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported ImageFrame format for YUV conversion: ",
+                       ImageFormat::Format_Name(image_frame->Format())));
+  }
+  RET_CHECK_EQ(0, rv);
+  return absl::OkStatus();
+}
+
+// Converts an SRGB, SRGBA or SBGRA frame to I420 planes, or GRAY8 to gray I420.
+absl::Status ImageFrameToI420(const ImageFrame& image_frame, uint8* y,
+                              int y_stride, uint8* u, int u_stride, uint8* v,
+                              int v_stride) {
+  const uint8* src = image_frame.PixelData();
+  const int src_step = image_frame.WidthStep();
+  const int width = image_frame.Width();
+  const int height = image_frame.Height();
+  int rv;
+  switch (image_frame.Format()) {
+    case ImageFormat::SRGB:
+      rv = libyuv::RAWToI420(src, src_step, y, y_stride, u, u_stride, v,
+                             v_stride, width, height);
+      break;
+    case ImageFormat::SRGBA:
+      rv = libyuv::ABGRToI420(src, src_step, y, y_stride, u, u_stride, v,
+                              v_stride, width, height);
+      break;
+    case ImageFormat::SBGRA:
+      rv = libyuv::ARGBToI420(src, src_step, y, y_stride, u, u_stride, v,
+                              v_stride, width, height);
+      break;
+    case ImageFormat::GRAY8: {
+      const auto& lut = GetGrayToMpegLumaLut();
+      for (int row = 0; row < height; ++row) {
+        LookupRow(lut, src + row * src_step, y + row * y_stride, width);
+      }
+      const int uv_width = (width + 1) / 2;
+      const int uv_height = (height + 1) / 2;
+      libyuv::SetPlane(u, u_stride, uv_width, uv_height, 128);
+      libyuv::SetPlane(v, v_stride, uv_width, uv_height, 128);
+      return absl::OkStatus();
+    }
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported ImageFrame format for YUV conversion: ",
+                       ImageFormat::Format_Name(image_frame.Format())));
+  }
+  RET_CHECK_EQ(0, rv);
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 void RescaleImageFrame(const ImageFrame& source_frame, const int width,
                        const int height, const int alignment_boundary,
                        const int open_cv_interpolation_algorithm,
@@ -99,25 +288,15 @@ void ImageFrameToYUVImage(const ImageFrame& image_frame, YUVImage* yuv_image) {
                         u, uv_stride,                     //
                         v, uv_stride,                     //
                         width, height);
-  int rv =
-      libyuv::RAWToI420(image_frame.PixelData(), image_frame.WidthStep(),  //
-                        y, y_stride,                                       //
-                        u, uv_stride,                                      //
-                        v, uv_stride,                                      //
-                        width, height);
-  CHECK_EQ(0, rv);
+  MEDIAPIPE_CHECK_OK(ConvertImageFrameToYUVImage(image_frame, yuv_image));
 }
 
 void ImageFrameToYUVNV12Image(const ImageFrame& image_frame,
                               YUVImage* yuv_nv12_image) {
-  // Create a YUV I420 image that will hold the converted RGBA image.
-  YUVImage yuv_i420_image;
-  ImageFrameToYUVImage(image_frame, &yuv_i420_image);
-
-  // Now create a YUV NV12 image and convert the I420 to NV12.
-  const int width = yuv_i420_image.width();
-  const int height = yuv_i420_image.height();
-  const int y_stride = yuv_i420_image.stride(0);
+  const int width = image_frame.Width();
+  const int height = image_frame.Height();
+  // Align y_stride on a 16-byte boundary.
+  const int y_stride = (width + 15) & ~15;
   const int y_size = y_stride * height;
   const int uv_stride = y_stride;
   const int uv_height = (height + 1) / 2;
@@ -128,38 +307,206 @@ void ImageFrameToYUVNV12Image(const ImageFrame& image_frame,
   uint8* uv = y + y_size;
   yuv_nv12_image->Initialize(libyuv::FOURCC_NV12, deallocate, y, y_stride, uv,
                              uv_stride, nullptr, 0, width, height);
-  const int rv = libyuv::I420ToNV12(
-      yuv_i420_image.data(0), yuv_i420_image.stride(0), yuv_i420_image.data(1),
-      yuv_i420_image.stride(1), yuv_i420_image.data(2),
-      yuv_i420_image.stride(2), yuv_nv12_image->mutable_data(0),
-      yuv_nv12_image->stride(0), yuv_nv12_image->mutable_data(1),
-      yuv_nv12_image->stride(1), width, height);
-  CHECK_EQ(0, rv);
+  MEDIAPIPE_CHECK_OK(ConvertImageFrameToYUVImage(image_frame, yuv_nv12_image));
 }
 
 void YUVImageToImageFrame(const YUVImage& yuv_image, ImageFrame* image_frame,
                           bool use_bt709) {
   CHECK(image_frame);
-  int width = yuv_image.width();
-  int height = yuv_image.height();
-  image_frame->Reset(ImageFormat::SRGB, width, height, 16);
-  int rv;
-
-  if (use_bt709) {
-    rv = libyuv::H420ToRAW(yuv_image.data(0), yuv_image.stride(0),  //
-                           yuv_image.data(1), yuv_image.stride(1),  //
-                           yuv_image.data(2), yuv_image.stride(2),  //
-                           image_frame->MutablePixelData(),
-                           image_frame->WidthStep(), width, height);
+  if (image_frame->Format() != ImageFormat::SRGB ||
+      image_frame->Width() != yuv_image.width() ||
+      image_frame->Height() != yuv_image.height()) {
+    image_frame->Reset(ImageFormat::SRGB, yuv_image.width(),
+                       yuv_image.height(), 16);
+  }
+  MEDIAPIPE_CHECK_OK(
+      ConvertYUVImageToImageFrame(yuv_image, image_frame, use_bt709));
+}
 
+absl::Status ConvertImageFrame(const ImageFrame& source,
+                               ImageFrame* destination) {
+  RET_CHECK(destination);
+  MP_RETURN_IF_ERROR(CheckSameSize(source.Width(), source.Height(),
+                                   destination->Width(),
+                                   destination->Height()));
+  const ImageFormat::Format from = source.Format();
+  const ImageFormat::Format to = destination->Format();
+  const uint8* src = source.PixelData();
+  const int src_step = source.WidthStep();
+  uint8* dst = destination->MutablePixelData();
+  const int dst_step = destination->WidthStep();
+  const int width = source.Width();
+  const int height = source.Height();
+  auto for_each_row = [&](auto row_function) {
+    ForEachRow(src, src_step, source.IsContiguous(), dst, dst_step,
+               destination->IsContiguous(), width, height, row_function);
+    return absl::OkStatus();
+  };
+  int rv = 0;
+  if (from == to) {
+    const int pixel_size = source.NumberOfChannels() * source.ByteDepth();
+    return for_each_row([pixel_size](const uint8* source_row,
+                                     uint8* destination_row, int row_width) {
+      std::memcpy(destination_row, source_row,
+                  static_cast<size_t>(pixel_size) * row_width);
+    });
+  } else if (from == ImageFormat::SRGBA && to == ImageFormat::SRGB) {
+    // libyuv names formats by word order, so its ARGB is BGRA in memory and
+    // its RGB24 is BGR in memory. Only the relative order matters here.
+    rv = libyuv::ARGBToRGB24(src, src_step, dst, dst_step, width, height);
+  } else if (from == ImageFormat::SBGRA && to == ImageFormat::SRGB) {
+    rv = libyuv::ARGBToRAW(src, src_step, dst, dst_step, width, height);
+  } else if (from == ImageFormat::SRGB && to == ImageFormat::SRGBA) {
+    rv = libyuv::RGB24ToARGB(src, src_step, dst, dst_step, width, height);
+  } else if (from == ImageFormat::SRGB && to == ImageFormat::SBGRA) {
+    rv = libyuv::RAWToARGB(src, src_step, dst, dst_step, width, height);
+  } else if (from == ImageFormat::SRGBA && to == ImageFormat::SBGRA) {
+    rv = libyuv::ABGRToARGB(src, src_step, dst, dst_step, width, height);
+  } else if (from == ImageFormat::SBGRA && to == ImageFormat::SRGBA) {
+    rv = libyuv::ARGBToABGR(src, src_step, dst, dst_step, width, height);
+  } else if (from == ImageFormat::SRGB && to == ImageFormat::GRAY8) {
+    return for_each_row(RgbRowToGray<3, 0>);
+  } else if (from == ImageFormat::SRGBA && to == ImageFormat::GRAY8) {
+    return for_each_row(RgbRowToGray<4, 0>);
+  } else if (from == ImageFormat::SBGRA && to == ImageFormat::GRAY8) {
+    return for_each_row(RgbRowToGray<4, 2>);
+  } else if (from == ImageFormat::GRAY8 && to == ImageFormat::SRGB) {
+    return for_each_row(GrayRowToRgb<3>);
+  } else if (from == ImageFormat::GRAY8 &&
+             (to == ImageFormat::SRGBA || to == ImageFormat::SBGRA)) {
+    return for_each_row(GrayRowToRgb<4>);
   } else {
-    rv = libyuv::I420ToRAW(yuv_image.data(0), yuv_image.stride(0),  //
-                           yuv_image.data(1), yuv_image.stride(1),  //
-                           yuv_image.data(2), yuv_image.stride(2),  //
-                           image_frame->MutablePixelData(),
-                           image_frame->WidthStep(), width, height);
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unsupported ImageFrame conversion: ", ImageFormat::Format_Name(from),
+        " to ", ImageFormat::Format_Name(to)));
+  }
+  RET_CHECK_EQ(0, rv);
+  return absl::OkStatus();
+}
+
+absl::Status ConvertYUVImageToImageFrame(const YUVImage& yuv_image,
+                                         ImageFrame* image_frame,
+                                         bool use_bt709) {
+  RET_CHECK(image_frame);
+  RET_CHECK_EQ(8, yuv_image.bit_depth());
+  const int width = yuv_image.width();
+  const int height = yuv_image.height();
+  MP_RETURN_IF_ERROR(CheckSameSize(width, height, image_frame->Width(),
+                                   image_frame->Height()));
+  const ImageFormat::Format format = image_frame->Format();
+  uint8* dst = image_frame->MutablePixelData();
+  const int dst_step = image_frame->WidthStep();
+
+  if (format == ImageFormat::GRAY8) {
+    // Only the luma plane is needed, for every YUV layout.
+    const auto& lut = GetMpegLumaToGrayLut();
+    for (int row = 0; row < height; ++row) {
+      LookupRow(lut, yuv_image.data(0) + row * yuv_image.stride(0),
+                dst + row * dst_step, width);
+    }
+    return absl::OkStatus();
+  }
+
+  switch (yuv_image.fourcc()) {
+    case libyuv::FOURCC_I420:
+      return I420ToImageFrame(
+          {yuv_image.data(0), yuv_image.stride(0), yuv_image.data(1),
+           yuv_image.stride(1), yuv_image.data(2), yuv_image.stride(2)},
+          width, height, use_bt709, image_frame);
+    case libyuv::FOURCC_YV12:
+      return I420ToImageFrame(
+          {yuv_image.data(0), yuv_image.stride(0), yuv_image.data(2),
+           yuv_image.stride(2), yuv_image.data(1), yuv_image.stride(1)},
+          width, height, use_bt709, image_frame);
+    case libyuv::FOURCC_NV12:
+    case libyuv::FOURCC_NV21:
+      break;
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported YUVImage fourcc: ",
+          static_cast<uint32>(yuv_image.fourcc())));
+  }
+
+  const bool is_nv21 = yuv_image.fourcc() == libyuv::FOURCC_NV21;
+  if (format == ImageFormat::SRGBA || format == ImageFormat::SBGRA) {
+    // Semi-planar images are converted directly. The YVU constants swap red
+    // and blue, and reading the chroma plane as the other layout swaps them
+    // back, which is how libyuv produces the byte order of SRGBA.
+    const bool swap_red_blue = format == ImageFormat::SRGBA;
+    const libyuv::YuvConstants* constants =
+        use_bt709
+            ? (swap_red_blue ? &libyuv::kYvuH709Constants
+                             : &libyuv::kYuvH709Constants)
+            : (swap_red_blue ? &libyuv::kYvuI601Constants
+                             : &libyuv::kYuvI601Constants);
+    const int rv = (is_nv21 != swap_red_blue ? libyuv::NV21ToARGBMatrix
+                                             : libyuv::NV12ToARGBMatrix)(
+        yuv_image.data(0), yuv_image.stride(0), yuv_image.data(1),
+        yuv_image.stride(1), dst, dst_step, constants, width, height);
+    RET_CHECK_EQ(0, rv);
+    return absl::OkStatus();
+  }
+
+  // For the remaining formats, only the interleaved chroma plane (a quarter of
+  // the luma size) is split into U and V planes.
+  const int uv_width = (width + 1) / 2;
+  const int uv_height = (height + 1) / 2;
+  const int uv_stride = (uv_width + 15) & ~15;
+  std::unique_ptr<uint8[]> chroma(new uint8[2 * uv_stride * uv_height]);
+  uint8* u = chroma.get();
+  uint8* v = u + uv_stride * uv_height;
+  libyuv::SplitUVPlane(yuv_image.data(1), yuv_image.stride(1),
+                       is_nv21 ? v : u, uv_stride, is_nv21 ? u : v, uv_stride,
+                       uv_width, uv_height);
+  return I420ToImageFrame({yuv_image.data(0), yuv_image.stride(0), u,
+                           uv_stride, v, uv_stride},
+                          width, height, use_bt709, image_frame);
+}
+
+absl::Status ConvertImageFrameToYUVImage(const ImageFrame& image_frame,
+                                         YUVImage* yuv_image) {
+  RET_CHECK(yuv_image);
+  RET_CHECK_EQ(8, yuv_image->bit_depth());
+  const int width = image_frame.Width();
+  const int height = image_frame.Height();
+  MP_RETURN_IF_ERROR(
+      CheckSameSize(width, height, yuv_image->width(), yuv_image->height()));
+  switch (yuv_image->fourcc()) {
+    case libyuv::FOURCC_I420:
+      return ImageFrameToI420(image_frame, yuv_image->mutable_data(0),
+                              yuv_image->stride(0), yuv_image->mutable_data(1),
+                              yuv_image->stride(1), yuv_image->mutable_data(2),
+                              yuv_image->stride(2));
+    case libyuv::FOURCC_YV12:
+      return ImageFrameToI420(image_frame, yuv_image->mutable_data(0),
+                              yuv_image->stride(0), yuv_image->mutable_data(2),
+                              yuv_image->stride(2), yuv_image->mutable_data(1),
+                              yuv_image->stride(1));
+    case libyuv::FOURCC_NV12:
+    case libyuv::FOURCC_NV21:
+      break;
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported YUVImage fourcc: ",
+          static_cast<uint32>(yuv_image->fourcc())));
   }
-  CHECK_EQ(0, rv);
+
+  // Luma is written in place, and the chroma planes are interleaved into the
+  // destination afterwards.
+  const int uv_width = (width + 1) / 2;
+  const int uv_height = (height + 1) / 2;
+  const int uv_stride = (uv_width + 15) & ~15;
+  std::unique_ptr<uint8[]> chroma(new uint8[2 * uv_stride * uv_height]);
+  uint8* u = chroma.get();
+  uint8* v = u + uv_stride * uv_height;
+  MP_RETURN_IF_ERROR(ImageFrameToI420(image_frame, yuv_image->mutable_data(0),
+                                      yuv_image->stride(0), u, uv_stride, v,
+                                      uv_stride));
+  const bool is_nv21 = yuv_image->fourcc() == libyuv::FOURCC_NV21;
+  libyuv::MergeUVPlane(is_nv21 ? v : u, uv_stride, is_nv21 ? u : v, uv_stride,
+                       yuv_image->mutable_data(1), yuv_image->stride(1),
+                       uv_width, uv_height);
+  return absl::OkStatus();
 }
 
 void SrgbToMpegYCbCr(const uint8 r, const uint8 g, const uint8 b,  //
@@ -259,18 +606,71 @@ void LinearRgb16ToSrgb(const cv::Mat& source, cv::Mat* destination) {
 
   static const cv::Mat kLut = GetLinearRgb16ToSrgbLut();
   const uint8* lookup_table_ptr = kLut.ptr<uint8>();
-  const int num_channels = source.channels();
+  const int row_size = source.cols * source.channels();
   for (int row = 0; row < source.rows; ++row) {
-    for (int col = 0; col < source.cols; ++col) {
-      for (int channel = 0; channel < num_channels; ++channel) {
-        uint8* ptr = destination->ptr<uint8>(row);
-        const uint16* ptr16 = source.ptr<uint16>(row);
-        ptr[col * num_channels + channel] =
-            lookup_table_ptr[ptr16[col * num_channels + channel]];
-      }
+    uint8* ptr = destination->ptr<uint8>(row);
+    const uint16* ptr16 = source.ptr<uint16>(row);
+    for (int i = 0; i < row_size; ++i) {
+      ptr[i] = lookup_table_ptr[ptr16[i]];
     }
   }
 }
 
+absl::Status SrgbToLinearRgb16(const ImageFrame& source,
+                               ImageFrame* destination) {
+  RET_CHECK(destination);
+  RET_CHECK((source.Format() == ImageFormat::SRGB &&
+             destination->Format() == ImageFormat::SRGB48) ||
+            (source.Format() == ImageFormat::SRGBA &&
+             destination->Format() == ImageFormat::SRGBA64))
+      << "Unsupported conversion: " << source.Format() << " to "
+      << destination->Format();
+  MP_RETURN_IF_ERROR(CheckSameSize(source.Width(), source.Height(),
+                                   destination->Width(),
+                                   destination->Height()));
+  static const cv::Mat kLut = GetSrgbToLinearRgb16Lut();
+  const uint16* lookup_table_ptr = kLut.ptr<uint16>();
+  ForEachRow(source.PixelData(), source.WidthStep(), source.IsContiguous(),
+             destination->MutablePixelData(), destination->WidthStep(),
+             destination->IsContiguous(), source.Width(), source.Height(),
+             [lookup_table_ptr, &source](const uint8* src, uint8* dst,
+                                         int width) {
+               uint16* dst16 = reinterpret_cast<uint16*>(dst);
+               const int size = width * source.NumberOfChannels();
+               for (int i = 0; i < size; ++i) {
+                 dst16[i] = lookup_table_ptr[src[i]];
+               }
+             });
+  return absl::OkStatus();
+}
+
+absl::Status LinearRgb16ToSrgb(const ImageFrame& source,
+                               ImageFrame* destination) {
+  RET_CHECK(destination);
+  RET_CHECK((source.Format() == ImageFormat::SRGB48 &&
+             destination->Format() == ImageFormat::SRGB) ||
+            (source.Format() == ImageFormat::SRGBA64 &&
+             destination->Format() == ImageFormat::SRGBA))
+      << "Unsupported conversion: " << source.Format() << " to "
+      << destination->Format();
+  MP_RETURN_IF_ERROR(CheckSameSize(source.Width(), source.Height(),
+                                   destination->Width(),
+                                   destination->Height()));
+  static const cv::Mat kLut = GetLinearRgb16ToSrgbLut();
+  const uint8* lookup_table_ptr = kLut.ptr<uint8>();
+  ForEachRow(source.PixelData(), source.WidthStep(), source.IsContiguous(),
+             destination->MutablePixelData(), destination->WidthStep(),
+             destination->IsContiguous(), source.Width(), source.Height(),
+             [lookup_table_ptr, &source](const uint8* src, uint8* dst,
+                                         int width) {
+               const uint16* src16 = reinterpret_cast<const uint16*>(src);
+               const int size = width * source.NumberOfChannels();
+               for (int i = 0; i < size; ++i) {
+                 dst[i] = lookup_table_ptr[src16[i]];
+               }
+             });
+  return absl::OkStatus();
+}
+
 }  // namespace image_frame_util
 }  // namespace mediapipe
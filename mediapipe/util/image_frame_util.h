@@ -18,6 +18,7 @@
 
 #include <string>
 
+#include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -48,6 +49,30 @@ void RescaleSrgbImage(const cv::Mat& source, const int width, const int height,
                       const int open_cv_interpolation_algorithm,
                       cv::Mat* destination);
 
+// The Convert* functions below write into a destination that the caller has
+// already allocated (e.g. a buffer from an ImageFramePool), so no intermediate
+// copies or allocations of the image are made. The destination must have the
+// same dimensions as the source, and its format selects the conversion. The
+// conversions are done by libyuv or by row kernels over contiguous rows, both
+// of which are vectorized.
+
+// Converts between the SRGB, SRGBA, SBGRA and GRAY8 formats. Alpha is set to
+// 255 when it is added, and GRAY8 uses the BT.601 luma weights like
+// cv::COLOR_RGB2GRAY.
+absl::Status ConvertImageFrame(const ImageFrame& source,
+                               ImageFrame* destination);
+
+// Converts an 8-bit I420, YV12, NV12 or NV21 YUVImage to an SRGB, SRGBA, SBGRA
+// or GRAY8 ImageFrame. See YUVImageToImageFrame() for use_bt709.
+absl::Status ConvertYUVImageToImageFrame(const YUVImage& yuv_image,
+                                         ImageFrame* image_frame,
+                                         bool use_bt709 = false);
+
+// Converts an SRGB, SRGBA, SBGRA or GRAY8 ImageFrame to an 8-bit I420, YV12,
+// NV12 or NV21 YUVImage using BT.601.
+absl::Status ConvertImageFrameToYUVImage(const ImageFrame& image_frame,
+                                         YUVImage* yuv_image);
+
 // Convert an SRGB ImageFrame to an I420 YUVImage.
 void ImageFrameToYUVImage(const ImageFrame& image_frame, YUVImage* yuv_image);
 
@@ -55,7 +80,8 @@ void ImageFrameToYUVImage(const ImageFrame& image_frame, YUVImage* yuv_image);
 void ImageFrameToYUVNV12Image(const ImageFrame& image_frame,
                               YUVImage* yuv_nv12_image);
 
-// Convert a YUVImage to an SRGB ImageFrame. If use_bt709 is set to false, this
+// Convert a YUVImage to an SRGB ImageFrame. image_frame is reallocated only if
+// it isn't an SRGB frame of the right size. If use_bt709 is set to false, this
 // function will assume that the YUV is as defined in BT.601 (standard from the
 // 1980s). Most content is using BT.709 (as of 2019), but it's likely that this
 // will no longer the case in the future, when BT.2100 will likely be dominant.
@@ -83,6 +109,14 @@ void MpegYCbCrToSrgb(const uint8 y, const uint8 cb, const uint8 cr,  //
 void SrgbToLinearRgb16(const cv::Mat& source, cv::Mat* destination);
 void LinearRgb16ToSrgb(const cv::Mat& source, cv::Mat* destination);
 
+// The same conversions between preallocated SRGB and SRGB48 or SRGBA and
+// SRGBA64 ImageFrames. Like the cv::Mat versions, every channel (including
+// alpha) goes through the lookup table.
+absl::Status SrgbToLinearRgb16(const ImageFrame& source,
+                               ImageFrame* destination);
+absl::Status LinearRgb16ToSrgb(const ImageFrame& source,
+                               ImageFrame* destination);
+
 }  // namespace image_frame_util
 }  // namespace mediapipe
 
@@ -0,0 +1,220 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/image_frame_util.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "libyuv/video_common.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace image_frame_util {
+namespace {
+
+// Odd sizes exercise the rounding of the chroma planes, and with the default
+// alignment the rows of a 7 pixel wide SRGB frame are padded.
+constexpr int kWidth = 7;
+constexpr int kHeight = 5;
+
+uint8* PixelAt(ImageFrame* frame, int x, int y) {
+  return frame->MutablePixelData() + y * frame->WidthStep() +
+         x * frame->NumberOfChannels() * frame->ByteDepth();
+}
+
+// Fills an SRGB frame with a flat color, which survives chroma subsampling.
+void Fill(uint8 r, uint8 g, uint8 b, ImageFrame* frame) {
+  for (int y = 0; y < frame->Height(); ++y) {
+    for (int x = 0; x < frame->Width(); ++x) {
+      uint8* pixel = PixelAt(frame, x, y);
+      pixel[0] = r;
+      pixel[1] = g;
+      pixel[2] = b;
+    }
+  }
+}
+
+void ExpectColorNear(ImageFrame* frame, const uint8 (&rgb)[3], int margin) {
+  for (int y = 0; y < frame->Height(); ++y) {
+    for (int x = 0; x < frame->Width(); ++x) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_LE(std::abs(PixelAt(frame, x, y)[c] - rgb[c]), margin)
+            << "x: " << x << " y: " << y << " c: " << c;
+      }
+    }
+  }
+}
+
+TEST(ImageFrameUtilTest, ConvertsBetweenPackedFormatsInPlace) {
+  ImageFrame rgb(ImageFormat::SRGB, kWidth, kHeight);
+  ASSERT_FALSE(rgb.IsContiguous());
+  Fill(10, 20, 30, &rgb);
+  *PixelAt(&rgb, 1, 2) = 255;
+
+  ImageFrame rgba(ImageFormat::SRGBA, kWidth, kHeight);
+  const uint8* rgba_data = rgba.PixelData();
+  MP_ASSERT_OK(ConvertImageFrame(rgb, &rgba));
+  EXPECT_EQ(rgba_data, rgba.PixelData());
+  EXPECT_EQ(255, PixelAt(&rgba, 1, 2)[0]);
+  EXPECT_EQ(30, PixelAt(&rgba, 1, 2)[2]);
+  EXPECT_EQ(255, PixelAt(&rgba, 1, 2)[3]);
+
+  ImageFrame bgra(ImageFormat::SBGRA, kWidth, kHeight);
+  MP_ASSERT_OK(ConvertImageFrame(rgba, &bgra));
+  EXPECT_EQ(30, PixelAt(&bgra, 1, 2)[0]);
+  EXPECT_EQ(255, PixelAt(&bgra, 1, 2)[2]);
+
+  ImageFrame round_trip(ImageFormat::SRGB, kWidth, kHeight);
+  MP_ASSERT_OK(ConvertImageFrame(bgra, &round_trip));
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_EQ(PixelAt(&rgb, x, y)[c], PixelAt(&round_trip, x, y)[c]);
+      }
+    }
+  }
+}
+
+TEST(ImageFrameUtilTest, ConvertsToAndFromGray) {
+  ImageFrame rgb(ImageFormat::SRGB, kWidth, kHeight);
+  Fill(255, 0, 0, &rgb);
+  ImageFrame gray(ImageFormat::GRAY8, kWidth, kHeight);
+  MP_ASSERT_OK(ConvertImageFrame(rgb, &gray));
+  // (4899 * 255 + 8192) >> 14, as computed by cv::COLOR_RGB2GRAY.
+  EXPECT_EQ(76, *PixelAt(&gray, kWidth - 1, kHeight - 1));
+
+  ImageFrame rgba(ImageFormat::SRGBA, kWidth, kHeight);
+  MP_ASSERT_OK(ConvertImageFrame(gray, &rgba));
+  const uint8* pixel = PixelAt(&rgba, 3, 4);
+  EXPECT_EQ(76, pixel[0]);
+  EXPECT_EQ(76, pixel[1]);
+  EXPECT_EQ(76, pixel[2]);
+  EXPECT_EQ(255, pixel[3]);
+}
+
+TEST(ImageFrameUtilTest, RejectsMismatchedSizesAndFormats) {
+  ImageFrame rgb(ImageFormat::SRGB, kWidth, kHeight);
+  ImageFrame small(ImageFormat::SRGBA, kWidth - 1, kHeight);
+  EXPECT_FALSE(ConvertImageFrame(rgb, &small).ok());
+  ImageFrame vec(ImageFormat::VEC32F1, kWidth, kHeight);
+  EXPECT_FALSE(ConvertImageFrame(rgb, &vec).ok());
+}
+
+TEST(ImageFrameUtilTest, RoundTripsThroughYUVLayouts) {
+  const uint8 kColor[3] = {200, 100, 50};
+  ImageFrame rgb(ImageFormat::SRGB, kWidth, kHeight);
+  Fill(kColor[0], kColor[1], kColor[2], &rgb);
+
+  YUVImage i420;
+  ImageFrameToYUVImage(rgb, &i420);
+  YUVImage nv12;
+  ImageFrameToYUVNV12Image(rgb, &nv12);
+  EXPECT_EQ(libyuv::FOURCC_NV12, nv12.fourcc());
+
+  // An NV21 image written in place into caller-owned planes.
+  std::vector<uint8> nv21_data(nv12.stride(0) * kHeight +
+                               nv12.stride(1) * ((kHeight + 1) / 2));
+  uint8* nv21_vu = nv21_data.data() + nv12.stride(0) * kHeight;
+  YUVImage nv21;
+  nv21.Initialize(libyuv::FOURCC_NV21, nullptr, nv21_data.data(),
+                  nv12.stride(0), nv21_vu, nv12.stride(1), nullptr, 0, kWidth,
+                  kHeight);
+  MP_ASSERT_OK(ConvertImageFrameToYUVImage(rgb, &nv21));
+  EXPECT_EQ(nv12.data(1)[0], nv21_vu[1]);
+  EXPECT_EQ(nv12.data(1)[1], nv21_vu[0]);
+
+  for (const ImageFormat::Format format :
+       {ImageFormat::SRGB, ImageFormat::SRGBA, ImageFormat::SBGRA}) {
+    for (YUVImage* yuv_image : {&i420, &nv12, &nv21}) {
+      ImageFrame frame(format, kWidth, kHeight);
+      MP_ASSERT_OK(ConvertYUVImageToImageFrame(*yuv_image, &frame));
+      if (format == ImageFormat::SBGRA) {
+        ImageFrame converted(ImageFormat::SRGB, kWidth, kHeight);
+        MP_ASSERT_OK(ConvertImageFrame(frame, &converted));
+        ExpectColorNear(&converted, kColor, 3);
+      } else {
+        ExpectColorNear(&frame, kColor, 3);
+      }
+    }
+  }
+
+  // YUVImageToImageFrame() reuses an SRGB frame of the right size.
+  ImageFrame reused(ImageFormat::SRGB, kWidth, kHeight);
+  const uint8* reused_data = reused.PixelData();
+  YUVImageToImageFrame(nv12, &reused, /*use_bt709=*/true);
+  EXPECT_EQ(reused_data, reused.PixelData());
+}
+
+TEST(ImageFrameUtilTest, ConvertsGrayThroughLuma) {
+  ImageFrame gray(ImageFormat::GRAY8, kWidth, kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      *PixelAt(&gray, x, y) = static_cast<uint8>(x * 40);
+    }
+  }
+  YUVImage yuv_image;
+  ImageFrameToYUVImage(gray, &yuv_image);
+  EXPECT_EQ(128, yuv_image.data(1)[0]);
+
+  ImageFrame round_trip(ImageFormat::GRAY8, kWidth, kHeight);
+  MP_ASSERT_OK(ConvertYUVImageToImageFrame(yuv_image, &round_trip));
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      EXPECT_LE(std::abs(*PixelAt(&gray, x, y) - *PixelAt(&round_trip, x, y)),
+                1);
+    }
+  }
+}
+
+TEST(ImageFrameUtilTest, ConvertsImageFramesToLinearRgb16) {
+  ImageFrame rgba(ImageFormat::SRGBA, kWidth, kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8* pixel = PixelAt(&rgba, x, y);
+      pixel[0] = 0;
+      pixel[1] = 128;
+      pixel[2] = 255;
+      pixel[3] = static_cast<uint8>(x);
+    }
+  }
+  ImageFrame linear(ImageFormat::SRGBA64, kWidth, kHeight);
+  MP_ASSERT_OK(SrgbToLinearRgb16(rgba, &linear));
+  const uint16* pixel = reinterpret_cast<const uint16*>(PixelAt(&linear, 2, 1));
+  EXPECT_EQ(0, pixel[0]);
+  EXPECT_NEAR(0.2158 * 65535, pixel[1], 10);
+  EXPECT_EQ(65535, pixel[2]);
+
+  ImageFrame round_trip(ImageFormat::SRGBA, kWidth, kHeight);
+  MP_ASSERT_OK(LinearRgb16ToSrgb(linear, &round_trip));
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      for (int c = 0; c < 4; ++c) {
+        EXPECT_EQ(PixelAt(&rgba, x, y)[c], PixelAt(&round_trip, x, y)[c]);
+      }
+    }
+  }
+
+  ImageFrame rgb48(ImageFormat::SRGB48, kWidth, kHeight);
+  EXPECT_FALSE(SrgbToLinearRgb16(rgba, &rgb48).ok());
+}
+
+}  // namespace
+}  // namespace image_frame_util
+}  // namespace mediapipe
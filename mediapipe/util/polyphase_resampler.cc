@@ -0,0 +1,242 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Finds the continued fraction convergent of x with the largest denominator
+// not exceeding max_denominator.
+void RationalApproximation(double x, int max_denominator, int64* numerator,
+                           int64* denominator) {
+  int64 h_prev = 0, h = 1;
+  int64 k_prev = 1, k = 0;
+  double remainder = x;
+  for (int i = 0; i < 64; ++i) {
+    double term = std::floor(remainder);
+    if (std::abs(remainder - std::round(remainder)) < 1e-9) {
+      term = std::round(remainder);
+    }
+    const int64 h_next = static_cast<int64>(term) * h + h_prev;
+    const int64 k_next = static_cast<int64>(term) * k + k_prev;
+    if (k_next > max_denominator) break;
+    h_prev = h;
+    h = h_next;
+    k_prev = k;
+    k = k_next;
+    const double fraction = remainder - term;
+    if (fraction < 1e-9) break;
+    remainder = 1.0 / fraction;
+  }
+  *numerator = h;
+  *denominator = k;
+}
+
+// Zeroth-order modified Bessel function of the first kind.
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  const double half_x_squared = 0.25 * x * x;
+  for (int k = 1; k < 500; ++k) {
+    term *= half_x_squared / (static_cast<double>(k) * k);
+    sum += term;
+    if (term < 1e-12 * sum) break;
+  }
+  return sum;
+}
+
+int64 CeilDiv(int64 numerator, int64 denominator) {
+  return (numerator + denominator - 1) / denominator;
+}
+
+}  // namespace
+
+// static
+absl::StatusOr<std::unique_ptr<PolyphaseResampler>> PolyphaseResampler::Create(
+    double input_sample_rate, double output_sample_rate, int num_channels,
+    const PolyphaseResamplerParams& params) {
+  if (!(input_sample_rate > 0.0) || !std::isfinite(input_sample_rate) ||
+      !(output_sample_rate > 0.0) || !std::isfinite(output_sample_rate)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid sample rates: ", input_sample_rate, " -> ",
+                     output_sample_rate));
+  }
+  if (num_channels < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid number of channels: ", num_channels));
+  }
+  if (!(params.filter_radius_factor > 0.0) ||
+      !(params.cutoff_proportion > 0.0) || params.cutoff_proportion > 1.0 ||
+      !(params.kaiser_beta >= 0.0) || params.max_denominator < 1) {
+    return absl::InvalidArgumentError("Invalid resampler parameters.");
+  }
+  int64 numerator;
+  int64 denominator;
+  RationalApproximation(output_sample_rate / input_sample_rate,
+                        params.max_denominator, &numerator, &denominator);
+  if (numerator < 1 || denominator < 1 ||
+      numerator > std::numeric_limits<int>::max() / 2) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unable to represent the resampling factor ",
+                     output_sample_rate, " / ", input_sample_rate,
+                     " with denominator at most ", params.max_denominator));
+  }
+  return absl::WrapUnique(new PolyphaseResampler(num_channels, numerator,
+                                                 denominator, params));
+}
+
+PolyphaseResampler::PolyphaseResampler(int num_channels, int factor_numerator,
+                                       int factor_denominator,
+                                       const PolyphaseResamplerParams& params)
+    : num_channels_(num_channels),
+      factor_numerator_(factor_numerator),
+      factor_denominator_(factor_denominator) {
+  const double ratio = static_cast<double>(factor_numerator_) /
+                       static_cast<double>(factor_denominator_);
+  // Kernel half-width and cutoff in units of input samples and of the input
+  // Nyquist frequency respectively.
+  const double radius = params.filter_radius_factor * std::max(1.0, 1.0 / ratio);
+  const double cutoff = params.cutoff_proportion * std::min(1.0, ratio);
+  // Consecutive output frames advance by up to ceil(M / L) input frames; the
+  // support must be at least that wide for DiscardHistory() to stay within
+  // the buffered frames.
+  half_taps_ = std::max<int>(std::ceil(radius),
+                             CeilDiv(factor_denominator_, factor_numerator_));
+  const int num_taps = 2 * half_taps_;
+
+  const double window_normalizer = 1.0 / BesselI0(params.kaiser_beta);
+  filters_.resize(num_taps, factor_numerator_);
+  for (int phase = 0; phase < factor_numerator_; ++phase) {
+    const double fraction = static_cast<double>(phase) / factor_numerator_;
+    for (int tap = 0; tap < num_taps; ++tap) {
+      // Distance from the output position to the input frame of this tap.
+      const double x = fraction + half_taps_ - 1 - tap;
+      double value = 0.0;
+      if (std::abs(x) < radius) {
+        const double y = cutoff * x;
+        const double sinc = y == 0.0 ? 1.0 : std::sin(kPi * y) / (kPi * y);
+        const double r = x / radius;
+        const double window =
+            BesselI0(params.kaiser_beta * std::sqrt(1.0 - r * r)) *
+            window_normalizer;
+        value = cutoff * sinc * window;
+      }
+      filters_(tap, phase) = static_cast<float>(value);
+    }
+  }
+  Reset();
+}
+
+void PolyphaseResampler::Reset() {
+  // The first output frame depends on half_taps_ - 1 frames before the start
+  // of the stream, which are zero.
+  history_size_ = 0;
+  history_start_ = -(half_taps_ - 1);
+  AppendSilenceToHistory(half_taps_ - 1);
+  num_output_frames_ = 0;
+  output_base_ = 0;
+  output_phase_ = 0;
+}
+
+void PolyphaseResampler::ProcessSamples(const Matrix& input, Matrix* output) {
+  if (input.cols() > 0) {
+    CHECK_EQ(input.rows(), num_channels_);
+    AppendToHistory(input.data(), input.cols());
+  }
+  ComputeOutput(output);
+  DiscardHistory();
+}
+
+void PolyphaseResampler::Flush(Matrix* output) {
+  // Enough silence for every output position before the end of the input to
+  // have its full support.
+  AppendSilenceToHistory(half_taps_);
+  ComputeOutput(output);
+  Reset();
+}
+
+void PolyphaseResampler::EnsureHistoryCapacity(int num_frames) {
+  const int required = history_size_ + num_frames;
+  if (history_.rows() == num_channels_ && required <= history_.cols()) {
+    return;
+  }
+  const int capacity =
+      std::max<int>(required, history_.rows() == num_channels_
+                                  ? 2 * history_.cols()
+                                  : 2 * filters_.rows());
+  history_.conservativeResize(num_channels_, capacity);
+}
+
+void PolyphaseResampler::AppendToHistory(const float* frames, int num_frames) {
+  EnsureHistoryCapacity(num_frames);
+  std::copy(frames, frames + static_cast<int64>(num_frames) * num_channels_,
+            history_.data() + static_cast<int64>(history_size_) * num_channels_);
+  history_size_ += num_frames;
+}
+
+void PolyphaseResampler::AppendSilenceToHistory(int num_frames) {
+  EnsureHistoryCapacity(num_frames);
+  history_.middleCols(history_size_, num_frames).setZero();
+  history_size_ += num_frames;
+}
+
+void PolyphaseResampler::ComputeOutput(Matrix* output) {
+  // Output frame n is ready once its last tap, at input frame
+  // floor(n * M / L) + R, has been buffered.
+  const int64 limit = history_start_ + history_size_ - half_taps_;
+  int64 num_ready = 0;
+  if (limit > 0) {
+    num_ready = std::max<int64>(
+        0, CeilDiv(limit * factor_numerator_, factor_denominator_) -
+               num_output_frames_);
+  }
+  output->resize(num_channels_, num_ready);
+  const int num_taps = filters_.rows();
+  for (int64 i = 0; i < num_ready; ++i) {
+    const int64 first_tap = output_base_ - half_taps_ + 1 - history_start_;
+    output->col(i).noalias() =
+        history_.middleCols(first_tap, num_taps) * filters_.col(output_phase_);
+    output_phase_ += factor_denominator_;
+    output_base_ += output_phase_ / factor_numerator_;
+    output_phase_ %= factor_numerator_;
+  }
+  num_output_frames_ += num_ready;
+}
+
+void PolyphaseResampler::DiscardHistory() {
+  const int64 first_needed = output_base_ - half_taps_ + 1;
+  const int num_discarded = first_needed - history_start_;
+  if (num_discarded <= 0) return;
+  DCHECK_LE(num_discarded, history_size_);
+  const int num_kept = history_size_ - num_discarded;
+  float* data = history_.data();
+  std::copy(data + static_cast<int64>(num_discarded) * num_channels_,
+            data + static_cast<int64>(history_size_) * num_channels_, data);
+  history_size_ = num_kept;
+  history_start_ = first_needed;
+}
+
+}  // namespace mediapipe
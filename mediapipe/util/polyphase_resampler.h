@@ -0,0 +1,139 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Streaming polyphase resampler for multichannel time series.
+
+#ifndef MEDIAPIPE_UTIL_POLYPHASE_RESAMPLER_H_
+#define MEDIAPIPE_UTIL_POLYPHASE_RESAMPLER_H_
+
+#include <memory>
+
+#include "Eigen/Core"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Filter design parameters. The defaults and the meaning of the fields follow
+// audio_dsp::QResamplerParams so that existing configurations carry over.
+struct PolyphaseResamplerParams {
+  // Half-width of the Kaiser-windowed sinc kernel, in units of the lower of
+  // the input and output sample periods.
+  double filter_radius_factor = 5.0;
+  // Anti-aliasing cutoff as a fraction of the lower Nyquist frequency.
+  double cutoff_proportion = 0.9;
+  // Kaiser window shape parameter.
+  double kaiser_beta = 6.0;
+  // Largest denominator used for the rational approximation of the
+  // output / input sample rate ratio.
+  int max_denominator = 1000;
+};
+
+// Resamples a multichannel time series by a rational factor L / M using a
+// bank of L precomputed FIR phases.
+//
+// Samples are stored as a Matrix with one row per channel and one column per
+// frame, which in Eigen's column-major layout is the interleaved frame order.
+// Each output frame is a single matrix-vector product of the 2R buffered
+// input frames around it with the kernel phase for its fractional position,
+// so all channels are filtered together with Eigen's vectorized kernels.
+//
+// The resampler keeps its filter history between calls, so a stream may be
+// fed in packets of any size. After the first packets have sized the internal
+// history buffer, ProcessSamples() does not allocate beyond resizing the
+// caller-provided output matrix.
+//
+// Output frame n is the band-limited input signal evaluated at input time
+// n * M / L, treating samples before the start of the stream as zero. Output
+// is therefore delayed by R input frames until Flush() is called, which
+// emits the remaining ceil(num_input_frames * L / M) - n frames and resets
+// the stream.
+//
+// Example:
+//   ASSIGN_OR_RETURN(auto resampler,
+//                    PolyphaseResampler::Create(48000, 16000, 2));
+//   Matrix output;
+//   resampler->ProcessSamples(input, &output);
+//   ...
+//   resampler->Flush(&output);
+class PolyphaseResampler {
+ public:
+  // Returns an error if the sample rates, channel count, or parameters are
+  // invalid.
+  static absl::StatusOr<std::unique_ptr<PolyphaseResampler>> Create(
+      double input_sample_rate, double output_sample_rate, int num_channels,
+      const PolyphaseResamplerParams& params = PolyphaseResamplerParams());
+
+  // Appends input frames (num_channels rows) to the stream and replaces
+  // *output with every output frame that can now be computed.
+  void ProcessSamples(const Matrix& input, Matrix* output);
+
+  // Emits the output frames still pending at the end of the stream, as if
+  // the input were followed by silence, and resets the stream.
+  void Flush(Matrix* output);
+
+  // Discards the filter history and starts a new stream.
+  void Reset();
+
+  int num_channels() const { return num_channels_; }
+  // The resampling factor is exactly factor_numerator() /
+  // factor_denominator(), which may differ slightly from the requested
+  // ratio of sample rates.
+  int factor_numerator() const { return factor_numerator_; }
+  int factor_denominator() const { return factor_denominator_; }
+  // Number of taps in each phase of the filter bank.
+  int num_taps() const { return filters_.rows(); }
+
+ private:
+  PolyphaseResampler(int num_channels, int factor_numerator,
+                     int factor_denominator,
+                     const PolyphaseResamplerParams& params);
+
+  // Copies frames to the end of the history buffer, growing it if needed.
+  void AppendToHistory(const float* frames, int num_frames);
+  // Appends num_frames frames of silence to the history buffer.
+  void AppendSilenceToHistory(int num_frames);
+  // Computes all output frames whose input support lies in the history.
+  void ComputeOutput(Matrix* output);
+  // Drops history frames that no future output frame depends on.
+  void DiscardHistory();
+  void EnsureHistoryCapacity(int num_frames);
+
+  const int num_channels_;
+  // L, the number of filter phases.
+  const int factor_numerator_;
+  // M, the input step between consecutive output frames, in 1 / L units.
+  const int factor_denominator_;
+  // Half the number of taps in each phase, R.
+  int half_taps_;
+  // One column of num_taps() coefficients per phase.
+  Eigen::MatrixXf filters_;
+
+  // Buffered input frames; only the first history_size_ columns are valid.
+  Matrix history_;
+  int history_size_;
+  // Stream index of the first column of history_. Negative at the start of
+  // the stream, where the leading columns are the implicit zero padding.
+  int64 history_start_;
+  // Index of the next output frame. Its position in the input is
+  // output_base_ + output_phase_ / L.
+  int64 num_output_frames_;
+  int64 output_base_;
+  int output_phase_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_POLYPHASE_RESAMPLER_H_
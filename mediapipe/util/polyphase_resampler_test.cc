@@ -0,0 +1,205 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+#include "audio/dsp/resampler_q.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Returns num_channels sinusoids with frequencies (c + 1) * base_frequency.
+Matrix MakeSinusoids(int num_channels, int num_samples, double sample_rate,
+                     double base_frequency) {
+  Matrix signal(num_channels, num_samples);
+  for (int c = 0; c < num_channels; ++c) {
+    for (int i = 0; i < num_samples; ++i) {
+      signal(c, i) =
+          std::sin(2 * kPi * (c + 1) * base_frequency * i / sample_rate);
+    }
+  }
+  return signal;
+}
+
+std::unique_ptr<PolyphaseResampler> CreateResampler(double input_sample_rate,
+                                                    double output_sample_rate,
+                                                    int num_channels) {
+  auto status_or_resampler = PolyphaseResampler::Create(
+      input_sample_rate, output_sample_rate, num_channels);
+  MP_EXPECT_OK(status_or_resampler);
+  return std::move(status_or_resampler).value();
+}
+
+// Resamples the whole signal in packets of the given size, including the
+// final flush.
+Matrix ResampleInPackets(PolyphaseResampler* resampler, const Matrix& input,
+                         int packet_size) {
+  Matrix result(input.rows(), 0);
+  Matrix output;
+  auto append = [&result, &output]() {
+    result.conservativeResize(result.rows(), result.cols() + output.cols());
+    result.rightCols(output.cols()) = output;
+  };
+  for (int start = 0; start < input.cols(); start += packet_size) {
+    const int size = std::min<int>(packet_size, input.cols() - start);
+    resampler->ProcessSamples(Matrix(input.middleCols(start, size)), &output);
+    append();
+  }
+  resampler->Flush(&output);
+  append();
+  return result;
+}
+
+TEST(PolyphaseResamplerTest, ReducesFactor) {
+  auto resampler = CreateResampler(48000, 16000, 2);
+  EXPECT_EQ(1, resampler->factor_numerator());
+  EXPECT_EQ(3, resampler->factor_denominator());
+
+  resampler = CreateResampler(44100, 16000, 1);
+  EXPECT_EQ(160, resampler->factor_numerator());
+  EXPECT_EQ(441, resampler->factor_denominator());
+}
+
+TEST(PolyphaseResamplerTest, RejectsInvalidArguments) {
+  EXPECT_FALSE(PolyphaseResampler::Create(-1, 16000, 1).ok());
+  EXPECT_FALSE(PolyphaseResampler::Create(16000, 0, 1).ok());
+  EXPECT_FALSE(PolyphaseResampler::Create(16000, 8000, 0).ok());
+  PolyphaseResamplerParams params;
+  params.cutoff_proportion = 1.5;
+  EXPECT_FALSE(PolyphaseResampler::Create(16000, 8000, 1, params).ok());
+}
+
+TEST(PolyphaseResamplerTest, OutputLength) {
+  for (double output_rate : {16000.0, 22050.0, 7600.0, 44100.0}) {
+    auto resampler = CreateResampler(48000, output_rate, 1);
+    const Matrix input = MakeSinusoids(1, 1001, 48000, 440);
+    const Matrix output = ResampleInPackets(resampler.get(), input, 128);
+    EXPECT_EQ(std::ceil(1001.0 * resampler->factor_numerator() /
+                        resampler->factor_denominator()),
+              output.cols())
+        << output_rate;
+  }
+}
+
+TEST(PolyphaseResamplerTest, PacketSizeDoesNotChangeOutput) {
+  auto resampler = CreateResampler(44100, 16000, 3);
+  const Matrix input = MakeSinusoids(3, 4410, 44100, 300);
+  const Matrix expected = ResampleInPackets(resampler.get(), input, 4410);
+  for (int packet_size : {1, 7, 160, 1000}) {
+    const Matrix actual = ResampleInPackets(resampler.get(), input, packet_size);
+    ASSERT_EQ(expected.cols(), actual.cols());
+    EXPECT_TRUE(expected.isApprox(actual, 1e-6)) << packet_size;
+  }
+}
+
+TEST(PolyphaseResamplerTest, ChannelsAreIndependent) {
+  auto stereo = CreateResampler(48000, 16000, 2);
+  auto mono = CreateResampler(48000, 16000, 1);
+  const Matrix input = MakeSinusoids(2, 4800, 48000, 250);
+  const Matrix output = ResampleInPackets(stereo.get(), input, 480);
+  for (int c = 0; c < 2; ++c) {
+    const Matrix channel_output =
+        ResampleInPackets(mono.get(), Matrix(input.row(c)), 480);
+    EXPECT_TRUE(channel_output.isApprox(output.row(c), 1e-6)) << c;
+  }
+}
+
+TEST(PolyphaseResamplerTest, PreservesInBandSinusoids) {
+  for (double output_rate : {16000.0, 22050.0, 96000.0}) {
+    auto resampler = CreateResampler(48000, output_rate, 2);
+    const Matrix input = MakeSinusoids(2, 9600, 48000, 1000);
+    const Matrix output = ResampleInPackets(resampler.get(), input, 512);
+    const double rate = 48000.0 * resampler->factor_numerator() /
+                        resampler->factor_denominator();
+    const Matrix expected = MakeSinusoids(2, output.cols(), rate, 1000);
+    // Skip the edges, where the signal is implicitly zero-padded.
+    const int margin = output.cols() / 10;
+    const int length = output.cols() - 2 * margin;
+    EXPECT_LT((output.middleCols(margin, length) -
+               expected.middleCols(margin, length))
+                  .cwiseAbs()
+                  .maxCoeff(),
+              2e-2)
+        << output_rate;
+  }
+}
+
+TEST(PolyphaseResamplerTest, AttenuatesAliasedSinusoids) {
+  auto resampler = CreateResampler(48000, 16000, 1);
+  // 12 kHz is above the 8 kHz output Nyquist frequency.
+  const Matrix input = MakeSinusoids(1, 9600, 48000, 12000);
+  const Matrix output = ResampleInPackets(resampler.get(), input, 512);
+  const int margin = output.cols() / 10;
+  EXPECT_LT(output.middleCols(margin, output.cols() - 2 * margin)
+                .cwiseAbs()
+                .maxCoeff(),
+            1e-2);
+}
+
+TEST(PolyphaseResamplerTest, MatchesQResampler) {
+  for (double output_rate : {8000.0, 16000.0, 22050.0, 44100.0, 96000.0}) {
+    // 1.5 and 3 kHz tones, within the passband of every output rate.
+    const Matrix input = MakeSinusoids(2, 4800, 48000, 1500);
+    auto resampler = CreateResampler(48000, output_rate, 2);
+    const Matrix output = ResampleInPackets(resampler.get(), input, 512);
+
+    for (int c = 0; c < 2; ++c) {
+      audio_dsp::QResampler<float> q_resampler(48000, output_rate,
+                                               /*num_channels=*/1);
+      ASSERT_TRUE(q_resampler.Valid());
+      std::vector<float> q_output;
+      std::vector<float> packet_output;
+      for (int start = 0; start < input.cols(); start += 512) {
+        const int size = std::min<int>(512, input.cols() - start);
+        std::vector<float> packet(size);
+        for (int i = 0; i < size; ++i) {
+          packet[i] = input(c, start + i);
+        }
+        q_resampler.ProcessSamples(packet, &packet_output);
+        q_output.insert(q_output.end(), packet_output.begin(),
+                        packet_output.end());
+      }
+      q_resampler.Flush(&packet_output);
+      q_output.insert(q_output.end(), packet_output.begin(),
+                      packet_output.end());
+
+      // QResampler may emit a few more trailing frames of the flushed
+      // silence.
+      ASSERT_GE(q_output.size(), output.cols()) << output_rate;
+      float max_difference = 0.0f;
+      for (int i = 0; i < output.cols(); ++i) {
+        max_difference =
+            std::max(max_difference, std::abs(output(c, i) - q_output[i]));
+      }
+      // Both implement the same filter design, so they differ only by float
+      // rounding. A looser bound would miss filter design or phase errors.
+      EXPECT_LT(max_difference, 1e-5) << output_rate << " channel " << c;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
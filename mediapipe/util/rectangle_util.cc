@@ -14,6 +14,8 @@
 
 #include "mediapipe/util/rectangle_util.h"
 
+#include <algorithm>
+
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/port/rectangle.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -70,4 +72,41 @@ float CalculateIou(const Rectangle_f& rect1, const Rectangle_f& rect2) {
   return normalization > 0.0f ? intersection_area / normalization : 0.0f;
 }
 
+std::vector<std::pair<int, int>> FindOverlappingRectangles(
+    absl::Span<const Rectangle_f> rects, float min_similarity_threshold) {
+  // An IoU above a non-negative threshold needs an intersection of positive
+  // area, so rectangles of zero or negative width or height (or NaN bounds)
+  // never take part in a pair.
+  std::vector<int> order;
+  order.reserve(rects.size());
+  for (int i = 0; i < rects.size(); ++i) {
+    if (rects[i].xmax() > rects[i].xmin() &&
+        rects[i].ymax() > rects[i].ymin()) {
+      order.push_back(i);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&rects](int a, int b) {
+    return rects[a].xmin() < rects[b].xmin();
+  });
+
+  std::vector<std::pair<int, int>> pairs;
+  for (int s = 0; s < order.size(); ++s) {
+    const Rectangle_f& rect = rects[order[s]];
+    // Every later rectangle starts at or after rect, so it overlaps rect
+    // along the x axis as long as it starts before rect ends.
+    for (int t = s + 1; t < order.size(); ++t) {
+      const Rectangle_f& other = rects[order[t]];
+      if (other.xmin() >= rect.xmax()) break;
+      if (other.ymin() >= rect.ymax() || rect.ymin() >= other.ymax()) {
+        continue;
+      }
+      if (CalculateIou(rect, other) > min_similarity_threshold) {
+        pairs.emplace_back(std::min(order[s], order[t]),
+                           std::max(order[s], order[t]));
+      }
+    }
+  }
+  return pairs;
+}
+
 }  // namespace mediapipe
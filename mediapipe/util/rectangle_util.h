@@ -15,6 +15,9 @@
 #ifndef MEDIAPIPE_RECTANGLE_UTIL_H_
 #define MEDIAPIPE_RECTANGLE_UTIL_H_
 
+#include <utility>
+#include <vector>
+
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "mediapipe/framework/formats/rect.pb.h"
@@ -35,6 +38,13 @@ absl::StatusOr<bool> DoesRectOverlap(
 // Computes the Intersection over Union (IoU) between two rectangles.
 float CalculateIou(const Rectangle_f& rect1, const Rectangle_f& rect2);
 
+// Returns the index pairs (i, j), i < j, of the rectangles in rects whose IoU
+// is greater than min_similarity_threshold, which must be non-negative. The
+// rectangles are swept in order of xmin, so only rectangles that overlap along
+// the x axis are compared, instead of all pairs. The pairs are not ordered.
+std::vector<std::pair<int, int>> FindOverlappingRectangles(
+    absl::Span<const Rectangle_f> rects, float min_similarity_threshold);
+
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_RECTANGLE_UTIL_H_
@@ -14,6 +14,11 @@
 
 #include "mediapipe/util/rectangle_util.h"
 
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/status_matchers.h"
 
@@ -21,6 +26,8 @@ namespace mediapipe {
 namespace {
 
 using ::testing::FloatNear;
+using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 
 class RectangleUtilTest : public testing::Test {
  protected:
@@ -176,5 +183,50 @@ TEST_F(RectangleUtilTest, NormRectToRectangleFail) {
   EXPECT_THAT(ToRectangle(invalid_nr), testing::Not(IsOk()));
 }
 
+TEST_F(RectangleUtilTest, FindOverlappingRectangles) {
+  std::vector<Rectangle_f> rects;
+  for (const auto* nr : {&nr_0, &nr_1, &nr_2, &nr_3, &nr_4}) {
+    auto rect = ToRectangle(*nr);
+    MP_ASSERT_OK(rect);
+    rects.push_back(*rect);
+  }
+  EXPECT_THAT(
+      FindOverlappingRectangles(rects, /*min_similarity_threshold=*/0.1),
+      UnorderedElementsAre(std::make_pair(0, 3), std::make_pair(1, 3),
+                           std::make_pair(2, 4)));
+  EXPECT_THAT(
+      FindOverlappingRectangles(rects, /*min_similarity_threshold=*/0.4),
+      UnorderedElementsAre(std::make_pair(1, 3)));
+  EXPECT_THAT(FindOverlappingRectangles({}, 0), testing::IsEmpty());
+}
+
+TEST(RectangleUtilRandomTest, FindOverlappingRectanglesMatchesAllPairs) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> position(-0.1f, 1.1f);
+  std::uniform_real_distribution<float> size(0.0f, 0.2f);
+  std::vector<Rectangle_f> rects;
+  for (int i = 0; i < 300; ++i) {
+    rects.emplace_back(position(rng), position(rng), size(rng), size(rng));
+  }
+  // Touching and empty rectangles.
+  rects.emplace_back(0.5f, 0.5f, 0.1f, 0.1f);
+  rects.emplace_back(0.6f, 0.5f, 0.1f, 0.1f);
+  rects.emplace_back(0.5f, 0.5f, 0.0f, 0.1f);
+  rects.emplace_back(0.5f, 0.5f, -0.1f, 0.1f);
+
+  for (float threshold : {0.0f, 0.1f, 0.5f}) {
+    std::vector<std::pair<int, int>> expected;
+    for (int i = 0; i < rects.size(); ++i) {
+      for (int j = i + 1; j < rects.size(); ++j) {
+        if (CalculateIou(rects[i], rects[j]) > threshold) {
+          expected.emplace_back(i, j);
+        }
+      }
+    }
+    EXPECT_THAT(FindOverlappingRectangles(rects, threshold),
+                UnorderedElementsAreArray(expected));
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,534 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/sequence/media_sequence_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+namespace mediasequence {
+namespace {
+
+// TFRecord framing: a little-endian uint64 length and its masked CRC32C,
+// followed by the payload and its masked CRC32C.
+constexpr int64 kRecordHeaderSize = sizeof(uint64) + sizeof(uint32);
+constexpr int64 kRecordFooterSize = sizeof(uint32);
+
+// Sidecar index layout, as little-endian uint64 values:
+//   kIndexMagic, size and modification time (in nanoseconds) of the TFRecord
+//   file, number of records, offsets...
+constexpr uint64 kIndexMagic = 0x32584449524654ULL;  // "TFRIDX2"
+constexpr int kIndexHeaderWords = 4;
+
+const uint32* Crc32cTable() {
+  static const uint32* table = [] {
+    uint32* table = new uint32[256];
+    for (uint32 i = 0; i < 256; ++i) {
+      uint32 crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+  return table;
+}
+
+int64 ModificationTimeNanos(const struct stat& file_stat) {
+#if defined(__APPLE__)
+  const struct timespec& mtime = file_stat.st_mtimespec;
+#else
+  const struct timespec& mtime = file_stat.st_mtim;
+#endif
+  return static_cast<int64>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+}
+
+uint64 DecodeFixed64(const char* data) {
+  uint64 value = 0;
+  for (int i = sizeof(uint64) - 1; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+uint32 DecodeFixed32(const char* data) {
+  uint32 value = 0;
+  for (int i = sizeof(uint32) - 1; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+void EncodeFixed64(uint64 value, std::string* output) {
+  for (int i = 0; i < sizeof(uint64); ++i) {
+    output->push_back(static_cast<char>(value & 0xff));
+    value >>= 8;
+  }
+}
+
+// Minimal reader for the protocol buffer wire format, used to locate
+// submessages without parsing them.
+class WireReader {
+ public:
+  explicit WireReader(absl::string_view data) : data_(data) {}
+
+  bool done() const { return position_ >= data_.size(); }
+
+  bool ReadTag(uint32* field_number, int* wire_type) {
+    uint64 tag;
+    if (!ReadVarint(&tag)) return false;
+    *field_number = static_cast<uint32>(tag >> 3);
+    *wire_type = static_cast<int>(tag & 7);
+    return *field_number != 0;
+  }
+
+  bool ReadLengthDelimited(absl::string_view* value) {
+    uint64 length;
+    if (!ReadVarint(&length) || length > data_.size() - position_) {
+      return false;
+    }
+    *value = data_.substr(position_, length);
+    position_ += length;
+    return true;
+  }
+
+  bool SkipField(int wire_type) {
+    uint64 unused_varint;
+    absl::string_view unused_bytes;
+    switch (wire_type) {
+      case 0:
+        return ReadVarint(&unused_varint);
+      case 1:
+        return Skip(8);
+      case 2:
+        return ReadLengthDelimited(&unused_bytes);
+      case 5:
+        return Skip(4);
+      default:
+        // Groups are not used by tf.SequenceExample.
+        return false;
+    }
+  }
+
+ private:
+  bool ReadVarint(uint64* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && position_ < data_.size(); shift += 7) {
+      const uint8 byte = static_cast<uint8>(data_[position_++]);
+      *value |= static_cast<uint64>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+  }
+
+  bool Skip(size_t num_bytes) {
+    if (num_bytes > data_.size() - position_) return false;
+    position_ += num_bytes;
+    return true;
+  }
+
+  absl::string_view data_;
+  size_t position_ = 0;
+};
+
+absl::Status MalformedError(absl::string_view what) {
+  return absl::InvalidArgumentError(
+      absl::StrCat("Malformed SequenceExample: ", what));
+}
+
+// Parses a tf.FeatureList into the locations of its tf.Feature entries.
+absl::Status IndexFeatureList(absl::string_view serialized,
+                              std::vector<absl::string_view>* features) {
+  features->clear();
+  WireReader reader(serialized);
+  while (!reader.done()) {
+    uint32 field;
+    int wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) return MalformedError("tag");
+    if (field == 1 && wire_type == 2) {
+      absl::string_view feature;
+      if (!reader.ReadLengthDelimited(&feature)) {
+        return MalformedError("feature");
+      }
+      features->push_back(feature);
+    } else if (!reader.SkipField(wire_type)) {
+      return MalformedError("feature list field");
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Returns the longest X such that `key` is "X/..." and "X/timestamp" is a
+// feature list of the view, or an empty string if there is none.
+std::string TimestampPrefix(const SequenceExampleView& view,
+                            const std::string& key) {
+  for (size_t end = key.rfind('/'); end != std::string::npos && end > 0;
+       end = key.rfind('/', end - 1)) {
+    std::string prefix = key.substr(0, end);
+    if (view.HasFeatureList(absl::StrCat(prefix, "/timestamp"))) {
+      return prefix;
+    }
+  }
+  return "";
+}
+
+}  // namespace
+
+uint32 ExtendCrc32c(uint32 crc, absl::string_view data) {
+  const uint32* table = Crc32cTable();
+  crc = ~crc;
+  for (const char c : data) {
+    crc = table[(crc ^ static_cast<uint8>(c)) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+uint32 MaskTFRecordCrc32c(uint32 crc) {
+  return ((crc >> 15) | (crc << 17)) + 0xa282ead8;
+}
+
+uint32 TFRecordMaskedCrc32c(absl::string_view data) {
+  return MaskTFRecordCrc32c(ExtendCrc32c(0, data));
+}
+
+std::string TFRecordIndexPath(const std::string& tfrecord_path) {
+  return absl::StrCat(tfrecord_path, ".index");
+}
+
+// static
+absl::StatusOr<std::unique_ptr<TFRecordShard>> TFRecordShard::Open(
+    const std::string& path, bool write_index) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  RET_CHECK_GE(fd, 0) << "Failed to open TFRecord file " << path;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return absl::UnavailableError(absl::StrCat("Failed to stat ", path));
+  }
+  const int64 size = file_stat.st_size;
+  const int64 mtime_nanos = ModificationTimeNanos(file_stat);
+  const char* data = nullptr;
+  if (size > 0) {
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      return absl::UnavailableError(absl::StrCat("Failed to map ", path));
+    }
+    data = static_cast<const char*>(mapping);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  auto shard =
+      absl::WrapUnique(new TFRecordShard(path, data, size, mtime_nanos));
+  if (!shard->LoadIndex().ok()) {
+    MP_RETURN_IF_ERROR(shard->BuildIndex());
+    if (write_index) shard->WriteIndex();
+  }
+  return shard;
+}
+
+TFRecordShard::TFRecordShard(const std::string& path, const char* data,
+                             int64 size, int64 mtime_nanos)
+    : path_(path), data_(data), size_(size), mtime_nanos_(mtime_nanos) {}
+
+TFRecordShard::~TFRecordShard() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+absl::StatusOr<absl::string_view> TFRecordShard::GetRecord(int index) const {
+  RET_CHECK(index >= 0 && index < NumRecords())
+      << "Record index " << index << " is out of range for " << path_
+      << " with " << NumRecords() << " records.";
+  const uint64 offset = offsets_[index];
+  // Record headers are only validated here, so that loading the index does
+  // not touch every record of the shard. The length checksum also catches an
+  // index that no longer matches a rewritten file.
+  RET_CHECK(HasValidHeader(offset))
+      << "Corrupted record header " << index << " in " << path_;
+  const uint64 length = DecodeFixed64(data_ + offset);
+  RET_CHECK(RecordFits(offset, length))
+      << "Truncated record " << index << " in " << path_;
+  return absl::string_view(data_ + offset + kRecordHeaderSize, length);
+}
+
+bool TFRecordShard::RecordFits(uint64 offset, uint64 length) const {
+  const uint64 size = size_;
+  return length <= size &&
+         offset + kRecordHeaderSize + length + kRecordFooterSize <= size;
+}
+
+bool TFRecordShard::HasValidHeader(uint64 offset) const {
+  if (offset + kRecordHeaderSize > static_cast<uint64>(size_)) return false;
+  const char* header = data_ + offset;
+  return DecodeFixed32(header + sizeof(uint64)) ==
+         TFRecordMaskedCrc32c(absl::string_view(header, sizeof(uint64)));
+}
+
+absl::Status TFRecordShard::LoadIndex() {
+  std::string contents;
+  MP_RETURN_IF_ERROR(file::GetContents(TFRecordIndexPath(path_), &contents));
+  const int64 num_words = contents.size() / sizeof(uint64);
+  RET_CHECK(contents.size() % sizeof(uint64) == 0 &&
+            num_words >= kIndexHeaderWords);
+  const char* words = contents.data();
+  RET_CHECK_EQ(DecodeFixed64(words), kIndexMagic);
+  RET_CHECK(DecodeFixed64(words + sizeof(uint64)) ==
+                static_cast<uint64>(size_) &&
+            DecodeFixed64(words + 2 * sizeof(uint64)) ==
+                static_cast<uint64>(mtime_nanos_))
+      << "Stale record index for " << path_;
+  const uint64 num_records = DecodeFixed64(words + 3 * sizeof(uint64));
+  RET_CHECK_EQ(num_records, num_words - kIndexHeaderWords);
+
+  std::vector<uint64> offsets(num_records);
+  for (uint64 i = 0; i < num_records; ++i) {
+    offsets[i] =
+        DecodeFixed64(words + (kIndexHeaderWords + i) * sizeof(uint64));
+    RET_CHECK(i == 0 || offsets[i] > offsets[i - 1]);
+  }
+  RET_CHECK(num_records == 0 ||
+            offsets.back() + kRecordHeaderSize <= static_cast<uint64>(size_));
+  offsets_ = std::move(offsets);
+  return absl::OkStatus();
+}
+
+absl::Status TFRecordShard::BuildIndex() {
+  offsets_.clear();
+  uint64 offset = 0;
+  while (offset < size_) {
+    RET_CHECK_LE(offset + kRecordHeaderSize, size_)
+        << "Truncated record header at offset " << offset << " in " << path_;
+    RET_CHECK(HasValidHeader(offset))
+        << "Corrupted record header at offset " << offset << " in " << path_;
+    const uint64 length = DecodeFixed64(data_ + offset);
+    RET_CHECK(RecordFits(offset, length))
+        << "Truncated record at offset " << offset << " in " << path_;
+    offsets_.push_back(offset);
+    offset += kRecordHeaderSize + length + kRecordFooterSize;
+  }
+  return absl::OkStatus();
+}
+
+void TFRecordShard::WriteIndex() const {
+  std::string contents;
+  contents.reserve((kIndexHeaderWords + offsets_.size()) * sizeof(uint64));
+  EncodeFixed64(kIndexMagic, &contents);
+  EncodeFixed64(size_, &contents);
+  EncodeFixed64(mtime_nanos_, &contents);
+  EncodeFixed64(offsets_.size(), &contents);
+  for (uint64 offset : offsets_) {
+    EncodeFixed64(offset, &contents);
+  }
+  const absl::Status status =
+      file::SetContents(TFRecordIndexPath(path_), contents);
+  if (!status.ok()) {
+    LOG(WARNING) << "Unable to write the record index for " << path_ << ": "
+                 << status;
+  }
+}
+
+absl::Status SequenceExampleView::Parse(absl::string_view serialized) {
+  context_.clear();
+  feature_lists_.clear();
+  WireReader reader(serialized);
+  while (!reader.done()) {
+    uint32 field;
+    int wire_type;
+    if (!reader.ReadTag(&field, &wire_type)) return MalformedError("tag");
+    if (wire_type != 2 || (field != 1 && field != 2)) {
+      if (!reader.SkipField(wire_type)) return MalformedError("field");
+      continue;
+    }
+    absl::string_view message;
+    if (!reader.ReadLengthDelimited(&message)) {
+      return MalformedError("submessage");
+    }
+    if (field == 1) {
+      context_.push_back(message);
+      continue;
+    }
+    // tf.FeatureLists: map<string, FeatureList> feature_list = 1.
+    WireReader lists(message);
+    while (!lists.done()) {
+      uint32 list_field;
+      int list_wire_type;
+      if (!lists.ReadTag(&list_field, &list_wire_type)) {
+        return MalformedError("feature lists tag");
+      }
+      absl::string_view entry;
+      if (list_field != 1 || list_wire_type != 2) {
+        if (!lists.SkipField(list_wire_type)) {
+          return MalformedError("feature lists field");
+        }
+        continue;
+      }
+      if (!lists.ReadLengthDelimited(&entry)) {
+        return MalformedError("feature lists entry");
+      }
+      std::string key;
+      absl::string_view value;
+      WireReader entry_reader(entry);
+      while (!entry_reader.done()) {
+        uint32 entry_field;
+        int entry_wire_type;
+        if (!entry_reader.ReadTag(&entry_field, &entry_wire_type)) {
+          return MalformedError("map entry tag");
+        }
+        absl::string_view bytes;
+        if (entry_wire_type == 2 && (entry_field == 1 || entry_field == 2)) {
+          if (!entry_reader.ReadLengthDelimited(&bytes)) {
+            return MalformedError("map entry");
+          }
+          if (entry_field == 1) {
+            key = std::string(bytes);
+          } else {
+            value = bytes;
+          }
+        } else if (!entry_reader.SkipField(entry_wire_type)) {
+          return MalformedError("map entry field");
+        }
+      }
+      // Later map entries replace earlier ones, as in a full parse.
+      MP_RETURN_IF_ERROR(IndexFeatureList(value, &feature_lists_[key]));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SequenceExampleView::ParseContext(
+    tensorflow::Features* context) const {
+  context->Clear();
+  for (absl::string_view serialized : context_) {
+    tensorflow::Features features;
+    RET_CHECK(features.ParseFromArray(serialized.data(), serialized.size()))
+        << "Failed to parse the SequenceExample context.";
+    context->MergeFrom(features);
+  }
+  return absl::OkStatus();
+}
+
+std::vector<std::string> SequenceExampleView::FeatureListKeys() const {
+  std::vector<std::string> keys;
+  keys.reserve(feature_lists_.size());
+  for (const auto& key_value : feature_lists_) {
+    keys.push_back(key_value.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+bool SequenceExampleView::HasFeatureList(const std::string& key) const {
+  return feature_lists_.contains(key);
+}
+
+int SequenceExampleView::FeatureListSize(const std::string& key) const {
+  auto it = feature_lists_.find(key);
+  return it == feature_lists_.end() ? 0 : it->second.size();
+}
+
+absl::Status SequenceExampleView::ParseFeature(
+    const std::string& key, int index, tensorflow::Feature* feature) const {
+  auto it = feature_lists_.find(key);
+  RET_CHECK(it != feature_lists_.end()) << "Missing feature list " << key;
+  RET_CHECK(index >= 0 && index < it->second.size())
+      << "Index " << index << " is out of range for feature list " << key
+      << " of size " << it->second.size();
+  const absl::string_view serialized = it->second[index];
+  RET_CHECK(feature->ParseFromArray(serialized.data(), serialized.size()))
+      << "Failed to parse entry " << index << " of feature list " << key;
+  return absl::OkStatus();
+}
+
+absl::Status ExtractSequenceExample(const SequenceExampleView& view,
+                                    const SequenceExampleSelection& selection,
+                                    tensorflow::SequenceExample* output) {
+  output->Clear();
+  MP_RETURN_IF_ERROR(view.ParseContext(output->mutable_context()));
+
+  const bool has_time_range =
+      selection.start_timestamp != std::numeric_limits<int64>::min() ||
+      selection.end_timestamp != std::numeric_limits<int64>::max();
+  // Indices to keep for each timestamp prefix, computed on first use.
+  absl::flat_hash_map<std::string, std::vector<int>> kept_indices;
+  auto* feature_lists = output->mutable_feature_lists()->mutable_feature_list();
+  for (const std::string& key : view.FeatureListKeys()) {
+    if (!selection.feature_list_prefixes.empty() &&
+        std::none_of(selection.feature_list_prefixes.begin(),
+                     selection.feature_list_prefixes.end(),
+                     [&key](const std::string& prefix) {
+                       return absl::StartsWith(key, prefix);
+                     })) {
+      continue;
+    }
+    const int size = view.FeatureListSize(key);
+    auto& feature_list = (*feature_lists)[key];
+
+    const std::vector<int>* indices = nullptr;
+    if (has_time_range) {
+      const std::string prefix = TimestampPrefix(view, key);
+      const std::string timestamp_key = absl::StrCat(prefix, "/timestamp");
+      if (!prefix.empty() && view.FeatureListSize(timestamp_key) == size) {
+        auto it = kept_indices.find(prefix);
+        if (it == kept_indices.end()) {
+          std::vector<int> in_range;
+          tensorflow::Feature timestamp;
+          for (int i = 0; i < size; ++i) {
+            MP_RETURN_IF_ERROR(view.ParseFeature(timestamp_key, i, &timestamp));
+            RET_CHECK_GT(timestamp.int64_list().value_size(), 0)
+                << "Missing timestamp " << i << " in " << timestamp_key;
+            const int64 value = timestamp.int64_list().value(0);
+            if ((value >= selection.start_timestamp &&
+                 value <= selection.end_timestamp) ||
+                value == Timestamp::PostStream().Value()) {
+              in_range.push_back(i);
+            }
+          }
+          it = kept_indices.emplace(prefix, std::move(in_range)).first;
+        }
+        indices = &it->second;
+      }
+    }
+
+    if (indices == nullptr) {
+      for (int i = 0; i < size; ++i) {
+        MP_RETURN_IF_ERROR(view.ParseFeature(key, i, feature_list.add_feature()));
+      }
+    } else {
+      for (int i : *indices) {
+        MP_RETURN_IF_ERROR(view.ParseFeature(key, i, feature_list.add_feature()));
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mediasequence
+}  // namespace mediapipe
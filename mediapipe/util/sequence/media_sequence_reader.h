@@ -0,0 +1,167 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Random access to MediaSequence tf.SequenceExamples stored in TFRecord files.
+//
+// TFRecordShard memory-maps a TFRecord file and locates records through a
+// sidecar offset index, so any record can be fetched without reading the ones
+// before it. SequenceExampleView indexes the wire format of one serialized
+// SequenceExample without parsing it, so individual feature list entries can
+// be decoded on demand. ExtractSequenceExample() combines the two to
+// materialize only the feature lists and the time range a consumer needs:
+//
+//   ASSIGN_OR_RETURN(auto shard, TFRecordShard::Open(path));
+//   ASSIGN_OR_RETURN(absl::string_view record, shard->GetRecord(index));
+//   SequenceExampleView view;
+//   MP_RETURN_IF_ERROR(view.Parse(record));
+//   SequenceExampleSelection selection;
+//   selection.feature_list_prefixes = {"image"};
+//   selection.start_timestamp = mpms::GetClipStartTimestamp(...);
+//   tensorflow::SequenceExample clip;
+//   MP_RETURN_IF_ERROR(ExtractSequenceExample(view, selection, &clip));
+
+#ifndef MEDIAPIPE_UTIL_SEQUENCE_MEDIA_SEQUENCE_READER_H_
+#define MEDIAPIPE_UTIL_SEQUENCE_MEDIA_SEQUENCE_READER_H_
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+
+namespace mediapipe {
+namespace mediasequence {
+
+// Extends `crc` with the CRC32C (Castagnoli) checksum of `data`. Start from 0.
+uint32 ExtendCrc32c(uint32 crc, absl::string_view data);
+
+// Returns the masked form of `crc` that TFRecord files store.
+uint32 MaskTFRecordCrc32c(uint32 crc);
+
+// Returns the masked CRC32C that TFRecord files store for `data`.
+uint32 TFRecordMaskedCrc32c(absl::string_view data);
+
+// Returns the path of the sidecar record index for a TFRecord file.
+std::string TFRecordIndexPath(const std::string& tfrecord_path);
+
+// A read-only, memory-mapped TFRecord file.
+//
+// The record offsets are loaded from TFRecordIndexPath(path) when it exists
+// and matches the size and modification time of the file. Otherwise they are
+// found by walking the record headers, which touches only a few bytes per
+// record, and the index is written next to the file when write_index is true.
+// Failing to write the index (e.g. on a read-only dataset) is not an error.
+//
+// The checksum of each record length is verified when the record is read, so
+// an index that matches a rewritten file by size and time is still caught.
+// Payload checksums are not verified; lengths are checked against the file
+// bounds.
+class TFRecordShard {
+ public:
+  static absl::StatusOr<std::unique_ptr<TFRecordShard>> Open(
+      const std::string& path, bool write_index = true);
+  ~TFRecordShard();
+
+  TFRecordShard(const TFRecordShard&) = delete;
+  TFRecordShard& operator=(const TFRecordShard&) = delete;
+
+  int NumRecords() const { return offsets_.size(); }
+
+  // Returns the payload of the record at `index`. The returned bytes point
+  // into the mapping and remain valid for the lifetime of the shard.
+  absl::StatusOr<absl::string_view> GetRecord(int index) const;
+
+ private:
+  TFRecordShard(const std::string& path, const char* data, int64 size,
+                int64 mtime_nanos);
+
+  // Returns true if the record header at `offset` is within the file and its
+  // length matches its checksum.
+  bool HasValidHeader(uint64 offset) const;
+
+  // Returns true if a record of `length` bytes at `offset` ends within the
+  // file.
+  bool RecordFits(uint64 offset, uint64 length) const;
+  absl::Status LoadIndex();
+  absl::Status BuildIndex();
+  void WriteIndex() const;
+
+  const std::string path_;
+  const char* data_;
+  const int64 size_;
+  const int64 mtime_nanos_;
+  std::vector<uint64> offsets_;
+};
+
+// Index over the wire format of a serialized tf.SequenceExample.
+//
+// Parse() records where the context and each feature list entry are in the
+// serialized bytes. Feature list entries are length-delimited, so indexing
+// skips over encoded images and feature vectors without decoding them. The
+// view references `serialized`, which must outlive it.
+class SequenceExampleView {
+ public:
+  absl::Status Parse(absl::string_view serialized);
+
+  // Parses the context features.
+  absl::Status ParseContext(tensorflow::Features* context) const;
+
+  std::vector<std::string> FeatureListKeys() const;
+  bool HasFeatureList(const std::string& key) const;
+  // Returns 0 for missing feature lists.
+  int FeatureListSize(const std::string& key) const;
+  // Parses a single entry of a feature list.
+  absl::Status ParseFeature(const std::string& key, int index,
+                            tensorflow::Feature* feature) const;
+
+ private:
+  // Serialized tf.Features messages; repeated fields are merged on parse.
+  std::vector<absl::string_view> context_;
+  // Serialized tf.Feature messages of each feature list.
+  absl::flat_hash_map<std::string, std::vector<absl::string_view>>
+      feature_lists_;
+};
+
+// Which parts of a SequenceExample to materialize.
+struct SequenceExampleSelection {
+  // Feature lists whose keys start with one of these prefixes are kept. All
+  // feature lists are kept when empty.
+  std::vector<std::string> feature_list_prefixes;
+  // Inclusive time range, in microseconds, of the feature list entries to
+  // keep. Each feature list "X/..." is trimmed according to the timestamps
+  // in "X/timestamp", using the longest such X. Feature lists without a
+  // timestamp list of the same length are kept whole, as are entries at
+  // Timestamp::PostStream().
+  int64 start_timestamp = std::numeric_limits<int64>::min();
+  int64 end_timestamp = std::numeric_limits<int64>::max();
+};
+
+// Builds a SequenceExample holding the full context of `view` and the
+// selected feature list entries. Only the selected entries and the timestamp
+// lists needed to select them are parsed.
+absl::Status ExtractSequenceExample(const SequenceExampleView& view,
+                                    const SequenceExampleSelection& selection,
+                                    tensorflow::SequenceExample* output);
+
+}  // namespace mediasequence
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_SEQUENCE_MEDIA_SEQUENCE_READER_H_
@@ -0,0 +1,290 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/sequence/media_sequence_reader.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/timestamp.h"
+#include "mediapipe/util/sequence/media_sequence.h"
+#include "tensorflow/core/example/example.pb.h"
+
+namespace mediapipe {
+namespace mediasequence {
+namespace {
+
+void AppendFixed(uint64 value, int num_bytes, std::string* output) {
+  for (int i = 0; i < num_bytes; ++i) {
+    output->push_back(static_cast<char>(value & 0xff));
+    value >>= 8;
+  }
+}
+
+// Writes records with TFRecord framing. The payload checksums are left as
+// zero because the reader only verifies the length checksums.
+void WriteTFRecords(const std::string& path,
+                    const std::vector<std::string>& records) {
+  std::string contents;
+  for (const std::string& record : records) {
+    std::string header;
+    AppendFixed(record.size(), sizeof(uint64), &header);
+    AppendFixed(TFRecordMaskedCrc32c(header), sizeof(uint32), &header);
+    contents.append(header);
+    contents.append(record);
+    contents.append(4, '\0');
+  }
+  MP_ASSERT_OK(file::SetContents(path, contents));
+}
+
+std::string TestPath(const std::string& name) {
+  return absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+}
+
+std::unique_ptr<TFRecordShard> OpenShard(const std::string& path) {
+  auto status_or_shard = TFRecordShard::Open(path);
+  MP_EXPECT_OK(status_or_shard);
+  return std::move(status_or_shard).value();
+}
+
+// Images every 1000us, "FDENSE" features every 2000us and a clip context.
+tensorflow::SequenceExample MakeSequence() {
+  tensorflow::SequenceExample sequence;
+  SetClipDataPath("clip.mp4", &sequence);
+  SetClipStartTimestamp(2000, &sequence);
+  SetClipEndTimestamp(6000, &sequence);
+  for (int i = 0; i < 10; ++i) {
+    AddImageTimestamp(i * 1000, &sequence);
+    AddImageEncoded(absl::StrCat("image_", i), &sequence);
+  }
+  for (int i = 0; i < 5; ++i) {
+    AddFeatureTimestamp("FDENSE", i * 2000, &sequence);
+    AddFeatureFloats("FDENSE", {static_cast<float>(i), 1.0f}, &sequence);
+  }
+  AddFeatureTimestamp("FDENSE", Timestamp::PostStream().Value(), &sequence);
+  AddFeatureFloats("FDENSE", {-1.0f, -1.0f}, &sequence);
+  return sequence;
+}
+
+// Compares feature maps entry by entry, since map serialization order is
+// unspecified.
+void ExpectSameContext(const tensorflow::Features& expected,
+                       const tensorflow::Features& actual) {
+  ASSERT_EQ(expected.feature_size(), actual.feature_size());
+  for (const auto& key_value : expected.feature()) {
+    ASSERT_TRUE(actual.feature().count(key_value.first)) << key_value.first;
+    EXPECT_THAT(actual.feature().at(key_value.first),
+                EqualsProto(key_value.second));
+  }
+}
+
+void ExpectSameSequence(const tensorflow::SequenceExample& expected,
+                        const tensorflow::SequenceExample& actual) {
+  ExpectSameContext(expected.context(), actual.context());
+  const auto& expected_lists = expected.feature_lists().feature_list();
+  const auto& actual_lists = actual.feature_lists().feature_list();
+  ASSERT_EQ(expected_lists.size(), actual_lists.size());
+  for (const auto& key_value : expected_lists) {
+    ASSERT_TRUE(actual_lists.count(key_value.first)) << key_value.first;
+    EXPECT_THAT(actual_lists.at(key_value.first),
+                EqualsProto(key_value.second));
+  }
+}
+
+TEST(TFRecordShardTest, ReadsRecordsAndReusesIndex) {
+  const std::string path = TestPath("reads_records.tfrecord");
+  const std::vector<std::string> records = {"first", "", "third record"};
+  WriteTFRecords(path, records);
+
+  auto shard = OpenShard(path);
+  ASSERT_EQ(records.size(), shard->NumRecords());
+  for (int i = 0; i < records.size(); ++i) {
+    auto status_or_record = shard->GetRecord(i);
+    MP_ASSERT_OK(status_or_record);
+    EXPECT_EQ(records[i], status_or_record.value());
+  }
+  EXPECT_FALSE(shard->GetRecord(3).ok());
+  MP_EXPECT_OK(file::Exists(TFRecordIndexPath(path)));
+
+  // A reopened shard uses the sidecar index.
+  shard = OpenShard(path);
+  ASSERT_EQ(records.size(), shard->NumRecords());
+  EXPECT_EQ(records[2], shard->GetRecord(2).value());
+}
+
+TEST(TFRecordShardTest, RebuildsStaleIndex) {
+  const std::string path = TestPath("stale_index.tfrecord");
+  WriteTFRecords(path, {"a", "b"});
+  EXPECT_EQ(2, OpenShard(path)->NumRecords());
+
+  WriteTFRecords(path, {"a", "b", "c"});
+  auto shard = OpenShard(path);
+  ASSERT_EQ(3, shard->NumRecords());
+  EXPECT_EQ("c", shard->GetRecord(2).value());
+}
+
+TEST(TFRecordShardTest, RebuildsIndexOfRewrittenFileOfSameSize) {
+  const std::string path = TestPath("same_size.tfrecord");
+  WriteTFRecords(path, {"ab", "c"});
+  EXPECT_EQ("c", OpenShard(path)->GetRecord(1).value());
+
+  WriteTFRecords(path, {"a", "bc"});
+  auto shard = OpenShard(path);
+  ASSERT_EQ(2, shard->NumRecords());
+  EXPECT_EQ("bc", shard->GetRecord(1).value());
+}
+
+TEST(TFRecordShardTest, DetectsStaleIndexWithRestoredModificationTime) {
+  const std::string path = TestPath("restored_mtime.tfrecord");
+  WriteTFRecords(path, {std::string(20, 'a'), "b"});
+  EXPECT_EQ(2, OpenShard(path)->NumRecords());
+  struct stat original;
+  ASSERT_EQ(0, stat(path.c_str(), &original));
+
+  // Same size and, as after "cp -p", same modification time, so the index
+  // is used. Its second offset now points into a payload that looks like the
+  // header of a one-byte record, but without a valid length checksum.
+  std::string payload(8, 'x');
+  AppendFixed(1, sizeof(uint64), &payload);
+  AppendFixed(0, sizeof(uint32), &payload);
+  payload.append("!");
+  WriteTFRecords(path, {"", payload});
+#if defined(__APPLE__)
+  const struct timespec times[2] = {original.st_atimespec,
+                                    original.st_mtimespec};
+#else
+  const struct timespec times[2] = {original.st_atim, original.st_mtim};
+#endif
+  ASSERT_EQ(0, utimensat(AT_FDCWD, path.c_str(), times, 0));
+  auto shard = OpenShard(path);
+  ASSERT_EQ(2, shard->NumRecords());
+  EXPECT_FALSE(shard->GetRecord(1).ok());
+}
+
+TEST(TFRecordShardTest, FailsOnCorruptedLengthChecksum) {
+  const std::string path = TestPath("corrupted.tfrecord");
+  WriteTFRecords(path, {"record"});
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+  contents[sizeof(uint64)] ^= 1;
+  MP_ASSERT_OK(file::SetContents(path, contents));
+  EXPECT_FALSE(TFRecordShard::Open(path, /*write_index=*/false).ok());
+}
+
+TEST(TFRecordShardTest, FailsOnTruncatedFile) {
+  const std::string path = TestPath("truncated.tfrecord");
+  WriteTFRecords(path, {"complete record"});
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+  MP_ASSERT_OK(
+      file::SetContents(path, contents.substr(0, contents.size() - 6)));
+  EXPECT_FALSE(TFRecordShard::Open(path, /*write_index=*/false).ok());
+}
+
+TEST(Crc32cTest, MatchesKnownValues) {
+  EXPECT_EQ(0, ExtendCrc32c(0, ""));
+  EXPECT_EQ(0xe3069283, ExtendCrc32c(0, "123456789"));
+  EXPECT_EQ(0xe3069283, ExtendCrc32c(ExtendCrc32c(0, "1234"), "56789"));
+}
+
+TEST(SequenceExampleViewTest, IndexesFeatureLists) {
+  const tensorflow::SequenceExample sequence = MakeSequence();
+  const std::string serialized = sequence.SerializeAsString();
+  SequenceExampleView view;
+  MP_ASSERT_OK(view.Parse(serialized));
+
+  EXPECT_THAT(view.FeatureListKeys(),
+              testing::ElementsAre("FDENSE/feature/floats",
+                                   "FDENSE/feature/timestamp",
+                                   "image/encoded", "image/timestamp"));
+  EXPECT_EQ(10, view.FeatureListSize("image/encoded"));
+  EXPECT_EQ(0, view.FeatureListSize("missing"));
+
+  tensorflow::Feature feature;
+  MP_ASSERT_OK(view.ParseFeature("image/encoded", 7, &feature));
+  EXPECT_EQ("image_7", feature.bytes_list().value(0));
+  EXPECT_FALSE(view.ParseFeature("image/encoded", 10, &feature).ok());
+
+  tensorflow::Features context;
+  MP_ASSERT_OK(view.ParseContext(&context));
+  ExpectSameContext(sequence.context(), context);
+}
+
+TEST(SequenceExampleViewTest, RejectsMalformedInput) {
+  const std::string serialized = MakeSequence().SerializeAsString();
+  SequenceExampleView view;
+  EXPECT_FALSE(view.Parse(serialized.substr(0, serialized.size() - 3)).ok());
+}
+
+TEST(ExtractSequenceExampleTest, ExtractsEverythingByDefault) {
+  const tensorflow::SequenceExample sequence = MakeSequence();
+  const std::string serialized = sequence.SerializeAsString();
+  SequenceExampleView view;
+  MP_ASSERT_OK(view.Parse(serialized));
+
+  tensorflow::SequenceExample extracted;
+  MP_ASSERT_OK(ExtractSequenceExample(view, SequenceExampleSelection(),
+                                      &extracted));
+  ExpectSameSequence(sequence, extracted);
+}
+
+TEST(ExtractSequenceExampleTest, ExtractsSelectedFeatureListsInTimeRange) {
+  const tensorflow::SequenceExample sequence = MakeSequence();
+  const std::string serialized = sequence.SerializeAsString();
+  SequenceExampleView view;
+  MP_ASSERT_OK(view.Parse(serialized));
+
+  SequenceExampleSelection selection;
+  selection.feature_list_prefixes = {"image/"};
+  selection.start_timestamp = 2000;
+  selection.end_timestamp = 6000;
+  tensorflow::SequenceExample extracted;
+  MP_ASSERT_OK(ExtractSequenceExample(view, selection, &extracted));
+
+  EXPECT_EQ("clip.mp4", GetClipDataPath(extracted));
+  EXPECT_FALSE(HasFeatureTimestamp("FDENSE", extracted));
+  ASSERT_EQ(5, GetImageTimestampSize(extracted));
+  ASSERT_EQ(5, GetImageEncodedSize(extracted));
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ((i + 2) * 1000, GetImageTimestampAt(extracted, i));
+    EXPECT_EQ(absl::StrCat("image_", i + 2), GetImageEncodedAt(extracted, i));
+  }
+
+  // Feature lists are trimmed by their own timestamps, and PostStream
+  // entries are kept.
+  selection.feature_list_prefixes.clear();
+  MP_ASSERT_OK(ExtractSequenceExample(view, selection, &extracted));
+  EXPECT_EQ(5, GetImageEncodedSize(extracted));
+  ASSERT_EQ(4, GetFeatureTimestampSize("FDENSE", extracted));
+  ASSERT_EQ(4, GetFeatureFloatsSize("FDENSE", extracted));
+  EXPECT_EQ(2000, GetFeatureTimestampAt("FDENSE", extracted, 0));
+  EXPECT_EQ(6000, GetFeatureTimestampAt("FDENSE", extracted, 2));
+  EXPECT_EQ(Timestamp::PostStream().Value(),
+            GetFeatureTimestampAt("FDENSE", extracted, 3));
+  EXPECT_THAT(GetFeatureFloatsAt("FDENSE", extracted, 1),
+              testing::ElementsAre(2.0f, 1.0f));
+}
+
+}  // namespace
+}  // namespace mediasequence
+}  // namespace mediapipe
@@ -0,0 +1,282 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/sequence/media_sequence_writer.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/sequence/media_sequence_reader.h"
+
+namespace mediapipe {
+namespace mediasequence {
+namespace {
+
+// Wire format tags of the length-delimited fields written below:
+// SequenceExample.context (1), SequenceExample.feature_lists (2),
+// FeatureLists.feature_list (1) and its map entry key (1) and value (2), and
+// FeatureList.feature (1).
+constexpr char kField1Tag = 0x0a;
+constexpr char kField2Tag = 0x12;
+
+// Largest serialized size protobuf parsers accept.
+constexpr int64 kMaxRecordBytes = 0x7fffffff;
+
+int VarintSize(uint64 value) {
+  int size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+void AppendVarint(uint64 value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+// Size of a length-delimited field holding `size` bytes.
+int64 FieldSize(int64 size) { return 1 + VarintSize(size) + size; }
+
+void AppendFixed(uint64 value, int num_bytes, std::string* output) {
+  for (int i = 0; i < num_bytes; ++i) {
+    output->push_back(static_cast<char>(value & 0xff));
+    value >>= 8;
+  }
+}
+
+// Writes to a file while accumulating the CRC32C of the written bytes.
+class ChecksummedFile {
+ public:
+  explicit ChecksummedFile(FILE* file) : file_(file) {}
+
+  absl::Status Write(absl::string_view data) {
+    crc_ = ExtendCrc32c(crc_, data);
+    RET_CHECK_EQ(fwrite(data.data(), 1, data.size(), file_), data.size())
+        << "Failed to write TFRecord.";
+    return absl::OkStatus();
+  }
+
+  uint32 crc() const { return crc_; }
+
+ private:
+  FILE* file_;
+  uint32 crc_ = 0;
+};
+
+}  // namespace
+
+constexpr int64 StreamingSequenceExampleWriter::kDefaultChunkBytes;
+constexpr int StreamingSequenceExampleWriter::kHeadSize;
+
+// static
+absl::StatusOr<std::unique_ptr<StreamingSequenceExampleWriter>>
+StreamingSequenceExampleWriter::Create(const std::string& spill_path,
+                                       int64 chunk_bytes) {
+  RET_CHECK_GT(chunk_bytes, 0);
+  FILE* spill = fopen(spill_path.c_str(), "w+b");
+  RET_CHECK(spill) << "Failed to create spill file " << spill_path;
+  return absl::WrapUnique(
+      new StreamingSequenceExampleWriter(spill_path, spill, chunk_bytes));
+}
+
+StreamingSequenceExampleWriter::StreamingSequenceExampleWriter(
+    const std::string& spill_path, FILE* spill, int64 chunk_bytes)
+    : spill_path_(spill_path), spill_(spill), chunk_bytes_(chunk_bytes) {}
+
+StreamingSequenceExampleWriter::~StreamingSequenceExampleWriter() {
+  fclose(spill_);
+  if (remove(spill_path_.c_str()) != 0) {
+    LOG(WARNING) << "Failed to remove spill file " << spill_path_;
+  }
+}
+
+absl::Status StreamingSequenceExampleWriter::AddFeature(
+    const std::string& key, const tensorflow::Feature& feature) {
+  return AppendFeature(key, feature, &feature_lists_[key]);
+}
+
+absl::Status StreamingSequenceExampleWriter::AppendFeature(
+    const std::string& key, const tensorflow::Feature& feature,
+    FeatureListState* state) {
+  const int64 feature_size = feature.ByteSizeLong();
+  state->buffer.push_back(kField1Tag);
+  AppendVarint(feature_size, &state->buffer);
+  feature.AppendToString(&state->buffer);
+  state->byte_size += FieldSize(feature_size);
+  ++state->size;
+  if (state->head.feature_size() < kHeadSize || retained_keys_.count(key)) {
+    *state->head.add_feature() = feature;
+  }
+  if (state->buffer.size() >= chunk_bytes_) {
+    MP_RETURN_IF_ERROR(SpillBuffer(state));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status StreamingSequenceExampleWriter::SpillBuffer(
+    FeatureListState* state) {
+  if (state->buffer.empty()) return absl::OkStatus();
+  RET_CHECK_EQ(fseeko(spill_, spill_size_, SEEK_SET), 0);
+  RET_CHECK_EQ(fwrite(state->buffer.data(), 1, state->buffer.size(), spill_),
+               state->buffer.size())
+      << "Failed to write spill file " << spill_path_;
+  const int64 size = state->buffer.size();
+  // Entries appended in consecutive calls are usually adjacent in the file.
+  if (!state->chunks.empty() &&
+      state->chunks.back().offset + state->chunks.back().size == spill_size_) {
+    state->chunks.back().size += size;
+  } else {
+    state->chunks.push_back({spill_size_, size});
+  }
+  spill_size_ += size;
+  state->buffer.clear();
+  state->buffer.shrink_to_fit();
+  return absl::OkStatus();
+}
+
+absl::Status StreamingSequenceExampleWriter::MoveFeatureLists(
+    tensorflow::SequenceExample* sequence) {
+  for (const auto& key_value : sequence->feature_lists().feature_list()) {
+    FeatureListState* state = &feature_lists_[key_value.first];
+    for (const auto& feature : key_value.second.feature()) {
+      MP_RETURN_IF_ERROR(AppendFeature(key_value.first, feature, state));
+    }
+  }
+  sequence->mutable_feature_lists()->clear_feature_list();
+  return absl::OkStatus();
+}
+
+void StreamingSequenceExampleWriter::ClearFeatureLists(
+    absl::string_view key_prefix) {
+  for (auto it = feature_lists_.lower_bound(std::string(key_prefix));
+       it != feature_lists_.end() && absl::StartsWith(it->first, key_prefix);) {
+    it = feature_lists_.erase(it);
+  }
+}
+
+bool StreamingSequenceExampleWriter::HasFeatureList(
+    const std::string& key) const {
+  return feature_lists_.count(key) > 0;
+}
+
+int StreamingSequenceExampleWriter::FeatureListSize(
+    const std::string& key) const {
+  auto it = feature_lists_.find(key);
+  return it == feature_lists_.end() ? 0 : it->second.size;
+}
+
+tensorflow::FeatureLists StreamingSequenceExampleWriter::FeatureListsHead()
+    const {
+  tensorflow::FeatureLists head;
+  for (const auto& key_value : feature_lists_) {
+    (*head.mutable_feature_list())[key_value.first] = key_value.second.head;
+  }
+  return head;
+}
+
+int64 StreamingSequenceExampleWriter::FeatureListsEntrySize(
+    const std::string& key, const FeatureListState& state) const {
+  return FieldSize(key.size()) + FieldSize(state.byte_size);
+}
+
+int64 StreamingSequenceExampleWriter::FeatureListsByteSize() const {
+  int64 size = 0;
+  for (const auto& key_value : feature_lists_) {
+    size += FieldSize(FeatureListsEntrySize(key_value.first, key_value.second));
+  }
+  return size;
+}
+
+int64 StreamingSequenceExampleWriter::ByteSizeLong(
+    const tensorflow::Features& context) const {
+  int64 size = FieldSize(context.ByteSizeLong());
+  if (!feature_lists_.empty()) size += FieldSize(FeatureListsByteSize());
+  return size;
+}
+
+absl::Status StreamingSequenceExampleWriter::WriteTFRecord(
+    const tensorflow::Features& context, const std::string& path) {
+  for (auto& key_value : feature_lists_) {
+    MP_RETURN_IF_ERROR(SpillBuffer(&key_value.second));
+  }
+  const int64 record_size = ByteSizeLong(context);
+  RET_CHECK_LE(record_size, kMaxRecordBytes)
+      << "SequenceExample is too large to serialize: " << record_size;
+
+  FILE* file = fopen(path.c_str(), "wb");
+  RET_CHECK(file) << "Failed to open " << path;
+  std::unique_ptr<FILE, int (*)(FILE*)> closer(file, &fclose);
+
+  std::string header;
+  AppendFixed(record_size, sizeof(uint64), &header);
+  AppendFixed(TFRecordMaskedCrc32c(header), sizeof(uint32), &header);
+  RET_CHECK_EQ(fwrite(header.data(), 1, header.size(), file), header.size())
+      << "Failed to write " << path;
+
+  ChecksummedFile record(file);
+  std::string prefix;
+  prefix.push_back(kField1Tag);
+  AppendVarint(context.ByteSizeLong(), &prefix);
+  context.AppendToString(&prefix);
+  if (!feature_lists_.empty()) {
+    prefix.push_back(kField2Tag);
+    AppendVarint(FeatureListsByteSize(), &prefix);
+  }
+  MP_RETURN_IF_ERROR(record.Write(prefix));
+
+  std::string buffer;
+  for (const auto& key_value : feature_lists_) {
+    const FeatureListState& state = key_value.second;
+    std::string entry_header;
+    entry_header.push_back(kField1Tag);
+    AppendVarint(FeatureListsEntrySize(key_value.first, state), &entry_header);
+    entry_header.push_back(kField1Tag);
+    AppendVarint(key_value.first.size(), &entry_header);
+    entry_header.append(key_value.first);
+    entry_header.push_back(kField2Tag);
+    AppendVarint(state.byte_size, &entry_header);
+    MP_RETURN_IF_ERROR(record.Write(entry_header));
+
+    for (const Chunk& chunk : state.chunks) {
+      RET_CHECK_EQ(fseeko(spill_, chunk.offset, SEEK_SET), 0);
+      for (int64 done = 0; done < chunk.size;) {
+        const int64 size = std::min(chunk.size - done, chunk_bytes_);
+        buffer.resize(size);
+        RET_CHECK_EQ(fread(&buffer[0], 1, size, spill_), size)
+            << "Failed to read spill file " << spill_path_;
+        MP_RETURN_IF_ERROR(record.Write(buffer));
+        done += size;
+      }
+    }
+  }
+
+  std::string footer;
+  AppendFixed(MaskTFRecordCrc32c(record.crc()), sizeof(uint32), &footer);
+  RET_CHECK_EQ(fwrite(footer.data(), 1, footer.size(), file), footer.size())
+      << "Failed to write " << path;
+  RET_CHECK_EQ(fclose(closer.release()), 0) << "Failed to close " << path;
+  return absl::OkStatus();
+}
+
+}  // namespace mediasequence
+}  // namespace mediapipe
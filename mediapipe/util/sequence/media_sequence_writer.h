@@ -0,0 +1,148 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Incremental writing of MediaSequence tf.SequenceExamples to TFRecord files.
+//
+// StreamingSequenceExampleWriter moves feature list entries out of an
+// in-memory SequenceExample into a chunked spill file as they are produced,
+// and assembles the final TFRecord from the spill file, so neither the
+// feature lists nor the serialized example are ever held in memory:
+//
+//   ASSIGN_OR_RETURN(auto writer,
+//                    StreamingSequenceExampleWriter::Create(spill_path));
+//   for (...) {
+//     AddImageTimestamp(timestamp, &sequence);
+//     AddImageEncoded(encoded, &sequence);
+//     MP_RETURN_IF_ERROR(writer->MoveFeatureLists(&sequence));
+//   }
+//   MP_RETURN_IF_ERROR(writer->WriteTFRecord(sequence.context(), path));
+//
+// The record is byte-compatible with serializing the equivalent in-memory
+// SequenceExample, except that feature lists are written in key order.
+
+#ifndef MEDIAPIPE_UTIL_SEQUENCE_MEDIA_SEQUENCE_WRITER_H_
+#define MEDIAPIPE_UTIL_SEQUENCE_MEDIA_SEQUENCE_WRITER_H_
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+
+namespace mediapipe {
+namespace mediasequence {
+
+class StreamingSequenceExampleWriter {
+ public:
+  // Entries are buffered per feature list and written to the spill file in
+  // chunks of about `chunk_bytes`.
+  static constexpr int64 kDefaultChunkBytes = 1 << 20;
+  // Number of leading entries of each feature list kept in memory for
+  // FeatureListsHead().
+  static constexpr int kHeadSize = 2;
+
+  // Creates a writer spilling to `spill_path`, which is overwritten and
+  // deleted when the writer is destroyed.
+  static absl::StatusOr<std::unique_ptr<StreamingSequenceExampleWriter>>
+  Create(const std::string& spill_path, int64 chunk_bytes = kDefaultChunkBytes);
+  ~StreamingSequenceExampleWriter();
+
+  StreamingSequenceExampleWriter(const StreamingSequenceExampleWriter&) =
+      delete;
+  StreamingSequenceExampleWriter& operator=(
+      const StreamingSequenceExampleWriter&) = delete;
+
+  // Keeps a complete in-memory copy of the feature list `key`, e.g. the image
+  // timestamps that metadata reconciliation needs.
+  void RetainFeatureList(const std::string& key) { retained_keys_.insert(key); }
+
+  // Appends one entry to the feature list `key`.
+  absl::Status AddFeature(const std::string& key,
+                          const tensorflow::Feature& feature);
+
+  // Appends the entries of every feature list in `sequence` to the writer and
+  // removes the feature lists from `sequence`. Feature lists without entries
+  // are recorded as present.
+  absl::Status MoveFeatureLists(tensorflow::SequenceExample* sequence);
+
+  // Drops all feature lists whose keys start with `key_prefix`. Their spilled
+  // bytes stay in the spill file but are not written.
+  void ClearFeatureLists(absl::string_view key_prefix);
+
+  bool HasFeatureList(const std::string& key) const;
+  // Returns 0 for missing feature lists.
+  int FeatureListSize(const std::string& key) const;
+
+  // Returns the first kHeadSize entries of each feature list, and all entries
+  // of the retained feature lists.
+  tensorflow::FeatureLists FeatureListsHead() const;
+
+  // Returns the serialized size of the SequenceExample with `context` and the
+  // written feature lists.
+  int64 ByteSizeLong(const tensorflow::Features& context) const;
+
+  // Writes the SequenceExample with `context` and the written feature lists
+  // as a single TFRecord to `path`. The writer remains usable.
+  absl::Status WriteTFRecord(const tensorflow::Features& context,
+                             const std::string& path);
+
+ private:
+  // A contiguous run of serialized entries in the spill file.
+  struct Chunk {
+    int64 offset;
+    int64 size;
+  };
+  struct FeatureListState {
+    // Serialized FeatureList field 1 entries not yet spilled.
+    std::string buffer;
+    std::vector<Chunk> chunks;
+    // Total size of the serialized FeatureList.
+    int64 byte_size = 0;
+    int size = 0;
+    tensorflow::FeatureList head;
+  };
+
+  StreamingSequenceExampleWriter(const std::string& spill_path, FILE* spill,
+                                 int64 chunk_bytes);
+
+  absl::Status AppendFeature(const std::string& key,
+                             const tensorflow::Feature& feature,
+                             FeatureListState* state);
+  absl::Status SpillBuffer(FeatureListState* state);
+  // Size of the body of the FeatureLists map entry for `key`.
+  int64 FeatureListsEntrySize(const std::string& key,
+                              const FeatureListState& state) const;
+  int64 FeatureListsByteSize() const;
+
+  const std::string spill_path_;
+  FILE* spill_;
+  const int64 chunk_bytes_;
+  int64 spill_size_ = 0;
+  // Ordered so that the output is deterministic.
+  std::map<std::string, FeatureListState> feature_lists_;
+  absl::flat_hash_set<std::string> retained_keys_;
+};
+
+}  // namespace mediasequence
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_SEQUENCE_MEDIA_SEQUENCE_WRITER_H_
@@ -0,0 +1,171 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/sequence/media_sequence_writer.h"
+
+#include <cstdlib>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/util/sequence/media_sequence.h"
+#include "mediapipe/util/sequence/media_sequence_reader.h"
+#include "tensorflow/core/example/example.pb.h"
+
+namespace mediapipe {
+namespace mediasequence {
+namespace {
+
+std::string TestPath(const std::string& name) {
+  return absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+}
+
+std::unique_ptr<StreamingSequenceExampleWriter> CreateWriter(
+    const std::string& name, int64 chunk_bytes) {
+  auto status_or_writer =
+      StreamingSequenceExampleWriter::Create(TestPath(name), chunk_bytes);
+  MP_EXPECT_OK(status_or_writer);
+  return std::move(status_or_writer).value();
+}
+
+uint32 DecodeFixed32(absl::string_view data) {
+  uint32 value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+// Reads back a single-record TFRecord file, verifying both checksums.
+tensorflow::SequenceExample ReadTFRecord(const std::string& path) {
+  std::string contents;
+  MP_EXPECT_OK(file::GetContents(path, &contents));
+  tensorflow::SequenceExample sequence;
+  EXPECT_GT(contents.size(), 16);
+  if (contents.size() <= 16) return sequence;
+  EXPECT_EQ(TFRecordMaskedCrc32c(contents.substr(0, 8)),
+            DecodeFixed32(contents.substr(8, 4)));
+  const std::string record = contents.substr(12, contents.size() - 16);
+  EXPECT_EQ(TFRecordMaskedCrc32c(record),
+            DecodeFixed32(contents.substr(contents.size() - 4)));
+
+  auto shard = TFRecordShard::Open(path, /*write_index=*/false);
+  MP_EXPECT_OK(shard);
+  EXPECT_EQ(1, shard.value()->NumRecords());
+  EXPECT_EQ(record, shard.value()->GetRecord(0).value());
+  EXPECT_TRUE(sequence.ParseFromString(record));
+  return sequence;
+}
+
+// Compares feature lists entry by entry, since map serialization order is
+// unspecified.
+void ExpectSameFeatureLists(const tensorflow::FeatureLists& expected,
+                            const tensorflow::FeatureLists& actual) {
+  ASSERT_EQ(expected.feature_list_size(), actual.feature_list_size());
+  for (const auto& key_value : expected.feature_list()) {
+    ASSERT_TRUE(actual.feature_list().count(key_value.first))
+        << key_value.first;
+    EXPECT_THAT(actual.feature_list().at(key_value.first),
+                EqualsProto(key_value.second));
+  }
+}
+
+TEST(StreamingSequenceExampleWriterTest, MatchesInMemorySequence) {
+  // Small chunks so that feature lists span several interleaved chunks.
+  auto writer = CreateWriter("matches.spill", 64);
+  tensorflow::SequenceExample expected;
+  SetClipDataPath("clip.mp4", &expected);
+  tensorflow::SequenceExample pending;
+  SetClipDataPath("clip.mp4", &pending);
+  for (int i = 0; i < 50; ++i) {
+    for (auto* sequence : {&expected, &pending}) {
+      AddImageTimestamp(i * 1000, sequence);
+      AddImageEncoded(std::string(i * 7, 'a' + i % 26), sequence);
+      if (i % 3 == 0) {
+        AddFeatureTimestamp("FDENSE", i * 1000, sequence);
+        AddFeatureFloats("FDENSE", {static_cast<float>(i), 0.5f}, sequence);
+      }
+    }
+    MP_ASSERT_OK(writer->MoveFeatureLists(&pending));
+    EXPECT_EQ(0, pending.feature_lists().feature_list_size());
+  }
+  EXPECT_EQ(50, writer->FeatureListSize("image/encoded"));
+  EXPECT_EQ(17, writer->FeatureListSize("FDENSE/feature/floats"));
+  EXPECT_EQ(expected.ByteSizeLong(), writer->ByteSizeLong(pending.context()));
+
+  const std::string path = TestPath("matches.tfrecord");
+  MP_ASSERT_OK(writer->WriteTFRecord(pending.context(), path));
+  const tensorflow::SequenceExample actual = ReadTFRecord(path);
+  EXPECT_EQ("clip.mp4", GetClipDataPath(actual));
+  ExpectSameFeatureLists(expected.feature_lists(), actual.feature_lists());
+}
+
+TEST(StreamingSequenceExampleWriterTest, KeepsHeadAndRetainedLists) {
+  auto writer = CreateWriter("head.spill", 1 << 10);
+  writer->RetainFeatureList("image/timestamp");
+  tensorflow::SequenceExample sequence;
+  for (int i = 0; i < 10; ++i) {
+    AddImageTimestamp(i, &sequence);
+    AddImageEncoded(absl::StrCat("image_", i), &sequence);
+    MP_ASSERT_OK(writer->MoveFeatureLists(&sequence));
+  }
+
+  tensorflow::SequenceExample head;
+  *head.mutable_feature_lists() = writer->FeatureListsHead();
+  ASSERT_EQ(10, GetImageTimestampSize(head));
+  EXPECT_EQ(9, GetImageTimestampAt(head, 9));
+  ASSERT_EQ(StreamingSequenceExampleWriter::kHeadSize,
+            GetImageEncodedSize(head));
+  EXPECT_EQ("image_1", GetImageEncodedAt(head, 1));
+}
+
+TEST(StreamingSequenceExampleWriterTest, ClearsFeatureListsByPrefix) {
+  auto writer = CreateWriter("clear.spill", 16);
+  tensorflow::SequenceExample sequence;
+  AddImageEncoded("image", &sequence);
+  AddFeatureTimestamp("A", 1, &sequence);
+  AddFeatureFloats("A", {1.0f}, &sequence);
+  AddFeatureTimestamp("B", 2, &sequence);
+  MP_ASSERT_OK(writer->MoveFeatureLists(&sequence));
+
+  writer->ClearFeatureLists("A/");
+  EXPECT_FALSE(writer->HasFeatureList("A/feature/timestamp"));
+  EXPECT_FALSE(writer->HasFeatureList("A/feature/floats"));
+  EXPECT_TRUE(writer->HasFeatureList("B/feature/timestamp"));
+
+  const std::string path = TestPath("clear.tfrecord");
+  MP_ASSERT_OK(writer->WriteTFRecord(sequence.context(), path));
+  const tensorflow::SequenceExample actual = ReadTFRecord(path);
+  EXPECT_EQ(2, actual.feature_lists().feature_list_size());
+  EXPECT_EQ("image", GetImageEncodedAt(actual, 0));
+  EXPECT_EQ(2, GetFeatureTimestampAt("B", actual, 0));
+}
+
+TEST(StreamingSequenceExampleWriterTest, WritesContextOnlySequence) {
+  auto writer = CreateWriter("context_only.spill", 16);
+  tensorflow::SequenceExample sequence;
+  SetClipDataPath("clip.mp4", &sequence);
+  const std::string path = TestPath("context_only.tfrecord");
+  MP_ASSERT_OK(writer->WriteTFRecord(sequence.context(), path));
+  const tensorflow::SequenceExample actual = ReadTFRecord(path);
+  EXPECT_EQ("clip.mp4", GetClipDataPath(actual));
+  EXPECT_EQ(0, actual.feature_lists().feature_list_size());
+}
+
+}  // namespace
+}  // namespace mediasequence
+}  // namespace mediapipe
@@ -0,0 +1,355 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Microbenchmarks for the hot kernels of util/tracking. They run on fixtures
+// that need no video decoding: frame pairs cropped from
+// testdata/stabilize_test.png at several resolutions, the
+// RegionFlowFeatureLists tracked between them, and the TrackingData recorded
+// in testdata/box_tracker. Results are therefore comparable across changes
+// and machines with the same build settings.
+//
+//   bazel run -c opt mediapipe/util/tracking:tracking_benchmark -- \
+//     --benchmark_filter=MotionEstimation
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_highgui_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/vector.h"
+#include "mediapipe/util/tracking/flow_packager.h"
+#include "mediapipe/util/tracking/flow_packager.pb.h"
+#include "mediapipe/util/tracking/motion_estimation.h"
+#include "mediapipe/util/tracking/push_pull_filtering.h"
+#include "mediapipe/util/tracking/region_flow.h"
+#include "mediapipe/util/tracking/region_flow.pb.h"
+#include "mediapipe/util/tracking/region_flow_computation.h"
+#include "mediapipe/util/tracking/tracking.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr char kTestDataDir[] = "mediapipe/util/tracking/testdata";
+
+// Border cropped around each frame, and the displacement of the second frame
+// of a pair within it.
+constexpr int kBorder = 20;
+constexpr int kShiftX = 7;
+constexpr int kShiftY = 4;
+
+constexpr int64 kFrameDurationUsec = 33333;
+
+// A pair of grayscale frames and the features tracked from the first to the
+// second one.
+struct FlowFixture {
+  cv::Mat frames[2];
+  RegionFlowFeatureList features;
+};
+
+RegionFlowComputationOptions FlowOptions(int max_features) {
+  RegionFlowComputationOptions options;
+  options.set_image_format(RegionFlowComputationOptions::FORMAT_GRAYSCALE);
+  options.mutable_tracking_options()->set_max_features(max_features);
+  return options;
+}
+
+const cv::Mat& SourceImage() {
+  static const cv::Mat* image = []() {
+    std::string png_data;
+    MEDIAPIPE_CHECK_OK(file::GetContents(
+        file::JoinPath("./", kTestDataDir, "stabilize_test.png"), &png_data));
+    std::vector<char> buffer(png_data.begin(), png_data.end());
+    cv::Mat* result = new cv::Mat(cv::imdecode(cv::Mat(buffer), 1));
+    CHECK(!result->empty());
+    return result;
+  }();
+  return *image;
+}
+
+// Returns the fixture for a resolution and feature budget, computed on first
+// use and then shared by all benchmarks.
+const FlowFixture& GetFlowFixture(int width, int height, int max_features) {
+  static auto* fixtures =
+      new std::map<std::tuple<int, int, int>, std::unique_ptr<FlowFixture>>();
+  auto& fixture = (*fixtures)[std::make_tuple(width, height, max_features)];
+  if (fixture != nullptr) {
+    return *fixture;
+  }
+  fixture = absl::make_unique<FlowFixture>();
+
+  cv::Mat resized;
+  cv::resize(SourceImage(), resized,
+             cv::Size(width + 2 * kBorder, height + 2 * kBorder));
+  cv::Mat gray;
+  // imdecode returns BGR.
+  cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
+  fixture->frames[0] =
+      gray(cv::Rect(kBorder, kBorder, width, height)).clone();
+  fixture->frames[1] =
+      gray(cv::Rect(kBorder + kShiftX, kBorder + kShiftY, width, height))
+          .clone();
+
+  RegionFlowComputation flow_computation(FlowOptions(max_features), width,
+                                         height);
+  flow_computation.AddImage(fixture->frames[0], 0);
+  flow_computation.AddImage(fixture->frames[1], kFrameDurationUsec);
+  std::unique_ptr<RegionFlowFeatureList> features(
+      flow_computation.RetrieveRegionFlowFeatureList(
+          false,  // No feature descriptor.
+          false,  // No match descriptor.
+          nullptr, nullptr));
+  fixture->features = *features;
+  return *fixture;
+}
+
+// The items of all recorded TrackingDataChunks, in order.
+const std::vector<TrackingDataChunk::Item>& RecordedTrackingData() {
+  static const auto* items = []() {
+    auto* result = new std::vector<TrackingDataChunk::Item>();
+    for (int chunk_idx = 0;; ++chunk_idx) {
+      std::string data;
+      const std::string chunk_file =
+          file::JoinPath("./", kTestDataDir, "box_tracker",
+                         absl::StrFormat("chunk_%04d", chunk_idx));
+      if (!file::GetContents(chunk_file, &data).ok()) {
+        break;
+      }
+      TrackingDataChunk chunk;
+      CHECK(chunk.ParseFromString(data)) << chunk_file;
+      result->insert(result->end(), chunk.item().begin(), chunk.item().end());
+    }
+    CHECK(!result->empty()) << "No recorded tracking data found.";
+    return result;
+  }();
+  return *items;
+}
+
+// Resolutions from QVGA to 720p, each with a small, medium and the default
+// feature budget.
+void FlowArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"width", "height", "max_features"});
+  for (const auto& size : std::vector<std::pair<int, int>>{
+           {320, 240}, {640, 480}, {1280, 720}}) {
+    for (int max_features : {250, 1000, 2000}) {
+      benchmark->Args({size.first, size.second, max_features});
+    }
+  }
+}
+
+void SetFeatureCounter(const RegionFlowFeatureList& features,
+                       benchmark::State& state) {
+  state.counters["features"] = features.feature_size();
+}
+
+void BM_RegionFlowComputationAddImage(benchmark::State& state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const FlowFixture& fixture = GetFlowFixture(width, height, state.range(2));
+  RegionFlowComputation flow_computation(FlowOptions(state.range(2)), width,
+                                         height);
+  int64 frame = 0;
+  for (auto _ : state) {
+    // Alternating the frames moves the content back and forth.
+    flow_computation.AddImage(fixture.frames[frame % 2],
+                              frame * kFrameDurationUsec);
+    std::unique_ptr<RegionFlowFeatureList> features(
+        flow_computation.RetrieveRegionFlowFeatureList(false, false, nullptr,
+                                                       nullptr));
+    benchmark::DoNotOptimize(features.get());
+    ++frame;
+  }
+  state.SetItemsProcessed(state.iterations());
+  SetFeatureCounter(fixture.features, state);
+}
+BENCHMARK(BM_RegionFlowComputationAddImage)->Apply(FlowArguments);
+
+// The full IRLS cascade, from translation to mixture homographies.
+void BM_MotionEstimationIrls(benchmark::State& state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const FlowFixture& fixture = GetFlowFixture(width, height, state.range(2));
+  MotionEstimation motion_estimation(MotionEstimationOptions(), width, height);
+  for (auto _ : state) {
+    // Estimation updates the IRLS weights of the features.
+    state.PauseTiming();
+    RegionFlowFeatureList features = fixture.features;
+    std::vector<RegionFlowFeatureList*> feature_lists = {&features};
+    std::vector<CameraMotion> camera_motions;
+    state.ResumeTiming();
+    motion_estimation.EstimateMotionsParallel(
+        false,  // No post IRLS weight smoothing.
+        &feature_lists, &camera_motions);
+    benchmark::DoNotOptimize(camera_motions.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+  SetFeatureCounter(fixture.features, state);
+}
+BENCHMARK(BM_MotionEstimationIrls)->Apply(FlowArguments);
+
+// A single IRLS homography fit, on normalized features.
+void BM_MotionEstimationHomography(benchmark::State& state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const FlowFixture& fixture = GetFlowFixture(width, height, state.range(2));
+  RegionFlowFeatureList normalized = fixture.features;
+  NormalizeRegionFlowFeatureList(&normalized);
+  MotionEstimation motion_estimation(MotionEstimationOptions(), width, height);
+  for (auto _ : state) {
+    state.PauseTiming();
+    RegionFlowFeatureList features = normalized;
+    CameraMotion camera_motion;
+    state.ResumeTiming();
+    motion_estimation.EstimateHomography(&features, &camera_motion);
+    benchmark::DoNotOptimize(camera_motion);
+  }
+  state.SetItemsProcessed(state.iterations());
+  SetFeatureCounter(fixture.features, state);
+}
+BENCHMARK(BM_MotionEstimationHomography)->Apply(FlowArguments);
+
+// Densifies the IRLS weights of the features over the frame, as done for
+// foreground saliency in MotionAnalysis.
+void BM_PushPullFiltering(benchmark::State& state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const FlowFixture& fixture = GetFlowFixture(width, height, state.range(2));
+  std::vector<Vector2_f> locations;
+  std::vector<cv::Vec<float, 1>> values;
+  for (const auto& feature : fixture.features.feature()) {
+    locations.push_back(FeatureLocation(feature));
+    values.push_back(cv::Vec<float, 1>(feature.irls_weight()));
+  }
+  PushPullFilteringC1 push_pull(cv::Size(width, height),
+                                PushPullFilteringC1::BINOMIAL_5X5, false,
+                                nullptr,    // Gaussian filter weights only.
+                                nullptr,    // No mip map visualizer.
+                                nullptr);  // No weight adjustment.
+  cv::Mat result(height + 4, width + 4, CV_32FC2);
+  for (auto _ : state) {
+    push_pull.PerformPushPull(locations, values, 0.2, cv::Point2i(0, 0),
+                              0,        // Default read out level.
+                              nullptr,  // Uniform weights.
+                              nullptr,  // No bilateral term.
+                              &result);
+  }
+  state.SetItemsProcessed(state.iterations());
+  SetFeatureCounter(fixture.features, state);
+}
+BENCHMARK(BM_PushPullFiltering)->Apply(FlowArguments);
+
+void BM_FlowPackagerPackFlow(benchmark::State& state) {
+  const FlowFixture& fixture =
+      GetFlowFixture(state.range(0), state.range(1), state.range(2));
+  FlowPackager flow_packager((FlowPackagerOptions()));
+  for (auto _ : state) {
+    TrackingData tracking_data;
+    flow_packager.PackFlow(fixture.features, nullptr, &tracking_data);
+    benchmark::DoNotOptimize(tracking_data);
+  }
+  state.SetItemsProcessed(state.iterations());
+  SetFeatureCounter(fixture.features, state);
+}
+BENCHMARK(BM_FlowPackagerPackFlow)->Apply(FlowArguments);
+
+void BM_FlowPackagerEncode(benchmark::State& state) {
+  const auto& items = RecordedTrackingData();
+  FlowPackager flow_packager((FlowPackagerOptions()));
+  for (auto _ : state) {
+    for (const auto& item : items) {
+      BinaryTrackingData binary_data;
+      flow_packager.EncodeTrackingData(item.tracking_data(), &binary_data);
+      benchmark::DoNotOptimize(binary_data);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * items.size());
+}
+BENCHMARK(BM_FlowPackagerEncode);
+
+void BM_FlowPackagerDecode(benchmark::State& state) {
+  const auto& items = RecordedTrackingData();
+  FlowPackager flow_packager((FlowPackagerOptions()));
+  std::vector<BinaryTrackingData> encoded(items.size());
+  int64 num_bytes = 0;
+  for (int i = 0; i < items.size(); ++i) {
+    flow_packager.EncodeTrackingData(items[i].tracking_data(), &encoded[i]);
+    num_bytes += encoded[i].data().size();
+  }
+  for (auto _ : state) {
+    for (const auto& binary_data : encoded) {
+      TrackingData tracking_data;
+      flow_packager.DecodeTrackingData(binary_data, &tracking_data);
+      benchmark::DoNotOptimize(tracking_data);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * items.size());
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+BENCHMARK(BM_FlowPackagerDecode);
+
+// Tracks the overlay of the recording forward over all frames, as
+// BoxTracker does.
+void BM_MotionBoxTrackStep(benchmark::State& state) {
+  const auto& items = RecordedTrackingData();
+  std::vector<MotionVectorFrame> motion_vectors(items.size() - 1);
+  for (int f = 0; f + 1 < items.size(); ++f) {
+    MotionVectorFrame mvf;
+    MotionVectorFrameFromTrackingData(items[f + 1].tracking_data(), &mvf);
+    const int track_duration_ms = TrackingDataDurationMs(items[f + 1]);
+    if (track_duration_ms > 0) {
+      mvf.duration_ms = track_duration_ms;
+    }
+    InvertMotionVectorFrame(mvf, &motion_vectors[f]);
+  }
+
+  // The initial position of the overlay in the 1280x720 recording.
+  MotionBoxState start_state;
+  start_state.set_pos_x(50.0f / 1280);
+  start_state.set_pos_y(100.0f / 720);
+  start_state.set_width(220.0f / 1280);
+  start_state.set_height(252.0f / 720);
+
+  int64 num_steps = 0;
+  for (auto _ : state) {
+    MotionBox motion_box((TrackStepOptions()));
+    motion_box.ResetAtFrame(0, start_state);
+    for (int f = 0; f < motion_vectors.size(); ++f) {
+      if (!motion_box.TrackStep(f, motion_vectors[f], /*forward=*/true)) {
+        break;
+      }
+      ++num_steps;
+    }
+  }
+  state.SetItemsProcessed(num_steps);
+}
+BENCHMARK(BM_MotionBoxTrackStep);
+
+}  // namespace
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}